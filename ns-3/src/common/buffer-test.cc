@@ -321,6 +321,98 @@ BufferTest::DoRun (void)
   return GetErrorStatus ();
 }
 //-----------------------------------------------------------------------------
+class BufferPoolTest : public TestCase {
+private:
+  void Release (struct Buffer::Data *data);
+  uint32_t CountCached (void);
+public:
+  virtual bool DoRun (void);
+  BufferPoolTest ();
+};
+
+BufferPoolTest::BufferPoolTest ()
+  : TestCase ("Buffer pool") {
+}
+
+void
+BufferPoolTest::Release (struct Buffer::Data *data)
+{
+  // as the last Buffer referencing data does
+  if (Buffer::UnrefData (data))
+    {
+      Buffer::Recycle (data);
+    }
+}
+
+uint32_t
+BufferPoolTest::CountCached (void)
+{
+  uint32_t cached = 0;
+  for (uint32_t sc = 0; sc < Buffer::POOL_SIZE_CLASSES; sc++)
+    {
+      cached += Buffer::g_poolCount[sc];
+    }
+  return cached;
+}
+
+bool
+BufferPoolTest::DoRun (void)
+{
+  Buffer::EnablePool (true);
+
+  // size classes are the powers of two from 64 to 8192 bytes
+  NS_TEST_ASSERT_MSG_EQ (Buffer::GetSizeClass (1), 0, "1 byte is in the smallest class");
+  NS_TEST_ASSERT_MSG_EQ (Buffer::GetSizeClass (64), 0, "64 bytes are in the smallest class");
+  NS_TEST_ASSERT_MSG_EQ (Buffer::GetSizeClass (65), 1, "65 bytes are rounded up to 128");
+  NS_TEST_ASSERT_MSG_EQ (Buffer::GetSizeClass (8192), 7, "8192 bytes are in the largest class");
+  NS_TEST_ASSERT_MSG_EQ (Buffer::GetSizeClass (8193), -1, "8193 bytes are in no class");
+  struct Buffer::Data *data = Buffer::Create (100);
+  NS_TEST_ASSERT_MSG_EQ (data->m_size, 128U, "100 bytes were not rounded up to their class");
+
+  // a released array is handed out again for the next request of its class
+  uint32_t cached = Buffer::g_poolCount[1];
+  Release (data);
+  NS_TEST_ASSERT_MSG_EQ (Buffer::g_poolCount[1], cached + 1, "The released array was not kept");
+  struct Buffer::Data *other = Buffer::Create (65);
+  NS_TEST_ASSERT_MSG_EQ (other, data, "The array of the same class was not reused");
+  NS_TEST_ASSERT_MSG_EQ (other->m_count, 1U, "The reused array is not referenced once");
+  NS_TEST_ASSERT_MSG_EQ (other->m_size, 128U, "The reused array lost its size");
+  struct Buffer::Data *larger = Buffer::Create (200);
+  NS_TEST_ASSERT_MSG_NE (larger, other, "The array of a smaller class was handed out");
+  Release (larger);
+  Release (other);
+  {
+    Buffer buffer;
+    buffer.AddAtStart (100);
+    data = buffer.m_data;
+  }
+  {
+    Buffer buffer;
+    buffer.AddAtStart (90);
+    NS_TEST_ASSERT_MSG_EQ (buffer.m_data, data, "The array of a destroyed buffer was not reused");
+  }
+
+  // arrays above the largest class go to the heap
+  cached = CountCached ();
+  data = Buffer::Create (10000);
+  NS_TEST_ASSERT_MSG_EQ (data->m_size, 10000U, "A large array was rounded up");
+  Release (data);
+  NS_TEST_ASSERT_MSG_EQ (CountCached (), cached, "A large array was kept");
+
+  // no pool once buffers are shared between threads
+  Buffer::EnableThreadSafety ();
+  NS_TEST_ASSERT_MSG_EQ (CountCached (), 0U, "The cached arrays were not released");
+  Buffer::EnablePool (true);
+  NS_TEST_ASSERT_MSG_EQ (Buffer::g_poolEnabled, false, "The pool was turned on with thread safety");
+  data = Buffer::Create (100);
+  NS_TEST_ASSERT_MSG_EQ (data->m_size, 100U, "An array was rounded up without the pool");
+  Release (data);
+  NS_TEST_ASSERT_MSG_EQ (CountCached (), 0U, "An array was kept without the pool");
+  Buffer::g_threadSafe = false;
+
+  return GetErrorStatus ();
+}
+//-----------------------------------------------------------------------------
 class BufferTestSuite : public TestSuite
 {
 public:
@@ -331,6 +423,7 @@ BufferTestSuite::BufferTestSuite ()
   : TestSuite ("buffer", UNIT)
 {
   AddTestCase (new BufferTest);
+  AddTestCase (new BufferPoolTest);
 }
 
 BufferTestSuite g_bufferTestSuite;
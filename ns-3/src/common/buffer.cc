@@ -47,108 +47,108 @@ namespace ns3 {
 
 
 uint32_t Buffer::g_recommendedStart = 0;
-#ifdef BUFFER_FREE_LIST
-/* The following macros are pretty evil but they are needed to allow us to
- * keep track of 3 possible states for the g_freeList variable:
- *  - uninitialized means that no one has created a buffer yet
- *    so no one has created the associated free list (it is created
- *    on-demand when the first buffer is created)
- *  - initialized means that the free list exists and is valid
- *  - destroyed means that the static destructors of this compilation unit
- *    have run so, the free list has been cleared from its content
- * The key is that in destroyed state, we are careful not re-create it
- * which is a typical weakness of lazy evaluation schemes which use 
- * '0' as a special value to indicate both un-initialized and destroyed.
- * Note that it is important to use '0' as the marker for un-initialized state
- * because the variable holding this state information is initialized to zero
- * which the compiler assigns to zero-memory which is initialized to _zero_
- * before the constructors run so this ensures perfect handling of crazy 
- * constructor orderings.
+bool Buffer::g_poolEnabled = false;
+/* The free lists are intrusive: the first bytes of a recycled
+ * Buffer::Data hold the pointer to the next free block. This keeps
+ * the pool usable from static destructors which release buffers after
+ * any container-based list would have been destroyed.
  */
-#define MAGIC_DESTROYED (~(long) 0)
-#define IS_UNINITIALIZED(x) (x == (Buffer::FreeList*)0)
-#define IS_DESTROYED(x) (x == (Buffer::FreeList*)MAGIC_DESTROYED)
-#define IS_INITIALIZED(x) (!IS_UNINITIALIZED(x) && !IS_DESTROYED(x))
-#define DESTROYED ((Buffer::FreeList*)MAGIC_DESTROYED)
-#define UNINITIALIZED ((Buffer::FreeList*)0)
-uint32_t Buffer::g_maxSize = 0;
-Buffer::FreeList *Buffer::g_freeList = 0;
-struct Buffer::LocalStaticDestructor Buffer::g_localStaticDestructor;
-
-Buffer::LocalStaticDestructor::~LocalStaticDestructor(void)
+struct Buffer::FreeBlock *Buffer::g_pool[POOL_SIZE_CLASSES];
+uint32_t Buffer::g_poolCount[POOL_SIZE_CLASSES];
+bool Buffer::g_threadSafe = false;
+
+int32_t
+Buffer::GetSizeClass (uint32_t size)
 {
-  if (IS_INITIALIZED(g_freeList))
+  for (int32_t sc = 0; sc < (int32_t)POOL_SIZE_CLASSES; sc++)
     {
-      for (Buffer::FreeList::iterator i = g_freeList->begin ();
-           i != g_freeList->end (); i++)
+      if (size <= (POOL_MIN_SIZE << sc))
         {
-          Buffer::Deallocate (*i);
+          return sc;
         }
-      delete g_freeList;
-      g_freeList = DESTROYED;
     }
+  return -1;
 }
 
 void
-Buffer::Recycle (struct Buffer::Data *data)
-{
-  NS_ASSERT (data->m_count == 0);
-  NS_ASSERT (!IS_UNINITIALIZED(g_freeList));
-  g_maxSize = std::max (g_maxSize, data->m_size);
-  /* feed into free list */
-  if (data->m_size < g_maxSize ||
-      IS_DESTROYED(g_freeList) ||
-      g_freeList->size () > 1000)
-    {
-      Buffer::Deallocate (data);
-    }
-  else
-    {
-      NS_ASSERT (IS_INITIALIZED(g_freeList));
-      g_freeList->push_back (data);
-    }
-}
-
-Buffer::Data *
-Buffer::Create (uint32_t dataSize)
+Buffer::EnablePool (bool enable)
 {
-  /* try to find a buffer correctly sized. */
-  if (IS_UNINITIALIZED(g_freeList))
+  if (enable && g_threadSafe)
     {
-      g_freeList = new Buffer::FreeList ();
+      NS_LOG_WARN ("The buffer pool is not thread-safe, it stays off");
+      return;
     }
-  else if (IS_INITIALIZED(g_freeList))
+  g_poolEnabled = enable;
+  if (!enable)
     {
-      while (!g_freeList->empty ()) 
+      for (uint32_t sc = 0; sc < POOL_SIZE_CLASSES; sc++)
         {
-          struct Buffer::Data *data = g_freeList->back ();
-          g_freeList->pop_back ();
-          if (data->m_size >= dataSize) 
+          while (g_pool[sc] != 0)
             {
-              data->m_count = 1;
-              return data;
+              struct FreeBlock *block = g_pool[sc];
+              g_pool[sc] = block->m_next;
+              struct Buffer::Data *data = reinterpret_cast<struct Buffer::Data *> (block);
+              data->m_count = 0;
+              Buffer::Deallocate (data);
             }
-          Buffer::Deallocate (data);
+          g_poolCount[sc] = 0;
         }
     }
-  struct Buffer::Data *data = Buffer::Allocate (dataSize);
-  NS_ASSERT (data->m_count == 1);
-  return data;
 }
-#else /* BUFFER_FREE_LIST */
+
+void
+Buffer::EnableThreadSafety (void)
+{
+  EnablePool (false);
+  g_threadSafe = true;
+}
+
 void
 Buffer::Recycle (struct Buffer::Data *data)
 {
   NS_ASSERT (data->m_count == 0);
-  Deallocate (data);
+  int32_t sc = GetSizeClass (data->m_size);
+  /* only blocks which were allocated with the exact size of a class
+   * can be handed out again for any request of that class.
+   */
+  if (!g_poolEnabled || sc < 0 ||
+      data->m_size != (POOL_MIN_SIZE << sc) ||
+      g_poolCount[sc] >= POOL_MAX_FREE)
+    {
+      Buffer::Deallocate (data);
+      return;
+    }
+  struct FreeBlock *block = reinterpret_cast<struct FreeBlock *> (data);
+  block->m_next = g_pool[sc];
+  g_pool[sc] = block;
+  g_poolCount[sc]++;
 }
 
 Buffer::Data *
-Buffer::Create (uint32_t size)
+Buffer::Create (uint32_t dataSize)
 {
-  return Allocate (size);
+  if (!g_poolEnabled)
+    {
+      return Buffer::Allocate (dataSize);
+    }
+  int32_t sc = GetSizeClass (dataSize);
+  if (sc < 0)
+    {
+      return Buffer::Allocate (dataSize);
+    }
+  if (g_pool[sc] != 0)
+    {
+      struct FreeBlock *block = g_pool[sc];
+      g_pool[sc] = block->m_next;
+      g_poolCount[sc]--;
+      struct Buffer::Data *data = reinterpret_cast<struct Buffer::Data *> (block);
+      data->m_size = POOL_MIN_SIZE << sc;
+      data->m_count = 1;
+      return data;
+    }
+  /* round up to the class size so that the block can be recycled. */
+  return Buffer::Allocate (POOL_MIN_SIZE << sc);
 }
-#endif /* BUFFER_FREE_LIST */
 
 struct Buffer::Data *
 Buffer::Allocate (uint32_t reqSize)
@@ -251,13 +251,12 @@ Buffer::operator = (Buffer const&o)
   if (m_data != o.m_data) 
     {
       // not assignment to self.
-      m_data->m_count--;
-      if (m_data->m_count == 0) 
+      if (UnrefData (m_data))
         {
           Recycle (m_data);
         }
       m_data = o.m_data;
-      m_data->m_count++;
+      RefData (m_data);
     }
   g_recommendedStart = std::max (g_recommendedStart, m_maxZeroAreaStart);
   m_maxZeroAreaStart = o.m_maxZeroAreaStart;
@@ -274,8 +273,7 @@ Buffer::~Buffer ()
   NS_LOG_FUNCTION (this);
   NS_ASSERT (CheckInternalState ());
   g_recommendedStart = std::max (g_recommendedStart, m_maxZeroAreaStart);
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
+  if (UnrefData (m_data))
     {
       Recycle (m_data);
     }
@@ -317,8 +315,7 @@ Buffer::AddAtStart (uint32_t start)
       uint32_t newSize = GetInternalSize () + start;
       struct Buffer::Data *newData = Buffer::Create (newSize);
       memcpy (newData->m_data + start, m_data->m_data + m_start, GetInternalSize ());
-      m_data->m_count--;
-      if (m_data->m_count == 0)
+      if (UnrefData (m_data))
         {
           Buffer::Recycle (m_data);
         }
@@ -370,8 +367,7 @@ Buffer::AddAtEnd (uint32_t end)
       uint32_t newSize = GetInternalSize () + end;
       struct Buffer::Data *newData = Buffer::Create (newSize);
       memcpy (newData->m_data, m_data->m_data + m_start, GetInternalSize ());
-      m_data->m_count--;
-      if (m_data->m_count == 0) 
+      if (UnrefData (m_data))
         {
           Buffer::Recycle (m_data);
         }
@@ -25,8 +25,6 @@
 #include <ostream>
 #include "ns3/assert.h"
 
-#define noBUFFER_FREE_LIST 1
-
 namespace ns3 {
 
 /**
@@ -527,6 +525,26 @@ private:
   Buffer (uint32_t dataSize);
   Buffer (uint32_t dataSize, bool initialize);
   ~Buffer ();
+
+  /**
+   * \param enable true to recycle the memory of released buffers.
+   *
+   * By default, the byte array of every buffer is allocated from and
+   * released to the heap. When the pool is enabled, arrays of up to
+   * 8192 bytes are rounded up to a power-of-two size class and kept on
+   * a per-class free list when their last reference is dropped, to be
+   * handed out again to the next buffer of that class. Disabling the
+   * pool releases all cached arrays. The pool stays off once
+   * EnableThreadSafety was called.
+   */
+  static void EnablePool (bool enable);
+  /**
+   * Make the reference counts of the byte arrays shared by buffers
+   * atomic, so that buffers referencing the same array can be copied
+   * and released from different threads. This turns the pool off.
+   * Used by Packet::EnableThreadSafety.
+   */
+  static void EnableThreadSafety (void);
 private:
   /**
    * This data structure is variable-sized through its last member whose size
@@ -574,6 +592,9 @@ private:
   static struct Buffer::Data *Create (uint32_t size);
   static struct Buffer::Data *Allocate (uint32_t reqSize);
   static void Deallocate (struct Buffer::Data *data);
+  static inline void RefData (struct Buffer::Data *data);
+  /* returns true when the last reference to data was dropped. */
+  static inline bool UnrefData (struct Buffer::Data *data);
   
   struct Data *m_data;
 
@@ -611,16 +632,24 @@ private:
    */
   uint32_t m_end;
 
-#ifdef BUFFER_FREE_LIST
-  typedef std::vector<struct Buffer::Data*> FreeList;
-  struct LocalStaticDestructor 
+  /* smallest size class of the pool, the largest is
+   * POOL_MIN_SIZE << (POOL_SIZE_CLASSES - 1).
+   */
+  static const uint32_t POOL_MIN_SIZE = 64;
+  static const uint32_t POOL_SIZE_CLASSES = 8;
+  /* maximum number of free arrays kept per size class. */
+  static const uint32_t POOL_MAX_FREE = 1000;
+  struct FreeBlock
   {
-    ~LocalStaticDestructor ();
+    struct FreeBlock *m_next;
   };
-  static uint32_t g_maxSize;
-  static FreeList *g_freeList;
-  static struct LocalStaticDestructor g_localStaticDestructor;
-#endif
+  static int32_t GetSizeClass (uint32_t size);
+  static bool g_poolEnabled;
+  static struct FreeBlock *g_pool[POOL_SIZE_CLASSES];
+  static uint32_t g_poolCount[POOL_SIZE_CLASSES];
+  static bool g_threadSafe;
+
+  friend class BufferPoolTest;
 };
 
 } // namespace ns3
@@ -859,10 +888,34 @@ Buffer::Buffer (Buffer const&o)
     m_start (o.m_start),
     m_end (o.m_end)
 {
-  m_data->m_count++;
+  RefData (m_data);
   NS_ASSERT (CheckInternalState ());
 }
 
+void
+Buffer::RefData (struct Buffer::Data *data)
+{
+  if (g_threadSafe)
+    {
+      __sync_fetch_and_add (&data->m_count, 1);
+    }
+  else
+    {
+      data->m_count++;
+    }
+}
+
+bool
+Buffer::UnrefData (struct Buffer::Data *data)
+{
+  if (g_threadSafe)
+    {
+      return __sync_sub_and_fetch (&data->m_count, 1) == 0;
+    }
+  data->m_count--;
+  return data->m_count == 0;
+}
+
 uint32_t 
 Buffer::GetSize (void) const
 {
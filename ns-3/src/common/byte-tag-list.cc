@@ -37,6 +37,33 @@ struct ByteTagListData {
   uint8_t data[4];
 };
 
+static bool g_threadSafe = false;
+
+static void
+RefData (struct ByteTagListData *data)
+{
+  if (g_threadSafe)
+    {
+      __sync_fetch_and_add (&data->count, 1);
+    }
+  else
+    {
+      data->count++;
+    }
+}
+
+// returns true when the last reference to data was dropped
+static bool
+UnrefData (struct ByteTagListData *data)
+{
+  if (g_threadSafe)
+    {
+      return __sync_sub_and_fetch (&data->count, 1) == 0;
+    }
+  data->count--;
+  return data->count == 0;
+}
+
 #ifdef USE_FREE_LIST
 static class ByteTagListDataFreeList : public std::vector<struct ByteTagListData *>
 {
@@ -129,7 +156,7 @@ ByteTagList::ByteTagList (const ByteTagList &o)
   NS_LOG_FUNCTION (this << &o);
   if (m_data != 0)
     {
-      m_data->count++;
+      RefData (m_data);
     }
 }
 ByteTagList &
@@ -146,7 +173,7 @@ ByteTagList::operator = (const ByteTagList &o)
   m_used = o.m_used;
   if (m_data != 0)
     {
-      m_data->count++;
+      RefData (m_data);
     }
   return *this;
 }
@@ -333,13 +360,20 @@ ByteTagList::AddAtStart (int32_t adjustment, int32_t prependOffset)
   *this = list;
 }
 
+void
+ByteTagList::EnableThreadSafety (void)
+{
+  g_threadSafe = true;
+}
+
 #ifdef USE_FREE_LIST
 
 struct ByteTagListData *
 ByteTagList::Allocate (uint32_t size)
 {
   NS_LOG_FUNCTION (this << size);
-  while (!g_freeList.empty ())
+  // the free list and the size heuristic are shared by all threads
+  while (!g_threadSafe && !g_freeList.empty ())
     {
       struct ByteTagListData *data = g_freeList.back ();
       g_freeList.pop_back ();
@@ -353,7 +387,8 @@ ByteTagList::Allocate (uint32_t size)
       uint8_t *buffer = (uint8_t *)data;
       delete [] buffer;
     }
-  uint8_t *buffer = new uint8_t [std::max (size, g_maxSize) + sizeof (struct ByteTagListData) - 4];
+  uint32_t allocSize = g_threadSafe ? size : std::max (size, g_maxSize);
+  uint8_t *buffer = new uint8_t [allocSize + sizeof (struct ByteTagListData) - 4];
   struct ByteTagListData *data = (struct ByteTagListData *)buffer;
   data->count = 1;
   data->size = size;
@@ -369,6 +404,15 @@ ByteTagList::Deallocate (struct ByteTagListData *data)
     {
       return;
     }
+  if (g_threadSafe)
+    {
+      if (UnrefData (data))
+        {
+          uint8_t *buffer = (uint8_t *)data;
+          delete [] buffer;
+        }
+      return;
+    }
   g_maxSize = std::max (g_maxSize, data->size);
   data->count--;
   if (data->count == 0)
@@ -408,8 +452,7 @@ ByteTagList::Deallocate (struct ByteTagListData *data)
     {
       return;
     }
-  data->count--;
-  if (data->count == 0)
+  if (UnrefData (data))
     {
       uint8_t *buffer = (uint8_t *)data;
       delete [] buffer;
@@ -153,6 +153,12 @@ private:
    */
   void AddAtStart (int32_t adjustment, int32_t prependOffset);
 
+  /**
+   * Make the reference counts of the tag data shared by packets
+   * atomic and stop recycling it, see Packet::EnableThreadSafety.
+   */
+  static void EnableThreadSafety (void);
+
 private:
   bool IsDirtyAtEnd (int32_t appendOffset);
   bool IsDirtyAtStart (int32_t prependOffset);
@@ -36,6 +36,7 @@ bool PacketMetadata::m_enableChecking = false;
 bool PacketMetadata::m_metadataSkipped = false;
 uint32_t PacketMetadata::m_maxSize = 0;
 uint16_t PacketMetadata::m_chunkUid = 0;
+bool PacketMetadata::m_threadSafe = false;
 PacketMetadata::DataFreeList PacketMetadata::m_freeList;
 
 PacketMetadata::DataFreeList::~DataFreeList ()
@@ -67,14 +68,19 @@ PacketMetadata::EnableChecking (void)
   m_enableChecking = true;
 }
 
+void
+PacketMetadata::EnableThreadSafety (void)
+{
+  m_threadSafe = true;
+}
+
 void
 PacketMetadata::ReserveCopy (uint32_t size)
 {
   struct PacketMetadata::Data *newData = PacketMetadata::Create (m_used + size);
   memcpy (newData->m_data, m_data->m_data, m_used);
   newData->m_dirtyEnd = m_used;
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
+  if (UnrefData (m_data))
     {
       PacketMetadata::Recycle (m_data);
     }
@@ -521,6 +527,11 @@ struct PacketMetadata::Data *
 PacketMetadata::Create (uint32_t size)
 {
   NS_LOG_LOGIC ("create size="<<size<<", max="<<m_maxSize);
+  if (m_threadSafe)
+    {
+      // the free list and the size heuristic are shared by all threads
+      return PacketMetadata::Allocate (size);
+    }
   if (size > m_maxSize)
     {
       m_maxSize = size;
@@ -545,7 +556,7 @@ PacketMetadata::Create (uint32_t size)
 void
 PacketMetadata::Recycle (struct PacketMetadata::Data *data)
 {
-  if (!m_enable)
+  if (!m_enable || m_threadSafe)
     {
       PacketMetadata::Deallocate (data);
       return;
@@ -126,6 +126,11 @@ private:
 
   static void Enable (void);
   static void EnableChecking (void);
+  /**
+   * Make the reference counts of the metadata shared by packets
+   * atomic and stop recycling it, see Packet::EnableThreadSafety.
+   */
+  static void EnableThreadSafety (void);
 
   inline PacketMetadata (uint64_t uid, uint32_t size);
   inline PacketMetadata (PacketMetadata const &o);
@@ -323,6 +328,9 @@ public:
   static void Recycle (struct PacketMetadata::Data *data);
   static struct PacketMetadata::Data *Allocate (uint32_t n);
   static void Deallocate (struct PacketMetadata::Data *data);
+  static inline void RefData (struct PacketMetadata::Data *data);
+  // returns true when the last reference to data was dropped
+  static inline bool UnrefData (struct PacketMetadata::Data *data);
 
   static DataFreeList m_freeList;
   static bool m_enable;
@@ -335,6 +343,7 @@ public:
 
   static uint32_t m_maxSize;
   static uint16_t m_chunkUid;
+  static bool m_threadSafe;
 
   struct Data *m_data;
   /**
@@ -365,6 +374,29 @@ PacketMetadata::PacketMetadata (uint64_t uid, uint32_t size)
       DoAddHeader (0, size);
     }
 }
+void
+PacketMetadata::RefData (struct PacketMetadata::Data *data)
+{
+  if (m_threadSafe)
+    {
+      __sync_fetch_and_add (&data->m_count, 1);
+    }
+  else
+    {
+      data->m_count++;
+    }
+}
+bool
+PacketMetadata::UnrefData (struct PacketMetadata::Data *data)
+{
+  if (m_threadSafe)
+    {
+      return __sync_sub_and_fetch (&data->m_count, 1) == 0;
+    }
+  data->m_count--;
+  return data->m_count == 0;
+}
+
 PacketMetadata::PacketMetadata (PacketMetadata const &o)
   : m_data (o.m_data),
     m_head (o.m_head),
@@ -373,7 +405,7 @@ PacketMetadata::PacketMetadata (PacketMetadata const &o)
     m_packetUid (o.m_packetUid)
 {
   NS_ASSERT (m_data != 0);
-  m_data->m_count++;
+  RefData (m_data);
 }
 PacketMetadata &
 PacketMetadata::operator = (PacketMetadata const& o)
@@ -382,14 +414,13 @@ PacketMetadata::operator = (PacketMetadata const& o)
     {
       // not self assignment
       NS_ASSERT (m_data != 0);
-      m_data->m_count--;
-      if (m_data->m_count == 0) 
+      if (UnrefData (m_data))
         {
           PacketMetadata::Recycle (m_data);
         }
       m_data = o.m_data;
       NS_ASSERT (m_data != 0);
-      m_data->m_count++;
+      RefData (m_data);
     }
   m_head = o.m_head;
   m_tail = o.m_tail;
@@ -400,8 +431,7 @@ PacketMetadata::operator = (PacketMetadata const& o)
 PacketMetadata::~PacketMetadata ()
 {
   NS_ASSERT (m_data != 0);
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
+  if (UnrefData (m_data))
     {
       PacketMetadata::Recycle (m_data);
     }
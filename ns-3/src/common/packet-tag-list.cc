@@ -28,6 +28,17 @@ NS_LOG_COMPONENT_DEFINE ("PacketTagList");
 
 namespace ns3 {
 
+bool PacketTagList::g_threadSafe = false;
+
+void
+PacketTagList::EnableThreadSafety (void)
+{
+#ifdef USE_FREE_LIST
+  NS_FATAL_ERROR ("The tag free list is not thread-safe");
+#endif
+  g_threadSafe = true;
+}
+
 #ifdef USE_FREE_LIST
 
 struct PacketTagList::TagData *PacketTagList::g_free = 0;
@@ -58,14 +58,24 @@ public:
 
   const struct PacketTagList::TagData *Head (void) const;
 
+  /**
+   * Make the reference counts of the tags shared by packets atomic,
+   * see Packet::EnableThreadSafety.
+   */
+  static void EnableThreadSafety (void);
+
 private:
 
   bool Remove (TypeId tid);
   struct PacketTagList::TagData *AllocData (void) const;
   void FreeData (struct TagData *data) const;
+  static inline void RefData (struct TagData *data);
+  // returns true when the last reference to data was dropped
+  static inline bool UnrefData (struct TagData *data);
 
   static struct PacketTagList::TagData *g_free;
   static uint32_t g_nfree;
+  static bool g_threadSafe;
 
   struct TagData *m_next;
 };
@@ -78,6 +88,30 @@ private:
 
 namespace ns3 {
 
+void
+PacketTagList::RefData (struct TagData *data)
+{
+  if (g_threadSafe)
+    {
+      __sync_fetch_and_add (&data->count, 1);
+    }
+  else
+    {
+      data->count++;
+    }
+}
+
+bool
+PacketTagList::UnrefData (struct TagData *data)
+{
+  if (g_threadSafe)
+    {
+      return __sync_sub_and_fetch (&data->count, 1) == 0;
+    }
+  data->count--;
+  return data->count == 0;
+}
+
 PacketTagList::PacketTagList ()
   : m_next ()
 {
@@ -88,7 +122,7 @@ PacketTagList::PacketTagList (PacketTagList const &o)
 {
   if (m_next != 0)
     {
-      m_next->count++;
+      RefData (m_next);
     }
 }
 
@@ -104,7 +138,7 @@ PacketTagList::operator = (PacketTagList const &o)
   m_next = o.m_next;
   if (m_next != 0) 
     {
-      m_next->count++;
+      RefData (m_next);
     }
   return *this;
 }
@@ -120,8 +154,7 @@ PacketTagList::RemoveAll (void)
   struct TagData *prev = 0;
   for (struct TagData *cur = m_next; cur != 0; cur = cur->next) 
     {
-      cur->count--;
-      if (cur->count > 0) 
+      if (!UnrefData (cur))
         {
           break;
         }
@@ -30,6 +30,15 @@ NS_LOG_COMPONENT_DEFINE ("Packet");
 namespace ns3 {
 
 uint32_t Packet::m_globalUid = 0;
+bool Packet::m_threadSafe = false;
+std::vector<uint32_t> Packet::m_partitionUids;
+__thread uint32_t Packet::m_partition = 0;
+
+/* maximum number of released Packet objects kept for reuse. */
+#define PACKET_POOL_MAX_FREE 1000
+bool Packet::m_poolEnabled = false;
+struct Packet::FreePacket *Packet::m_pool = 0;
+uint32_t Packet::m_poolCount = 0;
 
 TypeId 
 ByteTagIterator::Item::GetTypeId (void) const
@@ -136,10 +145,9 @@ Packet::Packet ()
      * zero.  The lower 32 bits are for the 
      * global UID
      */
-    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, 0),
+    m_metadata (AllocateUid (), 0),
     m_nixVector (0)
 {
-  m_globalUid++;
 }
 
 Packet::Packet (const Packet &o)
@@ -178,10 +186,9 @@ Packet::Packet (uint32_t size)
      * zero.  The lower 32 bits are for the 
      * global UID
      */
-    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, size),
+    m_metadata (AllocateUid (), size),
     m_nixVector (0)
 {
-  m_globalUid++;
 }
 Packet::Packet (uint8_t const *buffer, uint32_t size, bool magic)
   : m_buffer (0, false),
@@ -204,10 +211,9 @@ Packet::Packet (uint8_t const*buffer, uint32_t size)
      * zero.  The lower 32 bits are for the 
      * global UID
      */
-    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, size),
+    m_metadata (AllocateUid (), size),
     m_nixVector (0)
 {
-  m_globalUid++;
   m_buffer.AddAtStart (size);
   Buffer::Iterator i = m_buffer.Begin ();
   i.Write (buffer, size);
@@ -561,6 +567,98 @@ Packet::EnableChecking (void)
   PacketMetadata::EnableChecking ();
 }
 
+void
+Packet::EnablePool (bool enable)
+{
+  NS_LOG_FUNCTION (enable);
+  if (enable && m_threadSafe)
+    {
+      NS_LOG_WARN ("The packet pool cannot be used from several threads, it stays off");
+      return;
+    }
+  m_poolEnabled = enable;
+  if (!enable)
+    {
+      while (m_pool != 0)
+        {
+          struct FreePacket *block = m_pool;
+          m_pool = block->m_next;
+          ::operator delete (block);
+        }
+      m_poolCount = 0;
+    }
+  Buffer::EnablePool (enable);
+}
+
+void
+Packet::EnableThreadSafety (uint32_t partitions)
+{
+  NS_LOG_FUNCTION (partitions);
+  if (m_poolEnabled)
+    {
+      NS_FATAL_ERROR ("The packet pool cannot be used from several threads");
+    }
+  if (m_partitionUids.empty ())
+    {
+      m_partitionUids.push_back (m_globalUid);
+    }
+  if (partitions > m_partitionUids.size ())
+    {
+      m_partitionUids.resize (partitions, 0);
+    }
+  m_threadSafe = true;
+  Buffer::EnableThreadSafety ();
+  ByteTagList::EnableThreadSafety ();
+  PacketTagList::EnableThreadSafety ();
+  PacketMetadata::EnableThreadSafety ();
+}
+
+void
+Packet::SetPartition (uint32_t partition)
+{
+  NS_ASSERT (partition < m_partitionUids.size ());
+  m_partition = partition;
+}
+
+uint64_t
+Packet::AllocateUid (void)
+{
+  if (m_threadSafe)
+    {
+      // a partition runs its events in the same order on every run
+      return static_cast<uint64_t> (m_partition) << 32 | m_partitionUids[m_partition]++;
+    }
+  return static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid++;
+}
+
+void *
+Packet::operator new (size_t size)
+{
+  if (m_poolEnabled && size == sizeof (Packet) && m_pool != 0)
+    {
+      struct FreePacket *block = m_pool;
+      m_pool = block->m_next;
+      m_poolCount--;
+      return block;
+    }
+  return ::operator new (size);
+}
+
+void
+Packet::operator delete (void *p, size_t size)
+{
+  if (m_poolEnabled && size == sizeof (Packet) && 
+      m_poolCount < PACKET_POOL_MAX_FREE)
+    {
+      struct FreePacket *block = static_cast<struct FreePacket *> (p);
+      block->m_next = m_pool;
+      m_pool = block;
+      m_poolCount++;
+      return;
+    }
+  ::operator delete (p);
+}
+
 uint32_t Packet::GetSerializedSize (void) const
 {
   uint32_t size = 0;
@@ -1308,6 +1406,52 @@ PacketTest::DoRun (void)
   return GetErrorStatus ();
 }
 //-----------------------------------------------------------------------------
+class PacketPoolTest : public TestCase
+{
+public:
+  PacketPoolTest ();
+  virtual bool DoRun (void);
+};
+
+PacketPoolTest::PacketPoolTest ()
+  : TestCase ("Packet pool") {
+}
+
+bool
+PacketPoolTest::DoRun (void)
+{
+  Packet::EnablePool (true);
+  Ptr<Packet> packet = Create<Packet> (100);
+  Packet *released = PeekPointer (packet);
+  packet = 0;
+  NS_TEST_ASSERT_MSG_EQ (Packet::m_poolCount, 1U, "The released packet was not kept");
+  packet = Create<Packet> (10);
+  NS_TEST_ASSERT_MSG_EQ (PeekPointer (packet), released, "The released packet was not reused");
+  NS_TEST_ASSERT_MSG_EQ (packet->GetSize (), 10U, "The reused packet was not constructed again");
+  Ptr<Packet> copy = packet->Copy ();
+  NS_TEST_ASSERT_MSG_NE (PeekPointer (copy), released, "A packet in use was handed out");
+  copy = 0;
+  packet = 0;
+  NS_TEST_ASSERT_MSG_EQ (Packet::m_poolCount, 2U, "The released packets were not kept");
+  Packet::EnablePool (false);
+  NS_TEST_ASSERT_MSG_EQ (Packet::m_poolCount, 0U, "Disabling the pool did not release the packets");
+  NS_TEST_ASSERT_MSG_EQ (Packet::m_pool, 0, "Disabling the pool did not release the packets");
+
+  // no pool once packets are shared between threads
+  Packet::EnableThreadSafety (1);
+  Packet::EnablePool (true);
+  NS_TEST_ASSERT_MSG_EQ (Packet::m_poolEnabled, false, "The pool was turned on with thread safety");
+  packet = Create<Packet> (10);
+  packet = 0;
+  NS_TEST_ASSERT_MSG_EQ (Packet::m_poolCount, 0U, "A packet was kept without the pool");
+  // back to the sequential uids, the shared reference counts stay atomic
+  Packet::m_globalUid = Packet::m_partitionUids[0];
+  Packet::m_partitionUids.clear ();
+  Packet::m_threadSafe = false;
+
+  return GetErrorStatus ();
+}
+//-----------------------------------------------------------------------------
 class PacketTestSuite : public TestSuite
 {
 public:
@@ -1318,6 +1462,7 @@ PacketTestSuite::PacketTestSuite ()
   : TestSuite ("packet", UNIT)
 {
   AddTestCase (new PacketTest);
+  AddTestCase (new PacketPoolTest);
 }
 
 PacketTestSuite g_packetTestSuite;
@@ -21,6 +21,7 @@
 #define PACKET_H
 
 #include <stdint.h>
+#include <vector>
 #include "buffer.h"
 #include "header.h"
 #include "trailer.h"
@@ -429,6 +430,42 @@ public:
    * errors will be detected and will abort the program.
    */
   static void EnableChecking (void);
+  /**
+   * \param enable true to recycle the memory of released packets.
+   *
+   * By default, every Packet object and its byte buffer are
+   * allocated from and released to the heap, which makes short-lived
+   * control packets a large source of allocations. When the pool is
+   * enabled, Packet objects and buffer arrays are kept on free lists
+   * when their last reference is dropped and reused by the next
+   * Create<Packet> (). This can be switched at any time: disabling
+   * the pool releases all cached memory. The pool stays off once
+   * EnableThreadSafety was called.
+   */
+  static void EnablePool (bool enable);
+  /**
+   * Allow packets which share their byte buffer, tags or metadata to
+   * be copied and released concurrently by different threads, as
+   * needed when the events of different nodes run in parallel. Every
+   * reference count shared between packets becomes atomic, which costs
+   * a little on every copy, so this is off by default. It cannot be
+   * combined with the packet pool, and once enabled it stays enabled.
+   *
+   * The uids are then numbered per partition, with the partition in
+   * the high 32 bits, so that they do not depend on how the threads
+   * interleave. Partition 0 goes on from the uids numbered so far.
+   *
+   * \param partitions the number of partitions of the nodes
+   */
+  static void EnableThreadSafety (uint32_t partitions);
+  /**
+   * Number the packets created by the calling thread as those of
+   * partition, see EnableThreadSafety.
+   */
+  static void SetPartition (uint32_t partition);
+
+  static void *operator new (size_t size);
+  static void operator delete (void *p, size_t size);
 
   /**
    * For packet serializtion, the total size is checked 
@@ -566,7 +603,22 @@ private:
   /* Please see comments above about nix-vector */
   Ptr<NixVector> m_nixVector;
 
+  static uint64_t AllocateUid (void);
+
   static uint32_t m_globalUid;
+  static bool m_threadSafe;
+  static std::vector<uint32_t> m_partitionUids;
+  static __thread uint32_t m_partition;
+
+  struct FreePacket
+  {
+    struct FreePacket *m_next;
+  };
+  static bool m_poolEnabled;
+  static struct FreePacket *m_pool;
+  static uint32_t m_poolCount;
+
+  friend class PacketPoolTest;
 };
 
 std::ostream& operator<< (std::ostream& os, const Packet &packet);
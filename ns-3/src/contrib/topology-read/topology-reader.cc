@@ -133,14 +133,14 @@ TopologyReader::Link::GetToNodeName (void) const
 std::string
 TopologyReader::Link::GetAttribute (std::string name)
 {
-  NS_ASSERT_MSG (m_linkAttr.find ("name") == m_linkAttr.end (), "Requested topology link attribute not found");
+  NS_ASSERT_MSG (m_linkAttr.find (name) != m_linkAttr.end (), "Requested topology link attribute not found");
   return m_linkAttr[name];
 }
 
 bool
 TopologyReader::Link::GetAttributeFailSafe (std::string name, std::string &value)
 {
-  if ( m_linkAttr.find ("name") == m_linkAttr.end () )
+  if ( m_linkAttr.find (name) == m_linkAttr.end () )
     {
       return false;
     }
@@ -23,6 +23,7 @@
 #include "rng-stream.h"
 #include "global-value.h"
 #include "integer.h"
+#include "system-mutex.h"
 using namespace std;
 
 namespace
@@ -334,11 +335,18 @@ double RngStream::nextSeed[6] =
   12345.0, 12345.0, 12345.0, 12345.0, 12345.0, 12345.0
 };
 
+std::vector<double> RngStream::partitionSeeds;
+__thread uint32_t RngStream::partition = 0;
+
 //-------------------------------------------------------------------------
 // constructor
 //
 RngStream::RngStream ()
 {
+  // streams are also created by the threads of the parallel simulator,
+  // each from the sequence of its partition
+  static SystemMutex mutex;
+  CriticalSection cs (mutex);
   uint32_t run = EnsureGlobalInitialized ();
   
   anti = false;
@@ -361,6 +369,30 @@ RngStream::RngStream(const RngStream& r)
 }
       
 
+void RngStream::SetPartitions (uint32_t partitions)
+{
+  EnsureGlobalInitialized ();
+  // 2^24 streams between the first seeds of two partitions
+  double J1[3][3], J2[3][3];
+  MatTwoPowModM (A1p127, J1, m1, 24);
+  MatTwoPowModM (A2p127, J2, m2, 24);
+  double seed[6];
+  for (int i = 0; i < 6; ++i) {
+    seed[i] = partitionSeeds.empty () ? nextSeed[i] : partitionSeeds[partitionSeeds.size () - 6 + i];
+  }
+  // the partitions already set keep their sequences
+  for (uint32_t p = partitionSeeds.size () / 6 + 1; p < partitions; ++p) {
+    MatVecModM (J1, seed, seed, m1);
+    MatVecModM (J2, &seed[3], &seed[3], m2);
+    partitionSeeds.insert (partitionSeeds.end (), seed, seed + 6);
+  }
+}
+
+void RngStream::SetPartition (uint32_t p)
+{
+  partition = p;
+}
+
 void RngStream::InitializeStream()
 { // Moved from the RngStream constructor above to allow seeding
   // AFTER the global package seed has been set in the Random
@@ -372,12 +404,16 @@ void RngStream::InitializeStream()
      bits if machine follows IEEE 754 standard) if incPrec = true. nextSeed
      will be the seed of the next declared RngStream. */
 
+  double *next = nextSeed;
+  if (partition > 0 && partition <= partitionSeeds.size () / 6) {
+    next = &partitionSeeds[(partition - 1) * 6];
+  }
   for (int i = 0; i < 6; ++i) {
-    Bg[i] = Cg[i] = Ig[i] = nextSeed[i];
+    Bg[i] = Cg[i] = Ig[i] = next[i];
   }
 
-  MatVecModM (A1p127, nextSeed, nextSeed, m1);
-  MatVecModM (A2p127, &nextSeed[3], &nextSeed[3], m2);
+  MatVecModM (A1p127, next, next, m1);
+  MatVecModM (A2p127, &next[3], &next[3], m2);
 }
 
 //-------------------------------------------------------------------------
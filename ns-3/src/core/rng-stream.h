@@ -20,6 +20,7 @@
 #ifndef RNGSTREAM_H
 #define RNGSTREAM_H
 #include <string>
+#include <vector>
 #include <stdint.h>
 
 namespace ns3 {
@@ -60,6 +61,19 @@ public: //public static api
   static uint32_t GetPackageRun (void);
   static bool CheckSeed(const uint32_t seed[6]);
   static bool CheckSeed(uint32_t seed);
+  /**
+   * Give each of partitions its own sequence of streams, for the threads
+   * of the ParallelSimulatorImpl, so that the streams a thread creates do
+   * not depend on how the threads interleave.  Partition 0 keeps the
+   * sequence of the package, partition p starts p * 2^24 streams after
+   * it.  Called from the main thread before the threads start.
+   */
+  static void SetPartitions (uint32_t partitions);
+  /**
+   * Take the streams created by the calling thread from the sequence of
+   * partition.
+   */
+  static void SetPartition (uint32_t partition);
 private: //members
   double Cg[6], Bg[6], Ig[6];
   bool anti, incPrec;
@@ -68,6 +82,9 @@ private: //members
   static uint32_t EnsureGlobalInitialized (void);
 private: //static data
   static double nextSeed[6];
+  // next seed of the sequences of partitions 1 and above, 6 per partition
+  static std::vector<double> partitionSeeds;
+  static __thread uint32_t partition;
 };
 
 } //namespace ns3
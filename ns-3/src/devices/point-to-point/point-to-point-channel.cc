@@ -76,6 +76,13 @@ PointToPointChannel::Attach(Ptr<PointToPointNetDevice> device)
       m_link[1].m_dst = m_link[0].m_src;
       m_link[0].m_state = IDLE;
       m_link[1].m_state = IDLE;
+      for (uint32_t i = 0; i < N_DEVICES; i++)
+        {
+          if (m_link[i].m_dst->GetNode () != 0)
+            {
+              m_link[i].m_dstNodeId = m_link[i].m_dst->GetNode ()->GetId ();
+            }
+        }
     }
 }
 
@@ -92,13 +99,24 @@ PointToPointChannel::TransmitStart(
   NS_ASSERT(m_link[1].m_state != INITIALIZING);
 
   uint32_t wire = src == m_link[0].m_src ? 0 : 1;
+  if (m_link[wire].m_dstNodeId == NO_NODE)
+    {
+      // the devices were attached before they were added to their nodes
+      m_link[wire].m_dstNodeId = m_link[wire].m_dst->GetNode ()->GetId ();
+    }
 
-  Simulator::ScheduleWithContext (m_link[wire].m_dst->GetNode ()->GetId (),
+  // The destination may be run by another thread of a parallel
+  // simulation, so its device is not referenced from here: the
+  // channel keeps it alive for as long as the event is pending.
+  Simulator::ScheduleWithContext (m_link[wire].m_dstNodeId,
                                   txTime + m_delay, &PointToPointNetDevice::Receive,
-                                  m_link[wire].m_dst, p);
+                                  PeekPointer (m_link[wire].m_dst), p);
 
   // Call the tx anim callback on the net device
-  m_txrxPointToPoint (p, src, m_link[wire].m_dst, txTime, txTime + m_delay);
+  if (!m_txrxPointToPoint.IsEmpty ())
+    {
+      m_txrxPointToPoint (p, src, m_link[wire].m_dst, txTime, txTime + m_delay);
+    }
   return true;
 }
 
@@ -154,11 +154,14 @@ private:
   class Link
   {
   public:
-    Link() : m_state (INITIALIZING), m_src (0), m_dst (0) {}
+    Link() : m_state (INITIALIZING), m_src (0), m_dst (0), m_dstNodeId (NO_NODE) {}
     WireState                  m_state;
     Ptr<PointToPointNetDevice> m_src;
     Ptr<PointToPointNetDevice> m_dst;
+    // id of the node of m_dst, the context of the receive events
+    uint32_t                   m_dstNodeId;
   };
+  static const uint32_t NO_NODE = 0xffffffff;
     
   Link    m_link[N_DEVICES];
 };
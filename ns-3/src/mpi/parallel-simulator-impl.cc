@@ -0,0 +1,806 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 University of Pennsylvania
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "parallel-simulator-impl.h"
+
+#include "ns3/simulator.h"
+#include "ns3/scheduler.h"
+#include "ns3/event-impl.h"
+#include "ns3/channel.h"
+#include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "ns3/net-device.h"
+#include "ns3/packet.h"
+#include "ns3/rng-stream.h"
+#include "ns3/assert.h"
+#include "ns3/log.h"
+
+#include <algorithm>
+#include <pthread.h>
+
+NS_LOG_COMPONENT_DEFINE ("ParallelSimulatorImpl");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (ParallelSimulatorImpl);
+
+static const uint32_t NO_CONTEXT = 0xffffffff;
+static const uint64_t NO_TS = ~(uint64_t)0;
+
+/**
+ * Blocks the threads until all of them reached it, at both ends of
+ * every window. The condition of SystemCondition is reset by Wait,
+ * so it would lose a signal sent before the waiter arrived.
+ */
+class WindowBarrier
+{
+public:
+  WindowBarrier (uint32_t n)
+    : m_n (n),
+      m_waiting (0),
+      m_generation (0)
+  {
+    pthread_mutex_init (&m_mutex, NULL);
+    pthread_cond_init (&m_cond, NULL);
+  }
+  ~WindowBarrier ()
+  {
+    pthread_mutex_destroy (&m_mutex);
+    pthread_cond_destroy (&m_cond);
+  }
+  void Wait (void)
+  {
+    pthread_mutex_lock (&m_mutex);
+    uint32_t generation = m_generation;
+    m_waiting++;
+    if (m_waiting == m_n)
+      {
+        m_waiting = 0;
+        m_generation++;
+        pthread_cond_broadcast (&m_cond);
+      }
+    else
+      {
+        while (generation == m_generation)
+          {
+            pthread_cond_wait (&m_cond, &m_mutex);
+          }
+      }
+    pthread_mutex_unlock (&m_mutex);
+  }
+private:
+  uint32_t m_n;
+  uint32_t m_waiting;
+  uint32_t m_generation;
+  pthread_mutex_t m_mutex;
+  pthread_cond_t m_cond;
+};
+
+__thread ParallelSimulatorImpl::Partition *ParallelSimulatorImpl::m_current = 0;
+
+TypeId
+ParallelSimulatorImpl::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ParallelSimulatorImpl")
+    .SetParent<SimulatorImpl> ()
+    .AddConstructor<ParallelSimulatorImpl> ()
+    .AddAttribute ("LookAhead",
+                   "The smallest delay of the events one partition schedules for another. "
+                   "Zero takes the smallest delay of the point-to-point links between partitions.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&ParallelSimulatorImpl::m_lookAheadAttribute),
+                   MakeTimeChecker ())
+    ;
+  return tid;
+}
+
+ParallelSimulatorImpl::ParallelSimulatorImpl ()
+{
+  m_stop = false;
+  // uids are allocated from 4, as in the DefaultSimulatorImpl.
+  // uid 0 is "invalid" events
+  // uid 1 is "now" events
+  // uid 2 is "destroy" events
+  m_uid = 4;
+  m_currentTs = 0;
+  m_currentContext = NO_CONTEXT;
+  m_currentEvent = 0;
+  m_inboxTs = NO_TS;
+  m_nPartitions = 1;
+  m_partitions.resize (2);
+  m_setup = false;
+  m_lookAhead = NO_TS;
+  m_windowEnd = 0;
+  m_windowUid = 0;
+  m_nextWorker = 0;
+  m_quit = false;
+  m_barrier = 0;
+}
+
+ParallelSimulatorImpl::~ParallelSimulatorImpl ()
+{}
+
+void
+ParallelSimulatorImpl::DoDispose (void)
+{
+  for (uint32_t i = 0; i < m_partitions.size (); i++)
+    {
+      Partition &partition = m_partitions[i];
+      Ingest (partition);
+      while (partition.events != 0 && !partition.events->IsEmpty ())
+        {
+          Scheduler::Event next = partition.events->RemoveNext ();
+          next.impl->Unref ();
+        }
+      partition.events = 0;
+    }
+  SimulatorImpl::DoDispose ();
+}
+
+void
+ParallelSimulatorImpl::Destroy ()
+{
+  while (!m_destroyEvents.empty ())
+    {
+      Ptr<EventImpl> ev = m_destroyEvents.front ().PeekEventImpl ();
+      m_destroyEvents.pop_front ();
+      NS_LOG_LOGIC ("handle destroy " << ev);
+      if (!ev->IsCancelled ())
+        {
+          ev->Invoke ();
+        }
+    }
+}
+
+void
+ParallelSimulatorImpl::SetScheduler (ObjectFactory schedulerFactory)
+{
+  m_schedulerFactory = schedulerFactory;
+  for (uint32_t i = 0; i < m_partitions.size (); i++)
+    {
+      Ptr<Scheduler> scheduler = schedulerFactory.Create<Scheduler> ();
+      Ptr<Scheduler> old = m_partitions[i].events;
+      if (old != 0)
+        {
+          while (!old->IsEmpty ())
+            {
+              scheduler->Insert (old->RemoveNext ());
+            }
+        }
+      m_partitions[i].events = scheduler;
+    }
+}
+
+void
+ParallelSimulatorImpl::SetPartitions (const std::vector<uint32_t> &partitions)
+{
+  NS_ASSERT_MSG (!m_setup, "The partitions must be set before Run");
+  m_contextPartition = partitions;
+}
+
+uint32_t
+ParallelSimulatorImpl::GetNPartitions (void) const
+{
+  uint32_t n = 1;
+  for (uint32_t i = 0; i < m_contextPartition.size (); i++)
+    {
+      n = std::max (n, m_contextPartition[i] + 1);
+    }
+  return n;
+}
+
+void
+ParallelSimulatorImpl::SetupPartitions (void)
+{
+  if (m_setup)
+    {
+      return;
+    }
+  m_setup = true;
+  if (m_contextPartition.empty ())
+    {
+      for (uint32_t i = 0; i < NodeList::GetNNodes (); i++)
+        {
+          m_contextPartition.push_back (NodeList::GetNode (i)->GetSystemId ());
+        }
+    }
+  // the events scheduled before Run all are in the two partitions
+  // used until now, sort them into the real ones
+  std::vector<Partition> old;
+  old.swap (m_partitions);
+  m_nPartitions = GetNPartitions ();
+  m_partitions.resize (m_nPartitions + 1);
+  for (uint32_t i = 0; i < m_partitions.size (); i++)
+    {
+      m_partitions[i].events = m_schedulerFactory.Create<Scheduler> ();
+      m_partitions[i].currentTs = 0;
+      m_partitions[i].currentContext = NO_CONTEXT;
+      m_partitions[i].currentEvent = 0;
+    }
+  for (uint32_t i = 0; i < old.size (); i++)
+    {
+      while (!old[i].events->IsEmpty ())
+        {
+          Scheduler::Event ev = old[i].events->RemoveNext ();
+          m_partitions[GetPartition (ev.key.m_context)].events->Insert (ev);
+        }
+    }
+  CalculateLookAhead ();
+  if (m_nPartitions > 1)
+    {
+      // packet uids and random streams are numbered per partition, and
+      // the streams of the partitions are set apart before the threads
+      // start, so that runs with the same partitions, seed and run
+      // number give the same results
+      Packet::EnableThreadSafety (m_nPartitions);
+      RngStream::SetPartitions (m_nPartitions);
+    }
+  NS_LOG_INFO ("partitions " << m_nPartitions << " lookahead " << m_lookAhead);
+}
+
+void
+ParallelSimulatorImpl::CalculateLookAhead (void)
+{
+  if (!m_lookAheadAttribute.IsZero ())
+    {
+      m_lookAhead = m_lookAheadAttribute.GetTimeStep ();
+      return;
+    }
+  // as for the DistributedSimulatorImpl, only point-to-point links
+  // are considered. An event scheduled over any other link within
+  // the window is caught by DoSchedule.
+  m_lookAhead = NO_TS;
+  for (uint32_t i = 0; i < NodeList::GetNNodes (); i++)
+    {
+      Ptr<Node> node = NodeList::GetNode (i);
+      for (uint32_t j = 0; j < node->GetNDevices (); j++)
+        {
+          Ptr<NetDevice> device = node->GetDevice (j);
+          Ptr<Channel> channel = device->GetChannel ();
+          if (!device->IsPointToPoint () || channel == 0)
+            {
+              continue;
+            }
+          for (uint32_t k = 0; k < channel->GetNDevices (); k++)
+            {
+              Ptr<Node> remote = channel->GetDevice (k)->GetNode ();
+              if (GetPartition (remote->GetId ()) == GetPartition (node->GetId ()))
+                {
+                  continue;
+                }
+              TimeValue delay;
+              channel->GetAttribute ("Delay", delay);
+              m_lookAhead = std::min (m_lookAhead, (uint64_t) delay.Get ().GetTimeStep ());
+            }
+        }
+    }
+  if (m_lookAhead == 0)
+    {
+      NS_FATAL_ERROR ("ParallelSimulatorImpl: a link between two partitions has no delay");
+    }
+}
+
+uint32_t
+ParallelSimulatorImpl::GetPartition (uint32_t context) const
+{
+  if (context == NO_CONTEXT)
+    {
+      return m_nPartitions;
+    }
+  // until Run, every node is in the first partition
+  if (m_setup && context < m_contextPartition.size ())
+    {
+      return m_contextPartition[context];
+    }
+  return 0;
+}
+
+uint32_t
+ParallelSimulatorImpl::GetSystemId (void) const
+{
+  return 0;
+}
+
+uint32_t
+ParallelSimulatorImpl::DoSchedule (uint64_t ts, uint32_t context, EventImpl *event)
+{
+  uint32_t partition = GetPartition (context);
+  Partition *current = m_current;
+  if (current == 0)
+    {
+      // on the main thread, outside of the windows: the uid is final
+      Scheduler::Event ev;
+      ev.impl = event;
+      ev.key.m_ts = ts;
+      ev.key.m_context = context;
+      ev.key.m_uid = m_uid;
+      m_uid++;
+      m_partitions[partition].events->Insert (ev);
+      return ev.key.m_uid;
+    }
+  Created created;
+  created.ev.impl = event;
+  created.ev.key.m_ts = ts;
+  created.ev.key.m_context = context;
+  created.ev.key.m_uid = m_windowUid + current->created.size ();
+  created.partition = partition;
+  if (ts < m_windowEnd)
+    {
+      if (&m_partitions[partition] != current)
+        {
+          NS_FATAL_ERROR ("ParallelSimulatorImpl: event for context " << context <<
+                          " scheduled at " << ts << " within the lookahead of another partition");
+        }
+      // provisional uids come after the uids of all events scheduled
+      // before the window, and in the order of this partition
+      created.kind = Created::WINDOW;
+      current->events->Insert (created.ev);
+    }
+  else
+    {
+      created.kind = Created::LATER;
+    }
+  current->created.push_back (created);
+  return created.ev.key.m_uid;
+}
+
+EventId
+ParallelSimulatorImpl::Schedule (Time const &time, EventImpl *event)
+{
+  uint64_t ts = (Now () + time).GetTimeStep ();
+  NS_ASSERT (time.IsPositive ());
+  uint32_t context = GetContext ();
+  uint32_t uid = DoSchedule (ts, context, event);
+  return EventId (event, ts, context, uid);
+}
+
+void
+ParallelSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &time, EventImpl *event)
+{
+  NS_LOG_FUNCTION (this << context << time.GetTimeStep () << event);
+  DoSchedule (Now ().GetTimeStep () + time.GetTimeStep (), context, event);
+}
+
+EventId
+ParallelSimulatorImpl::ScheduleNow (EventImpl *event)
+{
+  return Schedule (TimeStep (0), event);
+}
+
+EventId
+ParallelSimulatorImpl::ScheduleDestroy (EventImpl *event)
+{
+  uint64_t ts = Now ().GetTimeStep ();
+  EventId id (Ptr<EventImpl> (event, false), ts, NO_CONTEXT, 2);
+  Partition *current = m_current;
+  if (current == 0)
+    {
+      m_destroyEvents.push_back (id);
+      m_uid++;
+      return id;
+    }
+  // the destroy events run in the order they were scheduled in, so
+  // they are queued once the window is merged
+  Created created;
+  created.ev.impl = event;
+  created.ev.key.m_ts = ts;
+  created.ev.key.m_context = NO_CONTEXT;
+  created.ev.key.m_uid = 2;
+  created.partition = m_nPartitions;
+  created.kind = Created::DESTROY;
+  event->Ref ();
+  current->created.push_back (created);
+  return id;
+}
+
+Time
+ParallelSimulatorImpl::Now (void) const
+{
+  Partition *current = m_current;
+  return TimeStep (current != 0 ? current->currentTs : m_currentTs);
+}
+
+uint32_t
+ParallelSimulatorImpl::GetContext (void) const
+{
+  Partition *current = m_current;
+  return current != 0 ? current->currentContext : m_currentContext;
+}
+
+Time
+ParallelSimulatorImpl::GetDelayLeft (const EventId &id) const
+{
+  if (IsExpired (id))
+    {
+      return TimeStep (0);
+    }
+  return TimeStep (id.GetTs () - Now ().GetTimeStep ());
+}
+
+void
+ParallelSimulatorImpl::Remove (const EventId &id)
+{
+  if (id.GetUid () == 2)
+    {
+      NS_ASSERT_MSG (m_current == 0, "Destroy events can only be removed from the main thread");
+      for (DestroyEvents::iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == id)
+            {
+              m_destroyEvents.erase (i);
+              break;
+            }
+        }
+      return;
+    }
+  // the event stays in the list of its partition, which may belong
+  // to another thread, and is dropped when it comes up
+  Cancel (id);
+}
+
+void
+ParallelSimulatorImpl::Cancel (const EventId &id)
+{
+  if (!IsExpired (id))
+    {
+      id.PeekEventImpl ()->Cancel ();
+    }
+}
+
+bool
+ParallelSimulatorImpl::IsExpired (const EventId &ev) const
+{
+  if (ev.GetUid () == 2)
+    {
+      if (ev.PeekEventImpl () == 0 ||
+          ev.PeekEventImpl ()->IsCancelled ())
+        {
+          return true;
+        }
+      // destroy events.
+      for (DestroyEvents::const_iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == ev)
+            {
+              return false;
+            }
+        }
+      return true;
+    }
+  // the uids within a window are provisional, so events which ran are
+  // marked as cancelled instead of being told apart by their uid
+  Partition *current = m_current;
+  EventImpl *currentEvent = current != 0 ? current->currentEvent : m_currentEvent;
+  if (ev.PeekEventImpl () == 0 ||
+      ev.GetTs () < (uint64_t) Now ().GetTimeStep () ||
+      ev.PeekEventImpl () == currentEvent ||
+      ev.PeekEventImpl ()->IsCancelled ())
+    {
+      return true;
+    }
+  return false;
+}
+
+Time
+ParallelSimulatorImpl::GetMaximumSimulationTime (void) const
+{
+  return TimeStep (0x7fffffffffffffffLL);
+}
+
+void
+ParallelSimulatorImpl::Stop (void)
+{
+  m_stop = true;
+}
+
+void
+ParallelSimulatorImpl::Stop (Time const &time)
+{
+  Simulator::Schedule (time, &Simulator::Stop);
+}
+
+void
+ParallelSimulatorImpl::Ingest (Partition &partition)
+{
+  for (std::vector<Scheduler::Event>::const_iterator i = partition.inbox.begin ();
+       i != partition.inbox.end (); i++)
+    {
+      partition.events->Insert (*i);
+    }
+  partition.inbox.clear ();
+}
+
+bool
+ParallelSimulatorImpl::NextTs (uint64_t &ts) const
+{
+  ts = m_inboxTs;
+  for (uint32_t i = 0; i < m_partitions.size (); i++)
+    {
+      if (!m_partitions[i].events->IsEmpty ())
+        {
+          ts = std::min (ts, m_partitions[i].events->PeekNext ().key.m_ts);
+        }
+    }
+  return ts != NO_TS;
+}
+
+bool
+ParallelSimulatorImpl::IsFinished (void) const
+{
+  uint64_t ts;
+  return !NextTs (ts) || m_stop;
+}
+
+Time
+ParallelSimulatorImpl::Next (void) const
+{
+  uint64_t ts;
+  NextTs (ts);
+  return TimeStep (ts);
+}
+
+bool
+ParallelSimulatorImpl::PeekNextSerial (uint32_t &partition) const
+{
+  bool found = false;
+  Scheduler::Event best;
+  for (uint32_t i = 0; i < m_partitions.size (); i++)
+    {
+      if (m_partitions[i].events->IsEmpty ())
+        {
+          continue;
+        }
+      Scheduler::Event ev = m_partitions[i].events->PeekNext ();
+      if (!found || ev.key < best.key)
+        {
+          best = ev;
+          partition = i;
+          found = true;
+        }
+    }
+  return found;
+}
+
+void
+ParallelSimulatorImpl::ProcessOneSerialEvent (uint32_t partition)
+{
+  Scheduler::Event next = m_partitions[partition].events->RemoveNext ();
+  NS_ASSERT (next.key.m_ts >= m_currentTs);
+  NS_LOG_LOGIC ("handle " << next.key.m_ts);
+  m_currentTs = next.key.m_ts;
+  m_currentContext = next.key.m_context;
+  m_currentEvent = next.impl;
+  next.impl->Invoke ();
+  next.impl->Cancel ();
+  m_currentEvent = 0;
+  next.impl->Unref ();
+}
+
+void
+ParallelSimulatorImpl::RunSerial (uint64_t ts)
+{
+  for (uint32_t i = 0; i < m_partitions.size (); i++)
+    {
+      Ingest (m_partitions[i]);
+    }
+  m_inboxTs = NO_TS;
+  uint32_t partition;
+  while (!m_stop && PeekNextSerial (partition) &&
+         m_partitions[partition].events->PeekNext ().key.m_ts == ts)
+    {
+      ProcessOneSerialEvent (partition);
+    }
+}
+
+void
+ParallelSimulatorImpl::RunWindow (Partition &partition)
+{
+  m_current = &partition;
+  Ingest (partition);
+  Ptr<Scheduler> events = partition.events;
+  while (!events->IsEmpty () && events->PeekNext ().key.m_ts < m_windowEnd)
+    {
+      Scheduler::Event next = events->RemoveNext ();
+      partition.currentTs = next.key.m_ts;
+      partition.currentContext = next.key.m_context;
+      partition.currentEvent = next.impl;
+      Executed executed;
+      executed.ts = next.key.m_ts;
+      executed.uid = next.key.m_uid;
+      next.impl->Invoke ();
+      executed.createdEnd = partition.created.size ();
+      partition.executed.push_back (executed);
+      next.impl->Cancel ();
+      partition.currentEvent = 0;
+      next.impl->Unref ();
+    }
+  m_current = 0;
+}
+
+void
+ParallelSimulatorImpl::MergeWindow (void)
+{
+  // Replay the order in which the sequential simulator would have run
+  // the events of the window: it would have given the events scheduled
+  // by each of them the next uids, in the order they were scheduled.
+  // The parent of an event scheduled within the window ran before it
+  // in the same partition, so the final uid of every partition's next
+  // event is known when it is compared.
+  std::vector<uint32_t> next (m_nPartitions, 0);
+  std::vector<uint32_t> created (m_nPartitions, 0);
+  while (true)
+    {
+      uint32_t best = m_nPartitions;
+      uint64_t bestTs = 0;
+      uint32_t bestUid = 0;
+      for (uint32_t i = 0; i < m_nPartitions; i++)
+        {
+          Partition &partition = m_partitions[i];
+          if (next[i] == partition.executed.size ())
+            {
+              continue;
+            }
+          const Executed &executed = partition.executed[next[i]];
+          uint32_t uid = executed.uid;
+          if (uid >= m_windowUid)
+            {
+              uid = partition.created[uid - m_windowUid].ev.key.m_uid;
+            }
+          if (best == m_nPartitions || executed.ts < bestTs ||
+              (executed.ts == bestTs && uid < bestUid))
+            {
+              best = i;
+              bestTs = executed.ts;
+              bestUid = uid;
+            }
+        }
+      if (best == m_nPartitions)
+        {
+          break;
+        }
+      Partition &partition = m_partitions[best];
+      uint32_t end = partition.executed[next[best]].createdEnd;
+      for (uint32_t j = created[best]; j < end; j++)
+        {
+          Created &child = partition.created[j];
+          child.ev.key.m_uid = m_uid;
+          m_uid++;
+          switch (child.kind)
+            {
+            case Created::WINDOW:
+              break;
+            case Created::LATER:
+              m_partitions[child.partition].inbox.push_back (child.ev);
+              m_inboxTs = std::min (m_inboxTs, child.ev.key.m_ts);
+              break;
+            case Created::DESTROY:
+              m_destroyEvents.push_back (EventId (Ptr<EventImpl> (child.ev.impl, false),
+                                                  child.ev.key.m_ts, NO_CONTEXT, 2));
+              break;
+            }
+        }
+      created[best] = end;
+      next[best]++;
+    }
+  for (uint32_t i = 0; i < m_nPartitions; i++)
+    {
+      Partition &partition = m_partitions[i];
+      NS_ASSERT (created[i] == partition.created.size ());
+      m_currentTs = std::max (m_currentTs, partition.executed.empty () ?
+                              0 : partition.executed.back ().ts);
+      partition.executed.clear ();
+      partition.created.clear ();
+    }
+  // the events without a context are only run from the main thread
+  Ingest (m_partitions[m_nPartitions]);
+}
+
+void
+ParallelSimulatorImpl::DoWork (void)
+{
+  uint32_t i = __sync_add_and_fetch (&m_nextWorker, 1);
+  Packet::SetPartition (i);
+  RngStream::SetPartition (i);
+  while (true)
+    {
+      m_barrier->Wait ();
+      if (m_quit)
+        {
+          break;
+        }
+      RunWindow (m_partitions[i]);
+      m_barrier->Wait ();
+    }
+}
+
+void
+ParallelSimulatorImpl::StartWorkers (void)
+{
+  m_barrier = new WindowBarrier (m_nPartitions);
+  m_nextWorker = 0;
+  m_quit = false;
+  for (uint32_t i = 1; i < m_nPartitions; i++)
+    {
+      Ptr<SystemThread> worker = Create<SystemThread> (MakeCallback (&ParallelSimulatorImpl::DoWork, this));
+      worker->Start ();
+      m_workers.push_back (worker);
+    }
+}
+
+void
+ParallelSimulatorImpl::StopWorkers (void)
+{
+  m_quit = true;
+  m_barrier->Wait ();
+  for (uint32_t i = 0; i < m_workers.size (); i++)
+    {
+      m_workers[i]->Join ();
+    }
+  m_workers.clear ();
+  delete m_barrier;
+  m_barrier = 0;
+}
+
+void
+ParallelSimulatorImpl::Run (void)
+{
+  SetupPartitions ();
+  m_stop = false;
+  StartWorkers ();
+  uint64_t ts;
+  while (!m_stop && NextTs (ts))
+    {
+      Ptr<Scheduler> global = m_partitions[m_nPartitions].events;
+      uint64_t globalTs = global->IsEmpty () ? NO_TS : global->PeekNext ().key.m_ts;
+      if (ts == globalTs || ts == 0)
+        {
+          RunSerial (ts);
+          continue;
+        }
+      m_windowEnd = globalTs;
+      if (ts + m_lookAhead > ts)
+        {
+          m_windowEnd = std::min (m_windowEnd, ts + m_lookAhead);
+        }
+      m_windowUid = m_uid;
+      m_inboxTs = NO_TS;
+      m_barrier->Wait ();
+      RunWindow (m_partitions[0]);
+      m_barrier->Wait ();
+      MergeWindow ();
+    }
+  StopWorkers ();
+}
+
+void
+ParallelSimulatorImpl::RunOneEvent (void)
+{
+  SetupPartitions ();
+  for (uint32_t i = 0; i < m_partitions.size (); i++)
+    {
+      Ingest (m_partitions[i]);
+    }
+  m_inboxTs = NO_TS;
+  uint32_t partition;
+  if (PeekNextSerial (partition))
+    {
+      ProcessOneSerialEvent (partition);
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,211 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 University of Pennsylvania
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PARALLEL_SIMULATOR_IMPL_H
+#define PARALLEL_SIMULATOR_IMPL_H
+
+#include "ns3/simulator-impl.h"
+#include "ns3/scheduler.h"
+#include "ns3/event-impl.h"
+#include "ns3/object-factory.h"
+#include "ns3/system-thread.h"
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+
+#include <list>
+#include <vector>
+
+namespace ns3 {
+
+class WindowBarrier;
+
+/**
+ * \brief conservative parallel simulator implementation using threads
+ *
+ * The nodes are split into partitions, by their system id as for the
+ * DistributedSimulatorImpl unless SetPartitions is called, and every
+ * partition runs on its own thread with its own event list. The
+ * threads advance in windows no longer than the lookahead, the
+ * smallest delay of the point-to-point links between partitions, so
+ * that no event a partition schedules for another one can fall into
+ * the current window. Events for other partitions are collected by
+ * the thread which scheduled them and handed over at the end of the
+ * window, without any locking while the window runs.
+ *
+ * The events of a window are given the uids the sequential simulator
+ * would have given them once the window is over: the uid of an event
+ * follows from the order in which its parent ran, which is merged
+ * from the partitions by (timestamp, uid). Every partition therefore
+ * runs its events in exactly the order of the DefaultSimulatorImpl,
+ * whatever the number of threads. The uids of the EventIds returned
+ * within a window are provisional, which only matters to callers who
+ * compare uids themselves.
+ *
+ * Events without a node context, such as the commands of a scenario,
+ * may touch any node: they run on the main thread, along with all the
+ * events of the same timestamp, in sequential order. So do the events
+ * at time zero, where models start up and take their random number
+ * streams from the shared generator.
+ *
+ * Packet uids and the random number streams created later are taken
+ * per partition: each partition numbers its packets and draws its
+ * streams from its own sequence (Packet::SetPartition,
+ * RngStream::SetPartition). Both therefore differ from those of the
+ * DefaultSimulatorImpl, but not from one run to the next with the same
+ * partitions, seed and run number.
+ *
+ * The models must not share state between nodes other than through
+ * point-to-point channels, or must lock it. Packets are made
+ * thread-safe with Packet::EnableThreadSafety as soon as more than
+ * one partition runs, which rules out the packet and event pools.
+ * Simulator::Stop called from a node stops at the end of the window.
+ */
+class ParallelSimulatorImpl : public SimulatorImpl
+{
+public:
+  static TypeId GetTypeId (void);
+
+  ParallelSimulatorImpl ();
+  ~ParallelSimulatorImpl ();
+
+  /**
+   * \param partitions the partition of every node, indexed by node id
+   *
+   * Replaces the system ids of the nodes, which are fixed when the
+   * nodes are created. Must be called before Run.
+   */
+  void SetPartitions (const std::vector<uint32_t> &partitions);
+  /**
+   * \returns the number of partitions, which is the number of threads
+   * once the simulation runs
+   */
+  uint32_t GetNPartitions (void) const;
+
+  // virtual from SimulatorImpl
+  virtual void Destroy ();
+  virtual bool IsFinished (void) const;
+  virtual Time Next (void) const;
+  virtual void Stop (void);
+  virtual void Stop (Time const &time);
+  virtual EventId Schedule (Time const &time, EventImpl *event);
+  virtual void ScheduleWithContext (uint32_t context, Time const &time, EventImpl *event);
+  virtual EventId ScheduleNow (EventImpl *event);
+  virtual EventId ScheduleDestroy (EventImpl *event);
+  virtual void Remove (const EventId &ev);
+  virtual void Cancel (const EventId &ev);
+  virtual bool IsExpired (const EventId &ev) const;
+  virtual void Run (void);
+  virtual void RunOneEvent (void);
+  virtual Time Now (void) const;
+  virtual Time GetDelayLeft (const EventId &id) const;
+  virtual Time GetMaximumSimulationTime (void) const;
+  virtual void SetScheduler (ObjectFactory schedulerFactory);
+  virtual uint32_t GetSystemId (void) const;
+  virtual uint32_t GetContext (void) const;
+
+private:
+  // an event run by a partition within the current window, and the
+  // end of the events it scheduled in the created list
+  struct Executed
+  {
+    uint64_t ts;
+    uint32_t uid;
+    uint32_t createdEnd;
+  };
+  // an event scheduled within the current window, whose uid is
+  // provisional until the window is merged
+  struct Created
+  {
+    enum Kind
+    {
+      // inserted into the event list of its own partition, to be run
+      // within the window
+      WINDOW,
+      // handed over to the inbox of its partition after the window
+      LATER,
+      DESTROY
+    };
+    Scheduler::Event ev;
+    uint32_t partition;
+    Kind kind;
+  };
+  struct Partition
+  {
+    Ptr<Scheduler> events;
+    // events from the last window not yet in the event list
+    std::vector<Scheduler::Event> inbox;
+    std::vector<Executed> executed;
+    std::vector<Created> created;
+    uint64_t currentTs;
+    uint32_t currentContext;
+    EventImpl *currentEvent;
+  };
+
+  virtual void DoDispose (void);
+  void SetupPartitions (void);
+  void CalculateLookAhead (void);
+  uint32_t GetPartition (uint32_t context) const;
+  uint32_t DoSchedule (uint64_t ts, uint32_t context, EventImpl *event);
+  void Ingest (Partition &partition);
+  bool NextTs (uint64_t &ts) const;
+  bool PeekNextSerial (uint32_t &partition) const;
+  void ProcessOneSerialEvent (uint32_t partition);
+  void RunSerial (uint64_t ts);
+  void RunWindow (Partition &partition);
+  void MergeWindow (void);
+  void DoWork (void);
+  void StartWorkers (void);
+  void StopWorkers (void);
+
+  typedef std::list<EventId> DestroyEvents;
+
+  DestroyEvents m_destroyEvents;
+  bool m_stop;
+  ObjectFactory m_schedulerFactory;
+  // the node partitions, followed by the partition of the events
+  // without a context, which never runs within a window
+  std::vector<Partition> m_partitions;
+  uint32_t m_nPartitions;
+  std::vector<uint32_t> m_contextPartition;
+  bool m_setup;
+  uint32_t m_uid;
+  // state of the main thread, outside of the windows
+  uint64_t m_currentTs;
+  uint32_t m_currentContext;
+  EventImpl *m_currentEvent;
+  // smallest timestamp in the inboxes
+  uint64_t m_inboxTs;
+
+  Time m_lookAheadAttribute;
+  uint64_t m_lookAhead;
+  uint64_t m_windowEnd;
+  // the provisional uids of the current window start here
+  uint32_t m_windowUid;
+
+  std::vector<Ptr<SystemThread> > m_workers;
+  uint32_t m_nextWorker;
+  bool m_quit;
+  WindowBarrier *m_barrier;
+
+  // the partition the current thread runs, zero outside of the windows
+  static __thread Partition *m_current;
+};
+
+} // namespace ns3
+
+#endif /* PARALLEL_SIMULATOR_IMPL_H */
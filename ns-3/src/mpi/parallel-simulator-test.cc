@@ -0,0 +1,375 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 University of Pennsylvania
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "parallel-simulator-impl.h"
+#include "ns3/simulator.h"
+#include "ns3/default-simulator-impl.h"
+#include "ns3/object-factory.h"
+#include "ns3/test.h"
+#include <sstream>
+#include <vector>
+
+using namespace ns3;
+
+static const uint32_t N_CONTEXTS = 8;
+static const uint32_t LOOKAHEAD_NS = 1000000;
+
+class ParallelSimulatorOrderTestCase : public TestCase
+{
+public:
+  ParallelSimulatorOrderTestCase (uint32_t nPartitions);
+  virtual bool DoRun (void);
+
+private:
+  struct Context
+  {
+    uint32_t seed;
+    uint32_t budget;
+    EventId timer;
+    std::vector<uint64_t> log;
+  };
+  uint32_t Random (Context &context, uint32_t max);
+  void Step (uint32_t context, uint32_t tag);
+  void Global (uint32_t tag);
+  void Destroyed (uint32_t context, uint32_t tag);
+  void RunOnce (Ptr<SimulatorImpl> impl);
+
+  uint32_t m_nPartitions;
+  std::vector<Context> m_contexts;
+  std::vector<uint64_t> m_global;
+  std::vector<uint64_t> m_destroyed;
+};
+
+ParallelSimulatorOrderTestCase::ParallelSimulatorOrderTestCase (uint32_t nPartitions)
+  : TestCase (""),
+    m_nPartitions (nPartitions)
+{
+  std::ostringstream oss;
+  oss << "Check that every node runs its events in sequential order with "
+      << nPartitions << " partitions";
+  SetName (oss.str ());
+}
+
+uint32_t
+ParallelSimulatorOrderTestCase::Random (Context &context, uint32_t max)
+{
+  context.seed = context.seed * 1103515245 + 12345;
+  return (context.seed >> 8) % max;
+}
+
+void
+ParallelSimulatorOrderTestCase::Step (uint32_t id, uint32_t tag)
+{
+  Context &context = m_contexts[id];
+  context.log.push_back (Simulator::Now ().GetTimeStep ());
+  context.log.push_back (tag);
+  if (context.budget == 0)
+    {
+      return;
+    }
+  context.budget--;
+  uint32_t n = (Random (context, 3) == 0) ? 2 : 1;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      uint32_t child = Random (context, 1000000);
+      switch (Random (context, 8))
+        {
+        case 0:
+        case 1:
+          Simulator::Schedule (NanoSeconds (Random (context, 1000)),
+                               &ParallelSimulatorOrderTestCase::Step, this, id, child);
+          break;
+        case 2:
+          Simulator::ScheduleNow (&ParallelSimulatorOrderTestCase::Step, this, id, child);
+          break;
+        case 3:
+          // a timer which is restarted before it expires half the time
+          context.log.push_back (Simulator::IsExpired (context.timer));
+          Simulator::Cancel (context.timer);
+          context.timer = Simulator::Schedule (MicroSeconds (Random (context, 5000)),
+                                               &ParallelSimulatorOrderTestCase::Step, this, id, child);
+          break;
+        case 4:
+        case 5:
+          {
+            uint32_t target = Random (context, N_CONTEXTS);
+            Simulator::ScheduleWithContext (target,
+                                            NanoSeconds (LOOKAHEAD_NS + Random (context, 3000000)),
+                                            &ParallelSimulatorOrderTestCase::Step, this,
+                                            target, child);
+          }
+          break;
+        case 6:
+          {
+            // lands exactly at the end of the window
+            uint32_t target = Random (context, N_CONTEXTS);
+            Simulator::ScheduleWithContext (target, NanoSeconds (LOOKAHEAD_NS),
+                                            &ParallelSimulatorOrderTestCase::Step, this,
+                                            target, child);
+          }
+          break;
+        default:
+          Simulator::ScheduleDestroy (&ParallelSimulatorOrderTestCase::Destroyed, this, id, child);
+          break;
+        }
+    }
+}
+
+void
+ParallelSimulatorOrderTestCase::Global (uint32_t tag)
+{
+  m_global.push_back (Simulator::Now ().GetTimeStep ());
+  m_global.push_back (tag);
+  for (uint32_t i = 0; i < N_CONTEXTS; i += 3)
+    {
+      Simulator::ScheduleWithContext (i, Seconds (0), &ParallelSimulatorOrderTestCase::Step,
+                                      this, i, tag);
+    }
+}
+
+void
+ParallelSimulatorOrderTestCase::Destroyed (uint32_t context, uint32_t tag)
+{
+  m_destroyed.push_back (context);
+  m_destroyed.push_back (tag);
+}
+
+void
+ParallelSimulatorOrderTestCase::RunOnce (Ptr<SimulatorImpl> impl)
+{
+  m_contexts.clear ();
+  m_contexts.resize (N_CONTEXTS);
+  m_global.clear ();
+  m_destroyed.clear ();
+  for (uint32_t i = 0; i < N_CONTEXTS; i++)
+    {
+      m_contexts[i].seed = i + 1;
+      m_contexts[i].budget = 3000;
+    }
+  Simulator::Destroy ();
+  Simulator::SetImplementation (impl);
+  for (uint32_t i = 0; i < N_CONTEXTS; i++)
+    {
+      Simulator::ScheduleWithContext (i, Seconds (0), &ParallelSimulatorOrderTestCase::Step,
+                                      this, i, i);
+      Simulator::ScheduleWithContext (i, NanoSeconds (13 * i + 1),
+                                      &ParallelSimulatorOrderTestCase::Step, this, i, i);
+    }
+  for (uint32_t i = 0; i < 20; i++)
+    {
+      Simulator::Schedule (MilliSeconds (7 * i + 1), &ParallelSimulatorOrderTestCase::Global,
+                           this, i);
+    }
+  Simulator::Run ();
+  m_global.push_back (Simulator::Now ().GetTimeStep ());
+  Simulator::Destroy ();
+}
+
+bool
+ParallelSimulatorOrderTestCase::DoRun (void)
+{
+  RunOnce (CreateObject<DefaultSimulatorImpl> ());
+  std::vector<Context> contexts = m_contexts;
+  std::vector<uint64_t> global = m_global;
+  std::vector<uint64_t> destroyed = m_destroyed;
+
+  ObjectFactory factory;
+  factory.SetTypeId (ParallelSimulatorImpl::GetTypeId ());
+  factory.Set ("LookAhead", TimeValue (NanoSeconds (LOOKAHEAD_NS)));
+  Ptr<ParallelSimulatorImpl> impl = factory.Create<ParallelSimulatorImpl> ();
+  std::vector<uint32_t> partitions;
+  for (uint32_t i = 0; i < N_CONTEXTS; i++)
+    {
+      partitions.push_back (i % m_nPartitions);
+    }
+  impl->SetPartitions (partitions);
+  RunOnce (impl);
+
+  for (uint32_t i = 0; i < N_CONTEXTS; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_contexts[i].log.size (), contexts[i].log.size (),
+                             "Context " << i << " ran another number of events");
+      NS_TEST_ASSERT_MSG_EQ ((m_contexts[i].log == contexts[i].log), true,
+                             "Context " << i << " ran its events in another order");
+    }
+  NS_TEST_ASSERT_MSG_EQ ((m_global == global), true, "Global events differ");
+  NS_TEST_ASSERT_MSG_EQ ((m_destroyed == destroyed), true, "Destroy events differ");
+  return false;
+}
+
+// Nodes on a ring pass messages to their neighbours over links of the
+// lookahead delay, as simulator-main does over its point-to-point links,
+// and restart a retransmission timer on every message. Every event is
+// folded into a hash of its node, which must come out the same as with
+// the sequential simulator.
+class ParallelSimulatorHashTestCase : public TestCase
+{
+public:
+  ParallelSimulatorHashTestCase (uint32_t nPartitions, bool interleaved);
+  virtual bool DoRun (void);
+
+private:
+  struct Node
+  {
+    uint64_t hash;
+    uint32_t events;
+    uint32_t sent;
+    EventId retransmit;
+  };
+  void Record (uint32_t id, uint64_t value);
+  void Receive (uint32_t id, uint32_t from, uint32_t message);
+  void Retransmit (uint32_t id, uint32_t message);
+  void Send (uint32_t id, uint32_t to, uint32_t message);
+  void RunOnce (Ptr<SimulatorImpl> impl);
+
+  uint32_t m_nPartitions;
+  bool m_interleaved;
+  std::vector<Node> m_nodes;
+};
+
+ParallelSimulatorHashTestCase::ParallelSimulatorHashTestCase (uint32_t nPartitions, bool interleaved)
+  : TestCase (""),
+    m_nPartitions (nPartitions),
+    m_interleaved (interleaved)
+{
+  std::ostringstream oss;
+  oss << "Check the event hash of a ring against the sequential run with "
+      << nPartitions << (interleaved ? " interleaved" : " contiguous") << " partitions";
+  SetName (oss.str ());
+}
+
+void
+ParallelSimulatorHashTestCase::Record (uint32_t id, uint64_t value)
+{
+  // FNV-1a
+  Node &node = m_nodes[id];
+  for (uint32_t i = 0; i < 8; i++)
+    {
+      node.hash ^= (value >> (8 * i)) & 0xff;
+      node.hash *= 1099511628211ULL;
+    }
+}
+
+void
+ParallelSimulatorHashTestCase::Send (uint32_t id, uint32_t to, uint32_t message)
+{
+  m_nodes[id].sent++;
+  Simulator::ScheduleWithContext (to, NanoSeconds (LOOKAHEAD_NS + message % 7),
+                                  &ParallelSimulatorHashTestCase::Receive, this, to, id, message);
+}
+
+void
+ParallelSimulatorHashTestCase::Receive (uint32_t id, uint32_t from, uint32_t message)
+{
+  Node &node = m_nodes[id];
+  node.events++;
+  Record (id, Simulator::Now ().GetTimeStep ());
+  Record (id, Simulator::GetContext ());
+  Record (id, ((uint64_t) from << 32) | message);
+  Record (id, node.retransmit.IsExpired ());
+  Simulator::Cancel (node.retransmit);
+  if (node.sent >= 400)
+    {
+      return;
+    }
+  uint32_t next = message * 1103515245 + 12345;
+  node.retransmit = Simulator::Schedule (NanoSeconds (3 * LOOKAHEAD_NS + next % 1000),
+                                         &ParallelSimulatorHashTestCase::Retransmit, this, id, next);
+  Send (id, (id + 1) % N_CONTEXTS, next);
+  if (message % 3 == 0)
+    {
+      Send (id, (id + N_CONTEXTS - 1) % N_CONTEXTS, next >> 4);
+    }
+}
+
+void
+ParallelSimulatorHashTestCase::Retransmit (uint32_t id, uint32_t message)
+{
+  m_nodes[id].events++;
+  Record (id, Simulator::Now ().GetTimeStep ());
+  Record (id, message);
+  Send (id, (id + 1) % N_CONTEXTS, message);
+}
+
+void
+ParallelSimulatorHashTestCase::RunOnce (Ptr<SimulatorImpl> impl)
+{
+  m_nodes.clear ();
+  m_nodes.resize (N_CONTEXTS);
+  for (uint32_t i = 0; i < N_CONTEXTS; i++)
+    {
+      m_nodes[i].hash = 14695981039346656037ULL;
+      m_nodes[i].events = 0;
+      m_nodes[i].sent = 0;
+    }
+  Simulator::Destroy ();
+  Simulator::SetImplementation (impl);
+  for (uint32_t i = 0; i < N_CONTEXTS; i += 2)
+    {
+      Simulator::ScheduleWithContext (i, MicroSeconds (i), &ParallelSimulatorHashTestCase::Receive,
+                                      this, i, i, i);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+bool
+ParallelSimulatorHashTestCase::DoRun (void)
+{
+  RunOnce (CreateObject<DefaultSimulatorImpl> ());
+  std::vector<Node> nodes = m_nodes;
+
+  ObjectFactory factory;
+  factory.SetTypeId (ParallelSimulatorImpl::GetTypeId ());
+  factory.Set ("LookAhead", TimeValue (NanoSeconds (LOOKAHEAD_NS)));
+  Ptr<ParallelSimulatorImpl> impl = factory.Create<ParallelSimulatorImpl> ();
+  std::vector<uint32_t> partitions;
+  for (uint32_t i = 0; i < N_CONTEXTS; i++)
+    {
+      partitions.push_back (m_interleaved ? i % m_nPartitions : i * m_nPartitions / N_CONTEXTS);
+    }
+  impl->SetPartitions (partitions);
+  RunOnce (impl);
+
+  uint64_t hash = 0;
+  uint64_t sequentialHash = 0;
+  for (uint32_t i = 0; i < N_CONTEXTS; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_nodes[i].events, nodes[i].events,
+                             "Node " << i << " ran another number of events");
+      NS_TEST_ASSERT_MSG_EQ (m_nodes[i].hash, nodes[i].hash, "Node " << i << " ran other events");
+      hash = hash * 31 + m_nodes[i].hash;
+      sequentialHash = sequentialHash * 31 + nodes[i].hash;
+    }
+  NS_TEST_ASSERT_MSG_EQ (hash, sequentialHash, "The run differs from the sequential one");
+  return false;
+}
+
+static class ParallelSimulatorTestSuite : public TestSuite
+{
+public:
+  ParallelSimulatorTestSuite ()
+    : TestSuite ("parallel-simulator")
+  {
+    AddTestCase (new ParallelSimulatorOrderTestCase (1));
+    AddTestCase (new ParallelSimulatorOrderTestCase (2));
+    AddTestCase (new ParallelSimulatorOrderTestCase (4));
+    AddTestCase (new ParallelSimulatorHashTestCase (2, false));
+    AddTestCase (new ParallelSimulatorHashTestCase (4, true));
+  }
+} g_parallelSimulatorTestSuite;
@@ -19,9 +19,14 @@
  */
 
 #include "event-impl.h"
+#include <new>
 
 namespace ns3 {
 
+bool EventImpl::g_poolEnabled = false;
+struct EventImpl::FreeEvent *EventImpl::g_pool[POOL_SIZE_CLASSES];
+uint32_t EventImpl::g_poolCount[POOL_SIZE_CLASSES];
+
 EventImpl::~EventImpl ()
 {}
 
@@ -50,4 +55,63 @@ EventImpl::IsCancelled (void)
   return m_cancel;
 }
 
+void
+EventImpl::EnablePool (bool enable)
+{
+  g_poolEnabled = enable;
+  if (!enable)
+    {
+      for (uint32_t sc = 0; sc < POOL_SIZE_CLASSES; sc++)
+        {
+          while (g_pool[sc] != 0)
+            {
+              struct FreeEvent *block = g_pool[sc];
+              g_pool[sc] = block->m_next;
+              ::operator delete (block);
+            }
+          g_poolCount[sc] = 0;
+        }
+    }
+}
+
+void *
+EventImpl::operator new (size_t size)
+{
+  uint32_t sc = (size - 1) / POOL_GRANULARITY;
+  if (sc >= POOL_SIZE_CLASSES)
+    {
+      return ::operator new (size);
+    }
+  if (g_poolEnabled && g_pool[sc] != 0)
+    {
+      struct FreeEvent *block = g_pool[sc];
+      g_pool[sc] = block->m_next;
+      g_poolCount[sc]--;
+      return block;
+    }
+  /* round up to the class size, even with the pool disabled, so that
+   * any block can be recycled for any event of its class.
+   */
+  return ::operator new ((sc + 1) * POOL_GRANULARITY);
+}
+
+void
+EventImpl::operator delete (void *p, size_t size)
+{
+  /* the destructor is virtual, so size is the size of the subclass
+   * which was created.
+   */
+  uint32_t sc = (size - 1) / POOL_GRANULARITY;
+  if (g_poolEnabled && sc < POOL_SIZE_CLASSES &&
+      g_poolCount[sc] < POOL_MAX_FREE)
+    {
+      struct FreeEvent *block = static_cast<struct FreeEvent *> (p);
+      block->m_next = g_pool[sc];
+      g_pool[sc] = block;
+      g_poolCount[sc]++;
+      return;
+    }
+  ::operator delete (p);
+}
+
 } // namespace ns3
@@ -21,6 +21,7 @@
 #define EVENT_IMPL_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include "ns3/simple-ref-count.h"
 
 namespace ns3 {
@@ -57,11 +58,41 @@ public:
    * Invoked by the simulation engine before calling Invoke.
    */
   bool IsCancelled (void);
+  /**
+   * \param enable true to recycle the memory of released events.
+   *
+   * By default, every event created by MakeEvent and the Schedule
+   * methods is allocated from and released to the heap, once per
+   * scheduled event. When the pool is enabled, event objects of up to
+   * 256 bytes are rounded up to a multiple of 16 bytes and kept on a
+   * per-size free list when their last reference is dropped, to be
+   * handed out again to the next event of that size. Disabling the
+   * pool releases all cached events. The pool is not locked: do not
+   * enable it when events are created from other threads, as with
+   * the realtime simulator.
+   */
+  static void EnablePool (bool enable);
+
+  static void *operator new (size_t size);
+  static void operator delete (void *p, size_t size);
 
 protected:
   virtual void Notify (void) = 0;
 
 private:
+  /* the first bytes of a recycled event hold the next free event. */
+  struct FreeEvent
+  {
+    struct FreeEvent *m_next;
+  };
+  static const uint32_t POOL_GRANULARITY = 16;
+  static const uint32_t POOL_SIZE_CLASSES = 16;
+  /* maximum number of free events kept per size class. */
+  static const uint32_t POOL_MAX_FREE = 100000;
+  static bool g_poolEnabled;
+  static struct FreeEvent *g_pool[POOL_SIZE_CLASSES];
+  static uint32_t g_poolCount[POOL_SIZE_CLASSES];
+
   bool m_cancel;
 };
 
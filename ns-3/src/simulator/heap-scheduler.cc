@@ -129,9 +129,9 @@ HeapScheduler::IsEmpty (void) const
 }
 
 void
-HeapScheduler::BottomUp (void)
+HeapScheduler::BottomUp (uint32_t start)
 {
-  uint32_t index = Last ();
+  uint32_t index = start;
   while (!IsRoot (index)
          && IsLessStrictly (index, Parent (index)))
     {
@@ -179,7 +179,7 @@ void
 HeapScheduler::Insert (const Event &ev)
 {
   m_heap.push_back (ev);
-  BottomUp ();
+  BottomUp (Last ());
 }
 
 Scheduler::Event
@@ -209,7 +209,12 @@ HeapScheduler::Remove (const Event &ev)
           NS_ASSERT (m_heap[i].impl == ev.impl);
           Exch (i, Last ());
           m_heap.pop_back ();
-          TopDown (i);
+          // the last event may belong above i as well as below it
+          if (!IsBottom (i))
+            {
+              TopDown (i);
+              BottomUp (i);
+            }
           return;
         }
     }
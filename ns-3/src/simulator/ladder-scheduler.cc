@@ -0,0 +1,325 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 University of Pennsylvania
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ladder-scheduler.h"
+#include "event-impl.h"
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE ("LadderScheduler");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (LadderScheduler);
+
+// a bucket with more events than this is split into a new rung
+// rather than sorted into Bottom, and so is a Bottom that grows past it
+static const uint32_t LADDER_THRESHOLD = 50;
+// deeper rungs are not worth their bookkeeping, buckets that would
+// need them are sorted into Bottom as they are
+static const uint32_t LADDER_MAX_RUNGS = 8;
+
+TypeId
+LadderScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LadderScheduler")
+    .SetParent<Scheduler> ()
+    .AddConstructor<LadderScheduler> ()
+  ;
+  return tid;
+}
+
+LadderScheduler::LadderScheduler ()
+  : m_topStart (0),
+    m_topMin (~(uint64_t)0),
+    m_topMax (0),
+    m_rungs (LADDER_MAX_RUNGS),
+    m_nRungs (0),
+    m_bottomHead (0),
+    m_size (0)
+{
+  for (uint32_t i = 0; i < m_rungs.size (); i++)
+    {
+      m_rungs[i].size = 0;
+      m_rungs[i].current = 0;
+    }
+}
+LadderScheduler::~LadderScheduler ()
+{
+}
+
+uint64_t
+LadderScheduler::CurrentStart (const Rung &rung)
+{
+  return rung.start + rung.current * rung.width;
+}
+
+uint32_t
+LadderScheduler::BucketIndex (const Rung &rung, uint64_t ts)
+{
+  NS_ASSERT (ts >= rung.start);
+  uint64_t index = (ts - rung.start) / rung.width;
+  // the last bucket also holds the events up to the start of the
+  // rung above, which may lie past the end of this rung
+  if (index >= rung.size)
+    {
+      return rung.size - 1;
+    }
+  return index;
+}
+
+uint32_t
+LadderScheduler::FindRung (uint64_t ts) const
+{
+  // the coarser rungs start later, so the first rung whose unread
+  // buckets start before ts is the one it belongs to.  A rung whose
+  // buckets were all read only waits for FillBottom to drop it, its
+  // last bucket cannot take events anymore.
+  for (uint32_t i = 0; i < m_nRungs; i++)
+    {
+      const Rung &rung = m_rungs[i];
+      if (rung.current < rung.size && ts >= CurrentStart (rung))
+        {
+          return i;
+        }
+    }
+  return m_nRungs;
+}
+
+void
+LadderScheduler::SpawnRung (Bucket::const_iterator begin, Bucket::const_iterator end,
+                            uint64_t minTs, uint64_t maxTs)
+{
+  NS_ASSERT (m_nRungs < LADDER_MAX_RUNGS);
+  NS_ASSERT (minTs < maxTs);
+  uint32_t n = end - begin;
+  Rung &rung = m_rungs[m_nRungs];
+  rung.start = minTs;
+  rung.width = (maxTs - minTs) / n + 1;
+  rung.size = n;
+  rung.current = 0;
+  if (rung.buckets.size () < n)
+    {
+      rung.buckets.resize (n);
+    }
+  for (Bucket::const_iterator i = begin; i != end; i++)
+    {
+      rung.buckets[BucketIndex (rung, i->key.m_ts)].push_back (*i);
+    }
+  m_nRungs++;
+  NS_LOG_DEBUG ("rung " << m_nRungs << " start=" << rung.start <<
+                " width=" << rung.width << " buckets=" << n);
+}
+
+void
+LadderScheduler::SortIntoBottom (Bucket &events)
+{
+  NS_ASSERT (m_bottomHead == m_bottom.size ());
+  m_bottom.swap (events);
+  events.clear ();
+  m_bottomHead = 0;
+  std::sort (m_bottom.begin (), m_bottom.end ());
+}
+
+void
+LadderScheduler::InsertBottom (const Event &ev)
+{
+  // new events tend to come after most of Bottom, so this mostly appends
+  Bucket::iterator pos = std::upper_bound (m_bottom.begin () + m_bottomHead,
+                                           m_bottom.end (), ev);
+  m_bottom.insert (pos, ev);
+  uint32_t pending = m_bottom.size () - m_bottomHead;
+  if (pending > LADDER_THRESHOLD && m_nRungs < LADDER_MAX_RUNGS)
+    {
+      uint64_t minTs = m_bottom[m_bottomHead].key.m_ts;
+      uint64_t maxTs = m_bottom.back ().key.m_ts;
+      if (minTs != maxTs)
+        {
+          // Bottom is too long to keep sorted, make it the finest rung.
+          // Every event in it comes before the current buckets of the
+          // other rungs, so the new rung fits below them.
+          SpawnRung (m_bottom.begin () + m_bottomHead, m_bottom.end (),
+                     minTs, maxTs);
+          m_bottom.clear ();
+          m_bottomHead = 0;
+        }
+    }
+}
+
+void
+LadderScheduler::FillBottom (void)
+{
+  NS_ASSERT (m_size > 0);
+  while (true)
+    {
+      if (m_nRungs == 0)
+        {
+          NS_ASSERT (!m_top.empty ());
+          uint64_t minTs = m_topMin;
+          uint64_t maxTs = m_topMax;
+          m_topStart = maxTs + 1;
+          m_topMin = ~(uint64_t)0;
+          m_topMax = 0;
+          if (m_top.size () <= LADDER_THRESHOLD || minTs == maxTs)
+            {
+              SortIntoBottom (m_top);
+              return;
+            }
+          SpawnRung (m_top.begin (), m_top.end (), minTs, maxTs);
+          m_top.clear ();
+          continue;
+        }
+      Rung &rung = m_rungs[m_nRungs - 1];
+      while (rung.current < rung.size && rung.buckets[rung.current].empty ())
+        {
+          rung.current++;
+        }
+      if (rung.current == rung.size)
+        {
+          m_nRungs--;
+          continue;
+        }
+      Bucket &bucket = rung.buckets[rung.current];
+      rung.current++;
+      if (bucket.size () > LADDER_THRESHOLD && rung.width > 1
+          && m_nRungs < LADDER_MAX_RUNGS)
+        {
+          uint64_t minTs = bucket[0].key.m_ts;
+          uint64_t maxTs = minTs;
+          for (Bucket::const_iterator i = bucket.begin (); i != bucket.end (); i++)
+            {
+              minTs = std::min (minTs, i->key.m_ts);
+              maxTs = std::max (maxTs, i->key.m_ts);
+            }
+          if (minTs != maxTs)
+            {
+              SpawnRung (bucket.begin (), bucket.end (), minTs, maxTs);
+              bucket.clear ();
+              continue;
+            }
+        }
+      SortIntoBottom (bucket);
+      return;
+    }
+}
+
+void
+LadderScheduler::Insert (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  uint64_t ts = ev.key.m_ts;
+  m_size++;
+  if (ts >= m_topStart)
+    {
+      m_top.push_back (ev);
+      m_topMin = std::min (m_topMin, ts);
+      m_topMax = std::max (m_topMax, ts);
+      return;
+    }
+  uint32_t i = FindRung (ts);
+  if (i < m_nRungs)
+    {
+      m_rungs[i].buckets[BucketIndex (m_rungs[i], ts)].push_back (ev);
+      return;
+    }
+  InsertBottom (ev);
+}
+
+bool
+LadderScheduler::IsEmpty (void) const
+{
+  return m_size == 0;
+}
+
+Scheduler::Event
+LadderScheduler::PeekNext (void) const
+{
+  NS_ASSERT (!IsEmpty ());
+  if (m_bottomHead == m_bottom.size ())
+    {
+      const_cast<LadderScheduler *> (this)->FillBottom ();
+    }
+  return m_bottom[m_bottomHead];
+}
+
+Scheduler::Event
+LadderScheduler::RemoveNext (void)
+{
+  NS_ASSERT (!IsEmpty ());
+  if (m_bottomHead == m_bottom.size ())
+    {
+      FillBottom ();
+    }
+  Event next = m_bottom[m_bottomHead];
+  m_bottomHead++;
+  if (m_bottomHead == m_bottom.size ())
+    {
+      m_bottom.clear ();
+      m_bottomHead = 0;
+    }
+  m_size--;
+  NS_LOG_FUNCTION (this << next.impl << next.key.m_ts << next.key.m_uid);
+  return next;
+}
+
+void
+LadderScheduler::Remove (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  uint64_t ts = ev.key.m_ts;
+  Bucket *bucket;
+  uint32_t i = FindRung (ts);
+  if (ts >= m_topStart)
+    {
+      bucket = &m_top;
+    }
+  else if (i < m_nRungs)
+    {
+      bucket = &m_rungs[i].buckets[BucketIndex (m_rungs[i], ts)];
+    }
+  else
+    {
+      Bucket::iterator pos = std::lower_bound (m_bottom.begin () + m_bottomHead,
+                                               m_bottom.end (), ev);
+      NS_ASSERT (pos != m_bottom.end () && pos->key.m_uid == ev.key.m_uid);
+      m_bottom.erase (pos);
+      if (m_bottomHead == m_bottom.size ())
+        {
+          m_bottom.clear ();
+          m_bottomHead = 0;
+        }
+      m_size--;
+      return;
+    }
+  for (Bucket::iterator j = bucket->begin (); j != bucket->end (); j++)
+    {
+      if (j->key.m_uid == ev.key.m_uid)
+        {
+          NS_ASSERT (ev.impl == j->impl);
+          // buckets are unsorted, so fill the hole with the last event
+          *j = bucket->back ();
+          bucket->pop_back ();
+          m_size--;
+          return;
+        }
+    }
+  NS_ASSERT (false);
+}
+
+} // namespace ns3
@@ -0,0 +1,106 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 University of Pennsylvania
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LADDER_SCHEDULER_H
+#define LADDER_SCHEDULER_H
+
+#include "scheduler.h"
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+class EventImpl;
+
+/**
+ * \ingroup scheduler
+ * \brief a ladder queue event scheduler
+ *
+ * This event scheduler implements the ladder queue described in "Ladder
+ * Queue: An O(1) Priority Queue Structure for Large-Scale Discrete Event
+ * Simulation" by Wai Teng Tang, Rick Siow Mong Goh and Ian Li-Jin Thng
+ * (ACM TOMACS, 2005).  Events go into one of three tiers:
+ *  - Top: an unsorted list of the events furthest in the future,
+ *  - Ladder: rungs of buckets, every rung splitting one bucket of the
+ *    rung above it into finer buckets, each bucket unsorted,
+ *  - Bottom: a short sorted list of the events to be removed next.
+ *
+ * Events are only sorted once they reach Bottom, a bucket at a time, and
+ * the bucket widths adapt to the event density, so that insert and
+ * remove-next take amortized O(1) time whatever the distribution of
+ * event times.  This suits the periodic timers and short link delays
+ * of large simulations, which keep many events pending.
+ */
+class LadderScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId (void);
+
+  LadderScheduler ();
+  virtual ~LadderScheduler ();
+
+  virtual void Insert (const Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Event PeekNext (void) const;
+  virtual Event RemoveNext (void);
+  virtual void Remove (const Event &ev);
+
+private:
+  typedef std::vector<Scheduler::Event> Bucket;
+  struct Rung
+  {
+    // timestamp at the start of the first bucket
+    uint64_t start;
+    // duration of a bucket
+    uint64_t width;
+    // number of buckets in use
+    uint32_t size;
+    // index of the first bucket not yet moved down
+    uint32_t current;
+    // never shrinks, so that the buckets keep their storage
+    std::vector<Bucket> buckets;
+  };
+
+  void FillBottom (void);
+  void SpawnRung (Bucket::const_iterator begin, Bucket::const_iterator end,
+                  uint64_t minTs, uint64_t maxTs);
+  void InsertBottom (const Event &ev);
+  void SortIntoBottom (Bucket &events);
+  uint32_t FindRung (uint64_t ts) const;
+  static uint64_t CurrentStart (const Rung &rung);
+  static uint32_t BucketIndex (const Rung &rung, uint64_t ts);
+
+  Bucket m_top;
+  // events at or after m_topStart go into m_top
+  uint64_t m_topStart;
+  uint64_t m_topMin;
+  uint64_t m_topMax;
+  // m_rungs[0] is the coarsest rung, only the first m_nRungs are in use,
+  // the others are kept to reuse their buckets
+  std::vector<Rung> m_rungs;
+  uint32_t m_nRungs;
+  // sorted, the next event is at m_bottom[m_bottomHead]
+  Bucket m_bottom;
+  uint32_t m_bottomHead;
+  // number of events in the queue
+  uint32_t m_size;
+};
+
+} // namespace ns3
+
+#endif /* LADDER_SCHEDULER_H */
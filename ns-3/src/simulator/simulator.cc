@@ -386,6 +386,8 @@ Simulator::GetImplementation (void)
 #include "map-scheduler.h"
 #include "calendar-scheduler.h"
 #include "ns2-calendar-scheduler.h"
+#include "ladder-scheduler.h"
+#include <vector>
 
 namespace ns3 {
 
@@ -532,6 +534,161 @@ SimulatorEventsTestCase::DoRun (void)
   return false;
 }
 
+class SchedulerOrderTestCase : public TestCase
+{
+public:
+  SchedulerOrderTestCase (ObjectFactory schedulerFactory);
+  virtual bool DoRun (void);
+  uint32_t Random (uint32_t max);
+  uint32_t m_seed;
+  ObjectFactory m_schedulerFactory;
+};
+
+SchedulerOrderTestCase::SchedulerOrderTestCase (ObjectFactory schedulerFactory)
+  : TestCase ("Check that many interleaved events come out in order with " +
+              schedulerFactory.GetTypeId ().GetName ()),
+    m_seed (1),
+    m_schedulerFactory (schedulerFactory)
+{}
+uint32_t
+SchedulerOrderTestCase::Random (uint32_t max)
+{
+  m_seed = m_seed * 1103515245 + 12345;
+  return (m_seed >> 8) % max;
+}
+bool
+SchedulerOrderTestCase::DoRun (void)
+{
+  // the map scheduler is the reference: drive both schedulers with
+  // a mix of periodic timers, bursts of simultaneous events, far
+  // away timeouts and removals, and compare what they return.
+  Ptr<Scheduler> scheduler = m_schedulerFactory.Create<Scheduler> ();
+  Ptr<Scheduler> reference = CreateObject<MapScheduler> ();
+  std::vector<Scheduler::Event> pending;
+  std::vector<bool> done;
+  uint64_t now = 0;
+  uint32_t uid = 0;
+  for (uint32_t i = 0; i < 20000; i++)
+    {
+      uint32_t op = Random (10);
+      if (op < 5 || reference->IsEmpty ())
+        {
+          uint32_t n = (Random (20) == 0) ? 60 : 1;
+          uint64_t delay;
+          switch (Random (4))
+            {
+            case 0: delay = 0; break;
+            case 1: delay = 1000 * Random (10); break;
+            case 2: delay = 50000000; break;
+            default: delay = Random (1000000000); break;
+            }
+          for (uint32_t j = 0; j < n; j++)
+            {
+              Scheduler::Event ev = {0, {now + delay, uid++, 0}};
+              scheduler->Insert (ev);
+              reference->Insert (ev);
+              pending.push_back (ev);
+              done.push_back (false);
+            }
+        }
+      else if (op < 6)
+        {
+          uint32_t k = Random (pending.size ());
+          Scheduler::Event ev = pending[k];
+          pending[k] = pending.back ();
+          pending.pop_back ();
+          if (!done[ev.key.m_uid])
+            {
+              scheduler->Remove (ev);
+              reference->Remove (ev);
+              done[ev.key.m_uid] = true;
+            }
+        }
+      else
+        {
+          NS_TEST_ASSERT_MSG_EQ (scheduler->PeekNext ().key.m_uid,
+                                 reference->PeekNext ().key.m_uid, "PeekNext out of order");
+          Scheduler::Event next = scheduler->RemoveNext ();
+          Scheduler::Event expected = reference->RemoveNext ();
+          NS_TEST_ASSERT_MSG_EQ (next.key.m_uid, expected.key.m_uid, "RemoveNext out of order");
+          done[next.key.m_uid] = true;
+          now = next.key.m_ts;
+        }
+    }
+  while (!reference->IsEmpty ())
+    {
+      NS_TEST_ASSERT_MSG_EQ (scheduler->IsEmpty (), false, "Events lost");
+      NS_TEST_ASSERT_MSG_EQ (scheduler->RemoveNext ().key.m_uid,
+                             reference->RemoveNext ().key.m_uid, "RemoveNext out of order");
+    }
+  NS_TEST_ASSERT_MSG_EQ (scheduler->IsEmpty (), true, "Spurious events");
+  return false;
+}
+
+class EventPoolTestCase : public TestCase
+{
+public:
+  EventPoolTestCase ();
+  virtual bool DoRun (void);
+  void Record (uint32_t tag);
+  std::vector<uint32_t> m_ran;
+};
+
+EventPoolTestCase::EventPoolTestCase ()
+  : TestCase ("Check that pooled events are recycled only once no EventId references them")
+{}
+void
+EventPoolTestCase::Record (uint32_t tag)
+{
+  m_ran.push_back (tag);
+}
+bool
+EventPoolTestCase::DoRun (void)
+{
+  // all the events below have the same type, so they share a size class
+  // and a released event is the next one handed out.
+  Simulator::Destroy ();
+  EventImpl::EnablePool (true);
+  m_ran.clear ();
+
+  EventId a = Simulator::Schedule (Seconds (1), &EventPoolTestCase::Record, this, 1);
+  EventImpl *slot = a.PeekEventImpl ();
+  EventId held = a;
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (held.IsExpired (), true, "Event ran: should have expired");
+  a = EventId ();
+  EventId b = Simulator::Schedule (Seconds (1), &EventPoolTestCase::Record, this, 2);
+  NS_TEST_EXPECT_MSG_NE (b.PeekEventImpl (), slot, "Event still referenced by an EventId was recycled");
+  NS_TEST_EXPECT_MSG_EQ (held.IsExpired (), true, "Expired event came back to life");
+
+  held = EventId ();
+  EventId c = Simulator::Schedule (Seconds (1), &EventPoolTestCase::Record, this, 3);
+  NS_TEST_EXPECT_MSG_EQ (c.PeekEventImpl (), slot, "Released event was not recycled");
+  NS_TEST_EXPECT_MSG_EQ (c.IsExpired (), false, "Recycled event should not have expired yet");
+  Simulator::Cancel (c);
+  NS_TEST_EXPECT_MSG_EQ (c.IsExpired (), true, "Recycled event was canceled: should have expired");
+  Simulator::Run ();
+
+  // the cancellation must not stick to the slot
+  c = EventId ();
+  EventId d = Simulator::Schedule (Seconds (1), &EventPoolTestCase::Record, this, 4);
+  NS_TEST_EXPECT_MSG_EQ (d.PeekEventImpl (), slot, "Canceled event was not recycled");
+  NS_TEST_EXPECT_MSG_EQ (d.IsExpired (), false, "Event recycled from a canceled one has expired");
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (d.IsExpired (), true, "Event ran: should have expired");
+
+  NS_TEST_EXPECT_MSG_EQ (m_ran.size (), 3U, "Wrong number of events ran");
+  if (m_ran.size () == 3)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_ran[0], 1U, "Wrong event ran");
+      NS_TEST_EXPECT_MSG_EQ (m_ran[1], 2U, "Wrong event ran");
+      NS_TEST_EXPECT_MSG_EQ (m_ran[2], 4U, "Canceled recycled event ran");
+    }
+  Simulator::Destroy ();
+  EventImpl::EnablePool (false);
+  return false;
+}
+
 class SimulatorTemplateTestCase : public TestCase
 {
 public:
@@ -842,6 +999,14 @@ public:
     AddTestCase (new SimulatorEventsTestCase (factory));
     factory.SetTypeId (Ns2CalendarScheduler::GetTypeId ());
     AddTestCase (new SimulatorEventsTestCase (factory));
+    factory.SetTypeId (LadderScheduler::GetTypeId ());
+    AddTestCase (new SimulatorEventsTestCase (factory));
+    AddTestCase (new SchedulerOrderTestCase (factory));
+    factory.SetTypeId (HeapScheduler::GetTypeId ());
+    AddTestCase (new SchedulerOrderTestCase (factory));
+    factory.SetTypeId (CalendarScheduler::GetTypeId ());
+    AddTestCase (new SchedulerOrderTestCase (factory));
+    AddTestCase (new EventPoolTestCase ());
   }
 } g_simulatorTestSuite;
 
@@ -136,6 +136,9 @@ PrintHelp (void)
   std::cout << "      --list: use std::list scheduler"<<std::endl;
   std::cout << "      --map: use std::map cheduler"<<std::endl;
   std::cout << "      --heap: use Binary Heap scheduler"<<std::endl;
+  std::cout << "      --calendar: use Calendar Queue scheduler"<<std::endl;
+  std::cout << "      --ladder: use Ladder Queue scheduler"<<std::endl;
+  std::cout << "      --event-pool: recycle events through free lists"<<std::endl;
   std::cout << "      --debug: enable some debugging"<<std::endl;
 }
 
@@ -183,6 +186,15 @@ int main (int argc, char *argv[])
           factory.SetTypeId ("ns3::CalendarScheduler");
           Simulator::SetScheduler (factory);
         }
+      else if (strcmp ("--ladder", argv[0]) == 0)
+        {
+          factory.SetTypeId ("ns3::LadderScheduler");
+          Simulator::SetScheduler (factory);
+        }
+      else if (strcmp ("--event-pool", argv[0]) == 0)
+        {
+          EventImpl::EnablePool (true);
+        }
       else if (strcmp ("--debug", argv[0]) == 0) 
         {
           g_debug = true;
@@ -0,0 +1,218 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 University of Pennsylvania
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Replays event traces recorded by simulator-main --event-trace against
+ * each scheduler and measures the scheduler operations per second.  The
+ * events are the same keys the simulation scheduled, in the same order,
+ * so the replay sees the real mix of timers, link delays and
+ * cancellations without the cost of running the events.  Every
+ * RemoveNext is checked against the event the recorded run got.
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/simulator-module.h"
+#include "ns3/event-trace-scheduler.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <string.h>
+#include <stdlib.h>
+
+using namespace ns3;
+
+typedef std::vector<EventTraceRecord> Trace;
+
+bool
+ReadTrace (std::string filename, Trace &trace)
+{
+  std::ifstream input (filename.c_str (), std::ios::in | std::ios::binary);
+  if (!input.is_open ())
+    {
+      return false;
+    }
+  EventTraceRecord record;
+  while (record.Read (input))
+    {
+      trace.push_back (record);
+    }
+  return true;
+}
+
+void
+PrintTraceStats (std::string name, const Trace &trace)
+{
+  uint32_t inserts = 0, removeNexts = 0, removes = 0;
+  uint32_t pending = 0, maxPending = 0;
+  uint64_t last = 0;
+  for (Trace::const_iterator i = trace.begin (); i != trace.end (); i++)
+    {
+      switch (i->op)
+        {
+        case EventTraceRecord::INSERT:
+          inserts++;
+          pending++;
+          maxPending = std::max (maxPending, pending);
+          break;
+        case EventTraceRecord::REMOVE_NEXT:
+          removeNexts++;
+          pending--;
+          last = i->ts;
+          break;
+        case EventTraceRecord::REMOVE:
+          removes++;
+          pending--;
+          break;
+        }
+    }
+  std::cout << name << ": inserts=" << inserts << " remove-next=" << removeNexts
+            << " removes=" << removes << " max-pending=" << maxPending
+            << " simulated=" << last / 1e9 << "s" << std::endl;
+}
+
+void
+RunBench (std::string schedulerType, const Trace &trace, uint32_t runs)
+{
+  ObjectFactory factory;
+  factory.SetTypeId (schedulerType);
+  uint32_t mismatches = 0;
+  double seconds = 0;
+  for (uint32_t run = 0; run < runs; run++)
+    {
+      Ptr<Scheduler> scheduler = factory.Create<Scheduler> ();
+      SystemWallClockMs time;
+      time.Start ();
+      for (Trace::const_iterator i = trace.begin (); i != trace.end (); i++)
+        {
+          Scheduler::Event ev = {0, {i->ts, i->uid, 0}};
+          switch (i->op)
+            {
+            case EventTraceRecord::INSERT:
+              scheduler->Insert (ev);
+              break;
+            case EventTraceRecord::REMOVE_NEXT:
+              if (scheduler->RemoveNext ().key.m_uid != i->uid)
+                {
+                  mismatches++;
+                }
+              break;
+            case EventTraceRecord::REMOVE:
+              scheduler->Remove (ev);
+              break;
+            }
+        }
+      seconds += time.End () / 1000.0;
+    }
+  std::cout << "  " << schedulerType << ": " << seconds / runs << "s, "
+            << trace.size () * runs / seconds << " ops/s"
+            << "  mismatches=" << mismatches << std::endl;
+}
+
+void
+PrintHelp (void)
+{
+  std::cout << "bench-scheduler [options] trace..." << std::endl;
+  std::cout << "  trace: a file recorded by simulator-main --event-trace=trace" << std::endl;
+  std::cout << "  Options:" << std::endl;
+  std::cout << "      --list: add the std::list scheduler" << std::endl;
+  std::cout << "      --map: add the std::map scheduler" << std::endl;
+  std::cout << "      --heap: add the binary heap scheduler" << std::endl;
+  std::cout << "      --calendar: add the calendar queue scheduler" << std::endl;
+  std::cout << "      --ns2calendar: add the ns-2 calendar queue scheduler" << std::endl;
+  std::cout << "      --ladder: add the ladder queue scheduler" << std::endl;
+  std::cout << "      --n=runs: replay every trace this many times (default 3)" << std::endl;
+  std::cout << "  Without schedulers, all but the list scheduler are compared." << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  std::vector<std::string> traces;
+  std::vector<std::string> schedulers;
+  uint32_t runs = 3;
+  for (int i = 1; i < argc; i++)
+    {
+      if (strcmp ("--list", argv[i]) == 0)
+        {
+          schedulers.push_back ("ns3::ListScheduler");
+        }
+      else if (strcmp ("--map", argv[i]) == 0)
+        {
+          schedulers.push_back ("ns3::MapScheduler");
+        }
+      else if (strcmp ("--heap", argv[i]) == 0)
+        {
+          schedulers.push_back ("ns3::HeapScheduler");
+        }
+      else if (strcmp ("--calendar", argv[i]) == 0)
+        {
+          schedulers.push_back ("ns3::CalendarScheduler");
+        }
+      else if (strcmp ("--ns2calendar", argv[i]) == 0)
+        {
+          schedulers.push_back ("ns3::Ns2CalendarScheduler");
+        }
+      else if (strcmp ("--ladder", argv[i]) == 0)
+        {
+          schedulers.push_back ("ns3::LadderScheduler");
+        }
+      else if (strncmp ("--n=", argv[i], strlen ("--n=")) == 0)
+        {
+          runs = atoi (argv[i] + strlen ("--n="));
+        }
+      else if (strncmp ("--", argv[i], 2) == 0)
+        {
+          PrintHelp ();
+          return 0;
+        }
+      else
+        {
+          traces.push_back (argv[i]);
+        }
+    }
+  if (traces.empty () || runs == 0)
+    {
+      PrintHelp ();
+      return 0;
+    }
+  if (schedulers.empty ())
+    {
+      // the list scheduler is quadratic on traces of any size
+      schedulers.push_back ("ns3::MapScheduler");
+      schedulers.push_back ("ns3::HeapScheduler");
+      schedulers.push_back ("ns3::CalendarScheduler");
+      schedulers.push_back ("ns3::Ns2CalendarScheduler");
+      schedulers.push_back ("ns3::LadderScheduler");
+    }
+  for (uint32_t i = 0; i < traces.size (); i++)
+    {
+      Trace trace;
+      if (!ReadTrace (traces[i], trace))
+        {
+          std::cerr << "Cannot read trace " << traces[i] << std::endl;
+          continue;
+        }
+      PrintTraceStats (traces[i], trace);
+      for (uint32_t j = 0; j < schedulers.size (); j++)
+        {
+          RunBench (schedulers[j], trace, runs);
+        }
+    }
+  return 0;
+}
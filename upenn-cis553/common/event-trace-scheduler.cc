@@ -0,0 +1,153 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 University of Pennsylvania
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "event-trace-scheduler.h"
+#include "ns3/global-value.h"
+#include "ns3/object-factory.h"
+#include "ns3/type-id.h"
+#include "ns3/log.h"
+#include <string.h>
+
+NS_LOG_COMPONENT_DEFINE ("EventTraceScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED (EventTraceScheduler);
+
+void
+EventTraceRecord::Write (std::ostream &os) const
+{
+  os.write ((const char *) &op, sizeof (op));
+  os.write ((const char *) &ts, sizeof (ts));
+  os.write ((const char *) &uid, sizeof (uid));
+}
+
+bool
+EventTraceRecord::Read (std::istream &is)
+{
+  is.read ((char *) &op, sizeof (op));
+  is.read ((char *) &ts, sizeof (ts));
+  is.read ((char *) &uid, sizeof (uid));
+  return is.good ();
+}
+
+std::ofstream EventTraceScheduler::m_trace;
+bool EventTraceScheduler::m_hashing = false;
+uint64_t EventTraceScheduler::m_hash = 14695981039346656037ULL;
+
+TypeId
+EventTraceScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("EventTraceScheduler")
+    .SetParent<Scheduler> ()
+    .AddConstructor<EventTraceScheduler> ()
+  ;
+  return tid;
+}
+
+EventTraceScheduler::EventTraceScheduler ()
+{
+  TypeIdValue schedulerType;
+  GlobalValue::GetValueByName ("SchedulerType", schedulerType);
+  ObjectFactory factory;
+  factory.SetTypeId (schedulerType.Get ());
+  m_scheduler = factory.Create<Scheduler> ();
+}
+
+EventTraceScheduler::~EventTraceScheduler ()
+{
+  m_trace.flush ();
+}
+
+bool
+EventTraceScheduler::Open (std::string fileName)
+{
+  m_trace.open (fileName.c_str (), std::ios::out | std::ios::binary | std::ios::trunc);
+  return m_trace.is_open ();
+}
+
+void
+EventTraceScheduler::EnableHash (void)
+{
+  m_hashing = true;
+}
+
+uint64_t
+EventTraceScheduler::GetHash (void)
+{
+  return m_hash;
+}
+
+void
+EventTraceScheduler::Record (uint8_t op, const Event &ev)
+{
+  EventTraceRecord record;
+  record.op = op;
+  record.ts = ev.key.m_ts;
+  record.uid = ev.key.m_uid;
+  if (m_trace.is_open ())
+    {
+      record.Write (m_trace);
+    }
+  if (m_hashing)
+    {
+      // byte by byte as the record is written, in host byte order, then
+      // the context, so the same event on another node hashes differently
+      uint8_t bytes[17];
+      memcpy (bytes, &record.op, 1);
+      memcpy (bytes + 1, &record.ts, 8);
+      memcpy (bytes + 9, &record.uid, 4);
+      memcpy (bytes + 13, &ev.key.m_context, 4);
+      for (uint32_t i = 0; i < sizeof (bytes); i++)
+        {
+          m_hash = (m_hash ^ bytes[i]) * 1099511628211ULL;
+        }
+    }
+}
+
+void
+EventTraceScheduler::Insert (const Event &ev)
+{
+  Record (EventTraceRecord::INSERT, ev);
+  m_scheduler->Insert (ev);
+}
+
+bool
+EventTraceScheduler::IsEmpty (void) const
+{
+  return m_scheduler->IsEmpty ();
+}
+
+Scheduler::Event
+EventTraceScheduler::PeekNext (void) const
+{
+  return m_scheduler->PeekNext ();
+}
+
+Scheduler::Event
+EventTraceScheduler::RemoveNext (void)
+{
+  Event next = m_scheduler->RemoveNext ();
+  Record (EventTraceRecord::REMOVE_NEXT, next);
+  return next;
+}
+
+void
+EventTraceScheduler::Remove (const Event &ev)
+{
+  Record (EventTraceRecord::REMOVE, ev);
+  m_scheduler->Remove (ev);
+}
@@ -0,0 +1,92 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 University of Pennsylvania
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef EVENT_TRACE_SCHEDULER_H
+#define EVENT_TRACE_SCHEDULER_H
+
+#include <stdint.h>
+#include <fstream>
+#include <string>
+#include "ns3/ptr.h"
+#include "ns3/scheduler.h"
+
+using namespace ns3;
+
+/**
+ * One scheduler operation of an event trace.  A trace file is a plain
+ * sequence of records of 13 bytes each, in host byte order: the
+ * operation, the event timestamp and the event uid.  The uid of
+ * REMOVE_NEXT is the event the recorded scheduler returned, so that a
+ * replay can check the order of another scheduler against it.
+ */
+struct EventTraceRecord
+{
+  enum Operation
+    {
+      INSERT = 'i',
+      REMOVE_NEXT = 'n',
+      REMOVE = 'r',
+    };
+
+  uint8_t op;
+  uint64_t ts;
+  uint32_t uid;
+
+  void Write (std::ostream &os) const;
+  bool Read (std::istream &is);
+};
+
+/**
+ * Scheduler that records every operation into an event trace, and
+ * passes it on to a scheduler of the type given by the SchedulerType
+ * global value.  Open () must be called before the simulator creates it.
+ * With EnableHash () the records and the node context of each event are
+ * also hashed, two runs with the same hash executed the same events on
+ * the same nodes in the same order.
+ */
+class EventTraceScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId (void);
+
+  EventTraceScheduler ();
+  virtual ~EventTraceScheduler ();
+
+  static bool Open (std::string fileName);
+  static void EnableHash (void);
+  /**
+   * \returns The FNV-1a hash of the records so far.
+   */
+  static uint64_t GetHash (void);
+
+  virtual void Insert (const Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Event PeekNext (void) const;
+  virtual Event RemoveNext (void);
+  virtual void Remove (const Event &ev);
+
+private:
+  void Record (uint8_t op, const Event &ev);
+
+  static std::ofstream m_trace;
+  static bool m_hashing;
+  static uint64_t m_hash;
+  Ptr<Scheduler> m_scheduler;
+};
+
+#endif
@@ -18,6 +18,7 @@
 
 #include "penn-application.h"
 #include "ns3/simulator.h"
+#include "ns3/penn-share-table.h"
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -39,6 +40,8 @@ PennApplication::GetTypeId ()
 PennApplication::PennApplication ()
 {
   m_realStack = false;
+  m_nodeAddressMap = PennShareTable (std::map<uint32_t, Ipv4Address> ());
+  m_addressNodeMap = PennShareTable (std::map<Ipv4Address, uint32_t> ());
 }
 
 PennApplication::~PennApplication ()
@@ -77,15 +80,15 @@ PennApplication::GetLocalAddress()
 
 
 void
-PennApplication::SetNodeAddressMap (std::map<uint32_t, Ipv4Address> nodeAddressMap)
+PennApplication::SetNodeAddressMap (const std::map<uint32_t, Ipv4Address> &nodeAddressMap)
 {
-  m_nodeAddressMap = nodeAddressMap;
+  m_nodeAddressMap = PennShareTable (nodeAddressMap);
 }
 
 void
-PennApplication::SetAddressNodeMap (std::map<Ipv4Address, uint32_t> addressNodeMap)
+PennApplication::SetAddressNodeMap (const std::map<Ipv4Address, uint32_t> &addressNodeMap)
 {
-  m_addressNodeMap = addressNodeMap;
+  m_addressNodeMap = PennShareTable (addressNodeMap);
 }
 
 Ipv4Address
@@ -96,8 +99,8 @@ PennApplication::ResolveNodeIpAddress (std::string nodeId)
     uint32_t nodeNumber;
     std::istringstream sin (nodeId);
     sin >> nodeNumber;
-    std::map<uint32_t, Ipv4Address>::iterator iter = m_nodeAddressMap.find (nodeNumber);
-    if (iter != m_nodeAddressMap.end ())
+    std::map<uint32_t, Ipv4Address>::const_iterator iter = m_nodeAddressMap->find (nodeNumber);
+    if (iter != m_nodeAddressMap->end ())
       { 
         return iter->second;
       }
@@ -126,8 +129,8 @@ PennApplication::ReverseLookup (Ipv4Address ipAddress)
 {
   if (!IsRealStack())
   {
-    std::map<Ipv4Address, uint32_t>::iterator iter = m_addressNodeMap.find (ipAddress);
-    if (iter != m_addressNodeMap.end ())
+    std::map<Ipv4Address, uint32_t>::const_iterator iter = m_addressNodeMap->find (ipAddress);
+    if (iter != m_addressNodeMap->end ())
       { 
         std::ostringstream sin;
         uint32_t nodeNumber = iter->second;
@@ -37,8 +37,8 @@ class PennApplication : public Application, public PennLog
 
    // Interface for PennApplication(s)
    virtual void ProcessCommand (std::vector<std::string> tokens) = 0;
-   virtual void SetNodeAddressMap (std::map<uint32_t, Ipv4Address> nodeAddressMap);
-   virtual void SetAddressNodeMap (std::map<Ipv4Address, uint32_t> addressNodeMap);
+   virtual void SetNodeAddressMap (const std::map<uint32_t, Ipv4Address> &nodeAddressMap);
+   virtual void SetAddressNodeMap (const std::map<Ipv4Address, uint32_t> &addressNodeMap);
    void SetRealStack (bool realStack);
    bool IsRealStack ();
    void SetLocalAddress (Ipv4Address local);
@@ -55,8 +55,9 @@ class PennApplication : public Application, public PennLog
   protected:
     // Stores local address in the case of Real Stack
     Ipv4Address m_local;
-    std::map<uint32_t, Ipv4Address> m_nodeAddressMap;
-    std::map<Ipv4Address, uint32_t> m_addressNodeMap;
+    // Shared by all nodes, see PennShareTable
+    const std::map<uint32_t, Ipv4Address> *m_nodeAddressMap;
+    const std::map<Ipv4Address, uint32_t> *m_addressNodeMap;
 };    
 
 #endif
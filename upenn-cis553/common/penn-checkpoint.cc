@@ -0,0 +1,130 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 University of Pennsylvania
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/penn-checkpoint.h"
+
+// a string longer than this is taken for a corrupt file
+static const uint32_t MAX_STRING = 1 << 24;
+
+PennCheckpointWriter::PennCheckpointWriter (std::ostream &os)
+  : m_os (os)
+{
+}
+
+void
+PennCheckpointWriter::WriteU8 (uint8_t value)
+{
+  m_os.write ((const char *) &value, sizeof (value));
+}
+
+void
+PennCheckpointWriter::WriteU32 (uint32_t value)
+{
+  m_os.write ((const char *) &value, sizeof (value));
+}
+
+void
+PennCheckpointWriter::WriteU64 (uint64_t value)
+{
+  m_os.write ((const char *) &value, sizeof (value));
+}
+
+void
+PennCheckpointWriter::WriteString (const std::string &value)
+{
+  WriteU32 (value.size ());
+  m_os.write (value.data (), value.size ());
+}
+
+void
+PennCheckpointWriter::WriteAddress (Ipv4Address address)
+{
+  WriteU32 (address.Get ());
+}
+
+void
+PennCheckpointWriter::WriteTime (Time time)
+{
+  WriteU64 (time.GetNanoSeconds ());
+}
+
+PennCheckpointReader::PennCheckpointReader (std::istream &is)
+  : m_is (is),
+    m_ok (true)
+{
+}
+
+uint8_t
+PennCheckpointReader::ReadU8 (void)
+{
+  uint8_t value = 0;
+  m_is.read ((char *) &value, sizeof (value));
+  m_ok = m_ok && m_is.good ();
+  return m_ok ? value : 0;
+}
+
+uint32_t
+PennCheckpointReader::ReadU32 (void)
+{
+  uint32_t value = 0;
+  m_is.read ((char *) &value, sizeof (value));
+  m_ok = m_ok && m_is.good ();
+  return m_ok ? value : 0;
+}
+
+uint64_t
+PennCheckpointReader::ReadU64 (void)
+{
+  uint64_t value = 0;
+  m_is.read ((char *) &value, sizeof (value));
+  m_ok = m_ok && m_is.good ();
+  return m_ok ? value : 0;
+}
+
+std::string
+PennCheckpointReader::ReadString (void)
+{
+  uint32_t size = ReadU32 ();
+  if (!m_ok || size > MAX_STRING)
+    {
+      m_ok = false;
+      return "";
+    }
+  std::string value (size, '\0');
+  m_is.read (&value[0], size);
+  m_ok = m_ok && m_is.good ();
+  return m_ok ? value : "";
+}
+
+Ipv4Address
+PennCheckpointReader::ReadAddress (void)
+{
+  return Ipv4Address (ReadU32 ());
+}
+
+Time
+PennCheckpointReader::ReadTime (void)
+{
+  return NanoSeconds (ReadU64 ());
+}
+
+bool
+PennCheckpointReader::IsOk (void) const
+{
+  return m_ok;
+}
@@ -0,0 +1,74 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 University of Pennsylvania
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PENN_CHECKPOINT_H
+#define PENN_CHECKPOINT_H
+
+#include <stdint.h>
+#include <iostream>
+#include <string>
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+
+using namespace ns3;
+
+/**
+ * Writes the state of the modules into a checkpoint file.  Like event
+ * traces, checkpoints are plain binary in host byte order and are only
+ * read back on the same kind of host.  Strings are a 32 bit length and
+ * their bytes, addresses 4 bytes and times 64 bit nanoseconds.
+ */
+class PennCheckpointWriter
+{
+public:
+  PennCheckpointWriter (std::ostream &os);
+
+  void WriteU8 (uint8_t value);
+  void WriteU32 (uint32_t value);
+  void WriteU64 (uint64_t value);
+  void WriteString (const std::string &value);
+  void WriteAddress (Ipv4Address address);
+  void WriteTime (Time time);
+
+private:
+  std::ostream &m_os;
+};
+
+/**
+ * Reads a checkpoint file back.  A short or corrupt file makes IsOk
+ * false, the values read after that are zero.
+ */
+class PennCheckpointReader
+{
+public:
+  PennCheckpointReader (std::istream &is);
+
+  uint8_t ReadU8 (void);
+  uint32_t ReadU32 (void);
+  uint64_t ReadU64 (void);
+  std::string ReadString (void);
+  Ipv4Address ReadAddress (void);
+  Time ReadTime (void);
+  bool IsOk (void) const;
+
+private:
+  std::istream &m_is;
+  bool m_ok;
+};
+
+#endif
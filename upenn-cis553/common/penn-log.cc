@@ -16,6 +16,7 @@
 
 
 #include "ns3/penn-log.h"
+#include "ns3/system-mutex.h"
 
 using namespace ns3;
 
@@ -89,3 +90,52 @@ PennLog::SetModuleName (std::string moduleName)
 {
   g_moduleName = moduleName;
 }
+
+static SystemMutex g_statsMutex;
+
+void
+PennStatsAdd (float &stat, float value)
+{
+  CriticalSection cs (g_statsMutex);
+  stat += value;
+}
+
+void
+PennStatsAdd (double &stat, double value)
+{
+  CriticalSection cs (g_statsMutex);
+  stat += value;
+}
+
+void
+PennStatsMax (Time &stat, Time value)
+{
+  CriticalSection cs (g_statsMutex);
+  if (value > stat)
+    {
+      stat = value;
+    }
+}
+
+Time
+PennStatsGet (Time &stat)
+{
+  CriticalSection cs (g_statsMutex);
+  return stat;
+}
+
+double
+PennStatsTake (double &stat)
+{
+  CriticalSection cs (g_statsMutex);
+  double value = stat;
+  stat = 0;
+  return value;
+}
+
+void
+PennStatsSample (std::vector<float> &stat, float value)
+{
+  CriticalSection cs (g_statsMutex);
+  stat.push_back (value);
+}
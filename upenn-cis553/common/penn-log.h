@@ -18,67 +18,85 @@
 #define PENN_LOG_H
 
 #include <iostream>
+#include <sstream>
 #include <string>
+#include <vector>
 #include "ns3/ptr.h"
+#include "ns3/nstime.h"
 
 using namespace ns3;
 
+// Every message is formatted first and written with a single call,
+// so that the lines of nodes run by different threads of the parallel
+// simulator do not interleave.
+#define PENN_LOG_WRITE(tag, msg)                                      \
+  do                                                                  \
+    {                                                                 \
+      std::ostringstream pennLogLine;                                 \
+      pennLogLine << "\n*" tag "* Node: " << g_nodeId                 \
+                  << ", Module: " << g_moduleName                     \
+                  << ", Time: " << Simulator::Now().GetMilliSeconds() \
+                  << " ms, Message" << msg << "\n";                   \
+      std::cout << pennLogLine.str ();                                \
+    }                                                                 \
+  while (0)
+
 #define TRAFFIC_LOG(msg)                                              \
-  if (g_trafficVerbose)                                               \
+  do                                                                  \
+    {                                                                 \
+      if (g_trafficVerbose)                                           \
+        PENN_LOG_WRITE ("TRAFFIC", ":: " << msg);                     \
+    }                                                                 \
+  while (0)
+
+#define ERROR_LOG(msg)                                                \
+  do                                                                  \
+    {                                                                 \
+      if (g_errorVerbose)                                             \
+        PENN_LOG_WRITE ("ERROR", ": " << msg);                        \
+    }                                                                 \
+  while (0)
+
+#define DEBUG_LOG(msg)                                                \
+  do                                                                  \
+    {                                                                 \
+      if (g_debugVerbose)                                             \
+        PENN_LOG_WRITE ("DEBUG", ": " << msg);                        \
+    }                                                                 \
+  while (0)
+
+#define STATUS_LOG(msg)                                               \
+  do                                                                  \
+    {                                                                 \
+      if (g_statusVerbose)                                            \
+        PENN_LOG_WRITE ("STATUS", ": " << msg);                       \
+    }                                                                 \
+  while (0)
+
+#define CHORD_LOG(msg)                                                \
+  do                                                                  \
     {                                                                 \
-      std::cout << "\n*TRAFFIC* Node: " << g_nodeId                   \
-                << ", Module: " << g_moduleName                      \
-                << ", Time: " << Simulator::Now().GetMilliSeconds()  \
-                << " ms, Message:: " << msg << "\n";                   \
+      if (g_chordVerbose)                                             \
+        PENN_LOG_WRITE ("CHORD", ": " << msg);                        \
     }                                                                 \
+  while (0)
 
-#define ERROR_LOG(msg)                                         \
-  if (g_errorVerbose)                                               \
-    {                                                               \
-      std::cout << "\n*ERROR* Node: " << g_nodeId                   \
-                << ", Module: " << g_moduleName                      \
-                << ", Time: " << Simulator::Now().GetMilliSeconds()  \
-                << " ms, Message: " << msg << "\n";                   \
-    }                                                               \
-
-#define DEBUG_LOG(msg)                                         \
-  if (g_debugVerbose)                                               \
-    {                                                               \
-      std::cout << "\n*DEBUG* Node: " << g_nodeId                   \
-                << ", Module: " << g_moduleName                      \
-                << ", Time: " << Simulator::Now().GetMilliSeconds()  \
-                << " ms, Message: " << msg << "\n";                   \
-    }  
-\
-#define STATUS_LOG(msg)                                         \
-  if (g_statusVerbose)                                               \
-    {                                                               \
-      std::cout << "\n*STATUS* Node: " << g_nodeId                   \
-                << ", Module: " << g_moduleName                      \
-                << ", Time: " << Simulator::Now().GetMilliSeconds()  \
-                << " ms, Message: " << msg << "\n";                   \
-    }       
-
-#define CHORD_LOG(msg)                                         \
-  if (g_chordVerbose)                                               \
-    {                                                               \
-      std::cout << "\n*CHORD* Node: " << g_nodeId                   \
-                << ", Module: " << g_moduleName                      \
-                << ", Time: " << Simulator::Now().GetMilliSeconds()  \
-                << " ms, Message: " << msg << "\n";                   \
-    }     
-
-#define SEARCH_LOG(msg)                                         \
-  if (g_searchVerbose)                                               \
-    {                                                               \
-      std::cout << "\n*SEARCH* Node: " << g_nodeId                   \
-                << ", Module: " << g_moduleName                      \
-                << ", Time: " << Simulator::Now().GetMilliSeconds()  \
-                << " ms, Message: " << msg << "\n";                   \
-    }     
-
-#define PRINT_LOG(msg)                                         \
-      std::cout << msg << "\n";                   
+#define SEARCH_LOG(msg)                                               \
+  do                                                                  \
+    {                                                                 \
+      if (g_searchVerbose)                                            \
+        PENN_LOG_WRITE ("SEARCH", ": " << msg);                       \
+    }                                                                 \
+  while (0)
+
+#define PRINT_LOG(msg)                                                \
+  do                                                                  \
+    {                                                                 \
+      std::ostringstream pennLogLine;                                 \
+      pennLogLine << msg << "\n";                                     \
+      std::cout << pennLogLine.str ();                                \
+    }                                                                 \
+  while (0)
 
 class PennLog 
 {
@@ -102,4 +120,42 @@ class PennLog
     bool g_trafficVerbose, g_errorVerbose, g_debugVerbose, g_statusVerbose, g_searchVerbose, g_chordVerbose;
 };
 
+// The statistics shared by all nodes are updated through these, since
+// the parallel simulator runs the nodes on several threads.
+inline void
+PennStatsAdd (uint32_t &stat, uint32_t value)
+{
+  __sync_fetch_and_add (&stat, value);
+}
+
+inline void
+PennStatsAdd (uint64_t &stat, uint64_t value)
+{
+  __sync_fetch_and_add (&stat, value);
+}
+
+void PennStatsAdd (float &stat, float value);
+void PennStatsAdd (double &stat, double value);
+// keeps the latest of the times
+void PennStatsMax (Time &stat, Time value);
+Time PennStatsGet (Time &stat);
+
+// Read and reset in one step, an update made meanwhile by another
+// thread is either counted in the value returned or left in the stat.
+inline uint32_t
+PennStatsTake (uint32_t &stat)
+{
+  return __sync_fetch_and_and (&stat, 0);
+}
+
+inline uint64_t
+PennStatsTake (uint64_t &stat)
+{
+  return __sync_fetch_and_and (&stat, 0);
+}
+
+double PennStatsTake (double &stat);
+// keeps every value, for percentiles
+void PennStatsSample (std::vector<float> &stat, float value);
+
 #endif
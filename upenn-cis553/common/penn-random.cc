@@ -0,0 +1,145 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 University of Pennsylvania
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/penn-random.h"
+#include "ns3/assert.h"
+#include "ns3/system-mutex.h"
+#include <map>
+#include <utility>
+
+// Moduli of the two components of the MRG32k3a generator behind RngStream
+static const uint64_t RNG_M1 = 4294967087ULL;
+static const uint64_t RNG_M2 = 4294944443ULL;
+
+static uint32_t g_seed = 1;
+static uint32_t g_run = 1;
+static std::map<uint32_t, std::pair<uint32_t, uint32_t> > g_nodeSeeds;
+// Streams are created from this one, RngStream () would take the next
+// stream of the ns-3 package and shift those of the other random variables
+static RngStream *g_prototype = 0;
+static SystemMutex g_mutex;
+
+static uint64_t
+SplitMix (uint64_t &state)
+{
+  uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+PennRandom::PennRandom (std::string module)
+  : m_module (module),
+    m_stream (0)
+{
+}
+
+PennRandom::PennRandom (const PennRandom &o)
+  : m_module (o.m_module),
+    m_stream (o.m_stream ? new RngStream (*o.m_stream) : 0)
+{
+}
+
+PennRandom::~PennRandom ()
+{
+  delete m_stream;
+}
+
+PennRandom &
+PennRandom::operator = (const PennRandom &o)
+{
+  if (this != &o)
+    {
+      delete m_stream;
+      m_module = o.m_module;
+      m_stream = o.m_stream ? new RngStream (*o.m_stream) : 0;
+    }
+  return *this;
+}
+
+/*
+ * The seeds of the stream of a (node, module) pair are hashed from the
+ * seed, the node and the module.  Streams of MRG32k3a seeded apart are
+ * as independent as the 2^127 spaced ones of RngStream, its period being
+ * 2^191, and hashing avoids jumping a stream ahead once per node.
+ */
+void
+PennRandom::SetNode (uint32_t node)
+{
+  uint32_t seed = g_seed;
+  uint32_t run = g_run;
+  std::map<uint32_t, std::pair<uint32_t, uint32_t> >::const_iterator iter = g_nodeSeeds.find (node);
+  if (iter != g_nodeSeeds.end ())
+    {
+      seed = iter->second.first;
+      run = iter->second.second;
+    }
+  uint64_t state = ((uint64_t) seed << 32) | node;
+  for (uint32_t i = 0; i < m_module.size (); i++)
+    {
+      state = state * 131 + (uint8_t) m_module[i];
+    }
+  uint32_t seeds[6];
+  do
+    {
+      for (uint32_t i = 0; i < 6; i++)
+        {
+          seeds[i] = SplitMix (state) % (i < 3 ? RNG_M1 : RNG_M2);
+        }
+    }
+  while (!RngStream::CheckSeed (seeds));
+
+  delete m_stream;
+  {
+    CriticalSection cs (g_mutex);
+    if (g_prototype == 0)
+      {
+        g_prototype = new RngStream ();
+      }
+    m_stream = new RngStream (*g_prototype);
+  }
+  m_stream->SetSeeds (seeds);
+  m_stream->ResetNthSubstream (run);
+}
+
+double
+PennRandom::GetValue (double min, double max)
+{
+  NS_ASSERT_MSG (m_stream != 0, "PennRandom of " << m_module << " used before SetNode");
+  return min + m_stream->RandU01 () * (max - min);
+}
+
+uint32_t
+PennRandom::GetInteger (uint32_t min, uint32_t max)
+{
+  NS_ASSERT_MSG (m_stream != 0, "PennRandom of " << m_module << " used before SetNode");
+  return min + (uint32_t) (m_stream->RandU01 () * ((double) max - min + 1));
+}
+
+void
+PennRandom::SetSeed (uint32_t seed, uint32_t run)
+{
+  g_seed = seed;
+  g_run = run;
+}
+
+void
+PennRandom::SetNodeSeed (uint32_t node, uint32_t seed, uint32_t run)
+{
+  g_nodeSeeds[node] = std::make_pair (seed, run);
+}
@@ -0,0 +1,64 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 University of Pennsylvania
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PENN_RANDOM_H
+#define PENN_RANDOM_H
+
+#include <stdint.h>
+#include <string>
+#include "ns3/rng-stream.h"
+
+using namespace ns3;
+
+/**
+ * Random numbers of one module of one node.  Every (node, module) pair
+ * has a stream of its own, so that what a node draws does not depend on
+ * the order the nodes happen to draw in, and the run picks the substream
+ * of it as ns-3 does.  The seed and run are global, a node can be given
+ * others, e.g. to vary one node only across runs.
+ */
+class PennRandom
+{
+public:
+  PennRandom (std::string module);
+  PennRandom (const PennRandom &o);
+  ~PennRandom ();
+  PennRandom &operator = (const PennRandom &o);
+
+  /**
+   * \brief Pick the stream of node, must be called before any draw.
+   */
+  void SetNode (uint32_t node);
+  /**
+   * \returns A value uniformly distributed in [min, max).
+   */
+  double GetValue (double min, double max);
+  /**
+   * \returns An integer uniformly distributed in [min, max].
+   */
+  uint32_t GetInteger (uint32_t min, uint32_t max);
+
+  static void SetSeed (uint32_t seed, uint32_t run);
+  static void SetNodeSeed (uint32_t node, uint32_t seed, uint32_t run);
+
+private:
+  std::string m_module;
+  RngStream *m_stream;
+};
+
+#endif
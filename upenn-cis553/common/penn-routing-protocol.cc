@@ -15,6 +15,8 @@
  */
 
 #include "penn-routing-protocol.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/packet.h"
 
 using namespace ns3;
 
@@ -41,3 +43,63 @@ PennRoutingProtocol::DoDispose ()
   Ipv4RoutingProtocol::DoDispose ();
 }
 
+std::vector<Ptr<Ipv4Route> >
+PennRoutingProtocol::MakeRoutes (Ipv4Address destination, Ipv4Address source, const NextHopList &nextHops)
+{
+  std::vector<Ptr<Ipv4Route> > routes;
+  for (uint32_t i = 0; i < nextHops.size (); i++)
+    {
+      Ptr<Ipv4Route> route = Create<Ipv4Route> ();
+      route->SetDestination (destination);
+      route->SetSource (source);
+      route->SetGateway (nextHops[i].first);
+      route->SetOutputDevice (nextHops[i].second);
+      routes.push_back (route);
+    }
+  return routes;
+}
+
+void
+PennRoutingProtocol::SetFibEntry (Fib &fib, Ipv4Address destination, Ipv4Address source,
+                                  const NextHopList &nextHops)
+{
+  if (nextHops.empty ())
+    {
+      fib.erase (destination);
+      return;
+    }
+  fib[destination] = MakeRoutes (destination, source, nextHops);
+}
+
+uint32_t
+PennRoutingProtocol::MixFlowHash (uint32_t hash, uint32_t value)
+{
+  hash ^= value;
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6b;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35;
+  return hash ^ (hash >> 16);
+}
+
+Ptr<Ipv4Route>
+PennRoutingProtocol::SelectRoute (const std::vector<Ptr<Ipv4Route> > &routes, Ipv4Address seed,
+                                  const Ipv4Header &header, Ptr<const Packet> packet)
+{
+  if (routes.size () == 1)
+    {
+      return routes[0];
+    }
+  uint32_t hash = MixFlowHash (seed.Get (), header.GetSource ().Get ());
+  hash = MixFlowHash (hash, header.GetDestination ().Get ());
+  hash = MixFlowHash (hash, header.GetProtocol ());
+  if (packet != 0 && (header.GetProtocol () == 6 || header.GetProtocol () == 17)
+      && packet->GetSize () >= 4)
+    {
+      // Source and destination port lead both the UDP and the TCP header
+      uint8_t ports[4];
+      packet->CopyData (ports, 4);
+      hash = MixFlowHash (hash, (ports[0] << 24) | (ports[1] << 16) | (ports[2] << 8) | ports[3]);
+    }
+  return routes[hash % routes.size ()];
+}
@@ -19,6 +19,8 @@
 
 #include "ns3/ipv4-routing-protocol.h"
 #include "ns3/ipv4-address.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/sgi-hashmap.h"
 #include "ns3/penn-log.h"
 
 #include <vector>
@@ -50,8 +52,50 @@ class PennRoutingProtocol : public Ipv4RoutingProtocol, public PennLog
     // Interface for protocols
     virtual void ProcessCommand (std::vector<std::string> tokens) = 0;
     virtual void SetMainInterface (uint32_t mainInterface) = 0;
-    virtual void SetNodeAddressMap (std::map<uint32_t, Ipv4Address> nodeAddressMap) = 0;
-    virtual void SetAddressNodeMap (std::map<Ipv4Address, uint32_t> addressNodeMap) = 0;
+    virtual void SetNodeAddressMap (const std::map<uint32_t, Ipv4Address> &nodeAddressMap) = 0;
+    virtual void SetAddressNodeMap (const std::map<Ipv4Address, uint32_t> &addressNodeMap) = 0;
+
+  protected:
+    // Forwarding table: ready-made routes, one per equal cost next hop,
+    // for every address of every reachable node
+    typedef sgi::hash_map<Ipv4Address, std::vector<Ptr<Ipv4Route> >, Ipv4AddressHash> Fib;
+    // Gateway and output device of each next hop
+    typedef std::vector<std::pair<Ipv4Address, Ptr<NetDevice> > > NextHopList;
+
+    /**
+     * \brief Build one route per next hop to a destination.
+     *
+     * \param destination Destination address.
+     * \param source Source address of the routes, our main address.
+     * \param nextHops Next hops towards destination.
+     */
+    static std::vector<Ptr<Ipv4Route> > MakeRoutes (Ipv4Address destination, Ipv4Address source,
+                                                    const NextHopList &nextHops);
+    /**
+     * \brief Replace the FIB entry of a destination, no next hops removes it.
+     */
+    static void SetFibEntry (Fib &fib, Ipv4Address destination, Ipv4Address source,
+                             const NextHopList &nextHops);
+    /**
+     * \brief Pick one of the equal cost routes of a FIB entry for a packet.
+     *
+     * All packets of a flow, identified by addresses, protocol and UDP or
+     * TCP ports, take the same route.
+     *
+     * \param routes Equal cost routes, at least one.
+     * \param seed Node address, so that consecutive routers do not make
+     * the same choice for the same flows.
+     * \param header IP header of the packet.
+     * \param packet Packet starting at the transport header, or 0 if the
+     * ports are not known yet.
+     */
+    static Ptr<Ipv4Route> SelectRoute (const std::vector<Ptr<Ipv4Route> > &routes, Ipv4Address seed,
+                                       const Ipv4Header &header, Ptr<const Packet> packet);
+    /**
+     * \brief MurmurHash3 finalizer over hash and value, so that every
+     * input bit reaches the low bits.
+     */
+    static uint32_t MixFlowHash (uint32_t hash, uint32_t value);
 
   private:
     virtual Ipv4Address ResolveNodeIpAddress (uint32_t nodeNumber) = 0;
@@ -0,0 +1,63 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 University of Pennsylvania
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PENN_SHARE_TABLE_H
+#define PENN_SHARE_TABLE_H
+
+#include <list>
+#include "ns3/system-mutex.h"
+
+using namespace ns3;
+
+/**
+ * The numbering tables handed to every node are the same, so only one
+ * copy of each is kept and the modules hold a pointer to it.  With per
+ * node copies the tables alone grow with the square of the number of
+ * nodes.  A table that already is a shared copy comes back as it is, so
+ * handing the result of PennShareTable to every node costs nothing;
+ * any other table is compared with the shared ones first.
+ */
+template <typename T>
+const T *
+PennShareTable (const T &table)
+{
+  static std::list<T> tables;
+  // applications start, and share their tables with chord, on the
+  // threads of the parallel simulator
+  static SystemMutex mutex;
+  CriticalSection critical (mutex);
+  typename std::list<T>::const_iterator iter;
+  for (iter = tables.begin (); iter != tables.end (); iter++)
+    {
+      if (&*iter == &table)
+        {
+          return &*iter;
+        }
+    }
+  for (iter = tables.begin (); iter != tables.end (); iter++)
+    {
+      if (*iter == table)
+        {
+          return &*iter;
+        }
+    }
+  tables.push_back (table);
+  return &tables.back ();
+}
+
+#endif
@@ -0,0 +1,513 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 University of Pennsylvania
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Generates PennSearch scenarios at scale for simulator-main:
+ *
+ *   <output>/<name>.topo   Inet topology, grown by preferential attachment
+ *                          on random coordinates, the link weights are the
+ *                          distances (see simulator-main --inet-delays)
+ *   <output>/<name>.sce    routing settle time, a staggered JOIN schedule,
+ *                          the PUBLISH commands and a Poisson SEARCH mix
+ *   <output>/keys/<n>.keys the metadata of the publishing nodes, whose
+ *                          keywords are Zipf distributed
+ *
+ * The query terms follow the same Zipf distribution as the keywords, so
+ * that the popular terms are searched for most.  All of it is drawn from
+ * the ns-3 random number generator and is reproducible with --seed.
+ * With --bootstrap the ring is built by CHORD BOOTSTRAP and the keys are
+ * placed by CHORD PRELOAD, which skips the JOIN and PUBLISH warm-up but
+ * leaves the workload the same.
+ *
+ * A posting list travels in one datagram, as the IPv4 stack does not
+ * fragment, so the head of the distribution is flattened with the
+ * offset of the Zipf-Mandelbrot law in the larger presets, and the
+ * scenario states the simulator-main --mtu its longest list needs.
+ */
+
+#include "ns3/core-module.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+using namespace ns3;
+
+struct ScenarioProfile
+{
+  uint32_t nodes;
+  // links of every node added to the topology
+  uint32_t degree;
+  // ms for the routing protocol to converge before the first JOIN
+  uint32_t settle;
+  uint32_t joinInterval;
+  uint32_t publishers;
+  uint32_t docs;
+  uint32_t keywordsPerDoc;
+  uint32_t vocabulary;
+  double zipf;
+  double zipfOffset;
+  uint32_t publishInterval;
+  uint32_t searches;
+  // searches per second
+  double searchRate;
+  uint32_t maxTerms;
+  // ms after the last search before QUIT
+  uint32_t tail;
+};
+
+static bool
+GetPreset (std::string name, ScenarioProfile &profile)
+{
+  profile.degree = 2;
+  profile.zipf = 1.0;
+  profile.zipfOffset = 0;
+  profile.maxTerms = 3;
+  if (name == "100")
+    {
+      profile.nodes = 100;
+      profile.settle = 30000;
+      profile.joinInterval = 500;
+      profile.publishers = 50;
+      profile.docs = 20;
+      profile.keywordsPerDoc = 5;
+      profile.vocabulary = 1000;
+      profile.publishInterval = 200;
+      profile.searches = 200;
+      profile.searchRate = 2;
+      profile.tail = 20000;
+      return true;
+    }
+  if (name == "1k")
+    {
+      profile.nodes = 1000;
+      profile.settle = 60000;
+      profile.joinInterval = 100;
+      profile.publishers = 500;
+      profile.docs = 100;
+      profile.keywordsPerDoc = 8;
+      profile.vocabulary = 20000;
+      profile.zipfOffset = 20;
+      profile.publishInterval = 50;
+      profile.searches = 2000;
+      profile.searchRate = 10;
+      profile.tail = 30000;
+      return true;
+    }
+  if (name == "10k")
+    {
+      // 5000 x 40 x 10 = 2 million postings
+      profile.nodes = 10000;
+      profile.settle = 60000;
+      profile.joinInterval = 20;
+      profile.publishers = 5000;
+      profile.docs = 40;
+      profile.keywordsPerDoc = 10;
+      profile.vocabulary = 200000;
+      profile.zipfOffset = 100;
+      profile.publishInterval = 10;
+      profile.searches = 20000;
+      profile.searchRate = 50;
+      profile.tail = 60000;
+      return true;
+    }
+  return false;
+}
+
+template <typename T>
+static void
+Override (T &value, T option)
+{
+  if (option > 0)
+    {
+      value = option;
+    }
+}
+
+/*
+ * Draws ranks from 1 to n with probability proportional to
+ * 1 / (rank + q)^s, by bisection of the cumulative distribution.
+ */
+class ZipfSampler
+{
+public:
+  ZipfSampler (uint32_t n, double s, double q)
+    : m_cdf (n)
+  {
+    double sum = 0;
+    for (uint32_t i = 0; i < n; i++)
+      {
+        sum += 1.0 / std::pow (i + 1.0 + q, s);
+        m_cdf[i] = sum;
+      }
+    for (uint32_t i = 0; i < n; i++)
+      {
+        m_cdf[i] /= sum;
+      }
+  }
+  uint32_t Sample (UniformVariable &random)
+  {
+    double u = random.GetValue ();
+    uint32_t rank = std::lower_bound (m_cdf.begin (), m_cdf.end (), u) - m_cdf.begin ();
+    return std::min (rank, (uint32_t) m_cdf.size () - 1) + 1;
+  }
+private:
+  std::vector<double> m_cdf;
+};
+
+// creates the directory and its missing parents, like mkdir -p
+static bool
+MakeDirectory (std::string path)
+{
+  for (std::string::size_type i = path.find ('/', 1); i != std::string::npos;
+       i = path.find ('/', i + 1))
+    {
+      if (mkdir (path.substr (0, i).c_str (), 0755) != 0 && errno != EEXIST)
+        {
+          return false;
+        }
+    }
+  return mkdir (path.c_str (), 0755) == 0 || errno == EEXIST;
+}
+
+static uint64_t
+WriteTopology (std::string fileName, const ScenarioProfile &profile, UniformVariable &random)
+{
+  std::vector<uint32_t> x (profile.nodes), y (profile.nodes);
+  for (uint32_t i = 0; i < profile.nodes; i++)
+    {
+      x[i] = random.GetInteger (0, 9999);
+      y[i] = random.GetInteger (0, 9999);
+    }
+  // Every new node links to nodes picked in proportion to their degree,
+  // which gives the heavy tailed degrees of the Internet graphs Inet
+  // models.  Every endpoint is listed once per link it has.
+  std::vector<std::pair<uint32_t, uint32_t> > links;
+  std::vector<uint32_t> endpoints;
+  for (uint32_t node = 1; node < profile.nodes; node++)
+    {
+      std::set<uint32_t> peers;
+      uint32_t wanted = std::min (profile.degree, node);
+      while (peers.size () < wanted)
+        {
+          uint32_t peer;
+          if (endpoints.empty ())
+            {
+              peer = random.GetInteger (0, node - 1);
+            }
+          else
+            {
+              peer = endpoints[random.GetInteger (0, endpoints.size () - 1)];
+            }
+          peers.insert (peer);
+        }
+      for (std::set<uint32_t>::const_iterator i = peers.begin (); i != peers.end (); i++)
+        {
+          links.push_back (std::make_pair (node, *i));
+          endpoints.push_back (node);
+          endpoints.push_back (*i);
+        }
+    }
+
+  std::ofstream topo (fileName.c_str ());
+  if (!topo.is_open ())
+    {
+      return 0;
+    }
+  topo << profile.nodes << " " << links.size () << "\n";
+  for (uint32_t i = 0; i < profile.nodes; i++)
+    {
+      topo << i << "\t" << x[i] << "\t" << y[i] << "\n";
+    }
+  for (uint32_t i = 0; i < links.size (); i++)
+    {
+      uint32_t a = links[i].first, b = links[i].second;
+      double dx = (double) x[a] - x[b], dy = (double) y[a] - y[b];
+      uint32_t weight = std::max ((uint32_t) std::sqrt (dx * dx + dy * dy), (uint32_t) 1);
+      topo << a << "\t" << b << "\t" << weight << "\n";
+    }
+  return links.size ();
+}
+
+// termBytes counts the serialized size of the posting list of every term
+static uint64_t
+WriteKeys (std::string fileName, uint32_t node, const ScenarioProfile &profile,
+           ZipfSampler &zipf, UniformVariable &random, std::vector<uint32_t> &termBytes)
+{
+  std::ofstream keys (fileName.c_str ());
+  if (!keys.is_open ())
+    {
+      return 0;
+    }
+  uint64_t postings = 0;
+  for (uint32_t doc = 0; doc < profile.docs; doc++)
+    {
+      std::set<uint32_t> terms;
+      // a document has every keyword once, and the vocabulary may be
+      // smaller than the keywords asked for
+      uint32_t wanted = std::min (profile.keywordsPerDoc, profile.vocabulary);
+      while (terms.size () < wanted)
+        {
+          terms.insert (zipf.Sample (random));
+        }
+      std::ostringstream docName;
+      docName << "doc" << node << "-" << doc;
+      keys << docName.str ();
+      for (std::set<uint32_t>::const_iterator i = terms.begin (); i != terms.end (); i++)
+        {
+          keys << " T" << *i;
+          termBytes[*i] += sizeof (uint16_t) + docName.str ().size ();
+        }
+      keys << "\n";
+      postings += terms.size ();
+    }
+  return postings;
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string preset = "100";
+  std::string output = ".";
+  std::string name = "";
+  uint32_t seed = 1;
+  ScenarioProfile profile;
+  uint32_t nodes = 0, degree = 0, settle = 0, joinInterval = 0, publishers = 0;
+  uint32_t docs = 0, keywordsPerDoc = 0, vocabulary = 0, publishInterval = 0;
+  uint32_t searches = 0, maxTerms = 0, tail = 0;
+  double zipfExponent = 0, zipfOffset = -1, searchRate = 0;
+  bool verbose = false;
+  bool bootstrap = false;
+
+  CommandLine cmd;
+  cmd.AddValue ("preset", "Profile the other options start from: 100, 1k or 10k nodes", preset);
+  cmd.AddValue ("output", "Directory of the generated files, created if needed", output);
+  cmd.AddValue ("name", "Name of the topology and scenario files (default scale-<nodes>)", name);
+  cmd.AddValue ("seed", "Seed of the random number generator", seed);
+  cmd.AddValue ("nodes", "Number of nodes", nodes);
+  cmd.AddValue ("degree", "Links every node adds to the topology", degree);
+  cmd.AddValue ("settle", "ms for the routing protocol to converge before the first JOIN", settle);
+  cmd.AddValue ("join-interval", "ms between two JOINs", joinInterval);
+  cmd.AddValue ("publishers", "Number of nodes publishing a keys file", publishers);
+  cmd.AddValue ("docs", "Documents per keys file", docs);
+  cmd.AddValue ("keywords", "Keywords per document", keywordsPerDoc);
+  cmd.AddValue ("vocabulary", "Number of distinct keywords", vocabulary);
+  cmd.AddValue ("zipf", "Exponent of the Zipf distribution of keywords and query terms", zipfExponent);
+  cmd.AddValue ("zipf-offset", "Offset q of the ranks in 1 / (rank + q)^zipf, larger ones flatten the popular terms", zipfOffset);
+  cmd.AddValue ("publish-interval", "ms between two PUBLISHes", publishInterval);
+  cmd.AddValue ("searches", "Number of SEARCHes", searches);
+  cmd.AddValue ("search-rate", "SEARCHes per second, as a Poisson process", searchRate);
+  cmd.AddValue ("terms", "Largest number of terms in a SEARCH", maxTerms);
+  cmd.AddValue ("tail", "ms from the last SEARCH to QUIT", tail);
+  cmd.AddValue ("verbose", "Log the search results in the scenario", verbose);
+  cmd.AddValue ("bootstrap", "Build the ring with CHORD BOOTSTRAP and place the keys with CHORD PRELOAD, rather than JOIN and PUBLISH", bootstrap);
+  cmd.Parse (argc, argv);
+
+  if (!GetPreset (preset, profile))
+    {
+      std::cerr << "Unknown preset " << preset << ", use 100, 1k or 10k" << std::endl;
+      return 1;
+    }
+  // the options left at zero keep the value of the preset
+  Override (profile.nodes, nodes);
+  Override (profile.degree, degree);
+  Override (profile.settle, settle);
+  Override (profile.joinInterval, joinInterval);
+  Override (profile.publishers, publishers);
+  Override (profile.docs, docs);
+  Override (profile.keywordsPerDoc, keywordsPerDoc);
+  Override (profile.vocabulary, vocabulary);
+  Override (profile.zipf, zipfExponent);
+  if (zipfOffset >= 0)
+    {
+      profile.zipfOffset = zipfOffset;
+    }
+  Override (profile.publishInterval, publishInterval);
+  Override (profile.searches, searches);
+  Override (profile.searchRate, searchRate);
+  Override (profile.maxTerms, maxTerms);
+  Override (profile.tail, tail);
+  profile.publishers = std::min (profile.publishers, profile.nodes);
+  if (profile.nodes < 2 || profile.vocabulary == 0)
+    {
+      std::cerr << "At least 2 nodes and 1 keyword are needed" << std::endl;
+      return 1;
+    }
+  if (name.empty ())
+    {
+      std::ostringstream oss;
+      oss << "scale-" << profile.nodes;
+      name = oss.str ();
+    }
+
+  SeedManager::SetSeed (seed);
+  UniformVariable random;
+  ZipfSampler zipf (profile.vocabulary, profile.zipf, profile.zipfOffset);
+
+  std::string keysDir = output + "/keys";
+  if (!MakeDirectory (output) || !MakeDirectory (keysDir))
+    {
+      std::cerr << "Cannot create " << keysDir << std::endl;
+      return 1;
+    }
+  std::string topoFile = output + "/" + name + ".topo";
+  uint64_t links = WriteTopology (topoFile, profile, random);
+  if (links == 0)
+    {
+      std::cerr << "Cannot write " << topoFile << std::endl;
+      return 1;
+    }
+
+  std::string scenarioFile = output + "/" + name + ".sce";
+  std::ofstream sce (scenarioFile.c_str ());
+  if (!sce.is_open ())
+    {
+      std::cerr << "Cannot write " << scenarioFile << std::endl;
+      return 1;
+    }
+  sce << "# Generated by scenario-generator --preset=" << preset << " --seed=" << seed << "\n";
+  sce << "* LS VERBOSE ALL OFF\n";
+  sce << "* DV VERBOSE ALL OFF\n";
+  sce << "* PENNSEARCH VERBOSE ALL OFF\n";
+  if (verbose)
+    {
+      sce << "* PENNSEARCH VERBOSE SEARCH ON\n";
+    }
+  sce << "\n# Let the routing protocol converge\n";
+  sce << "TIME " << profile.settle << "\n";
+
+  // The ring grows from node 0, every other node joins through one which
+  // is already in it, in random order
+  std::vector<uint32_t> order (profile.nodes);
+  for (uint32_t i = 0; i < profile.nodes; i++)
+    {
+      order[i] = i;
+    }
+  for (uint32_t i = profile.nodes - 1; i > 1; i--)
+    {
+      std::swap (order[i], order[random.GetInteger (1, i)]);
+    }
+  if (bootstrap)
+    {
+      sce << "\n# The converged ring of all nodes\n";
+      sce << "CHORD BOOTSTRAP\n";
+    }
+  else
+    {
+      sce << "\n# Staggered JOINs, " << profile.joinInterval << " ms apart\n";
+      sce << "0 PENNSEARCH CHORD JOIN 0\n";
+    }
+  for (uint32_t i = 1; i < profile.nodes; i++)
+    {
+      // drawn either way, so that both modes get the same workload
+      uint32_t landmark = order[random.GetInteger (0, i - 1)];
+      if (!bootstrap)
+        {
+          sce << "TIME " << profile.joinInterval << "\n";
+          sce << order[i] << " PENNSEARCH CHORD JOIN " << landmark << "\n";
+        }
+    }
+  if (!bootstrap)
+    {
+      // give the last nodes a few stabilize rounds
+      sce << "TIME " << profile.settle / 2 << "\n";
+    }
+
+  sce << "\n# " << profile.publishers << " publishers of " << profile.docs << " documents\n";
+  uint64_t postings = 0;
+  std::vector<uint32_t> termBytes (profile.vocabulary + 1, 0);
+  for (uint32_t i = 0; i < profile.publishers; i++)
+    {
+      uint32_t node = order[i];
+      std::ostringstream keysFile;
+      keysFile << keysDir << "/" << node << ".keys";
+      uint64_t written = WriteKeys (keysFile.str (), node, profile, zipf, random, termBytes);
+      if (written == 0)
+        {
+          std::cerr << "Cannot write " << keysFile.str () << std::endl;
+          return 1;
+        }
+      postings += written;
+      if (bootstrap)
+        {
+          sce << "CHORD PRELOAD " << keysFile.str () << "\n";
+          continue;
+        }
+      sce << node << " PENNSEARCH PUBLISH " << keysFile.str () << "\n";
+      sce << "TIME " << profile.publishInterval << "\n";
+    }
+  if (!bootstrap)
+    {
+      sce << "TIME " << profile.settle / 2 << "\n";
+    }
+  // the list, the message, UDP, IPv4 and PPP headers
+  uint32_t longest = *std::max_element (termBytes.begin (), termBytes.end ());
+  uint32_t mtu = std::max (longest + 100, (uint32_t) 1500);
+  sce << "# The longest posting list is " << longest << " bytes, run simulator-main with --mtu="
+      << mtu << "\n";
+
+  sce << "\n# " << profile.searches << " searches, " << profile.searchRate << " per second\n";
+  ExponentialVariable interArrival (1000.0 / profile.searchRate);
+  double now = 0;
+  uint64_t last = 0;
+  for (uint32_t i = 0; i < profile.searches; i++)
+    {
+      now += interArrival.GetValue ();
+      uint64_t ms = (uint64_t) now;
+      if (ms > last)
+        {
+          sce << "TIME " << ms - last << "\n";
+          last = ms;
+        }
+      uint32_t node = random.GetInteger (0, profile.nodes - 1);
+      uint32_t n = random.GetInteger (1, profile.maxTerms);
+      std::set<uint32_t> terms;
+      for (uint32_t j = 0; j < n; j++)
+        {
+          terms.insert (zipf.Sample (random));
+        }
+      sce << node << " PENNSEARCH SEARCH " << node;
+      for (std::set<uint32_t>::const_iterator j = terms.begin (); j != terms.end (); j++)
+        {
+          sce << " T" << *j;
+        }
+      sce << "\n";
+    }
+  sce << "\nTIME " << profile.tail << "\n";
+  sce << "QUIT\n";
+
+  std::cout << topoFile << ": " << profile.nodes << " nodes, " << links << " links" << std::endl;
+  std::cout << scenarioFile << ": " << profile.nodes << " joins, " << profile.publishers
+            << " publishers, " << postings << " postings, " << profile.searches << " searches"
+            << std::endl;
+  std::cout << "The longest posting list is " << longest << " bytes, run simulator-main with --mtu="
+            << mtu << std::endl;
+  if (mtu > 65535)
+    {
+      std::cerr << "The longest posting list does not fit a datagram, raise --zipf-offset or --vocabulary"
+                << std::endl;
+    }
+  return 0;
+}
@@ -0,0 +1,456 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 University of Pennsylvania
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Runs simulator-main over a grid of parameters, as independent
+ * processes on the cores of this host, and merges their --metrics into
+ * one CSV line per configuration.  Each line of the grid file is a
+ * simulator-main option and the values it takes:
+ *
+ *   routing LS DV
+ *   PennChord::StabilizePeriod 1s 5s 10s
+ *   inet-topo,scenario s100/scale-100.topo,s100/scale-100.sce s1k/scale-1k.topo,s1k/scale-1k.sce
+ *
+ * Options joined by commas vary together, which pairs a topology with
+ * its scenario.  Every combination runs --runs times, run i with
+ * --run=i in every configuration so that they see the same random
+ * streams, a seed line varies --seed as well.  A run is only started when its --threads fit in the cores
+ * not taken by the others.  The logs and metrics of the runs are kept
+ * in the output directory, the merged CSV holds the mean of each metric
+ * over the runs that succeeded.  A mean of percentiles is no percentile:
+ * the lookup percentiles are taken over the latencies of all those runs
+ * together, maxima are the largest of the runs and the hot node is the
+ * one of the run with the most utilized node.
+ */
+
+#include "ns3/core-module.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+using namespace ns3;
+
+struct SweepAxis
+{
+  std::vector<std::string> options;
+  // values[i][j] is the value of options[j] in the i-th setting
+  std::vector<std::vector<std::string> > values;
+};
+
+struct SweepRun
+{
+  uint32_t config;
+  uint32_t run;
+  std::vector<std::string> args;
+  uint32_t threads;
+  std::string metricsFile;
+};
+
+static std::vector<std::string>
+Split (const std::string &str, char delimiter)
+{
+  std::vector<std::string> tokens;
+  std::string token;
+  std::istringstream stream (str);
+  while (std::getline (stream, token, delimiter))
+    {
+      tokens.push_back (token);
+    }
+  return tokens;
+}
+
+static bool
+ReadGrid (std::string gridFile, std::vector<SweepAxis> &axes)
+{
+  std::ifstream file (gridFile.c_str ());
+  if (!file)
+    {
+      std::cerr << "Cannot read " << gridFile << std::endl;
+      return false;
+    }
+  std::string line;
+  while (std::getline (file, line))
+    {
+      std::istringstream tokens (line);
+      std::string name;
+      if (!(tokens >> name) || name[0] == '#')
+        {
+          continue;
+        }
+      SweepAxis axis;
+      axis.options = Split (name, ',');
+      std::string value;
+      while (tokens >> value)
+        {
+          std::vector<std::string> values = Split (value, ',');
+          if (values.size () != axis.options.size ())
+            {
+              std::cerr << "Value " << value << " does not match " << name << std::endl;
+              return false;
+            }
+          axis.values.push_back (values);
+        }
+      if (axis.values.empty ())
+        {
+          std::cerr << "No value for " << name << std::endl;
+          return false;
+        }
+      axes.push_back (axis);
+    }
+  return true;
+}
+
+static bool
+ReadMetrics (std::string metricsFile, std::vector<std::string> &names,
+             std::map<std::string, double> &sums)
+{
+  std::ifstream file (metricsFile.c_str ());
+  std::string name;
+  double value;
+  bool any = false;
+  while (file >> name >> value)
+    {
+      if (std::find (names.begin (), names.end (), name) == names.end ())
+        {
+          names.push_back (name);
+        }
+      sums[name] += value;
+      any = true;
+    }
+  return any;
+}
+
+// The lookup latencies simulator-main writes next to the metrics
+static bool
+ReadLatencies (std::string latenciesFile, std::vector<float> &latencies)
+{
+  std::ifstream file (latenciesFile.c_str ());
+  float latency;
+  bool any = false;
+  while (file >> latency)
+    {
+      latencies.push_back (latency);
+      any = true;
+    }
+  return any;
+}
+
+// nearest rank, as simulator-main
+static float
+Percentile (const std::vector<float> &sorted, double fraction)
+{
+  if (sorted.empty ())
+    {
+      return 0;
+    }
+  uint32_t rank = (uint32_t) (fraction * sorted.size () + 0.999999);
+  return sorted[std::min (std::max (rank, (uint32_t) 1), (uint32_t) sorted.size ()) - 1];
+}
+
+static bool
+IsMaximum (const std::string &name)
+{
+  return name.find ("_max") != std::string::npos;
+}
+
+static pid_t
+StartRun (const SweepRun &run, std::string simulator, std::string logFile, int input)
+{
+  pid_t pid = fork ();
+  if (pid != 0)
+    {
+      return pid;
+    }
+  // simulator-main reads commands from stdin, which must not reach EOF
+  // under it or its command thread spins
+  int log = open (logFile.c_str (), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (log < 0)
+    {
+      _exit (127);
+    }
+  dup2 (input, 0);
+  dup2 (log, 1);
+  dup2 (log, 2);
+  std::vector<char *> argv;
+  argv.push_back ((char *) simulator.c_str ());
+  for (uint32_t i = 0; i < run.args.size (); i++)
+    {
+      argv.push_back ((char *) run.args[i].c_str ());
+    }
+  argv.push_back (0);
+  execv (simulator.c_str (), &argv[0]);
+  _exit (127);
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string gridFile = "";
+  std::string output = "sweep";
+  std::string csvFile = "";
+  std::string simulator = "";
+  uint32_t runs = 1;
+  uint32_t firstRun = 1;
+  uint32_t cores = sysconf (_SC_NPROCESSORS_ONLN);
+
+  CommandLine cmd;
+  cmd.AddValue ("grid", "File of simulator-main options and their values, one option per line", gridFile);
+  cmd.AddValue ("output", "Directory of the logs and metrics of the runs, created if needed", output);
+  cmd.AddValue ("csv", "Merged CSV, one line per configuration (default <output>/sweep.csv)", csvFile);
+  cmd.AddValue ("simulator", "simulator-main to run (default the one next to sweep-runner)", simulator);
+  cmd.AddValue ("runs", "Runs of every configuration", runs);
+  cmd.AddValue ("first-run", "Run number of the first run", firstRun);
+  cmd.AddValue ("cores", "Cores the runs may take together (default all of this host)", cores);
+  cmd.Parse (argc, argv);
+
+  std::vector<SweepAxis> axes;
+  if (gridFile.empty () || !ReadGrid (gridFile, axes))
+    {
+      std::cerr << "A grid file is needed, see --PrintHelp" << std::endl;
+      return 1;
+    }
+  if (simulator.empty ())
+    {
+      std::string self = argv[0];
+      std::string::size_type slash = self.rfind ('/');
+      simulator = (slash == std::string::npos ? "" : self.substr (0, slash + 1)) + "simulator-main";
+    }
+  if (csvFile.empty ())
+    {
+      csvFile = output + "/sweep.csv";
+    }
+  if (mkdir (output.c_str (), 0755) != 0 && errno != EEXIST)
+    {
+      std::cerr << "Cannot create " << output << std::endl;
+      return 1;
+    }
+  cores = std::max (cores, (uint32_t) 1);
+
+  // Every combination of the axes, the last one varying fastest
+  uint32_t configs = 1;
+  for (uint32_t i = 0; i < axes.size (); i++)
+    {
+      configs *= axes[i].values.size ();
+    }
+  std::vector<std::vector<std::string> > settings (configs);
+  std::vector<SweepRun> queue;
+  for (uint32_t c = 0; c < configs; c++)
+    {
+      uint32_t index = c;
+      std::vector<std::string> args;
+      uint32_t threads = 1;
+      for (int32_t i = axes.size () - 1; i >= 0; i--)
+        {
+          const std::vector<std::string> &values = axes[i].values[index % axes[i].values.size ()];
+          index /= axes[i].values.size ();
+          for (uint32_t j = 0; j < values.size (); j++)
+            {
+              args.push_back ("--" + axes[i].options[j] + "=" + values[j]);
+              if (axes[i].options[j] == "threads")
+                {
+                  threads = std::max (atoi (values[j].c_str ()), 1);
+                }
+            }
+          settings[c].insert (settings[c].begin (), values.begin (), values.end ());
+        }
+      for (uint32_t r = 0; r < runs; r++)
+        {
+          std::ostringstream name;
+          name << output << "/c" << c << "-r" << firstRun + r;
+          SweepRun run;
+          run.config = c;
+          run.run = firstRun + r;
+          run.args = args;
+          std::ostringstream runArg;
+          runArg << "--run=" << run.run;
+          run.args.push_back (runArg.str ());
+          run.metricsFile = name.str () + ".metrics";
+          run.args.push_back ("--metrics=" + run.metricsFile);
+          run.threads = std::min (threads, cores);
+          queue.push_back (run);
+        }
+    }
+  std::cout << configs << " configurations, " << queue.size () << " runs on " << cores << " cores" << std::endl;
+
+  int input[2];
+  if (pipe (input) != 0)
+    {
+      std::cerr << "Cannot create a pipe" << std::endl;
+      return 1;
+    }
+  fcntl (input[1], F_SETFD, FD_CLOEXEC);
+
+  std::map<pid_t, uint32_t> running;
+  std::vector<bool> succeeded (queue.size (), false);
+  uint32_t next = 0;
+  uint32_t busy = 0;
+  uint32_t done = 0;
+  while (next < queue.size () || !running.empty ())
+    {
+      while (next < queue.size () && (running.empty () || busy + queue[next].threads <= cores))
+        {
+          std::ostringstream logFile;
+          logFile << output << "/c" << queue[next].config << "-r" << queue[next].run << ".log";
+          unlink (queue[next].metricsFile.c_str ());
+          pid_t pid = StartRun (queue[next], simulator, logFile.str (), input[0]);
+          if (pid < 0)
+            {
+              std::cerr << "Cannot start " << simulator << ", stopping the runs" << std::endl;
+              for (std::map<pid_t, uint32_t>::iterator iter = running.begin (); iter != running.end (); iter++)
+                {
+                  kill (iter->first, SIGTERM);
+                }
+              for (std::map<pid_t, uint32_t>::iterator iter = running.begin (); iter != running.end (); iter++)
+                {
+                  int status;
+                  waitpid (iter->first, &status, 0);
+                }
+              close (input[0]);
+              close (input[1]);
+              return 1;
+            }
+          running[pid] = next;
+          busy += queue[next].threads;
+          next++;
+        }
+      int status;
+      pid_t pid = wait (&status);
+      if (pid < 0)
+        {
+          break;
+        }
+      std::map<pid_t, uint32_t>::iterator iter = running.find (pid);
+      if (iter == running.end ())
+        {
+          continue;
+        }
+      const SweepRun &run = queue[iter->second];
+      busy -= run.threads;
+      succeeded[iter->second] = WIFEXITED (status) && WEXITSTATUS (status) == 0;
+      done++;
+      std::cout << "[" << done << "/" << queue.size () << "] c" << run.config << "-r" << run.run
+                << (succeeded[iter->second] ? "" : " failed") << std::endl;
+      running.erase (iter);
+    }
+  close (input[0]);
+  close (input[1]);
+
+  std::vector<std::string> names;
+  std::vector<std::map<std::string, double> > sums (configs);
+  std::vector<std::map<std::string, double> > maxima (configs);
+  std::vector<std::vector<float> > latencies (configs);
+  std::vector<uint32_t> counts (configs, 0);
+  uint32_t failed = 0;
+  for (uint32_t i = 0; i < queue.size (); i++)
+    {
+      std::map<std::string, double> metrics;
+      if (!succeeded[i] || !ReadMetrics (queue[i].metricsFile, names, metrics))
+        {
+          failed++;
+          continue;
+        }
+      uint32_t c = queue[i].config;
+      for (std::map<std::string, double>::iterator iter = metrics.begin (); iter != metrics.end (); iter++)
+        {
+          sums[c][iter->first] += iter->second;
+          if (IsMaximum (iter->first) && (counts[c] == 0 || iter->second > maxima[c][iter->first]))
+            {
+              maxima[c][iter->first] = iter->second;
+            }
+        }
+      if (counts[c] == 0 || metrics["service_utilization_max"] >= maxima[c]["service_utilization_max"])
+        {
+          maxima[c]["service_hot_node"] = metrics["service_hot_node"];
+        }
+      ReadLatencies (queue[i].metricsFile + ".latencies", latencies[c]);
+      counts[c]++;
+    }
+  std::map<std::string, double> percentiles;
+  percentiles["lookup_p50_ms"] = 0.5;
+  percentiles["lookup_p90_ms"] = 0.9;
+  percentiles["lookup_p99_ms"] = 0.99;
+
+  std::ofstream csv (csvFile.c_str ());
+  if (!csv)
+    {
+      std::cerr << "Cannot write " << csvFile << std::endl;
+      return 1;
+    }
+  for (uint32_t i = 0; i < axes.size (); i++)
+    {
+      for (uint32_t j = 0; j < axes[i].options.size (); j++)
+        {
+          csv << axes[i].options[j] << ",";
+        }
+    }
+  csv << "runs";
+  for (uint32_t i = 0; i < names.size (); i++)
+    {
+      csv << "," << names[i];
+    }
+  csv << std::endl;
+  for (uint32_t c = 0; c < configs; c++)
+    {
+      for (uint32_t i = 0; i < settings[c].size (); i++)
+        {
+          csv << settings[c][i] << ",";
+        }
+      csv << counts[c];
+      std::sort (latencies[c].begin (), latencies[c].end ());
+      for (uint32_t i = 0; i < names.size (); i++)
+        {
+          csv << ",";
+          if (counts[c] == 0)
+            {
+              continue;
+            }
+          if (percentiles.find (names[i]) != percentiles.end () && !latencies[c].empty ())
+            {
+              csv << Percentile (latencies[c], percentiles[names[i]]);
+            }
+          else if (IsMaximum (names[i]) || names[i] == "service_hot_node")
+            {
+              csv << maxima[c][names[i]];
+            }
+          else
+            {
+              csv << sums[c][names[i]] / counts[c];
+            }
+        }
+      csv << std::endl;
+    }
+  std::cout << "Wrote " << csvFile;
+  if (failed > 0)
+    {
+      std::cout << ", " << failed << " runs failed, see their logs in " << output;
+    }
+  std::cout << std::endl;
+  return failed > 0 ? 2 : 0;
+}
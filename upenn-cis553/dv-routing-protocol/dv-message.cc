@@ -68,6 +68,12 @@ DVMessage::GetSerializedSize (void) const
       case PING_RSP:
         size += m_message.pingRsp.GetSerializedSize ();
         break;
+      case HELLO:
+        size += m_message.hello.GetSerializedSize ();
+        break;
+      case UPDATE:
+        size += m_message.update.GetSerializedSize ();
+        break;
       default:
         NS_ASSERT (false);
     }
@@ -92,6 +98,12 @@ DVMessage::Print (std::ostream &os) const
       case PING_RSP:
         m_message.pingRsp.Print (os);
         break;
+      case HELLO:
+        m_message.hello.Print (os);
+        break;
+      case UPDATE:
+        m_message.update.Print (os);
+        break;
       default:
         break;  
     }
@@ -115,6 +127,12 @@ DVMessage::Serialize (Buffer::Iterator start) const
       case PING_RSP:
         m_message.pingRsp.Serialize (i);
         break;
+      case HELLO:
+        m_message.hello.Serialize (i);
+        break;
+      case UPDATE:
+        m_message.update.Serialize (i);
+        break;
       default:
         NS_ASSERT (false);   
     }
@@ -140,6 +158,12 @@ DVMessage::Deserialize (Buffer::Iterator start)
       case PING_RSP:
         size += m_message.pingRsp.Deserialize (i);
         break;
+      case HELLO:
+        size += m_message.hello.Deserialize (i);
+        break;
+      case UPDATE:
+        size += m_message.update.Deserialize (i);
+        break;
       default:
         NS_ASSERT (false);
     }
@@ -261,6 +285,116 @@ DVMessage::GetPingRsp ()
 }
 
 
+/* HELLO */
+
+uint32_t
+DVMessage::Hello::GetSerializedSize (void) const
+{
+  return sizeof(uint32_t);
+}
+
+void
+DVMessage::Hello::Print (std::ostream &os) const
+{
+  os << "Hello:: Interval: " << interval << "us\n";
+}
+
+void
+DVMessage::Hello::Serialize (Buffer::Iterator &start) const
+{
+  start.WriteHtonU32 (interval);
+}
+
+uint32_t
+DVMessage::Hello::Deserialize (Buffer::Iterator &start)
+{
+  interval = start.ReadNtohU32 ();
+  return Hello::GetSerializedSize ();
+}
+
+void
+DVMessage::SetHello (uint32_t interval)
+{
+  if (m_messageType == 0)
+    {
+      m_messageType = HELLO;
+    }
+  else
+    {
+      NS_ASSERT (m_messageType == HELLO);
+    }
+  m_message.hello.interval = interval;
+}
+
+DVMessage::Hello
+DVMessage::GetHello ()
+{
+  return m_message.hello;
+}
+
+/* UPDATE */
+
+uint32_t
+DVMessage::Update::GetSerializedSize (void) const
+{
+  return sizeof(uint8_t) + sizeof(uint16_t) + (IPV4_ADDRESS_SIZE + sizeof(uint8_t)) * destinations.size();
+}
+
+void
+DVMessage::Update::Print (std::ostream &os) const
+{
+  os << "Update:: Full: " << (uint32_t) full << " Entries: " << destinations.size() << "\n";
+}
+
+void
+DVMessage::Update::Serialize (Buffer::Iterator &start) const
+{
+  start.WriteU8 (full);
+  start.WriteU16 (destinations.size());
+  for (uint16_t i=0; i<destinations.size(); i++)
+  {
+      start.WriteHtonU32 (destinations[i].Get ());
+      start.WriteU8 (metrics[i]);
+  }
+}
+
+uint32_t
+DVMessage::Update::Deserialize (Buffer::Iterator &start)
+{
+  full = start.ReadU8 ();
+  uint16_t size = start.ReadU16 ();
+  destinations.clear();
+  metrics.clear();
+  for (uint16_t i=0; i<size; i++)
+  {
+      destinations.push_back (Ipv4Address (start.ReadNtohU32 ()));
+      metrics.push_back (start.ReadU8 ());
+  }
+  return Update::GetSerializedSize ();
+}
+
+void
+DVMessage::SetUpdate (bool full, std::vector<Ipv4Address> destinations, std::vector<uint8_t> metrics)
+{
+  if (m_messageType == 0)
+    {
+      m_messageType = UPDATE;
+    }
+  else
+    {
+      NS_ASSERT (m_messageType == UPDATE);
+    }
+  m_message.update.full = full;
+  m_message.update.destinations = destinations;
+  m_message.update.metrics = metrics;
+}
+
+DVMessage::Update
+DVMessage::GetUpdate ()
+{
+  return m_message.update;
+}
+
 //
 //
 //
@@ -22,6 +22,8 @@
 #include "ns3/packet.h"
 #include "ns3/object.h"
 
+#include <vector>
+
 using namespace ns3;
 
 #define IPV4_ADDRESS_SIZE 4
@@ -37,6 +39,8 @@ class DVMessage : public Header
       {
         PING_REQ = 1,
         PING_RSP = 2,
+        HELLO = 3,
+        UPDATE = 4,
         // Define extra message types when needed       
       };
 
@@ -129,11 +133,47 @@ class DVMessage : public Header
       };
 
 
+    /**
+     * \brief Neighbor discovery and liveness hello, broadcast on every
+     * interface.
+     */
+    struct Hello
+      {
+        void Print (std::ostream &os) const;
+        uint32_t GetSerializedSize (void) const;
+        void Serialize (Buffer::Iterator &start) const;
+        uint32_t Deserialize (Buffer::Iterator &start);
+        // Payload
+        // Time until the sender's next hello, in microseconds
+        uint32_t interval;
+      };
+
+    /**
+     * \brief Distance vector: the sender's metric to each listed
+     * destination, Infinity withdraws the route.  A full update lists
+     * every destination the sender knows, a triggered one only those
+     * that changed.
+     */
+    struct Update
+      {
+        void Print (std::ostream &os) const;
+        uint32_t GetSerializedSize (void) const;
+        void Serialize (Buffer::Iterator &start) const;
+        uint32_t Deserialize (Buffer::Iterator &start);
+        // Payload
+        uint8_t full;
+        std::vector<Ipv4Address> destinations;
+        // Metric to each destination, in destinations order
+        std::vector<uint8_t> metrics;
+      };
+
   private:
     struct
       {
         PingReq pingReq;
         PingRsp pingRsp;
+        Hello hello;
+        Update update;
       } m_message;
     
   public:
@@ -159,6 +199,30 @@ class DVMessage : public Header
      */
     void SetPingRsp (Ipv4Address destinationAddress, std::string message);
 
+    /**
+     * \returns Hello Struct
+     */
+    Hello GetHello ();
+
+    /**
+     *  \brief Sets HELLO message params
+     *  \param interval Hello interval of the sender, in microseconds
+     */
+    void SetHello (uint32_t interval);
+
+    /**
+     * \returns Update Struct
+     */
+    Update GetUpdate ();
+
+    /**
+     *  \brief Sets UPDATE message params
+     *  \param full Whether destinations left out are unreachable
+     *  \param destinations Main addresses of the destinations
+     *  \param metrics Metric to each destination
+     */
+    void SetUpdate (bool full, std::vector<Ipv4Address> destinations, std::vector<uint8_t> metrics);
+
 }; // class DVMessage
 
 static inline std::ostream& operator<< (std::ostream& os, const DVMessage& message)
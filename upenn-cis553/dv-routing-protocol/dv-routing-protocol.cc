@@ -25,13 +25,21 @@
 #include "ns3/ipv4-header.h"
 #include "ns3/ipv4-route.h"
 #include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/penn-share-table.h"
 #include <sys/time.h>
+#include <set>
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE ("DVRoutingProtocol");
 NS_OBJECT_ENSURE_REGISTERED (DVRoutingProtocol);
 
+uint32_t DVRoutingProtocol::globalUpdates = 0;
+uint64_t DVRoutingProtocol::globalUpdateBytes = 0;
+Time DVRoutingProtocol::globalStatsStart;
+Time DVRoutingProtocol::globalLastRouteChange;
+
 TypeId
 DVRoutingProtocol::GetTypeId (void)
 {
@@ -53,19 +61,58 @@ DVRoutingProtocol::GetTypeId (void)
                  UintegerValue (16),
                  MakeUintegerAccessor (&DVRoutingProtocol::m_maxTTL),
                  MakeUintegerChecker<uint8_t> ())
+  .AddAttribute ("HelloInterval",
+                 "Interval of the hellos broadcast on every interface",
+                 TimeValue (MilliSeconds (50)),
+                 MakeTimeAccessor (&DVRoutingProtocol::m_helloInterval),
+                 MakeTimeChecker ())
+  .AddAttribute ("DetectMultiplier",
+                 "Missed hellos before a neighbor is declared dead",
+                 UintegerValue (3),
+                 MakeUintegerAccessor (&DVRoutingProtocol::m_detectMultiplier),
+                 MakeUintegerChecker<uint32_t> (1))
+  .AddAttribute ("UpdateInterval",
+                 "Period of the full distance vector sent to every neighbor",
+                 TimeValue (Seconds (30)),
+                 MakeTimeAccessor (&DVRoutingProtocol::m_updateInterval),
+                 MakeTimeChecker ())
+  .AddAttribute ("TriggerDelay",
+                 "Time route changes are collected before a triggered update advertises them",
+                 TimeValue (MilliSeconds (50)),
+                 MakeTimeAccessor (&DVRoutingProtocol::m_triggerDelay),
+                 MakeTimeChecker ())
+  .AddAttribute ("HoldDownTime",
+                 "Time a route that got worse ignores neighbors not closer than the route was",
+                 TimeValue (MilliSeconds (1000)),
+                 MakeTimeAccessor (&DVRoutingProtocol::m_holdDownTime),
+                 MakeTimeChecker ())
+  .AddAttribute ("Infinity",
+                 "Metric of unreachable destinations, bounds counting to infinity, must exceed the diameter",
+                 UintegerValue (32),
+                 MakeUintegerAccessor (&DVRoutingProtocol::m_infinity),
+                 MakeUintegerChecker<uint32_t> (2, 255))
+  .AddAttribute ("PoisonReverse",
+                 "Advertise routes back to their next hop at Infinity rather than leave them out",
+                 BooleanValue (true),
+                 MakeBooleanAccessor (&DVRoutingProtocol::m_poisonReverse),
+                 MakeBooleanChecker ())
   ;
   return tid;
 }
 
 DVRoutingProtocol::DVRoutingProtocol ()
-  : m_auditPingsTimer (Timer::CANCEL_ON_DESTROY)
+  : m_nodeNumber (0),
+    m_random ("DV"),
+    m_auditPingsTimer (Timer::CANCEL_ON_DESTROY),
+    m_helloTimer (Timer::CANCEL_ON_DESTROY),
+    m_updateTimer (Timer::CANCEL_ON_DESTROY),
+    m_triggerTimer (Timer::CANCEL_ON_DESTROY)
 {
-  RandomVariable random;
-  SeedManager::SetSeed (time (NULL));
-  random = UniformVariable (0x00000000, 0xFFFFFFFF);
-  m_currentSequenceNumber = random.GetInteger ();
   // Setup static routing 
   m_staticRouting = Create<Ipv4StaticRouting> ();
+  m_nodeAddressMap = PennShareTable (std::map<uint32_t, Ipv4Address> ());
+  m_addressNodeMap = PennShareTable (std::map<Ipv4Address, uint32_t> ());
+  m_nodeAddresses = PennShareTable (std::map<uint32_t, std::vector<Ipv4Address> > ());
 }
 
 DVRoutingProtocol::~DVRoutingProtocol ()
@@ -88,8 +135,24 @@ DVRoutingProtocol::DoDispose ()
 
   // Cancel timers
   m_auditPingsTimer.Cancel ();
+  m_helloTimer.Cancel ();
+  m_updateTimer.Cancel ();
+  m_triggerTimer.Cancel ();
  
   m_pingTracker.clear (); 
+  for (std::map<uint32_t, NeighborTableEntry>::iterator iter = m_neighborTable.begin ();
+       iter != m_neighborTable.end (); iter++)
+    {
+      Simulator::Cancel (iter->second.timeoutEvent);
+    }
+  m_neighborTable.clear ();
+  for (std::map<uint32_t, RouteTableDetails>::iterator iter = m_routeTable.begin ();
+       iter != m_routeTable.end (); iter++)
+    {
+      Simulator::Cancel (iter->second.holdDownEvent);
+    }
+  m_routeTable.clear ();
+  m_fib.clear ();
 
   PennRoutingProtocol::DoDispose ();
 }
@@ -101,22 +164,43 @@ DVRoutingProtocol::SetMainInterface (uint32_t mainInterface)
 }
 
 void
-DVRoutingProtocol::SetNodeAddressMap (std::map<uint32_t, Ipv4Address> nodeAddressMap)
+DVRoutingProtocol::SetNodeAddressMap (const std::map<uint32_t, Ipv4Address> &nodeAddressMap)
 {
-  m_nodeAddressMap = nodeAddressMap;
+  m_nodeAddressMap = PennShareTable (nodeAddressMap);
 }
 
 void
-DVRoutingProtocol::SetAddressNodeMap (std::map<Ipv4Address, uint32_t> addressNodeMap)
+DVRoutingProtocol::SetAddressNodeMap (const std::map<Ipv4Address, uint32_t> &addressNodeMap)
 {
-  m_addressNodeMap = addressNodeMap;
+  m_addressNodeMap = PennShareTable (addressNodeMap);
+  // Only invert the table once for all nodes
+  static const std::map<Ipv4Address, uint32_t> *inverted = 0;
+  static const std::map<uint32_t, std::vector<Ipv4Address> > *nodeAddresses = 0;
+  if (inverted != m_addressNodeMap)
+    {
+      std::map<uint32_t, std::vector<Ipv4Address> > table;
+      for (std::map<Ipv4Address, uint32_t>::const_iterator iter = m_addressNodeMap->begin ();
+           iter != m_addressNodeMap->end (); iter++)
+        {
+          table[iter->second].push_back (iter->first);
+        }
+      nodeAddresses = PennShareTable (table);
+      inverted = m_addressNodeMap;
+    }
+  m_nodeAddresses = nodeAddresses;
+}
+
+Time
+DVRoutingProtocol::GetLastRouteChange ()
+{
+  return PennStatsGet (globalLastRouteChange);
 }
 
 Ipv4Address
 DVRoutingProtocol::ResolveNodeIpAddress (uint32_t nodeNumber)
 {
-  std::map<uint32_t, Ipv4Address>::iterator iter = m_nodeAddressMap.find (nodeNumber);
-  if (iter != m_nodeAddressMap.end ())
+  std::map<uint32_t, Ipv4Address>::const_iterator iter = m_nodeAddressMap->find (nodeNumber);
+  if (iter != m_nodeAddressMap->end ())
     { 
       return iter->second;
     }
@@ -126,8 +210,8 @@ DVRoutingProtocol::ResolveNodeIpAddress (uint32_t nodeNumber)
 std::string
 DVRoutingProtocol::ReverseLookup (Ipv4Address ipAddress)
 {
-  std::map<Ipv4Address, uint32_t>::iterator iter = m_addressNodeMap.find (ipAddress);
-  if (iter != m_addressNodeMap.end ())
+  std::map<Ipv4Address, uint32_t>::const_iterator iter = m_addressNodeMap->find (ipAddress);
+  if (iter != m_addressNodeMap->end ())
     { 
       std::ostringstream sin;
       uint32_t nodeNumber = iter->second;
@@ -140,6 +224,8 @@ DVRoutingProtocol::ReverseLookup (Ipv4Address ipAddress)
 void
 DVRoutingProtocol::DoStart ()
 {
+  m_random.SetNode (GetObject<Node> ()->GetId ());
+  m_currentSequenceNumber = m_random.GetInteger (0, 0xFFFFFFFF);
   // Create sockets
   for (uint32_t i = 0 ; i < m_ipv4->GetNInterfaces () ; i++)
     {
@@ -162,15 +248,34 @@ DVRoutingProtocol::DoStart ()
     }
   // Configure timers
   m_auditPingsTimer.SetFunction (&DVRoutingProtocol::AuditPings, this);
+  m_helloTimer.SetFunction (&DVRoutingProtocol::SendHellos, this);
+  m_updateTimer.SetFunction (&DVRoutingProtocol::SendPeriodicUpdate, this);
+  m_triggerTimer.SetFunction (&DVRoutingProtocol::SendTriggeredUpdate, this);
 
   // Start timers
   m_auditPingsTimer.Schedule (m_pingTimeout);
+  m_helloTimer.Schedule (Seconds (m_helloInterval.GetSeconds () * m_random.GetValue (0.75, 1)));
+  m_updateTimer.Schedule (Seconds (m_updateInterval.GetSeconds () * m_random.GetValue (0.75, 1)));
 
+  std::map<Ipv4Address, uint32_t>::const_iterator self = m_addressNodeMap->find (m_mainAddress);
+  if (self != m_addressNodeMap->end ())
+    {
+      m_nodeNumber = self->second;
+    }
 }
 
 Ptr<Ipv4Route>
 DVRoutingProtocol::RouteOutput (Ptr<Packet> packet, const Ipv4Header &header, Ptr<NetDevice> outInterface, Socket::SocketErrno &sockerr)
 {
+  Fib::const_iterator iter = m_fib.find (header.GetDestination ());
+  if (iter != m_fib.end ())
+    {
+      Ptr<Ipv4Route> route = SelectRoute (iter->second, m_mainAddress, header, 0);
+      DEBUG_LOG ("Destination: " << header.GetDestination () << " via next-hop: " << route->GetGateway ());
+      sockerr = Socket::ERROR_NOTERROR;
+      return route;
+    }
+
   Ptr<Ipv4Route> ipv4Route = m_staticRouting->RouteOutput (packet, header, outInterface, sockerr);
   if (ipv4Route)
     {
@@ -213,6 +318,14 @@ DVRoutingProtocol::RouteInput  (Ptr<const Packet> packet,
         }
     }
 
+  Fib::const_iterator iter = m_fib.find (destinationAddress);
+  if (iter != m_fib.end ())
+    {
+      DEBUG_LOG ("Destination: " << destinationAddress);
+      ucb (SelectRoute (iter->second, m_mainAddress, header, packet), packet, header);
+      return true;
+    }
+
   // Check static routing table
   if (m_staticRouting->RouteInput (packet, header, inputDev, ucb, mcb, lcb, ecb))
     {
@@ -283,6 +396,10 @@ DVRoutingProtocol::ProcessCommand (std::vector<std::string> tokens)
         {
           DumpNeighbors ();
         }
+      else if (table == "STATS")
+        {
+          DumpStats ();
+        }
     }
 }
 
@@ -290,16 +407,63 @@ void
 DVRoutingProtocol::DumpNeighbors ()
 {
   STATUS_LOG (std::endl << "**************** Neighbor List ********************" << std::endl
-              << "Neighbor\t\tInterface");
-  PRINT_LOG ("");
+              << "NeighborNumber\t\tNeighborAddr\t\tInterfaceAddr");
+  PRINT_LOG (m_neighborTable.size ());
+  for (std::map<uint32_t, NeighborTableEntry>::iterator iter = m_neighborTable.begin ();
+       iter != m_neighborTable.end (); iter++)
+    {
+      PRINT_LOG (iter->first << "\t\t" << iter->second.neighborAddr << "\t\t" << iter->second.interfaceAddr);
+    }
 }
 
 void
 DVRoutingProtocol::DumpRoutingTable ()
 {
   STATUS_LOG (std::endl << "**************** Route Table ********************" << std::endl
-              << "Destination\t\tNextHop\t\tInterface\t\tCost");
-  PRINT_LOG ("");
+              << "DestNumber\t\tDestAddr\t\tNextHopNumber\t\tNextHopAddr\t\tInterfaceAddr\t\tCost");
+  // Routes being withdrawn are left out
+  uint32_t reachable = 0;
+  for (std::map<uint32_t, RouteTableDetails>::iterator iter = m_routeTable.begin ();
+       iter != m_routeTable.end (); iter++)
+    {
+      if (iter->second.cost < m_infinity)
+        {
+          reachable++;
+        }
+    }
+  PRINT_LOG (reachable);
+  for (std::map<uint32_t, RouteTableDetails>::iterator iter = m_routeTable.begin ();
+       iter != m_routeTable.end (); iter++)
+    {
+      if (iter->second.cost < m_infinity)
+        {
+          PRINT_LOG (iter->first << "\t\t" << iter->second.destAddr << "\t\t" << iter->second.nextHopNumber
+                     << "\t\t" << iter->second.nextHopAddr << "\t\t" << iter->second.interfaceAddr
+                     << "\t\t" << iter->second.cost);
+        }
+    }
+}
+
+void
+DVRoutingProtocol::DumpStats ()
+{
+  // the other partitions keep counting while we dump
+  uint32_t updates = PennStatsTake (globalUpdates);
+  uint64_t updateBytes = PennStatsTake (globalUpdateBytes);
+  Time lastRouteChange = PennStatsGet (globalLastRouteChange);
+  Time elapsed = Simulator::Now () - globalStatsStart;
+  PRINT_LOG ("Updates: " << updates << " messages, " << updateBytes << " bytes in the last "
+             << elapsed.GetMilliSeconds () << " ms");
+  if (lastRouteChange > globalStatsStart)
+    {
+      PRINT_LOG ("Routes converged " << (lastRouteChange - globalStatsStart).GetMilliSeconds ()
+                 << " ms after the previous dump");
+    }
+  else
+    {
+      PRINT_LOG ("No route changed since the previous dump");
+    }
+  globalStatsStart = Simulator::Now ();
 }
 
 void
@@ -320,6 +484,12 @@ DVRoutingProtocol::RecvDVMessage (Ptr<Socket> socket)
       case DVMessage::PING_RSP:
         ProcessPingRsp (dvMessage);
         break;
+      case DVMessage::HELLO:
+        ProcessHello (dvMessage, socket, sourceAddress);
+        break;
+      case DVMessage::UPDATE:
+        ProcessUpdate (dvMessage, socket);
+        break;
       default:
         ERROR_LOG ("Unknown Message Type!");
         break;
@@ -410,6 +580,412 @@ DVRoutingProtocol::GetNextSequenceNumber ()
   return m_currentSequenceNumber++;
 }
 
+/*
+ * Distance vector routing in the manner of RIP (RFC 2453), with hop
+ * count metrics bounded by Infinity.  Hellos discover the neighbors and
+ * keep them alive.  Every node keeps the metrics its neighbors last
+ * advertised and routes through the one closest to each destination.
+ * Changed routes are advertised at once by triggered updates holding
+ * only those routes, and the whole vector goes out every UpdateInterval
+ * to repair lost updates.
+ *
+ * A route is advertised back to its next hop at Infinity (split horizon
+ * with poisoned reverse), so two nodes never route through each other.
+ * Longer loops are held off by hold-down: a route that got worse is
+ * withdrawn, and until HoldDownTime passes only a neighbor closer to the
+ * destination than the route was may take it over, as that neighbor
+ * cannot be routing through us.  A loop that still forms counts up to
+ * Infinity and breaks.
+ */
+void
+DVRoutingProtocol::SendHellos ()
+{
+  for (std::map<Ptr<Socket> , Ipv4InterfaceAddress>::const_iterator i =
+      m_socketAddresses.begin (); i != m_socketAddresses.end (); i++)
+    {
+      SendHello (i->first);
+    }
+  // Jittered, so that the hellos of neighbors do not synchronize
+  m_helloTimer.Schedule (Seconds (m_helloInterval.GetSeconds () * m_random.GetValue (0.75, 1)));
+}
+
+void
+DVRoutingProtocol::SendHello (Ptr<Socket> socket)
+{
+  DVMessage dvMessage = DVMessage (DVMessage::HELLO, GetNextSequenceNumber (), 1, m_mainAddress);
+  dvMessage.SetHello (m_helloInterval.GetMicroSeconds ());
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (dvMessage);
+  Ipv4InterfaceAddress interfaceAddr = m_socketAddresses[socket];
+  socket->SendTo (packet, 0, InetSocketAddress (interfaceAddr.GetLocal ().GetSubnetDirectedBroadcast (interfaceAddr.GetMask ()), m_dvPort));
+}
+
+void
+DVRoutingProtocol::ProcessHello (DVMessage dvMessage, Ptr<Socket> socket, Ipv4Address sourceAddress)
+{
+  std::map<Ipv4Address, uint32_t>::const_iterator node = m_addressNodeMap->find (dvMessage.GetOriginatorAddress ());
+  if (node == m_addressNodeMap->end () || node->second == m_nodeNumber)
+    {
+      return;
+    }
+  uint32_t nodeNumber = node->second;
+  Ipv4Address interfaceAddr = m_socketAddresses[socket].GetLocal ();
+  std::map<uint32_t, NeighborTableEntry>::iterator iter = m_neighborTable.find (nodeNumber);
+  bool added = false;
+  if (iter == m_neighborTable.end ())
+    {
+      NeighborTableEntry entry;
+      entry.neighborAddr = sourceAddress;
+      entry.interfaceAddr = interfaceAddr;
+      iter = m_neighborTable.insert (std::make_pair (nodeNumber, entry)).first;
+      added = true;
+    }
+  else if (iter->second.interfaceAddr != interfaceAddr)
+    {
+      // Further links to the same neighbor stay unused while the first is up
+      return;
+    }
+  NeighborTableEntry &entry = iter->second;
+  // Whole nanoseconds, a fractional deadline would keep NeighborTimeout
+  // rescheduling itself at zero delay
+  entry.deadline = Simulator::Now ()
+    + NanoSeconds (MicroSeconds (dvMessage.GetHello ().interval).GetNanoSeconds () * m_detectMultiplier);
+  if (!entry.timeoutEvent.IsRunning ())
+    {
+      entry.timeoutEvent = Simulator::Schedule (entry.deadline - Simulator::Now (),
+                                                &DVRoutingProtocol::NeighborTimeout, this, nodeNumber);
+    }
+  if (!added)
+    {
+      return;
+    }
+  DEBUG_LOG ("Neighbor " << nodeNumber << " is up");
+  // The neighbor advertises itself at 0, the hello tells as much
+  entry.metrics[nodeNumber] = 0;
+  if (UpdateRoute (nodeNumber))
+    {
+      ScheduleTriggeredUpdate ();
+    }
+  // Make ourselves known to the neighbor before handing it our routes,
+  // it ignores updates from nodes it has not heard a hello from
+  SendHello (socket);
+  SendUpdate (socket, true);
+}
+
+void
+DVRoutingProtocol::NeighborTimeout (uint32_t nodeNumber)
+{
+  std::map<uint32_t, NeighborTableEntry>::iterator iter = m_neighborTable.find (nodeNumber);
+  if (iter == m_neighborTable.end ())
+    {
+      return;
+    }
+  if (Simulator::Now () < iter->second.deadline)
+    {
+      iter->second.timeoutEvent = Simulator::Schedule (iter->second.deadline - Simulator::Now (),
+                                                       &DVRoutingProtocol::NeighborTimeout, this, nodeNumber);
+      return;
+    }
+  DEBUG_LOG ("Neighbor " << nodeNumber << " timed out");
+  m_neighborTable.erase (iter);
+  // Only the routes through the neighbor can change
+  std::vector<uint32_t> affected;
+  for (std::map<uint32_t, RouteTableDetails>::iterator route = m_routeTable.begin ();
+       route != m_routeTable.end (); route++)
+    {
+      if (route->second.cost < m_infinity && route->second.nextHopNumber == nodeNumber)
+        {
+          affected.push_back (route->first);
+        }
+    }
+  bool changed = false;
+  for (uint32_t i = 0; i < affected.size (); i++)
+    {
+      changed = UpdateRoute (affected[i]) || changed;
+    }
+  if (changed)
+    {
+      ScheduleTriggeredUpdate ();
+    }
+}
+
+void
+DVRoutingProtocol::ProcessUpdate (DVMessage dvMessage, Ptr<Socket> socket)
+{
+  std::map<Ipv4Address, uint32_t>::const_iterator node = m_addressNodeMap->find (dvMessage.GetOriginatorAddress ());
+  if (node == m_addressNodeMap->end ())
+    {
+      return;
+    }
+  std::map<uint32_t, NeighborTableEntry>::iterator iter = m_neighborTable.find (node->second);
+  // Neighbors come up through hellos only
+  if (iter == m_neighborTable.end () || iter->second.interfaceAddr != m_socketAddresses[socket].GetLocal ())
+    {
+      return;
+    }
+  std::map<uint32_t, uint32_t> &metrics = iter->second.metrics;
+  DVMessage::Update update = dvMessage.GetUpdate ();
+  std::set<uint32_t> changed;
+  std::set<uint32_t> listed;
+  for (uint32_t i = 0; i < update.destinations.size (); i++)
+    {
+      std::map<Ipv4Address, uint32_t>::const_iterator destination = m_addressNodeMap->find (update.destinations[i]);
+      if (destination == m_addressNodeMap->end () || destination->second == m_nodeNumber)
+        {
+          continue;
+        }
+      uint32_t nodeNumber = destination->second;
+      uint32_t metric = std::min ((uint32_t) update.metrics[i], m_infinity);
+      listed.insert (nodeNumber);
+      std::map<uint32_t, uint32_t>::iterator old = metrics.find (nodeNumber);
+      if (metric >= m_infinity)
+        {
+          if (old != metrics.end ())
+            {
+              metrics.erase (old);
+              changed.insert (nodeNumber);
+            }
+        }
+      else if (old == metrics.end () || old->second != metric)
+        {
+          metrics[nodeNumber] = metric;
+          changed.insert (nodeNumber);
+        }
+    }
+  // A full update leaves out what the neighbor cannot reach
+  if (update.full)
+    {
+      for (std::map<uint32_t, uint32_t>::iterator metric = metrics.begin (); metric != metrics.end ();)
+        {
+          if (listed.find (metric->first) == listed.end ())
+            {
+              changed.insert (metric->first);
+              metrics.erase (metric++);
+            }
+          else
+            {
+              metric++;
+            }
+        }
+    }
+  bool trigger = false;
+  for (std::set<uint32_t>::iterator nodeNumber = changed.begin (); nodeNumber != changed.end (); nodeNumber++)
+    {
+      trigger = UpdateRoute (*nodeNumber) || trigger;
+    }
+  if (trigger)
+    {
+      ScheduleTriggeredUpdate ();
+    }
+}
+
+bool
+DVRoutingProtocol::UpdateRoute (uint32_t nodeNumber)
+{
+  std::map<uint32_t, RouteTableDetails>::iterator route = m_routeTable.find (nodeNumber);
+  bool held = route != m_routeTable.end () && Simulator::Now () < route->second.holdDown;
+  // Closest neighbor, the current next hop wins ties
+  uint32_t cost = m_infinity;
+  std::map<uint32_t, NeighborTableEntry>::iterator nextHop = m_neighborTable.end ();
+  for (std::map<uint32_t, NeighborTableEntry>::iterator iter = m_neighborTable.begin ();
+       iter != m_neighborTable.end (); iter++)
+    {
+      std::map<uint32_t, uint32_t>::iterator metric = iter->second.metrics.find (nodeNumber);
+      if (metric == iter->second.metrics.end () || metric->second + 1 >= m_infinity)
+        {
+          continue;
+        }
+      if (held && metric->second >= route->second.heldCost)
+        {
+          continue;
+        }
+      if (metric->second + 1 < cost
+          || (metric->second + 1 == cost && route != m_routeTable.end ()
+              && iter->first == route->second.nextHopNumber))
+        {
+          cost = metric->second + 1;
+          nextHop = iter;
+        }
+    }
+
+  if (route == m_routeTable.end ())
+    {
+      if (cost >= m_infinity)
+        {
+          return false;
+        }
+      RouteTableDetails routeTableDetails;
+      routeTableDetails.destAddr = ResolveNodeIpAddress (nodeNumber);
+      routeTableDetails.nextHopNumber = nextHop->first;
+      routeTableDetails.cost = m_infinity;
+      routeTableDetails.heldCost = m_infinity;
+      routeTableDetails.changed = false;
+      route = m_routeTable.insert (std::make_pair (nodeNumber, routeTableDetails)).first;
+    }
+  RouteTableDetails &details = route->second;
+  if (!held && cost > details.cost)
+    {
+      // Withdraw the route rather than follow a longer path that may lead
+      // back through us.  No neighbor is closer than the route was, or it
+      // would have been chosen.
+      DEBUG_LOG ("Route to " << nodeNumber << " held down");
+      details.heldCost = details.cost;
+      details.holdDown = Simulator::Now () + m_holdDownTime;
+      Simulator::Cancel (details.holdDownEvent);
+      details.holdDownEvent = Simulator::Schedule (m_holdDownTime, &DVRoutingProtocol::HoldDownExpired,
+                                                   this, nodeNumber);
+      cost = m_infinity;
+    }
+  else if (held && cost < m_infinity)
+    {
+      details.holdDown = Seconds (0);
+      Simulator::Cancel (details.holdDownEvent);
+    }
+
+  if (cost == details.cost && (cost >= m_infinity || nextHop->first == details.nextHopNumber))
+    {
+      return false;
+    }
+  details.cost = cost;
+  if (cost < m_infinity)
+    {
+      details.nextHopNumber = nextHop->first;
+      details.nextHopAddr = ResolveNodeIpAddress (nextHop->first);
+      details.interfaceAddr = nextHop->second.interfaceAddr;
+    }
+  details.changed = true;
+  PennStatsMax (globalLastRouteChange, Simulator::Now ());
+  UpdateFibEntry (nodeNumber);
+  return true;
+}
+
+void
+DVRoutingProtocol::UpdateFibEntry (uint32_t nodeNumber)
+{
+  std::map<uint32_t, std::vector<Ipv4Address> >::const_iterator addresses = m_nodeAddresses->find (nodeNumber);
+  if (addresses == m_nodeAddresses->end ())
+    {
+      return;
+    }
+  std::map<uint32_t, RouteTableDetails>::iterator route = m_routeTable.find (nodeNumber);
+  NextHopList nextHops;
+  if (route != m_routeTable.end () && route->second.cost < m_infinity)
+    {
+      nextHops.push_back (std::make_pair (route->second.nextHopAddr,
+        m_ipv4->GetNetDevice (m_ipv4->GetInterfaceForAddress (route->second.interfaceAddr))));
+    }
+  for (uint32_t i = 0; i < addresses->second.size (); i++)
+    {
+      SetFibEntry (m_fib, addresses->second[i], m_mainAddress, nextHops);
+    }
+}
+
+void
+DVRoutingProtocol::HoldDownExpired (uint32_t nodeNumber)
+{
+  std::map<uint32_t, RouteTableDetails>::iterator route = m_routeTable.find (nodeNumber);
+  if (route == m_routeTable.end ())
+    {
+      return;
+    }
+  if (UpdateRoute (nodeNumber))
+    {
+      ScheduleTriggeredUpdate ();
+    }
+  else if (route->second.cost >= m_infinity && !route->second.changed)
+    {
+      m_routeTable.erase (route);
+    }
+}
+
+void
+DVRoutingProtocol::ScheduleTriggeredUpdate ()
+{
+  if (!m_triggerTimer.IsRunning ())
+    {
+      m_triggerTimer.Schedule (Seconds (m_triggerDelay.GetSeconds () * m_random.GetValue (0.75, 1)));
+    }
+}
+
+void
+DVRoutingProtocol::SendTriggeredUpdate ()
+{
+  for (std::map<Ptr<Socket> , Ipv4InterfaceAddress>::const_iterator i =
+      m_socketAddresses.begin (); i != m_socketAddresses.end (); i++)
+    {
+      SendUpdate (i->first, false);
+    }
+  // Withdrawn routes are forgotten once advertised and out of hold-down
+  for (std::map<uint32_t, RouteTableDetails>::iterator route = m_routeTable.begin ();
+       route != m_routeTable.end ();)
+    {
+      route->second.changed = false;
+      if (route->second.cost >= m_infinity && Simulator::Now () >= route->second.holdDown)
+        {
+          m_routeTable.erase (route++);
+        }
+      else
+        {
+          route++;
+        }
+    }
+}
+
+void
+DVRoutingProtocol::SendPeriodicUpdate ()
+{
+  for (std::map<Ptr<Socket> , Ipv4InterfaceAddress>::const_iterator i =
+      m_socketAddresses.begin (); i != m_socketAddresses.end (); i++)
+    {
+      SendUpdate (i->first, true);
+    }
+  m_updateTimer.Schedule (Seconds (m_updateInterval.GetSeconds () * m_random.GetValue (0.75, 1)));
+}
+
+void
+DVRoutingProtocol::SendUpdate (Ptr<Socket> socket, bool full)
+{
+  Ipv4InterfaceAddress interfaceAddr = m_socketAddresses[socket];
+  std::vector<Ipv4Address> destinations;
+  std::vector<uint8_t> metrics;
+  if (full)
+    {
+      destinations.push_back (m_mainAddress);
+      metrics.push_back (0);
+    }
+  for (std::map<uint32_t, RouteTableDetails>::iterator route = m_routeTable.begin ();
+       route != m_routeTable.end (); route++)
+    {
+      if (!full && !route->second.changed)
+        {
+          continue;
+        }
+      uint32_t cost = route->second.cost;
+      // Split horizon, the next hop must not route back through us
+      if (cost < m_infinity && route->second.interfaceAddr == interfaceAddr.GetLocal ())
+        {
+          if (!m_poisonReverse)
+            {
+              continue;
+            }
+          cost = m_infinity;
+        }
+      destinations.push_back (route->second.destAddr);
+      metrics.push_back (cost);
+    }
+  if (destinations.empty ())
+    {
+      return;
+    }
+  DVMessage dvMessage = DVMessage (DVMessage::UPDATE, GetNextSequenceNumber (), 1, m_mainAddress);
+  dvMessage.SetUpdate (full, destinations, metrics);
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (dvMessage);
+  PennStatsAdd (globalUpdates, 1);
+  PennStatsAdd (globalUpdateBytes, packet->GetSize ());
+  socket->SendTo (packet, 0, InetSocketAddress (interfaceAddr.GetLocal ().GetSubnetDirectedBroadcast (interfaceAddr.GetMask ()), m_dvPort));
+}
+
 void 
 DVRoutingProtocol::NotifyInterfaceUp (uint32_t i)
 {
@@ -25,6 +25,9 @@
 #include "ns3/node.h"
 #include "ns3/socket.h"
 #include "ns3/timer.h"
+#include "ns3/event-id.h"
+#include "ns3/random-variable.h"
+#include "ns3/penn-random.h"
 
 #include "ns3/ping-request.h"
 #include "ns3/penn-routing-protocol.h"
@@ -67,7 +70,7 @@ class DVRoutingProtocol : public PennRoutingProtocol
      * \param nodeAddressMap Mapping.
      */
 
-    virtual void SetNodeAddressMap (std::map<uint32_t, Ipv4Address> nodeAddressMap); 
+    virtual void SetNodeAddressMap (const std::map<uint32_t, Ipv4Address> &nodeAddressMap); 
     /**
      * \brief Save the mapping from IP addresses to Inet topology node numbers.
      *
@@ -76,7 +79,12 @@ class DVRoutingProtocol : public PennRoutingProtocol
      * \param addressNodeMap Mapping.
      */
 
-    virtual void SetAddressNodeMap (std::map<Ipv4Address, uint32_t> addressNodeMap);
+    virtual void SetAddressNodeMap (const std::map<Ipv4Address, uint32_t> &addressNodeMap);
+    /**
+     * \brief Returns the time any node last changed a route, for
+     * convergence measurements.
+     */
+    static Time GetLastRouteChange ();
 
     // Message Handling
     /**
@@ -88,6 +96,8 @@ class DVRoutingProtocol : public PennRoutingProtocol
     void RecvDVMessage (Ptr<Socket> socket);
     void ProcessPingReq (DVMessage DVMessage);
     void ProcessPingRsp (DVMessage DVMessage);
+    void ProcessHello (DVMessage dvMessage, Ptr<Socket> socket, Ipv4Address sourceAddress);
+    void ProcessUpdate (DVMessage dvMessage, Ptr<Socket> socket);
 
     // Periodic Audit
     void AuditPings ();
@@ -208,6 +218,35 @@ class DVRoutingProtocol : public PennRoutingProtocol
     // Status 
     void DumpNeighbors ();
     void DumpRoutingTable ();
+    void DumpStats ();
+
+    // Neighbor discovery and liveness
+    void SendHellos ();
+    void SendHello (Ptr<Socket> socket);
+    void NeighborTimeout (uint32_t nodeNumber);
+
+    // Distance vector
+    /**
+     * \brief Select the route to a node from the metrics its neighbors
+     * advertised, and update the FIB if it changed.
+     *
+     * \param nodeNumber Destination node.
+     * \returns Whether the next hop or the metric changed.
+     */
+    bool UpdateRoute (uint32_t nodeNumber);
+    void UpdateFibEntry (uint32_t nodeNumber);
+    void HoldDownExpired (uint32_t nodeNumber);
+    void ScheduleTriggeredUpdate ();
+    void SendTriggeredUpdate ();
+    void SendPeriodicUpdate ();
+    /**
+     * \brief Send our distance vector to the neighbors on a socket.
+     *
+     * \param socket Socket to send on.
+     * \param full Every route, or only those changed since the last
+     * triggered update.
+     */
+    void SendUpdate (Ptr<Socket> socket, bool full);
 
   protected:
     virtual void DoStart (void);
@@ -229,10 +268,61 @@ class DVRoutingProtocol : public PennRoutingProtocol
     uint8_t m_maxTTL;
     uint16_t m_dvPort;
     uint32_t m_currentSequenceNumber;
-    std::map<uint32_t, Ipv4Address> m_nodeAddressMap;
-    std::map<Ipv4Address, uint32_t> m_addressNodeMap;
+    // Shared by all nodes, see PennShareTable
+    const std::map<uint32_t, Ipv4Address> *m_nodeAddressMap;
+    const std::map<Ipv4Address, uint32_t> *m_addressNodeMap;
+    // All addresses of each node, the FIB has an entry for each
+    const std::map<uint32_t, std::vector<Ipv4Address> > *m_nodeAddresses;
+    uint32_t m_nodeNumber;
+    // Neighbors, discovered and kept alive by hellos
+    struct NeighborTableEntry
+      {
+        Ipv4Address neighborAddr;
+        Ipv4Address interfaceAddr;
+        Time deadline;
+        EventId timeoutEvent;
+        // Metric the neighbor last advertised to each node it reaches
+        std::map<uint32_t, uint32_t> metrics;
+      };
+    std::map<uint32_t, NeighborTableEntry> m_neighborTable;
+    struct RouteTableDetails
+      {
+        Ipv4Address destAddr;
+        uint32_t nextHopNumber;
+        Ipv4Address nextHopAddr;
+        Ipv4Address interfaceAddr;
+        // Infinity while the route is unreachable
+        uint32_t cost;
+        // The route got worse: until holdDown passes, only neighbors that
+        // advertise less than heldCost can be used
+        Time holdDown;
+        uint32_t heldCost;
+        EventId holdDownEvent;
+        // Not advertised by a triggered update yet
+        bool changed;
+      };
+    std::map<uint32_t, RouteTableDetails> m_routeTable;
+    Fib m_fib;
+    // Parameters
+    Time m_helloInterval;
+    uint32_t m_detectMultiplier;
+    Time m_updateInterval;
+    Time m_triggerDelay;
+    Time m_holdDownTime;
+    uint32_t m_infinity;
+    bool m_poisonReverse;
+    // Jitter of the timers, and the first sequence number
+    PennRandom m_random;
     // Timers
     Timer m_auditPingsTimer;
+    Timer m_helloTimer;
+    Timer m_updateTimer;
+    Timer m_triggerTimer;
+    // Statistics, shared by all nodes and reset by DUMP STATS
+    static uint32_t globalUpdates;
+    static uint64_t globalUpdateBytes;
+    static Time globalStatsStart;
+    static Time globalLastRouteChange;
     // Ping tracker
     std::map<uint32_t, Ptr<PingRequest> > m_pingTracker;
 };
@@ -0,0 +1,481 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 University of Pennsylvania
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Measures hierarchical LS routing against flat LS on a large Inet
+ * topology.  The areas come from a fourth column of the node lines, or
+ * from LSAreaPartitioner with --area-size; without either LS runs flat.
+ *
+ * After the initial convergence, links go down and come back one at a
+ * time.  The benchmark reports the LS state per node, the peak memory of
+ * the process, the flooding bytes on the wire, how long the routes took
+ * to settle, and for sampled node pairs whether packets following the
+ * next hops arrive and how much longer their path is than the shortest.
+ *
+ * Liveness hellos are off, as by default, unless --hellos is given,
+ * failures are then detected by neighbor discovery, which keeps runs on
+ * 10k nodes short.
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/simulator-module.h"
+#include "ns3/node-module.h"
+#include "ns3/helper-module.h"
+#include "ns3/error-model.h"
+#include "ns3/ls-routing-helper.h"
+#include "ns3/ls-routing-protocol.h"
+#include "ns3/ls-area-partitioner.h"
+#include <sys/resource.h>
+#include <fstream>
+#include <iostream>
+#include <deque>
+#include <set>
+#include <string.h>
+#include <stdlib.h>
+
+using namespace ns3;
+
+typedef LSAreaPartitioner::LinkList LinkList;
+
+bool
+ReadInetTopology (std::string filename, uint32_t &nodes, LinkList &links, std::vector<uint32_t> &areas)
+{
+  std::ifstream input (filename.c_str ());
+  uint32_t linkCount;
+  if (!(input >> nodes >> linkCount))
+    {
+      return false;
+    }
+  std::string line;
+  std::getline (input, line);
+  bool allAreas = true;
+  for (uint32_t i = 0; i < nodes; i++)
+    {
+      std::getline (input, line);
+      std::istringstream fields (line);
+      uint32_t node, area;
+      double x, y;
+      if (fields >> node >> x >> y >> area)
+        {
+          areas.resize (nodes);
+          areas[node < nodes ? node : 0] = area;
+        }
+      else
+        {
+          allAreas = false;
+        }
+    }
+  if (!allAreas)
+    {
+      areas.clear ();
+    }
+  uint32_t from, to;
+  while (input >> from >> to)
+    {
+      std::getline (input, line);
+      if (from < nodes && to < nodes && from != to)
+        {
+          links.push_back (std::make_pair (from, to));
+        }
+    }
+  return true;
+}
+
+/**
+ * \brief Counts the LS flooding bytes (LSP, LSP_ACK, CSNP and LSP_REQ)
+ * received, area LSPs included.
+ */
+class FloodingCounter : public ErrorModel
+{
+public:
+  static uint64_t globalBytes;
+private:
+  virtual bool DoCorrupt (Ptr<Packet> packet);
+  virtual void DoReset (void);
+};
+
+uint64_t FloodingCounter::globalBytes = 0;
+
+bool
+FloodingCounter::DoCorrupt (Ptr<Packet> packet)
+{
+  // PPP header, IPv4 header without options, UDP header, then the type
+  // of the LS message
+  uint8_t bytes[31];
+  if (packet->GetSize () < 31)
+    {
+      return false;
+    }
+  packet->CopyData (bytes, 31);
+  if (bytes[11] == 17
+      && ((bytes[24] << 8) | bytes[25]) == 5000
+      && bytes[30] >= LSMessage::LSP && bytes[30] <= LSMessage::LSP_REQ)
+    {
+      globalBytes += packet->GetSize ();
+    }
+  return false;
+}
+
+void
+FloodingCounter::DoReset (void)
+{
+}
+
+class Bench
+{
+public:
+  Bench (uint32_t nodes, const LinkList &links, const std::vector<uint32_t> &areas);
+  void Run (uint32_t changes, uint32_t pairs);
+private:
+  void SetLink (uint32_t link, bool up);
+  void PrintState (void);
+  void CheckPaths (uint32_t pairs);
+  NodeContainer m_nodes;
+  LinkList m_links;
+  std::vector<uint32_t> m_areas;
+  std::vector<NetDeviceContainer> m_devices;
+  std::vector<bool> m_up;
+  std::map<uint32_t, Ipv4Address> m_nodeAddressMap;
+  std::map<Ipv4Address, uint32_t> m_addressNodeMap;
+};
+
+Bench::Bench (uint32_t nodes, const LinkList &links, const std::vector<uint32_t> &areas)
+  : m_links (links),
+    m_areas (areas),
+    m_up (links.size (), true)
+{
+  m_nodes.Create (nodes);
+  InternetStackHelper internetStack;
+  LSRoutingHelper lsRouting;
+  internetStack.SetRoutingHelper (lsRouting);
+  internetStack.Install (m_nodes);
+
+  PointToPointHelper p2p;
+  p2p.SetChannelAttribute ("Delay", StringValue ("2ms"));
+  p2p.SetDeviceAttribute ("DataRate", StringValue ("5Mbps"));
+  Ipv4AddressHelper address;
+  address.SetBase ("10.0.0.0", "255.255.255.0");
+  for (uint32_t i = 0; i < links.size (); i++)
+    {
+      NetDeviceContainer devices = p2p.Install (m_nodes.Get (links[i].first), m_nodes.Get (links[i].second));
+      for (uint32_t j = 0; j < devices.GetN (); j++)
+        {
+          devices.Get (j)->SetAttribute ("ReceiveErrorModel", PointerValue (Create<FloodingCounter> ()));
+        }
+      address.Assign (devices);
+      address.NewNetwork ();
+      m_devices.push_back (devices);
+    }
+
+  for (uint32_t i = 0; i < nodes; i++)
+    {
+      Ptr<Ipv4> ipv4 = m_nodes.Get (i)->GetObject<Ipv4> ();
+      Ptr<LSRoutingProtocol> routing = DynamicCast<LSRoutingProtocol> (ipv4->GetRoutingProtocol ());
+      std::ostringstream nodeId;
+      nodeId << i;
+      routing->SetNodeId (nodeId.str ());
+      routing->SetModuleName ("LS");
+      // Interface 0 is the loopback, isolated nodes have no other
+      if (ipv4->GetNInterfaces () < 2)
+        {
+          continue;
+        }
+      routing->SetMainInterface (1);
+      m_nodeAddressMap[i] = ipv4->GetAddress (1, 0).GetLocal ();
+      for (uint32_t j = 1; j < ipv4->GetNInterfaces (); j++)
+        {
+          m_addressNodeMap[ipv4->GetAddress (j, 0).GetLocal ()] = i;
+        }
+    }
+  std::map<uint32_t, uint32_t> nodeAreaMap;
+  for (uint32_t i = 0; i < m_areas.size (); i++)
+    {
+      nodeAreaMap[i] = m_areas[i];
+    }
+  for (uint32_t i = 0; i < nodes; i++)
+    {
+      Ptr<LSRoutingProtocol> routing = DynamicCast<LSRoutingProtocol> (m_nodes.Get (i)->GetObject<Ipv4> ()->GetRoutingProtocol ());
+      routing->SetNodeAddressMap (m_nodeAddressMap);
+      routing->SetAddressNodeMap (m_addressNodeMap);
+      routing->SetNodeAreaMap (nodeAreaMap);
+    }
+}
+
+void
+Bench::SetLink (uint32_t link, bool up)
+{
+  m_up[link] = up;
+  for (uint32_t i = 0; i < m_devices[link].GetN (); i++)
+    {
+      Ptr<NetDevice> device = m_devices[link].Get (i);
+      Ptr<Ipv4> ipv4 = device->GetNode ()->GetObject<Ipv4> ();
+      if (up)
+        {
+          ipv4->SetUp (ipv4->GetInterfaceForDevice (device));
+        }
+      else
+        {
+          ipv4->SetDown (ipv4->GetInterfaceForDevice (device));
+        }
+    }
+}
+
+void
+Bench::PrintState (void)
+{
+  uint64_t lspSum = 0, linkSum = 0, fibSum = 0;
+  uint32_t lspMax = 0, linkMax = 0, fibMax = 0;
+  for (uint32_t i = 0; i < m_nodes.GetN (); i++)
+    {
+      Ptr<LSRoutingProtocol> routing = DynamicCast<LSRoutingProtocol> (m_nodes.Get (i)->GetObject<Ipv4> ()->GetRoutingProtocol ());
+      uint32_t lsps, links, fibEntries;
+      routing->GetStateSize (lsps, links, fibEntries);
+      lspSum += lsps;
+      linkSum += links;
+      fibSum += fibEntries;
+      lspMax = std::max (lspMax, lsps);
+      linkMax = std::max (linkMax, links);
+      fibMax = std::max (fibMax, fibEntries);
+    }
+  uint32_t nodes = m_nodes.GetN ();
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+  std::cout << "  LS state per node: LSPs mean " << lspSum / nodes << " max " << lspMax
+            << ", links mean " << linkSum / nodes << " max " << linkMax
+            << ", FIB entries mean " << fibSum / nodes << " max " << fibMax << std::endl
+            << "  peak memory: " << usage.ru_maxrss / 1024 << " MB" << std::endl;
+}
+
+/*
+ * Packets follow the next hops from node to node.  Stretch is the hop
+ * count of a delivered packet over the shortest hop count.
+ */
+void
+Bench::CheckPaths (uint32_t pairs)
+{
+  uint32_t nodes = m_nodes.GetN ();
+  std::vector<std::set<uint32_t> > adjacency (nodes);
+  for (uint32_t i = 0; i < m_links.size (); i++)
+    {
+      if (m_up[i])
+        {
+          adjacency[m_links[i].first].insert (m_links[i].second);
+          adjacency[m_links[i].second].insert (m_links[i].first);
+        }
+    }
+  UniformVariable random;
+  uint32_t reachable = 0, delivered = 0;
+  double stretchSum = 0, stretchMax = 0;
+  for (uint32_t i = 0; i < pairs; i++)
+    {
+      uint32_t from = random.GetInteger (0, nodes - 1);
+      uint32_t to = random.GetInteger (0, nodes - 1);
+      if (from == to)
+        {
+          continue;
+        }
+      std::vector<uint32_t> distance (nodes, 0xffffffff);
+      std::deque<uint32_t> queue;
+      distance[from] = 0;
+      queue.push_back (from);
+      while (!queue.empty () && distance[to] == 0xffffffff)
+        {
+          uint32_t node = queue.front ();
+          queue.pop_front ();
+          for (std::set<uint32_t>::iterator iter = adjacency[node].begin (); iter != adjacency[node].end (); iter++)
+            {
+              if (distance[*iter] == 0xffffffff)
+                {
+                  distance[*iter] = distance[node] + 1;
+                  queue.push_back (*iter);
+                }
+            }
+        }
+      if (distance[to] == 0xffffffff)
+        {
+          continue;
+        }
+      reachable++;
+      Ipv4Header header;
+      header.SetSource (m_nodeAddressMap[from]);
+      header.SetDestination (m_nodeAddressMap[to]);
+      uint32_t node = from, hops = 0;
+      while (node != to && hops <= nodes)
+        {
+          Socket::SocketErrno error;
+          Ptr<Ipv4RoutingProtocol> routing = m_nodes.Get (node)->GetObject<Ipv4> ()->GetRoutingProtocol ();
+          Ptr<Ipv4Route> route = routing->RouteOutput (0, header, 0, error);
+          if (route == 0)
+            {
+              break;
+            }
+          std::map<Ipv4Address, uint32_t>::iterator iter = m_addressNodeMap.find (route->GetGateway ());
+          if (iter == m_addressNodeMap.end () || adjacency[node].find (iter->second) == adjacency[node].end ())
+            {
+              break;
+            }
+          node = iter->second;
+          hops++;
+        }
+      if (node == to)
+        {
+          delivered++;
+          double stretch = (double) hops / distance[to];
+          stretchSum += stretch;
+          stretchMax = std::max (stretchMax, stretch);
+        }
+    }
+  std::cout << "  sampled pairs delivered: " << delivered << "/" << reachable;
+  if (delivered > 0)
+    {
+      std::cout << ", stretch mean " << stretchSum / delivered << " max " << stretchMax;
+    }
+  std::cout << std::endl;
+}
+
+void
+Bench::Run (uint32_t changes, uint32_t pairs)
+{
+  std::set<uint32_t> areas (m_areas.begin (), m_areas.end ());
+  std::cout << "nodes=" << m_nodes.GetN () << " links=" << m_links.size ()
+            << " areas=" << areas.size () << std::endl;
+  SystemWallClockMs time;
+  time.Start ();
+  // Let neighbor discovery, flooding and the area LSPs converge first
+  Simulator::Stop (Seconds (60));
+  Simulator::Run ();
+  std::cout << "  initial convergence: routes settled at "
+            << LSRoutingProtocol::GetLastRouteChange ().GetMilliSeconds () << " ms, "
+            << FloodingCounter::globalBytes << " flooding bytes, "
+            << time.End () / 1000.0 << "s wall" << std::endl;
+  PrintState ();
+  CheckPaths (pairs);
+  if (changes == 0)
+    {
+      Simulator::Destroy ();
+      return;
+    }
+  uint64_t bytes = FloodingCounter::globalBytes;
+  double convergenceSum = 0, convergenceMax = 0;
+  UniformVariable random;
+  time.Start ();
+  uint32_t link = 0;
+  for (uint32_t i = 0; i < 2 * changes; i++)
+    {
+      if (i % 2 == 0)
+        {
+          link = random.GetInteger (0, m_links.size () - 1);
+        }
+      SetLink (link, i % 2 == 1);
+      Time changeTime = Simulator::Now ();
+      Simulator::Stop (Seconds (20));
+      Simulator::Run ();
+      Time lastChange = LSRoutingProtocol::GetLastRouteChange ();
+      double convergence = (lastChange > changeTime) ? (lastChange - changeTime).GetSeconds () * 1000 : 0;
+      convergenceSum += convergence;
+      convergenceMax = std::max (convergenceMax, convergence);
+    }
+  std::cout << "  topology changes=" << 2 * changes << ": routes settled after mean "
+            << convergenceSum / (2 * changes) << " ms, max " << convergenceMax << " ms, "
+            << (FloodingCounter::globalBytes - bytes) / (2 * changes) << " flooding bytes per change, "
+            << time.End () / 1000.0 << "s wall" << std::endl;
+  CheckPaths (pairs);
+  Simulator::Destroy ();
+}
+
+void
+PrintHelp (void)
+{
+  std::cout << "bench-ls-areas --topo=file [options]" << std::endl;
+  std::cout << "  Options:" << std::endl;
+  std::cout << "      --topo=file: Inet topology, a fourth column of the node lines sets the areas" << std::endl;
+  std::cout << "      --area-size=n: split the topology into areas of about n nodes instead" << std::endl;
+  std::cout << "      --flat: ignore the areas of the topology" << std::endl;
+  std::cout << "      --changes=n: links taken down and brought back (default 5)" << std::endl;
+  std::cout << "      --pairs=n: node pairs whose path is checked (default 1000)" << std::endl;
+  std::cout << "      --hellos: turn the liveness hellos on, every 50ms" << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  std::string topology;
+  uint32_t areaSize = 0;
+  bool flat = false;
+  uint32_t changes = 5;
+  uint32_t pairs = 1000;
+  bool hellos = false;
+  for (int i = 1; i < argc; i++)
+    {
+      if (strncmp ("--topo=", argv[i], strlen ("--topo=")) == 0)
+        {
+          topology = argv[i] + strlen ("--topo=");
+        }
+      else if (strncmp ("--area-size=", argv[i], strlen ("--area-size=")) == 0)
+        {
+          areaSize = atoi (argv[i] + strlen ("--area-size="));
+        }
+      else if (strcmp ("--flat", argv[i]) == 0)
+        {
+          flat = true;
+        }
+      else if (strncmp ("--changes=", argv[i], strlen ("--changes=")) == 0)
+        {
+          changes = atoi (argv[i] + strlen ("--changes="));
+        }
+      else if (strncmp ("--pairs=", argv[i], strlen ("--pairs=")) == 0)
+        {
+          pairs = atoi (argv[i] + strlen ("--pairs="));
+        }
+      else if (strcmp ("--hellos", argv[i]) == 0)
+        {
+          hellos = true;
+        }
+      else
+        {
+          PrintHelp ();
+          return 0;
+        }
+    }
+
+  uint32_t nodes;
+  LinkList links;
+  std::vector<uint32_t> areas;
+  if (topology.empty () || !ReadInetTopology (topology, nodes, links, areas))
+    {
+      PrintHelp ();
+      return 1;
+    }
+  if (areaSize > 0)
+    {
+      areas = LSAreaPartitioner::Partition (nodes, links, areaSize);
+    }
+  if (flat)
+    {
+      areas.clear ();
+    }
+  if (hellos)
+    {
+      Config::SetDefault ("LSRoutingProtocol::HelloInterval", TimeValue (MilliSeconds (50)));
+    }
+  Bench bench (nodes, links, areas);
+  // LSRoutingProtocol reseeds the generator from the clock, the link
+  // changes and sampled pairs must not depend on it
+  SeedManager::SetSeed (1);
+  bench.Run (changes, pairs);
+  return 0;
+}
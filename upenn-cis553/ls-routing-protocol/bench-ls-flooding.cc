@@ -0,0 +1,389 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 University of Pennsylvania
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Measures LS flooding.  LSRoutingProtocol runs on an Inet topology whose
+ * links drop a fraction of the flooding packets (LSP, LSP_ACK, CSNP and
+ * LSP_REQ) they carry, neighbor discovery is left alone.  After the
+ * initial convergence, links go down and come back one at a time.
+ *
+ * Before every change the benchmark checks every route against the true
+ * topology: the next hop must be one hop closer to the destination.  It
+ * reports the share of correct routes and the flooding bytes on the wire
+ * per topology change, to compare delta LSPs with reliable flooding
+ * against full, unacknowledged LSPs (--full-lsps, --unreliable).
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/simulator-module.h"
+#include "ns3/node-module.h"
+#include "ns3/helper-module.h"
+#include "ns3/error-model.h"
+#include "ns3/ls-routing-helper.h"
+#include "ns3/ls-routing-protocol.h"
+#include <fstream>
+#include <iostream>
+#include <deque>
+#include <string.h>
+#include <stdlib.h>
+
+using namespace ns3;
+
+typedef std::vector<std::pair<uint32_t, uint32_t> > LinkList;
+
+bool
+ReadInetTopology (std::string filename, uint32_t &nodes, LinkList &links)
+{
+  std::ifstream input (filename.c_str ());
+  uint32_t linkCount;
+  if (!(input >> nodes >> linkCount))
+    {
+      return false;
+    }
+  std::string line;
+  std::getline (input, line);
+  for (uint32_t i = 0; i < nodes; i++)
+    {
+      std::getline (input, line);
+    }
+  uint32_t from, to;
+  while (input >> from >> to)
+    {
+      std::getline (input, line);
+      if (from < nodes && to < nodes && from != to)
+        {
+          links.push_back (std::make_pair (from, to));
+        }
+    }
+  return true;
+}
+
+/**
+ * \brief Drops LS flooding packets with a fixed probability and counts
+ * the flooding bytes received.
+ */
+class FloodingLossModel : public ErrorModel
+{
+public:
+  static uint64_t globalBytes;
+  static uint32_t globalDrops;
+
+  FloodingLossModel (double loss);
+private:
+  virtual bool DoCorrupt (Ptr<Packet> packet);
+  virtual void DoReset (void);
+  UniformVariable m_random;
+  double m_loss;
+};
+
+uint64_t FloodingLossModel::globalBytes = 0;
+uint32_t FloodingLossModel::globalDrops = 0;
+
+FloodingLossModel::FloodingLossModel (double loss)
+  : m_loss (loss)
+{
+}
+
+bool
+FloodingLossModel::DoCorrupt (Ptr<Packet> packet)
+{
+  // PPP header, IPv4 header without options, UDP header, then the type
+  // of the LS message
+  uint8_t bytes[31];
+  if (packet->GetSize () < 31)
+    {
+      return false;
+    }
+  packet->CopyData (bytes, 31);
+  if (bytes[11] != 17
+      || ((bytes[24] << 8) | bytes[25]) != 5000
+      || bytes[30] < LSMessage::LSP || bytes[30] > LSMessage::LSP_REQ)
+    {
+      return false;
+    }
+  globalBytes += packet->GetSize ();
+  if (m_random.GetValue () < m_loss)
+    {
+      globalDrops++;
+      return true;
+    }
+  return false;
+}
+
+void
+FloodingLossModel::DoReset (void)
+{
+}
+
+class Bench
+{
+public:
+  Bench (uint32_t nodes, const LinkList &links, double loss);
+  void Run (uint32_t changes);
+private:
+  void SetLink (uint32_t link, bool up);
+  void CheckRoutes (void);
+  NodeContainer m_nodes;
+  LinkList m_links;
+  std::vector<NetDeviceContainer> m_devices;
+  std::vector<bool> m_up;
+  std::map<uint32_t, Ipv4Address> m_nodeAddressMap;
+  std::map<Ipv4Address, uint32_t> m_addressNodeMap;
+  uint32_t m_checks;
+  double m_correctSum;
+  double m_correctMin;
+};
+
+Bench::Bench (uint32_t nodes, const LinkList &links, double loss)
+  : m_links (links),
+    m_up (links.size (), true),
+    m_checks (0),
+    m_correctSum (0),
+    m_correctMin (1)
+{
+  m_nodes.Create (nodes);
+  InternetStackHelper internetStack;
+  LSRoutingHelper lsRouting;
+  internetStack.SetRoutingHelper (lsRouting);
+  internetStack.Install (m_nodes);
+
+  PointToPointHelper p2p;
+  p2p.SetChannelAttribute ("Delay", StringValue ("2ms"));
+  p2p.SetDeviceAttribute ("DataRate", StringValue ("5Mbps"));
+  Ipv4AddressHelper address;
+  address.SetBase ("10.0.0.0", "255.255.255.0");
+  for (uint32_t i = 0; i < links.size (); i++)
+    {
+      NetDeviceContainer devices = p2p.Install (m_nodes.Get (links[i].first), m_nodes.Get (links[i].second));
+      for (uint32_t j = 0; j < devices.GetN (); j++)
+        {
+          devices.Get (j)->SetAttribute ("ReceiveErrorModel", PointerValue (Create<FloodingLossModel> (loss)));
+        }
+      address.Assign (devices);
+      address.NewNetwork ();
+      m_devices.push_back (devices);
+    }
+
+  for (uint32_t i = 0; i < nodes; i++)
+    {
+      Ptr<Ipv4> ipv4 = m_nodes.Get (i)->GetObject<Ipv4> ();
+      Ptr<LSRoutingProtocol> routing = DynamicCast<LSRoutingProtocol> (ipv4->GetRoutingProtocol ());
+      std::ostringstream nodeId;
+      nodeId << i;
+      routing->SetNodeId (nodeId.str ());
+      routing->SetModuleName ("LS");
+      // Interface 0 is the loopback
+      routing->SetMainInterface (1);
+      m_nodeAddressMap[i] = ipv4->GetAddress (1, 0).GetLocal ();
+      for (uint32_t j = 1; j < ipv4->GetNInterfaces (); j++)
+        {
+          m_addressNodeMap[ipv4->GetAddress (j, 0).GetLocal ()] = i;
+        }
+    }
+  for (uint32_t i = 0; i < nodes; i++)
+    {
+      Ptr<LSRoutingProtocol> routing = DynamicCast<LSRoutingProtocol> (m_nodes.Get (i)->GetObject<Ipv4> ()->GetRoutingProtocol ());
+      routing->SetNodeAddressMap (m_nodeAddressMap);
+      routing->SetAddressNodeMap (m_addressNodeMap);
+    }
+}
+
+void
+Bench::SetLink (uint32_t link, bool up)
+{
+  m_up[link] = up;
+  for (uint32_t i = 0; i < m_devices[link].GetN (); i++)
+    {
+      Ptr<NetDevice> device = m_devices[link].Get (i);
+      Ptr<Ipv4> ipv4 = device->GetNode ()->GetObject<Ipv4> ();
+      if (up)
+        {
+          ipv4->SetUp (ipv4->GetInterfaceForDevice (device));
+        }
+      else
+        {
+          ipv4->SetDown (ipv4->GetInterfaceForDevice (device));
+        }
+    }
+}
+
+void
+Bench::CheckRoutes (void)
+{
+  uint32_t nodes = m_nodes.GetN ();
+  std::vector<std::vector<uint32_t> > adjacency (nodes);
+  for (uint32_t i = 0; i < m_links.size (); i++)
+    {
+      if (m_up[i])
+        {
+          adjacency[m_links[i].first].push_back (m_links[i].second);
+          adjacency[m_links[i].second].push_back (m_links[i].first);
+        }
+    }
+  uint32_t correct = 0, total = 0;
+  for (uint32_t to = 0; to < nodes; to++)
+    {
+      // Hop distances towards to
+      std::vector<uint32_t> distance (nodes, 0xffffffff);
+      std::deque<uint32_t> queue;
+      distance[to] = 0;
+      queue.push_back (to);
+      while (!queue.empty ())
+        {
+          uint32_t node = queue.front ();
+          queue.pop_front ();
+          for (uint32_t i = 0; i < adjacency[node].size (); i++)
+            {
+              if (distance[adjacency[node][i]] == 0xffffffff)
+                {
+                  distance[adjacency[node][i]] = distance[node] + 1;
+                  queue.push_back (adjacency[node][i]);
+                }
+            }
+        }
+      Ipv4Header header;
+      header.SetDestination (m_nodeAddressMap[to]);
+      for (uint32_t from = 0; from < nodes; from++)
+        {
+          if (from == to)
+            {
+              continue;
+            }
+          Socket::SocketErrno error;
+          Ptr<Ipv4RoutingProtocol> routing = m_nodes.Get (from)->GetObject<Ipv4> ()->GetRoutingProtocol ();
+          Ptr<Ipv4Route> route = routing->RouteOutput (0, header, 0, error);
+          uint32_t nextHopDistance = 0xffffffff;
+          if (route != 0)
+            {
+              std::map<Ipv4Address, uint32_t>::iterator iter = m_addressNodeMap.find (route->GetGateway ());
+              // No gateway means the destination is on the link
+              nextHopDistance = (iter != m_addressNodeMap.end ()) ? distance[iter->second] : 0;
+            }
+          total++;
+          if (distance[from] == 0xffffffff ? route == 0 : nextHopDistance + 1 == distance[from])
+            {
+              correct++;
+            }
+        }
+    }
+  double share = (double) correct / total;
+  m_checks++;
+  m_correctSum += share;
+  m_correctMin = std::min (m_correctMin, share);
+}
+
+void
+Bench::Run (uint32_t changes)
+{
+  // Let neighbor discovery and flooding converge first
+  Simulator::Stop (Seconds (30));
+  Simulator::Run ();
+  CheckRoutes ();
+  double initial = m_correctSum;
+  uint64_t bytes = FloodingLossModel::globalBytes;
+  uint32_t drops = FloodingLossModel::globalDrops;
+  UniformVariable random;
+  SystemWallClockMs time;
+  time.Start ();
+  // Every change gets 10s to converge before the routes are checked
+  for (uint32_t i = 0; i < changes; i++)
+    {
+      uint32_t link = random.GetInteger (0, m_links.size () - 1);
+      SetLink (link, false);
+      Simulator::Stop (Seconds (10));
+      Simulator::Run ();
+      CheckRoutes ();
+      SetLink (link, true);
+      Simulator::Stop (Seconds (10));
+      Simulator::Run ();
+      CheckRoutes ();
+    }
+  double seconds = time.End () / 1000.0;
+  std::cout << "nodes=" << m_nodes.GetN () << " links=" << m_links.size ()
+            << " topology changes=" << 2 * changes << " time=" << seconds << "s" << std::endl
+            << "  routes correct after initial convergence: " << initial * 100 << "%" << std::endl;
+  if (changes > 0)
+    {
+      std::cout << "  routes correct after each change: mean "
+                << (m_correctSum - initial) / (m_checks - 1) * 100 << "%, worst " << m_correctMin * 100 << "%" << std::endl
+                << "  flooding bytes per change: " << (FloodingLossModel::globalBytes - bytes) / (2 * changes)
+                << ", " << FloodingLossModel::globalDrops - drops << " flooding packets dropped" << std::endl;
+    }
+  Simulator::Destroy ();
+}
+
+void
+PrintHelp (void)
+{
+  std::cout << "bench-ls-flooding --topo=file [options]" << std::endl;
+  std::cout << "  Options:" << std::endl;
+  std::cout << "      --topo=file: Inet topology" << std::endl;
+  std::cout << "      --loss=p: probability that a link drops a flooding packet (default 0)" << std::endl;
+  std::cout << "      --changes=n: links taken down and brought back (default 10)" << std::endl;
+  std::cout << "      --full-lsps: turn LSRoutingProtocol::DeltaLsp off" << std::endl;
+  std::cout << "      --unreliable: turn LSRoutingProtocol::ReliableFlooding off" << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  std::string topology;
+  double loss = 0;
+  uint32_t changes = 10;
+  for (int i = 1; i < argc; i++)
+    {
+      if (strncmp ("--topo=", argv[i], strlen ("--topo=")) == 0)
+        {
+          topology = argv[i] + strlen ("--topo=");
+        }
+      else if (strncmp ("--loss=", argv[i], strlen ("--loss=")) == 0)
+        {
+          loss = atof (argv[i] + strlen ("--loss="));
+        }
+      else if (strncmp ("--changes=", argv[i], strlen ("--changes=")) == 0)
+        {
+          changes = atoi (argv[i] + strlen ("--changes="));
+        }
+      else if (strcmp ("--full-lsps", argv[i]) == 0)
+        {
+          Config::SetDefault ("LSRoutingProtocol::DeltaLsp", BooleanValue (false));
+        }
+      else if (strcmp ("--unreliable", argv[i]) == 0)
+        {
+          Config::SetDefault ("LSRoutingProtocol::ReliableFlooding", BooleanValue (false));
+        }
+      else
+        {
+          PrintHelp ();
+          return 0;
+        }
+    }
+
+  uint32_t nodes;
+  LinkList links;
+  if (topology.empty () || !ReadInetTopology (topology, nodes, links))
+    {
+      PrintHelp ();
+      return 1;
+    }
+  Bench bench (nodes, links, loss);
+  // LSRoutingProtocol reseeds the generator from the clock, the losses and
+  // link changes must not depend on it
+  SeedManager::SetSeed (1);
+  bench.Run (changes);
+  return 0;
+}
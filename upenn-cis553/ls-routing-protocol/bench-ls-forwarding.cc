@@ -0,0 +1,364 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 University of Pennsylvania
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Measures the LS data plane.  By default a chain of nodes runs
+ * LSRoutingProtocol until routes converge, then the first node streams
+ * UDP packets to the last one over fast links.  Every delivered packet
+ * took one RouteOutput and one RouteInput per hop, and the benchmark
+ * reports route lookups per second of simulator wall time.
+ *
+ * With --topo, the nodes and 5Mbps links of an Inet topology are used
+ * instead and many UDP flows run between random node pairs at once.  The
+ * benchmark then reports the delivered load and how evenly it spread
+ * over the links, to compare single path and equal cost multipath
+ * forwarding (--single-path).
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/simulator-module.h"
+#include "ns3/node-module.h"
+#include "ns3/helper-module.h"
+#include "ns3/point-to-point-net-device.h"
+#include "ns3/ls-routing-helper.h"
+#include "ns3/ls-routing-protocol.h"
+#include <fstream>
+#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+
+using namespace ns3;
+
+typedef std::vector<std::pair<uint32_t, uint32_t> > LinkList;
+
+bool
+ReadInetTopology (std::string filename, uint32_t &nodes, LinkList &links)
+{
+  std::ifstream input (filename.c_str ());
+  uint32_t linkCount;
+  if (!(input >> nodes >> linkCount))
+    {
+      return false;
+    }
+  std::string line;
+  std::getline (input, line);
+  for (uint32_t i = 0; i < nodes; i++)
+    {
+      std::getline (input, line);
+    }
+  uint32_t from, to;
+  while (input >> from >> to)
+    {
+      std::getline (input, line);
+      if (from < nodes && to < nodes && from != to)
+        {
+          links.push_back (std::make_pair (from, to));
+        }
+    }
+  return true;
+}
+
+class Bench
+{
+public:
+  Bench (uint32_t nodes, const LinkList &links, std::string dataRate);
+  void AddFlow (uint32_t from, uint32_t to, Time interval, uint32_t packets, uint32_t size);
+  void Run (void);
+private:
+  struct Flow
+  {
+    Ptr<Socket> socket;
+    Time interval;
+    uint32_t packets;
+    uint32_t size;
+    uint32_t sent;
+  };
+  void Send (uint32_t flow);
+  void Receive (Ptr<Socket> socket);
+  NodeContainer m_nodes;
+  std::map<uint32_t, Ipv4Address> m_nodeAddressMap;
+  std::map<uint32_t, Ptr<Socket> > m_sinks;
+  std::vector<Flow> m_flows;
+  Time m_duration;
+  uint32_t m_sent;
+  uint32_t m_received;
+  uint64_t m_receivedBytes;
+};
+
+Bench::Bench (uint32_t nodes, const LinkList &links, std::string dataRate)
+  : m_sent (0),
+    m_received (0),
+    m_receivedBytes (0)
+{
+  m_nodes.Create (nodes);
+  InternetStackHelper internetStack;
+  LSRoutingHelper lsRouting;
+  internetStack.SetRoutingHelper (lsRouting);
+  internetStack.Install (m_nodes);
+
+  PointToPointHelper p2p;
+  p2p.SetChannelAttribute ("Delay", StringValue ("2ms"));
+  p2p.SetDeviceAttribute ("DataRate", StringValue (dataRate));
+  Ipv4AddressHelper address;
+  address.SetBase ("10.0.0.0", "255.255.255.0");
+  for (uint32_t i = 0; i < links.size (); i++)
+    {
+      address.Assign (p2p.Install (m_nodes.Get (links[i].first), m_nodes.Get (links[i].second)));
+      address.NewNetwork ();
+    }
+
+  std::map<Ipv4Address, uint32_t> addressNodeMap;
+  for (uint32_t i = 0; i < nodes; i++)
+    {
+      Ptr<Ipv4> ipv4 = m_nodes.Get (i)->GetObject<Ipv4> ();
+      Ptr<LSRoutingProtocol> routing = DynamicCast<LSRoutingProtocol> (ipv4->GetRoutingProtocol ());
+      std::ostringstream nodeId;
+      nodeId << i;
+      routing->SetNodeId (nodeId.str ());
+      routing->SetModuleName ("LS");
+      // Interface 0 is the loopback
+      routing->SetMainInterface (1);
+      m_nodeAddressMap[i] = ipv4->GetAddress (1, 0).GetLocal ();
+      for (uint32_t j = 1; j < ipv4->GetNInterfaces (); j++)
+        {
+          addressNodeMap[ipv4->GetAddress (j, 0).GetLocal ()] = i;
+        }
+    }
+  for (uint32_t i = 0; i < nodes; i++)
+    {
+      Ptr<LSRoutingProtocol> routing = DynamicCast<LSRoutingProtocol> (m_nodes.Get (i)->GetObject<Ipv4> ()->GetRoutingProtocol ());
+      routing->SetNodeAddressMap (m_nodeAddressMap);
+      routing->SetAddressNodeMap (addressNodeMap);
+    }
+}
+
+void
+Bench::AddFlow (uint32_t from, uint32_t to, Time interval, uint32_t packets, uint32_t size)
+{
+  if (m_sinks.find (to) == m_sinks.end ())
+    {
+      Ptr<Socket> sink = Socket::CreateSocket (m_nodes.Get (to), UdpSocketFactory::GetTypeId ());
+      sink->Bind (InetSocketAddress (Ipv4Address::GetAny (), 9));
+      sink->SetRecvCallback (MakeCallback (&Bench::Receive, this));
+      m_sinks[to] = sink;
+    }
+  // A socket per flow, so that every flow has its own source port
+  Flow flow;
+  flow.socket = Socket::CreateSocket (m_nodes.Get (from), UdpSocketFactory::GetTypeId ());
+  flow.socket->Connect (InetSocketAddress (m_nodeAddressMap[to], 9));
+  flow.interval = interval;
+  flow.packets = packets;
+  flow.size = size;
+  flow.sent = 0;
+  m_flows.push_back (flow);
+  if (interval.GetSeconds () * packets > m_duration.GetSeconds ())
+    {
+      m_duration = Seconds (interval.GetSeconds () * packets);
+    }
+}
+
+void
+Bench::Send (uint32_t index)
+{
+  Flow &flow = m_flows[index];
+  if (flow.sent == flow.packets)
+    {
+      return;
+    }
+  flow.socket->Send (Create<Packet> (flow.size));
+  flow.sent++;
+  m_sent++;
+  Simulator::Schedule (flow.interval, &Bench::Send, this, index);
+}
+
+void
+Bench::Receive (Ptr<Socket> socket)
+{
+  Ptr<Packet> packet;
+  while ((packet = socket->Recv ()))
+    {
+      m_received++;
+      m_receivedBytes += packet->GetSize ();
+    }
+}
+
+void
+Bench::Run (void)
+{
+  // Let neighbor discovery and flooding converge first
+  Simulator::Stop (Seconds (30));
+  Simulator::Run ();
+  std::vector<std::pair<uint32_t, uint32_t> > before;
+  for (uint32_t i = 0; i < m_nodes.GetN (); i++)
+    {
+      for (uint32_t j = 0; j < m_nodes.Get (i)->GetNDevices (); j++)
+        {
+          Ptr<PointToPointNetDevice> device = DynamicCast<PointToPointNetDevice> (m_nodes.Get (i)->GetDevice (j));
+          if (device != 0)
+            {
+              before.push_back (std::make_pair (device->GetQueue ()->GetTotalReceivedBytes (),
+                                                device->GetQueue ()->GetTotalDroppedPackets ()));
+            }
+        }
+    }
+  for (uint32_t i = 0; i < m_flows.size (); i++)
+    {
+      Simulator::Schedule (Seconds (0), &Bench::Send, this, i);
+    }
+  // Leave time for the last packets to drain
+  Simulator::Stop (m_duration + Seconds (1));
+  SystemWallClockMs time;
+  time.Start ();
+  Simulator::Run ();
+  double seconds = time.End () / 1000.0;
+  std::cout << "nodes=" << m_nodes.GetN () << " flows=" << m_flows.size () << " sent=" << m_sent
+            << " delivered=" << m_received << " time=" << seconds << "s" << std::endl;
+  if (m_flows.size () == 1)
+    {
+      // The chain flow crosses every node
+      uint32_t hops = m_nodes.GetN () - 1;
+      std::cout << "  " << m_received / seconds << " packets/s end to end, "
+                << m_received * hops / seconds << " route lookups/s" << std::endl;
+    }
+  else
+    {
+      // Link load is counted in the direction of transmission, so every
+      // device stands for one direction of one link
+      uint64_t total = 0, busiest = 0;
+      uint32_t used = 0, drops = 0, k = 0;
+      for (uint32_t i = 0; i < m_nodes.GetN (); i++)
+        {
+          for (uint32_t j = 0; j < m_nodes.Get (i)->GetNDevices (); j++)
+            {
+              Ptr<PointToPointNetDevice> device = DynamicCast<PointToPointNetDevice> (m_nodes.Get (i)->GetDevice (j));
+              if (device == 0)
+                {
+                  continue;
+                }
+              uint64_t bytes = device->GetQueue ()->GetTotalReceivedBytes () - before[k].first;
+              drops += device->GetQueue ()->GetTotalDroppedPackets () - before[k].second;
+              total += bytes;
+              busiest = std::max (busiest, bytes);
+              // Ignore the trickle of hellos on links that carry no data
+              used += (bytes > 1000 * m_duration.GetSeconds ()) ? 1 : 0;
+              k++;
+            }
+        }
+      double simSeconds = m_duration.GetSeconds ();
+      std::cout << "  delivered " << m_receivedBytes * 8 / simSeconds / 1000000 << " Mbps, "
+                << drops << " queue drops" << std::endl
+                << "  busiest link direction " << busiest * 8 / simSeconds / 1000000 << " Mbps, "
+                << used << " of " << k << " link directions carry data, mean "
+                << (used == 0 ? 0 : total * 8 / simSeconds / 1000000 / used) << " Mbps" << std::endl;
+    }
+  Simulator::Destroy ();
+}
+
+void
+PrintHelp (void)
+{
+  std::cout << "bench-ls-forwarding [options]" << std::endl;
+  std::cout << "  Options:" << std::endl;
+  std::cout << "      --nodes=n: chain length (default 10)" << std::endl;
+  std::cout << "      --packets=n: packets sent on the chain (default 100000)" << std::endl;
+  std::cout << "      --topo=file: run random flows over an Inet topology instead of the chain" << std::endl;
+  std::cout << "      --flows=n: number of flows on the topology (default 40)" << std::endl;
+  std::cout << "      --rate=n: packets per second of each flow (default 100)" << std::endl;
+  std::cout << "      --single-path: turn LSRoutingProtocol::Ecmp off" << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t nodes = 10;
+  uint32_t packets = 100000;
+  std::string topology;
+  uint32_t flows = 40;
+  uint32_t rate = 100;
+  for (int i = 1; i < argc; i++)
+    {
+      if (strncmp ("--nodes=", argv[i], strlen ("--nodes=")) == 0)
+        {
+          nodes = atoi (argv[i] + strlen ("--nodes="));
+        }
+      else if (strncmp ("--packets=", argv[i], strlen ("--packets=")) == 0)
+        {
+          packets = atoi (argv[i] + strlen ("--packets="));
+        }
+      else if (strncmp ("--topo=", argv[i], strlen ("--topo=")) == 0)
+        {
+          topology = argv[i] + strlen ("--topo=");
+        }
+      else if (strncmp ("--flows=", argv[i], strlen ("--flows=")) == 0)
+        {
+          flows = atoi (argv[i] + strlen ("--flows="));
+        }
+      else if (strncmp ("--rate=", argv[i], strlen ("--rate=")) == 0)
+        {
+          rate = atoi (argv[i] + strlen ("--rate="));
+        }
+      else if (strcmp ("--single-path", argv[i]) == 0)
+        {
+          Config::SetDefault ("LSRoutingProtocol::Ecmp", BooleanValue (false));
+        }
+      else
+        {
+          PrintHelp ();
+          return 0;
+        }
+    }
+
+  if (topology.empty ())
+    {
+      LinkList links;
+      for (uint32_t i = 0; i + 1 < nodes; i++)
+        {
+          links.push_back (std::make_pair (i, i + 1));
+        }
+      Bench bench (nodes, links, "10Gbps");
+      bench.AddFlow (0, nodes - 1, MicroSeconds (10), packets, 64);
+      bench.Run ();
+      return 0;
+    }
+
+  LinkList links;
+  if (!ReadInetTopology (topology, nodes, links))
+    {
+      std::cerr << "Cannot read topology " << topology << std::endl;
+      return 1;
+    }
+  // Draw the flows before LSRoutingProtocol reseeds the generator
+  SeedManager::SetSeed (1);
+  UniformVariable random;
+  std::vector<std::pair<uint32_t, uint32_t> > pairs;
+  while (pairs.size () < flows)
+    {
+      uint32_t from = random.GetInteger (0, nodes - 1);
+      uint32_t to = random.GetInteger (0, nodes - 1);
+      if (from != to)
+        {
+          pairs.push_back (std::make_pair (from, to));
+        }
+    }
+  Bench bench (nodes, links, "5Mbps");
+  for (uint32_t i = 0; i < pairs.size (); i++)
+    {
+      bench.AddFlow (pairs[i].first, pairs[i].second, Seconds (1.0 / rate), 10 * rate, 512);
+    }
+  bench.Run ();
+  return 0;
+}
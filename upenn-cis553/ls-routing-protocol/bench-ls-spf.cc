@@ -0,0 +1,341 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 University of Pennsylvania
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Measures the SPF CPU time one router spends per flood when a link goes
+ * down or comes back up.  Each flood carries the LSPs of both ends of the
+ * link and, as in LSRoutingProtocol::UpdateMap, SPF runs once per LSP.
+ * Full and incremental runs are timed on the same sequence of events and
+ * their route tables, including all equal cost next hops, are compared
+ * after every LSP.
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/ls-spf-engine.h"
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <sstream>
+#include <string.h>
+#include <stdlib.h>
+
+using namespace ns3;
+
+typedef std::vector<LSSpfEngine::Adjacency> Graph;
+
+bool
+ReadInetTopology (std::string filename, Graph &graph)
+{
+  std::ifstream input (filename.c_str ());
+  uint32_t nodes, links;
+  if (!(input >> nodes >> links))
+    {
+      return false;
+    }
+  graph.assign (nodes, LSSpfEngine::Adjacency ());
+  std::string line;
+  std::getline (input, line);
+  for (uint32_t i = 0; i < nodes; i++)
+    {
+      std::getline (input, line);
+    }
+  uint32_t from, to;
+  while (input >> from >> to)
+    {
+      std::getline (input, line);
+      if (from < nodes && to < nodes && from != to)
+        {
+          graph[from][to] = 1;
+          graph[to][from] = 1;
+        }
+    }
+  return true;
+}
+
+/*
+ * Inet-like graph: a random spanning tree grown by preferential
+ * attachment, plus extra links up to an average degree of about four.
+ */
+void
+GenerateTopology (uint32_t nodes, Graph &graph)
+{
+  UniformVariable random;
+  graph.assign (nodes, LSSpfEngine::Adjacency ());
+  std::vector<uint32_t> ends;
+  for (uint32_t node = 1; node < nodes; node++)
+    {
+      uint32_t peer = ends.empty () ? 0 : ends[random.GetInteger (0, ends.size () - 1)];
+      graph[node][peer] = 1;
+      graph[peer][node] = 1;
+      ends.push_back (node);
+      ends.push_back (peer);
+    }
+  for (uint32_t extra = 0; extra < nodes; extra++)
+    {
+      uint32_t from = random.GetInteger (0, nodes - 1);
+      uint32_t to = ends[random.GetInteger (0, ends.size () - 1)];
+      if (from != to)
+        {
+          graph[from][to] = 1;
+          graph[to][from] = 1;
+        }
+    }
+}
+
+class Bench
+{
+public:
+  Bench (const Graph &graph, uint32_t root, bool multipath);
+  void Flood (uint32_t from, uint32_t to, bool up);
+  double GetTime (bool incremental) const;
+  uint32_t GetMismatches () const;
+  uint32_t GetFallbacks () const;
+  double GetNextHopsPerRoute () const;
+private:
+  void Run (uint32_t node, bool rootChanged);
+  Graph m_graph;
+  uint32_t m_root;
+  LSSpfEngine m_engine[2];
+  double m_time[2];
+  uint32_t m_mismatches;
+};
+
+Bench::Bench (const Graph &graph, uint32_t root, bool multipath)
+  : m_graph (graph),
+    m_root (root),
+    m_mismatches (0)
+{
+  std::vector<uint32_t> changed;
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      m_engine[i].SetIncremental (i == 1);
+      m_engine[i].SetMultipath (multipath);
+      m_engine[i].SetRootAdjacency (m_graph[m_root]);
+      for (uint32_t node = 0; node < m_graph.size (); node++)
+        {
+          m_engine[i].SetLsp (node, m_graph[node]);
+        }
+      m_engine[i].Compute (changed);
+      m_time[i] = 0;
+    }
+}
+
+void
+Bench::Run (uint32_t node, bool rootChanged)
+{
+  std::vector<uint32_t> changed;
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      std::clock_t start = std::clock ();
+      if (rootChanged)
+        {
+          m_engine[i].SetRootAdjacency (m_graph[m_root]);
+        }
+      m_engine[i].SetLsp (node, m_graph[node]);
+      m_engine[i].Compute (changed);
+      m_time[i] += (double) (std::clock () - start) / CLOCKS_PER_SEC;
+    }
+  for (uint32_t node = 0; node < m_graph.size (); node++)
+    {
+      uint32_t cost[2];
+      std::vector<uint32_t> nextHops[2];
+      bool found[2];
+      for (uint32_t i = 0; i < 2; i++)
+        {
+          found[i] = m_engine[i].GetRoute (node, cost[i], nextHops[i]);
+        }
+      if (found[0] != found[1] || (found[0] && (cost[0] != cost[1] || nextHops[0] != nextHops[1])))
+        {
+          m_mismatches++;
+        }
+    }
+}
+
+void
+Bench::Flood (uint32_t from, uint32_t to, bool up)
+{
+  if (up)
+    {
+      m_graph[from][to] = 1;
+      m_graph[to][from] = 1;
+    }
+  else
+    {
+      m_graph[from].erase (to);
+      m_graph[to].erase (from);
+    }
+  Run (from, from == m_root);
+  Run (to, to == m_root);
+}
+
+double
+Bench::GetTime (bool incremental) const
+{
+  return m_time[incremental ? 1 : 0];
+}
+
+uint32_t
+Bench::GetMismatches () const
+{
+  return m_mismatches;
+}
+
+uint32_t
+Bench::GetFallbacks () const
+{
+  // One full run is the initial computation
+  return m_engine[1].GetFullRuns () - 1;
+}
+
+double
+Bench::GetNextHopsPerRoute () const
+{
+  uint32_t routes = 0, nextHopCount = 0;
+  for (uint32_t node = 0; node < m_graph.size (); node++)
+    {
+      uint32_t cost;
+      std::vector<uint32_t> nextHops;
+      if (m_engine[0].GetRoute (node, cost, nextHops))
+        {
+          routes++;
+          nextHopCount += nextHops.size ();
+        }
+    }
+  return routes == 0 ? 0 : (double) nextHopCount / routes;
+}
+
+void
+RunBench (std::string name, const Graph &graph, uint32_t roots, uint32_t events, bool multipath)
+{
+  UniformVariable random;
+  uint32_t links = 0;
+  for (uint32_t node = 0; node < graph.size (); node++)
+    {
+      links += graph[node].size ();
+    }
+  double full = 0, incremental = 0, width = 0;
+  uint32_t floods = 0, mismatches = 0, fallbacks = 0;
+  for (uint32_t r = 0; r < roots; r++)
+    {
+      Bench bench (graph, random.GetInteger (0, graph.size () - 1), multipath);
+      for (uint32_t e = 0; e < events; e++)
+        {
+          uint32_t from;
+          do
+            {
+              from = random.GetInteger (0, graph.size () - 1);
+            }
+          while (graph[from].empty ());
+          LSSpfEngine::Adjacency::const_iterator iter = graph[from].begin ();
+          std::advance (iter, random.GetInteger (0, graph[from].size () - 1));
+          bench.Flood (from, iter->first, false);
+          bench.Flood (from, iter->first, true);
+          floods += 2;
+        }
+      full += bench.GetTime (false);
+      incremental += bench.GetTime (true);
+      mismatches += bench.GetMismatches ();
+      fallbacks += bench.GetFallbacks ();
+      width += bench.GetNextHopsPerRoute ();
+    }
+  std::cout << name << ": nodes=" << graph.size () << " links=" << links / 2
+            << " floods=" << floods << std::endl
+            << "  full        " << full * 1000 / floods << " ms/flood" << std::endl
+            << "  incremental " << incremental * 1000 / floods << " ms/flood"
+            << " (" << fallbacks << " full fallbacks)" << std::endl
+            << "  speedup     " << full / incremental
+            << "  mismatches=" << mismatches << std::endl
+            << "  next hops   " << width / roots << " per route" << std::endl;
+}
+
+void
+PrintHelp (void)
+{
+  std::cout << "bench-ls-spf [options]" << std::endl;
+  std::cout << "  Options:" << std::endl;
+  std::cout << "      --topo=file: add an Inet topology file" << std::endl;
+  std::cout << "      --nodes=n: add a generated topology with n nodes" << std::endl;
+  std::cout << "      --roots=n: number of computing routers per topology (default 3)" << std::endl;
+  std::cout << "      --events=n: link down/up events per router (default 20)" << std::endl;
+  std::cout << "      --single-path: keep only the lowest numbered equal cost next hop" << std::endl;
+  std::cout << "  Without topologies, runs 60.topo and generated 1000 and 10000 node graphs." << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  std::vector<std::string> topologies;
+  std::vector<uint32_t> sizes;
+  uint32_t roots = 3;
+  uint32_t events = 20;
+  bool multipath = true;
+  for (int i = 1; i < argc; i++)
+    {
+      if (strncmp ("--topo=", argv[i], strlen ("--topo=")) == 0)
+        {
+          topologies.push_back (argv[i] + strlen ("--topo="));
+        }
+      else if (strncmp ("--nodes=", argv[i], strlen ("--nodes=")) == 0)
+        {
+          sizes.push_back (atoi (argv[i] + strlen ("--nodes=")));
+        }
+      else if (strncmp ("--roots=", argv[i], strlen ("--roots=")) == 0)
+        {
+          roots = atoi (argv[i] + strlen ("--roots="));
+        }
+      else if (strncmp ("--events=", argv[i], strlen ("--events=")) == 0)
+        {
+          events = atoi (argv[i] + strlen ("--events="));
+        }
+      else if (strcmp ("--single-path", argv[i]) == 0)
+        {
+          multipath = false;
+        }
+      else
+        {
+          PrintHelp ();
+          return 0;
+        }
+    }
+  if (topologies.empty () && sizes.empty ())
+    {
+      topologies.push_back ("upenn-cis553/topologies/60.topo");
+      sizes.push_back (1000);
+      sizes.push_back (10000);
+    }
+  SeedManager::SetSeed (1);
+  for (uint32_t i = 0; i < topologies.size (); i++)
+    {
+      Graph graph;
+      if (!ReadInetTopology (topologies[i], graph))
+        {
+          std::cerr << "Cannot read topology " << topologies[i] << std::endl;
+          continue;
+        }
+      RunBench (topologies[i], graph, roots, events, multipath);
+    }
+  for (uint32_t i = 0; i < sizes.size (); i++)
+    {
+      Graph graph;
+      GenerateTopology (sizes[i], graph);
+      std::ostringstream name;
+      name << "generated-" << sizes[i];
+      RunBench (name.str (), graph, roots, events, multipath);
+    }
+  return 0;
+}
@@ -0,0 +1,159 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 University of Pennsylvania
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ls-area-partitioner.h"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+
+static const uint32_t NONE = 0xffffffff;
+
+std::vector<uint32_t>
+LSAreaPartitioner::Partition (uint32_t nodes, const LinkList &links, uint32_t areaSize)
+{
+  std::vector<std::vector<uint32_t> > adjacency (nodes);
+  for (LinkList::const_iterator iter = links.begin (); iter != links.end (); iter++)
+    {
+      if (iter->first < nodes && iter->second < nodes && iter->first != iter->second)
+        {
+          adjacency[iter->first].push_back (iter->second);
+          adjacency[iter->second].push_back (iter->first);
+        }
+    }
+  areaSize = std::max (areaSize, (uint32_t) 1);
+
+  // Seeds in breadth first order, component after component
+  std::vector<uint32_t> order;
+  std::vector<bool> seen (nodes, false);
+  for (uint32_t start = 0; start < nodes; start++)
+    {
+      if (seen[start])
+        {
+          continue;
+        }
+      seen[start] = true;
+      order.push_back (start);
+      for (uint32_t i = order.size () - 1; i < order.size (); i++)
+        {
+          const std::vector<uint32_t> &neighbors = adjacency[order[i]];
+          for (uint32_t j = 0; j < neighbors.size (); j++)
+            {
+              if (!seen[neighbors[j]])
+                {
+                  seen[neighbors[j]] = true;
+                  order.push_back (neighbors[j]);
+                }
+            }
+        }
+    }
+
+  std::vector<uint32_t> area (nodes, NONE);
+  std::vector<uint32_t> sizes;
+  for (uint32_t i = 0; i < order.size (); i++)
+    {
+      if (area[order[i]] != NONE)
+        {
+          continue;
+        }
+      uint32_t current = sizes.size ();
+      sizes.push_back (1);
+      area[order[i]] = current;
+      std::deque<uint32_t> queue (1, order[i]);
+      while (!queue.empty () && sizes[current] < areaSize)
+        {
+          const std::vector<uint32_t> &neighbors = adjacency[queue.front ()];
+          queue.pop_front ();
+          for (uint32_t j = 0; j < neighbors.size () && sizes[current] < areaSize; j++)
+            {
+              if (area[neighbors[j]] == NONE)
+                {
+                  area[neighbors[j]] = current;
+                  sizes[current]++;
+                  queue.push_back (neighbors[j]);
+                }
+            }
+        }
+    }
+
+  // Merge the fragments, smallest first.  A fragment is adjacent to the
+  // area it merges into, so the result stays connected.
+  std::vector<std::vector<uint32_t> > members (sizes.size ());
+  for (uint32_t node = 0; node < nodes; node++)
+    {
+      members[area[node]].push_back (node);
+    }
+  std::vector<std::pair<uint32_t, uint32_t> > fragments;
+  for (uint32_t i = 0; i < sizes.size (); i++)
+    {
+      if (2 * sizes[i] < areaSize)
+        {
+          fragments.push_back (std::make_pair (sizes[i], i));
+        }
+    }
+  std::sort (fragments.begin (), fragments.end ());
+  for (uint32_t i = 0; i < fragments.size (); i++)
+    {
+      uint32_t fragment = fragments[i].second;
+      // Grown past the threshold by an earlier merge
+      if (2 * sizes[fragment] >= areaSize)
+        {
+          continue;
+        }
+      uint32_t target = NONE;
+      for (uint32_t j = 0; j < members[fragment].size (); j++)
+        {
+          const std::vector<uint32_t> &neighbors = adjacency[members[fragment][j]];
+          for (uint32_t k = 0; k < neighbors.size (); k++)
+            {
+              uint32_t other = area[neighbors[k]];
+              if (other != fragment && (target == NONE || sizes[other] < sizes[target]
+                                        || (sizes[other] == sizes[target] && other < target)))
+                {
+                  target = other;
+                }
+            }
+        }
+      // Alone in its component
+      if (target == NONE)
+        {
+          continue;
+        }
+      for (uint32_t j = 0; j < members[fragment].size (); j++)
+        {
+          area[members[fragment][j]] = target;
+        }
+      members[target].insert (members[target].end (), members[fragment].begin (), members[fragment].end ());
+      members[fragment].clear ();
+      sizes[target] += sizes[fragment];
+      sizes[fragment] = 0;
+    }
+
+  // Renumber densely, in the order of the lowest numbered node
+  std::map<uint32_t, uint32_t> number;
+  for (uint32_t node = 0; node < nodes; node++)
+    {
+      std::map<uint32_t, uint32_t>::iterator iter = number.find (area[node]);
+      if (iter == number.end ())
+        {
+          iter = number.insert (std::make_pair (area[node], (uint32_t) number.size ())).first;
+        }
+      area[node] = iter->second;
+    }
+  return area;
+}
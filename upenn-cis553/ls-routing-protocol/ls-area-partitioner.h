@@ -0,0 +1,49 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 University of Pennsylvania
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LS_AREA_PARTITIONER_H
+#define LS_AREA_PARTITIONER_H
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * \brief Splits a topology into connected LS areas of about equal size.
+ *
+ * Areas are grown breadth first from seeds taken in breadth first order
+ * of the whole topology, so that they tile it without gaps.  An area
+ * stops growing at the target size or when it runs out of unassigned
+ * neighbors, and areas left at less than half the target size are
+ * merged into their smallest neighboring area.  Every area is connected,
+ * which hierarchical LS routing relies on.
+ */
+class LSAreaPartitioner
+{
+  public:
+    typedef std::vector<std::pair<uint32_t, uint32_t> > LinkList;
+
+    /**
+     * \param nodes Number of nodes, numbered from 0.
+     * \param links Links between node numbers.
+     * \param areaSize Target number of nodes per area, at least 1.
+     * \returns The area of every node, areas are numbered densely from 0.
+     */
+    static std::vector<uint32_t> Partition (uint32_t nodes, const LinkList &links, uint32_t areaSize);
+};
+
+#endif
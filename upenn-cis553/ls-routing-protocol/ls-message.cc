@@ -77,6 +77,14 @@ LSMessage::GetSerializedSize (void) const
       case LSP:
         size += m_message.lsp.GetSerializedSize ();
         break;
+      case LSP_ACK:
+      case CSNP:
+      case LSP_REQ:
+        size += m_message.lspDigest.GetSerializedSize ();
+        break;
+      case HELLO:
+        size += m_message.hello.GetSerializedSize ();
+        break;
       default:
         NS_ASSERT (false);
     }
@@ -110,6 +118,14 @@ LSMessage::Print (std::ostream &os) const
       case LSP:
         m_message.lsp.Print (os);
         break;
+      case LSP_ACK:
+      case CSNP:
+      case LSP_REQ:
+        m_message.lspDigest.Print (os);
+        break;
+      case HELLO:
+        m_message.hello.Print (os);
+        break;
       default:
         break;  
     }
@@ -142,6 +158,14 @@ LSMessage::Serialize (Buffer::Iterator start) const
       case LSP:
         m_message.lsp.Serialize(i);
         break;
+      case LSP_ACK:
+      case CSNP:
+      case LSP_REQ:
+        m_message.lspDigest.Serialize (i);
+        break;
+      case HELLO:
+        m_message.hello.Serialize (i);
+        break;
       default:
         NS_ASSERT (false);   
     }
@@ -176,6 +200,14 @@ LSMessage::Deserialize (Buffer::Iterator start)
      case LSP:
         size += m_message.lsp.Deserialize (i);
         break;
+      case LSP_ACK:
+      case CSNP:
+      case LSP_REQ:
+        size += m_message.lspDigest.Deserialize (i);
+        break;
+      case HELLO:
+        size += m_message.hello.Deserialize (i);
+        break;
       default:
         NS_ASSERT (false);
     }
@@ -386,7 +418,11 @@ uint32_t
 LSMessage::Lsp::GetSerializedSize (void) const
 {
   uint32_t size;
-  size = sizeof(uint64_t)+ sizeof(uint16_t)+ (IPV4_ADDRESS_SIZE* NeighborAddrlist.size()) + IPV4_ADDRESS_SIZE + sizeof(uint16_t) + message.length();
+  size = sizeof(uint64_t)+ sizeof(uint8_t)+ sizeof(uint16_t)+ ((IPV4_ADDRESS_SIZE + sizeof(uint32_t)) * NeighborAddrlist.size()) + IPV4_ADDRESS_SIZE + sizeof(uint16_t) + message.length();
+  if (!ackOriginators.empty ())
+    {
+      size += sizeof(uint16_t) + (IPV4_ADDRESS_SIZE + sizeof(uint64_t)) * ackOriginators.size ();
+    }
   return size;
 }
 
@@ -400,25 +436,42 @@ void
 LSMessage::Lsp::Serialize (Buffer::Iterator &start) const
 {
   start.WriteU64 (sequenceNumber);
+  // Bit 0 flags a delta, bit 1 piggybacked acks, so an LSP without acks
+  // costs no more than before
+  start.WriteU8 (delta | (ackOriginators.empty () ? 0 : LSP_FLAG_ACKS));
   start.WriteU16 (NeighborAddrlist.size());
   for(uint16_t i=0; i<NeighborAddrlist.size(); i++)
   {
       start.WriteHtonU32 (NeighborAddrlist[i].Get ());
+      start.WriteHtonU32 (NeighborCostList[i]);
   }
   start.WriteHtonU32 (destinationAddress.Get ());
   start.WriteU16 (message.length ());
   start.Write ((uint8_t *) (const_cast<char*> (message.c_str())), message.length());
+  if (!ackOriginators.empty ())
+    {
+      start.WriteU16 (ackOriginators.size ());
+      for (uint16_t i = 0; i < ackOriginators.size (); i++)
+        {
+          start.WriteHtonU32 (ackOriginators[i].Get ());
+          start.WriteU64 (ackSequenceNumbers[i]);
+        }
+    }
 }
 
 uint32_t
 LSMessage::Lsp::Deserialize (Buffer::Iterator &start)
 {
   sequenceNumber = start.ReadU64 ();
+  uint8_t flags = start.ReadU8 ();
+  delta = flags & 1;
   uint16_t size = start.ReadU16 ();
   NeighborAddrlist.clear();
+  NeighborCostList.clear();
   for(uint16_t i=0; i<size; i++)
   {
       NeighborAddrlist.push_back((Ipv4Address)start.ReadNtohU32 ());
+      NeighborCostList.push_back(start.ReadNtohU32 ());
   }
   destinationAddress = Ipv4Address (start.ReadNtohU32 ());
   uint16_t length = start.ReadU16 ();
@@ -426,11 +479,22 @@ LSMessage::Lsp::Deserialize (Buffer::Iterator &start)
   start.Read ((uint8_t*)str, length);
   message = std::string (str, length);
   free (str);
+  ackOriginators.clear ();
+  ackSequenceNumbers.clear ();
+  if (flags & LSP_FLAG_ACKS)
+    {
+      uint16_t acks = start.ReadU16 ();
+      for (uint16_t i = 0; i < acks; i++)
+        {
+          ackOriginators.push_back (Ipv4Address (start.ReadNtohU32 ()));
+          ackSequenceNumbers.push_back (start.ReadU64 ());
+        }
+    }
   return Lsp::GetSerializedSize ();
 }
 
 void
-LSMessage::SetLsp (uint64_t sequenceNumber, std::vector<Ipv4Address> NeighborAddrlist, Ipv4Address destinationAddress, std::string message)
+LSMessage::SetLsp (uint64_t sequenceNumber, bool delta, std::vector<Ipv4Address> NeighborAddrlist, std::vector<uint32_t> NeighborCostList, Ipv4Address destinationAddress, std::string message)
 {
   if (m_messageType == 0)
     {
@@ -441,9 +505,21 @@ LSMessage::SetLsp (uint64_t sequenceNumber, std::vector<Ipv4Address> NeighborAdd
       NS_ASSERT (m_messageType == LSP);
     }
   m_message.lsp.sequenceNumber = sequenceNumber;
+  m_message.lsp.delta = delta;
   m_message.lsp.NeighborAddrlist= NeighborAddrlist;
+  m_message.lsp.NeighborCostList= NeighborCostList;
   m_message.lsp.destinationAddress = destinationAddress;
   m_message.lsp.message = message;
+  m_message.lsp.ackOriginators.clear ();
+  m_message.lsp.ackSequenceNumbers.clear ();
+}
+
+void
+LSMessage::SetLspAcks (std::vector<Ipv4Address> originators, std::vector<uint64_t> sequenceNumbers)
+{
+  NS_ASSERT (m_messageType == LSP);
+  m_message.lsp.ackOriginators = originators;
+  m_message.lsp.ackSequenceNumbers = sequenceNumbers;
 }
 
 LSMessage::Lsp
@@ -451,3 +527,106 @@ LSMessage::GetLsp ()
 {
   return m_message.lsp;
 }
+
+/* LSP_ACK, CSNP, LSP_REQ */
+
+uint32_t
+LSMessage::LspDigest::GetSerializedSize (void) const
+{
+  return sizeof(uint32_t) + sizeof(uint16_t) + (IPV4_ADDRESS_SIZE + sizeof(uint64_t)) * originators.size();
+}
+
+void
+LSMessage::LspDigest::Print (std::ostream &os) const
+{
+  os << "LspDigest:: Entries: " << originators.size() << "\n";
+}
+
+void
+LSMessage::LspDigest::Serialize (Buffer::Iterator &start) const
+{
+  start.WriteHtonU32 (checksum);
+  start.WriteU16 (originators.size());
+  for (uint16_t i=0; i<originators.size(); i++)
+  {
+      start.WriteHtonU32 (originators[i].Get ());
+      start.WriteU64 (sequenceNumbers[i]);
+  }
+}
+
+uint32_t
+LSMessage::LspDigest::Deserialize (Buffer::Iterator &start)
+{
+  checksum = start.ReadNtohU32 ();
+  uint16_t size = start.ReadU16 ();
+  originators.clear();
+  sequenceNumbers.clear();
+  for (uint16_t i=0; i<size; i++)
+  {
+      originators.push_back (Ipv4Address (start.ReadNtohU32 ()));
+      sequenceNumbers.push_back (start.ReadU64 ());
+  }
+  return LspDigest::GetSerializedSize ();
+}
+
+void
+LSMessage::SetLspDigest (std::vector<Ipv4Address> originators, std::vector<uint64_t> sequenceNumbers, uint32_t checksum)
+{
+  NS_ASSERT (m_messageType == LSP_ACK || m_messageType == CSNP || m_messageType == LSP_REQ);
+  m_message.lspDigest.originators = originators;
+  m_message.lspDigest.sequenceNumbers = sequenceNumbers;
+  m_message.lspDigest.checksum = checksum;
+}
+
+LSMessage::LspDigest
+LSMessage::GetLspDigest ()
+{
+  return m_message.lspDigest;
+}
+
+/* HELLO */
+
+uint32_t
+LSMessage::Hello::GetSerializedSize (void) const
+{
+  return sizeof(uint32_t);
+}
+
+void
+LSMessage::Hello::Print (std::ostream &os) const
+{
+  os << "Hello:: Interval: " << interval << "us\n";
+}
+
+void
+LSMessage::Hello::Serialize (Buffer::Iterator &start) const
+{
+  start.WriteHtonU32 (interval);
+}
+
+uint32_t
+LSMessage::Hello::Deserialize (Buffer::Iterator &start)
+{
+  interval = start.ReadNtohU32 ();
+  return Hello::GetSerializedSize ();
+}
+
+void
+LSMessage::SetHello (uint32_t interval)
+{
+  if (m_messageType == 0)
+    {
+      m_messageType = HELLO;
+    }
+  else
+    {
+      NS_ASSERT (m_messageType == HELLO);
+    }
+  m_message.hello.interval = interval;
+}
+
+LSMessage::Hello
+LSMessage::GetHello ()
+{
+  return m_message.hello;
+}
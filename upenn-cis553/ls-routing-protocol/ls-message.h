@@ -25,6 +25,8 @@
 using namespace ns3;
 
 #define IPV4_ADDRESS_SIZE 4
+// Flag in the delta byte of an LSP that carries piggybacked LSP_ACK entries
+#define LSP_FLAG_ACKS 2
 
 class LSMessage : public Header
 {
@@ -40,6 +42,10 @@ class LSMessage : public Header
         ND_REQ = 3,
         ND_RSP = 4,
         LSP = 5,
+        LSP_ACK = 6,
+        CSNP = 7,
+        LSP_REQ = 8,
+        HELLO = 9,
         // Define extra message types when needed       
       };
 
@@ -140,18 +146,62 @@ class LSMessage : public Header
         uint32_t Deserialize (Buffer::Iterator &start);
         // Payload
         uint64_t sequenceNumber;
+        // A delta LSP only lists the links that changed since the
+        // previous sequence number, cost 0 withdraws a link
+        uint8_t delta;
         std::vector<Ipv4Address> NeighborAddrlist;
+        // Link cost to each neighbor, in NeighborAddrlist order
+        std::vector<uint32_t> NeighborCostList;
         Ipv4Address destinationAddress;
         std::string message;
+        // LSP_ACK entries for the receiver, carried along instead of
+        // their own packet when an LSP goes out on that link anyway
+        std::vector<Ipv4Address> ackOriginators;
+        std::vector<uint64_t> ackSequenceNumbers;
       };
   
 
+    /**
+     * \brief (originator, sequence number) pairs.
+     *
+     * Acknowledges LSPs in LSP_ACK, summarizes the whole LSDB in CSNP and
+     * asks for the listed LSPs in LSP_REQ.  A CSNP without entries only
+     * carries the checksum of the sender's LSDB.
+     */
+    struct LspDigest
+      {
+        void Print (std::ostream &os) const;
+        uint32_t GetSerializedSize (void) const;
+        void Serialize (Buffer::Iterator &start) const;
+        uint32_t Deserialize (Buffer::Iterator &start);
+        // Payload
+        uint32_t checksum;
+        std::vector<Ipv4Address> originators;
+        std::vector<uint64_t> sequenceNumbers;
+      };
+
+    /**
+     * \brief Liveness hello, sent to every neighbor at an adaptive rate.
+     */
+    struct Hello
+      {
+        void Print (std::ostream &os) const;
+        uint32_t GetSerializedSize (void) const;
+        void Serialize (Buffer::Iterator &start) const;
+        uint32_t Deserialize (Buffer::Iterator &start);
+        // Payload
+        // Time until the sender's next hello, in microseconds
+        uint32_t interval;
+      };
+
   private:
     struct
       {
         PingReq pingReq;
         PingRsp pingRsp;
         Lsp lsp;
+        LspDigest lspDigest;
+        Hello hello;
       } m_message;
     
   public:
@@ -182,7 +232,38 @@ class LSMessage : public Header
     void SetPingRsp (Ipv4Address destinationAddress, std::string message);
     void SetNdRsp (Ipv4Address destinationAddress, std::string message);
 
-    void SetLsp (uint64_t sequenceNumber, std::vector<Ipv4Address> NeighborAddrlist, Ipv4Address destinationAddress, std::string Message);
+    void SetLsp (uint64_t sequenceNumber, bool delta, std::vector<Ipv4Address> NeighborAddrlist, std::vector<uint32_t> NeighborCostList, Ipv4Address destinationAddress, std::string Message);
+
+    /**
+     *  \brief Piggybacks LSP_ACK entries on an LSP
+     *  \param originators LSP originator addresses
+     *  \param sequenceNumbers LSP sequence number of each originator
+     */
+    void SetLspAcks (std::vector<Ipv4Address> originators, std::vector<uint64_t> sequenceNumbers);
+
+    /**
+     * \returns LspDigest Struct of an LSP_ACK, CSNP or LSP_REQ
+     */
+    LspDigest GetLspDigest ();
+
+    /**
+     *  \brief Sets LSP_ACK, CSNP or LSP_REQ message params
+     *  \param originators LSP originator addresses
+     *  \param sequenceNumbers LSP sequence number of each originator
+     *  \param checksum LSDB checksum, for CSNP
+     */
+    void SetLspDigest (std::vector<Ipv4Address> originators, std::vector<uint64_t> sequenceNumbers, uint32_t checksum);
+
+    /**
+     * \returns Hello Struct
+     */
+    Hello GetHello ();
+
+    /**
+     *  \brief Sets HELLO message params
+     *  \param interval Hello interval of the sender, in microseconds
+     */
+    void SetHello (uint32_t interval);
     
 
 }; // class LSMessage
@@ -25,14 +25,20 @@
 #include "ns3/node.h"
 #include "ns3/socket.h"
 #include "ns3/timer.h"
+#include "ns3/event-id.h"
+#include "ns3/random-variable.h"
+#include "ns3/penn-random.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/sgi-hashmap.h"
 
 #include "ns3/ping-request.h"
 #include "ns3/penn-routing-protocol.h"
 #include "ns3/ls-message.h"
+#include "ns3/ls-spf-engine.h"
+#include "ns3/penn-checkpoint.h"
 
 #include <vector>
 #include <map>
-#include <queue>
 
 using namespace ns3;
 
@@ -41,6 +47,12 @@ class LSRoutingProtocol : public PennRoutingProtocol
   public:
     static TypeId GetTypeId (void);
 
+    enum LinkMetric
+      {
+        HOP_COUNT,
+        DELAY,
+      };
+
     LSRoutingProtocol ();
     virtual ~LSRoutingProtocol ();
     /**
@@ -68,7 +80,7 @@ class LSRoutingProtocol : public PennRoutingProtocol
      * \param nodeAddressMap Mapping.
      */
 
-    virtual void SetNodeAddressMap (std::map<uint32_t, Ipv4Address> nodeAddressMap); 
+    virtual void SetNodeAddressMap (const std::map<uint32_t, Ipv4Address> &nodeAddressMap); 
     /**
      * \brief Save the mapping from IP addresses to Inet topology node numbers.
      *
@@ -77,7 +89,50 @@ class LSRoutingProtocol : public PennRoutingProtocol
      * \param addressNodeMap Mapping.
      */
 
-    virtual void SetAddressNodeMap (std::map<Ipv4Address, uint32_t> addressNodeMap);
+    virtual void SetAddressNodeMap (const std::map<Ipv4Address, uint32_t> &addressNodeMap);
+    /**
+     * \brief Save the area of every node, which turns on hierarchical routing.
+     *
+     * Router LSPs are then only flooded within an area.  Each area has one
+     * area LSP, flooded everywhere, that lists the areas next to it.
+     * Destinations in other areas are routed by area: towards the next area
+     * on the shortest path over areas, through the closest exit into it.
+     * Areas must be connected.
+     *
+     * This method is called by the simulator-main when this node is created.
+     *
+     * \param nodeAreaMap Mapping from Inet topology node numbers to areas.
+     */
+    void SetNodeAreaMap (const std::map<uint32_t, uint32_t> &nodeAreaMap);
+    /**
+     * \brief Size of the routing state of this node.
+     *
+     * \param lsps Installed router and area LSPs.
+     * \param links Links listed in the installed LSPs.
+     * \param fibEntries Addresses and areas in the forwarding table.
+     */
+    void GetStateSize (uint32_t &lsps, uint32_t &links, uint32_t &fibEntries) const;
+    /**
+     * \brief Write the neighbors, link metrics and LSDB of this node.
+     */
+    void SaveCheckpoint (PennCheckpointWriter &writer);
+    /**
+     * \brief Install the state written by SaveCheckpoint and recompute the
+     * routes from it, without flooding.  Neighbors are taken as alive
+     * until their liveness times out as usual, and the LSP sequence
+     * number continues above the restored LSPs of this node.
+     *
+     * \returns False if the checkpoint is corrupt.
+     */
+    bool LoadCheckpoint (PennCheckpointReader &reader);
+    /**
+     * \returns Last time a route of any node changed.
+     */
+    static Time GetLastRouteChange ();
+    /**
+     * \brief Flooding and SPF work of all nodes since the last SPF dump.
+     */
+    static void GetStats (uint32_t &lsps, uint64_t &floodingBytes, uint32_t &spfRuns);
 
     // Message Handling
     /**
@@ -186,15 +241,145 @@ class LSRoutingProtocol : public PennRoutingProtocol
     void NeighborDiscovery ();
     void ProcessNdReq (LSMessage lsMessage, Ptr<Socket> socket);
     void ProcessNdRsp (LSMessage lsMessage, Ptr<Socket> socket);
+    /**
+     * \brief Fold a delay sample into the smoothed delay of a link.
+     *
+     * \param nodeNumber Neighbor at the far end of the link.
+     * \param interfaceAddr Local address of the link.
+     * \param rtt Round trip time of the last ND_REQ/ND_RSP exchange.
+     */
+    void UpdateLinkDelay (uint32_t nodeNumber, Ipv4Address interfaceAddr, Time rtt);
+    /**
+     * \brief Turn smoothed link delays into advertised link costs.
+     *
+     * \returns true if the cost of any current neighbor changed.
+     */
+    bool UpdateLinkCosts ();
+    uint32_t GetLinkCost (uint32_t nodeNumber) const;
     
     /*Periodic NeighbourDiscovery*/
     void NdRequests ();
+    /**
+     * \brief Advertise and route around a change of the neighbor set or
+     * of a link cost.
+     */
+    void NeighborsChanged ();
+
+    // Neighbor liveness
+    /**
+     * \brief Start hellos to a neighbor that just came up, and its
+     * detection timer.
+     */
+    void StartLiveness (uint32_t nodeNumber);
+    /**
+     * \brief Push back the time a neighbor is declared dead.
+     *
+     * \param nodeNumber Neighbor.
+     * \param interval Time until the next sign of life is due, the neighbor
+     * is declared dead after DetectMultiplier of them went missing, or at
+     * the end of the neighbor discovery round without hellos.
+     */
+    void RefreshNeighbor (uint32_t nodeNumber, Time interval);
+    void NeighborTimeout (uint32_t nodeNumber);
+    void SendHello (uint32_t nodeNumber);
+    void ProcessHello (LSMessage lsMessage, Ptr<Socket> socket);
+    /**
+     * \returns Our hello interval towards a neighbor, HelloInterval doubled
+     * for every recent failure of the link.
+     */
+    Time GetHelloInterval (uint32_t nodeNumber);
    
+    /**
+     * \brief Originate our LSP.
+     *
+     * With DeltaLsp on, only the first LSP lists all links, later ones
+     * carry the links added, changed or withdrawn since the previous one.
+     */
     void Flooding ();
     void ProcessLsp (LSMessage lsMessage,Ptr<Socket> socket);
-    void ForwardPacket (Ptr<Packet> packet,Ptr<Socket> socket);
+    void ProcessLspAck (LSMessage lsMessage, Ptr<Socket> socket);
+    /**
+     * \brief Stops retransmitting the LSPs a neighbor acknowledged.
+     */
+    void ReleaseLsps (Ptr<Socket> socket, const std::vector<Ipv4Address> &originators,
+                      const std::vector<uint64_t> &sequenceNumbers);
+    void ProcessCsnp (LSMessage lsMessage, Ptr<Socket> socket);
+    void ProcessLspReq (LSMessage lsMessage, Ptr<Socket> socket);
+    /**
+     * \brief Send an LSP on every socket but one.
+     *
+     * \param packet LSP.
+     * \param socket Socket to skip, the one the LSP arrived on, or 0.
+     * \param originator Originator of the LSP.
+     * \param sequenceNumber LSP sequence number.
+     * \param delta Whether the LSP is a delta.
+     */
+    void FloodLsp (Ptr<Packet> packet, Ptr<Socket> socket, Ipv4Address originator,
+                   uint64_t sequenceNumber, bool delta);
+    /**
+     * \brief Send an LSP to the neighbor on socket, and keep it for
+     * retransmission until that neighbor acknowledges it.
+     *
+     * A delta whose predecessor is still unacknowledged goes out as a full
+     * LSP instead, the neighbor may have missed the predecessor.
+     */
+    void SendLsp (Ptr<Socket> socket, Ptr<Packet> packet, Ipv4Address originator,
+                  uint64_t sequenceNumber, bool delta);
+    /**
+     * \brief Build a full LSP from the installed copy of originator's LSP.
+     *
+     * \param originator Originator address, may be our own.
+     * \param sequenceNumber Set to the sequence number of the LSP.
+     * \returns 0 if no LSP of originator is installed.
+     */
+    Ptr<Packet> BuildFullLsp (Ipv4Address originator, uint64_t &sequenceNumber);
+    void SendLspDigest (Ptr<Socket> socket, LSMessage::MessageType messageType,
+                        std::vector<Ipv4Address> originators, std::vector<uint64_t> sequenceNumbers);
+    /**
+     * \brief Acknowledge an LSP to the neighbor on socket.
+     *
+     * Acknowledgments are held for LspAckDelay so that one LSP_ACK covers
+     * all LSPs that arrived meanwhile, or an LSP sent on the link carries them.
+     */
+    void AckLsp (Ptr<Socket> socket, Ipv4Address originator, uint64_t sequenceNumber);
+    /**
+     * \returns packet, or a copy of it with the ACKs pending for socket.
+     */
+    Ptr<Packet> PiggybackAcks (Ptr<Socket> socket, Ptr<Packet> packet);
+    void SendLspAcks ();
+    void RetransmitLsps ();
+    /**
+     * \brief Periodically send the LSDB checksum to every neighbor, so
+     * that LSPs lost despite retransmission get repaired.
+     *
+     * A neighbor whose LSDB differs answers with a full CSNP.
+     */
+    void SendCsnps ();
+    /**
+     * \param socket Socket of the neighbor.
+     * \param full Whether to list every LSP or only send the checksum.
+     */
+    void SendCsnp (Ptr<Socket> socket, bool full);
+    /**
+     * \returns Order independent checksum of the originators and sequence
+     * numbers of the installed LSPs in scope for socket, our own included.
+     */
+    uint32_t GetLsdbChecksum (Ptr<Socket> socket);
     void UpdateMap (LSMessage lsMessage);
+    void ScheduleSpf ();
     void DijkstraAlgo ();
+    void UpdateRouteTableEntry (uint32_t nodeNumber);
+    void UpdateFibEntry (uint32_t nodeNumber);
+    /**
+     * \brief Recompute the routes to other areas, after SPF.
+     */
+    void UpdateAreaRoutes ();
+    void UpdateAreaFib ();
+    /**
+     * \brief Originate the LSP of our area if we speak for it and the
+     * areas next to it changed.
+     */
+    void OriginateAreaLsp ();
     void DoDispose ();
 
   private:
@@ -204,6 +389,46 @@ class LSRoutingProtocol : public PennRoutingProtocol
      * \param packet Packet to be sent.
      */
     void BroadcastPacket (Ptr<Packet> packet);
+    /**
+     * \brief Send a flooding packet to the neighbor on socket.
+     */
+    void SendOnSocket (Ptr<Socket> socket, Ptr<Packet> packet);
+    bool HasNeighbor (Ptr<Socket> socket);
+    Ptr<Socket> FindSocket (Ipv4Address interfaceAddr);
+    /**
+     * \returns Equal cost routes to destination, or 0 if there is none.
+     */
+    const std::vector<Ptr<Ipv4Route> > *LookupFib (Ipv4Address destination) const;
+    // Areas
+    uint32_t GetNodeArea (uint32_t nodeNumber) const;
+    /**
+     * \brief Area LSPs are keyed by a pseudo address in 240.0.0.0/4,
+     * which no interface has.
+     */
+    Ipv4Address GetAreaAddress (uint32_t area) const;
+    uint32_t GetAreaNumber (Ipv4Address areaAddress) const;
+    bool IsAreaAddress (Ipv4Address address) const;
+    /**
+     * \returns Whether the LSP of originator goes to the neighbor on socket:
+     * router LSPs stay within the area, area LSPs go everywhere.
+     */
+    bool IsInScope (Ptr<Socket> socket, Ipv4Address originator);
+    /**
+     * \brief List the installed LSPs that are in scope for socket, our own
+     * first.
+     */
+    void GetLsdbDigest (Ptr<Socket> socket, std::vector<Ipv4Address> &originators,
+                        std::vector<uint64_t> &sequenceNumbers);
+    /**
+     * \returns The areas next to ours with the cheapest link into each, over
+     * our own links and those of the routers of our area we reach.
+     */
+    LSSpfEngine::Adjacency GetAreaExits ();
+    /**
+     * \returns Whether we are the lowest numbered router of our area we
+     * reach, which originates the area LSP.
+     */
+    bool IsAreaSpeaker ();
     /**
      * \brief Returns the main IP address of a node in Inet topology.
      *
@@ -227,6 +452,7 @@ class LSRoutingProtocol : public PennRoutingProtocol
     void DumpNeighbors ();
     void DumpRouteMap();
     void DumpRoutingTable ();
+    void DumpSpf ();
 
   protected:
     virtual void DoStart (void);
@@ -241,14 +467,6 @@ class LSRoutingProtocol : public PennRoutingProtocol
 
 
   private:
-    class CompareCost
-    {
-      public:
-      bool operator() (const std::pair<int,int>& p1,const std::pair<int,int>& p2)
-      {
-        return p1.second<p2.second;
-      }
-    };
     std::map< Ptr<Socket>, Ipv4InterfaceAddress > m_socketAddresses;
     Ipv4Address m_mainAddress;
     struct NeighborTableEntry
@@ -265,17 +483,109 @@ class LSRoutingProtocol : public PennRoutingProtocol
       std::vector<uint32_t> neighborList;
       std::vector<Ipv4Address> neighborListAddr;
       std::vector<uint32_t> neighborListCost;
+      // Sequence number of the last LSP applied
+      uint64_t sequenceNumber;
     };  
     std::map<uint32_t, RouteMapDetails> m_routeMap;
+    // Area LSPs, by area, neighborList holds areas
+    std::map<uint32_t, RouteMapDetails> m_areaMap;
+    /**
+     * \returns The installed router or area LSP of originator, or 0.
+     */
+    RouteMapDetails *FindLsp (Ipv4Address originator);
+    /**
+     * \brief Hand the links of a router LSP to SPF.  Links into other areas
+     * become links to the exit into that area.
+     */
+    void SetSpfLsp (uint32_t nodeNumber, const RouteMapDetails &routeMapDetails);
+    // Links of our last LSP, the base of the next delta
+    LSSpfEngine::Adjacency m_advertisedAdjacency;
+    struct PendingLsp
+    {
+      uint64_t sequenceNumber;
+      Ptr<Packet> packet;
+      Time lastSent;
+      uint32_t retransmits;
+    };
+    // LSPs not yet acknowledged, per neighbor socket and originator
+    std::map<Ptr<Socket>, std::map<Ipv4Address, PendingLsp> > m_pendingLsps;
+    // Acknowledgments not sent yet, per neighbor socket
+    std::map<Ptr<Socket>, std::map<Ipv4Address, uint64_t> > m_pendingAcks;
+    struct LinkMetricEntry
+    {
+      // Smoothed one way delay, and the delay the advertised cost is based on
+      Time delay;
+      Time advertisedDelay;
+      uint32_t cost;
+    };
+    std::map<uint32_t, LinkMetricEntry> m_linkMetrics;
+    struct LivenessEntry
+    {
+      // The neighbor is declared dead once this passes without a hello
+      Time deadline;
+      // Recent failures of the link, and when the last one was (forgiven)
+      uint32_t penalty;
+      Time lastChange;
+      EventId helloEvent;
+      EventId timeoutEvent;
+    };
+    std::map<uint32_t, LivenessEntry> m_liveness;
     struct RouteTableDetails
     {
       Ipv4Address destAddr;
       uint32_t nextHopNumber;
+      // All equal cost next hops, nextHopNumber is the lowest of them
+      std::vector<uint32_t> nextHopNumbers;
       Ipv4Address nextHopAddr;
       Ipv4Address interfaceAddr;
       uint32_t cost;
     };
     std::map<uint32_t, RouteTableDetails> m_routeTable;
+    // Forwarding table, refreshed from m_routeTable after each change
+    Fib m_fib;
+    // SPF vertex of the exit into an area, the routers of our area with
+    // links into it are linked to it
+    static const uint32_t AREA_EXIT = 0x80000000;
+    // Cost from an exit back into our area, paths through another area
+    // are only found while ours is split
+    static const uint32_t AREA_TRANSIT = 0x10000000;
+    // Hierarchical routing, on once the areas are set
+    const std::map<uint32_t, uint32_t> *m_nodeAreaMap;
+    uint32_t m_nodeNumber;
+    uint32_t m_area;
+    // Routers of our area linking into each other area, with the cost
+    std::map<uint32_t, LSSpfEngine::Adjacency> m_exitAdjacency;
+    // Links of the last area LSP we originated, while we speak for the area
+    bool m_areaSpeaker;
+    LSSpfEngine::Adjacency m_originatedAreaLinks;
+    Time m_areaLspDelay;
+    Timer m_areaLspTimer;
+    // SPF over areas, our area is the root
+    LSSpfEngine m_areaSpf;
+    // Routes and forwarding table entries towards other areas
+    std::map<uint32_t, RouteTableDetails> m_areaRoutes;
+    std::map<uint32_t, std::vector<Ptr<Ipv4Route> > > m_areaFib;
+    LSSpfEngine m_spf;
+    bool m_incrementalSpf;
+    bool m_ecmp;
+    LinkMetric m_linkMetric;
+    Time m_metricUnit;
+    double m_metricHysteresis;
+    bool m_queueMetric;
+    bool m_deltaLsp;
+    bool m_reliableFlooding;
+    Time m_lspRetransmitInterval;
+    Time m_lspAckDelay;
+    uint32_t m_lspMaxRetransmits;
+    Time m_csnpInterval;
+    Time m_helloInterval;
+    Time m_helloMaxInterval;
+    Time m_helloDecayTime;
+    uint32_t m_detectMultiplier;
+    // Jitter of the hellos, and the first sequence number
+    PennRandom m_random;
+    uint32_t m_ndSequenceNumber;
+    Time m_ndSendTime;
     Ptr<Ipv4StaticRouting> m_staticRouting;
     Ptr<Ipv4> m_ipv4;
     Time m_pingTimeout;
@@ -285,11 +595,31 @@ class LSRoutingProtocol : public PennRoutingProtocol
     uint16_t m_lsPort;
     uint32_t m_currentSequenceNumber;
     uint64_t m_lspSequenceNumber;
-    std::map<uint32_t, Ipv4Address> m_nodeAddressMap;
-    std::map<Ipv4Address, uint32_t> m_addressNodeMap;
+    // The same on every node, shared between all of them
+    const std::map<uint32_t, Ipv4Address> *m_nodeAddressMap;
+    const std::map<Ipv4Address, uint32_t> *m_addressNodeMap;
+    const std::map<uint32_t, std::vector<Ipv4Address> > *m_nodeAddresses;
     // Timers
     Timer m_auditPingsTimer;
     Timer m_ndTimer;
+    Timer m_spfTimer;
+    Timer m_retransmitTimer;
+    Timer m_ackTimer;
+    Timer m_csnpTimer;
+    // SPF throttling
+    Time m_spfInitialDelay;
+    Time m_spfHoldTime;
+    Time m_spfMaxHoldTime;
+    Time m_spfHold;
+    Time m_lastSpfTime;
+    // SPF statistics, shared by all nodes and reset by DUMP SPF
+    static uint32_t globalSpfRuns;
+    static uint32_t globalLspCount;
+    static double globalSpfCpu;
+    static Time globalStatsStart;
+    static Time globalLastRouteChange;
+    static uint64_t globalFloodingBytes;
+    static uint32_t globalLspRetransmits;
     // Ping tracker
     std::map<uint32_t, Ptr<PingRequest> > m_pingTracker;
 };
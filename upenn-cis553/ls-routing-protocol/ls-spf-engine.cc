@@ -0,0 +1,679 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 University of Pennsylvania
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/ls-spf-engine.h"
+#include <algorithm>
+
+const uint32_t LSSpfEngine::ROOT;
+const uint32_t LSSpfEngine::INFINITE_COST;
+const uint32_t LSSpfEngine::NONE;
+
+LSSpfEngine::LSSpfEngine ()
+  : m_incremental (true),
+    m_multipath (true),
+    m_computed (false),
+    m_fullRunFraction (0.25),
+    m_fullRuns (0),
+    m_incrementalRuns (0)
+{
+  Vertex &root = m_vertices[GetIndex (ROOT)];
+  root.cost = 0;
+  root.nextHops.assign (1, ROOT);
+}
+
+void
+LSSpfEngine::SetIncremental (bool incremental)
+{
+  m_incremental = incremental;
+}
+
+void
+LSSpfEngine::SetFullRunFraction (double fraction)
+{
+  m_fullRunFraction = fraction;
+}
+
+void
+LSSpfEngine::SetMultipath (bool multipath)
+{
+  if (multipath != m_multipath)
+    {
+      m_multipath = multipath;
+      m_computed = false;
+    }
+}
+
+void
+LSSpfEngine::SetRootAdjacency (const Adjacency &adjacency)
+{
+  m_pending[ROOT] = adjacency;
+}
+
+void
+LSSpfEngine::SetLsp (uint32_t node, const Adjacency &adjacency)
+{
+  m_pending[node] = adjacency;
+}
+
+bool
+LSSpfEngine::IsDirty () const
+{
+  return !m_pending.empty ();
+}
+
+bool
+LSSpfEngine::GetRoute (uint32_t node, uint32_t &cost, uint32_t &nextHop) const
+{
+  uint32_t index = FindIndex (node);
+  if (node == ROOT || index == NONE || m_vertices[index].cost == INFINITE_COST)
+    {
+      return false;
+    }
+  cost = m_vertices[index].cost;
+  nextHop = m_vertices[index].nextHops.front ();
+  return true;
+}
+
+bool
+LSSpfEngine::GetRoute (uint32_t node, uint32_t &cost, std::vector<uint32_t> &nextHops) const
+{
+  uint32_t index = FindIndex (node);
+  if (node == ROOT || index == NONE || m_vertices[index].cost == INFINITE_COST)
+    {
+      return false;
+    }
+  cost = m_vertices[index].cost;
+  nextHops = m_vertices[index].nextHops;
+  return true;
+}
+
+uint32_t
+LSSpfEngine::GetNodeCount () const
+{
+  return m_vertices.size () - 1;
+}
+
+uint32_t
+LSSpfEngine::GetFullRuns () const
+{
+  return m_fullRuns;
+}
+
+uint32_t
+LSSpfEngine::GetIncrementalRuns () const
+{
+  return m_incrementalRuns;
+}
+
+void
+LSSpfEngine::IndexedHeap::Resize (uint32_t size)
+{
+  m_position.resize (size, NONE);
+}
+
+bool
+LSSpfEngine::IndexedHeap::IsEmpty () const
+{
+  return m_heap.empty ();
+}
+
+void
+LSSpfEngine::IndexedHeap::Push (uint32_t index, uint32_t key)
+{
+  uint32_t i = m_position[index];
+  if (i == NONE)
+    {
+      m_heap.push_back (std::make_pair (key, index));
+      i = m_heap.size () - 1;
+      m_position[index] = i;
+    }
+  else if (key < m_heap[i].first)
+    {
+      m_heap[i].first = key;
+    }
+  SiftUp (i);
+}
+
+uint32_t
+LSSpfEngine::IndexedHeap::Pop ()
+{
+  uint32_t index = m_heap[0].second;
+  Swap (0, m_heap.size () - 1);
+  m_heap.pop_back ();
+  m_position[index] = NONE;
+  if (!m_heap.empty ())
+    {
+      SiftDown (0);
+    }
+  return index;
+}
+
+void
+LSSpfEngine::IndexedHeap::Swap (uint32_t i, uint32_t j)
+{
+  std::swap (m_heap[i], m_heap[j]);
+  m_position[m_heap[i].second] = i;
+  m_position[m_heap[j].second] = j;
+}
+
+void
+LSSpfEngine::IndexedHeap::SiftUp (uint32_t i)
+{
+  while (i > 0 && m_heap[i].first < m_heap[(i - 1) / 2].first)
+    {
+      Swap (i, (i - 1) / 2);
+      i = (i - 1) / 2;
+    }
+}
+
+void
+LSSpfEngine::IndexedHeap::SiftDown (uint32_t i)
+{
+  while (true)
+    {
+      uint32_t smallest = i;
+      uint32_t left = 2 * i + 1;
+      uint32_t right = left + 1;
+      if (left < m_heap.size () && m_heap[left].first < m_heap[smallest].first)
+        {
+          smallest = left;
+        }
+      if (right < m_heap.size () && m_heap[right].first < m_heap[smallest].first)
+        {
+          smallest = right;
+        }
+      if (smallest == i)
+        {
+          return;
+        }
+      Swap (i, smallest);
+      i = smallest;
+    }
+}
+
+uint32_t
+LSSpfEngine::FindIndex (uint32_t node) const
+{
+  std::map<uint32_t, uint32_t>::const_iterator iter = m_index.find (node);
+  if (iter == m_index.end ())
+    {
+      return NONE;
+    }
+  return iter->second;
+}
+
+uint32_t
+LSSpfEngine::GetIndex (uint32_t node)
+{
+  std::map<uint32_t, uint32_t>::iterator iter = m_index.find (node);
+  if (iter != m_index.end ())
+    {
+      return iter->second;
+    }
+  Vertex vertex;
+  vertex.node = node;
+  vertex.hasLsp = false;
+  vertex.cost = INFINITE_COST;
+  m_vertices.push_back (vertex);
+  m_index[node] = m_vertices.size () - 1;
+  return m_vertices.size () - 1;
+}
+
+static uint32_t
+FindLinkCost (const std::vector<std::pair<uint32_t, uint32_t> > &links, uint32_t index)
+{
+  std::vector<std::pair<uint32_t, uint32_t> >::const_iterator iter =
+    std::lower_bound (links.begin (), links.end (), std::make_pair (index, (uint32_t) 0));
+  if (iter == links.end () || iter->first != index)
+    {
+      return LSSpfEngine::INFINITE_COST;
+    }
+  return iter->second;
+}
+
+uint32_t
+LSSpfEngine::LinkCost (uint32_t from, uint32_t to) const
+{
+  if (from != 0 && !m_vertices[from].hasLsp)
+    {
+      return INFINITE_COST;
+    }
+  uint32_t cost = FindLinkCost (m_vertices[from].links, to);
+  // Links of the computing router come from neighbor discovery and need
+  // no confirmation, all others must be advertised by both ends.
+  if (from != 0 && cost != INFINITE_COST
+      && (!m_vertices[to].hasLsp || FindLinkCost (m_vertices[to].links, from) == INFINITE_COST))
+    {
+      return INFINITE_COST;
+    }
+  return cost;
+}
+
+const LSSpfEngine::Adjacency *
+LSSpfEngine::FindPending (uint32_t node) const
+{
+  std::map<uint32_t, Adjacency>::const_iterator iter = m_pending.find (node);
+  if (iter == m_pending.end ())
+    {
+      return 0;
+    }
+  return &iter->second;
+}
+
+uint32_t
+LSSpfEngine::PendingLinkCost (uint32_t fromNode, uint32_t toNode) const
+{
+  const Adjacency *fromPending = FindPending (fromNode);
+  const Adjacency *toPending = FindPending (toNode);
+  if (fromPending == 0 && toPending == 0)
+    {
+      uint32_t from = FindIndex (fromNode);
+      uint32_t to = FindIndex (toNode);
+      return (from == NONE || to == NONE) ? INFINITE_COST : LinkCost (from, to);
+    }
+  uint32_t cost = INFINITE_COST;
+  if (fromPending != 0)
+    {
+      Adjacency::const_iterator iter = fromPending->find (toNode);
+      if (iter != fromPending->end ())
+        {
+          cost = iter->second;
+        }
+    }
+  else
+    {
+      uint32_t from = FindIndex (fromNode);
+      uint32_t to = FindIndex (toNode);
+      if (from != NONE && to != NONE && (from == 0 || m_vertices[from].hasLsp))
+        {
+          cost = FindLinkCost (m_vertices[from].links, to);
+        }
+    }
+  if (fromNode == ROOT || cost == INFINITE_COST)
+    {
+      return cost;
+    }
+  if (toPending != 0)
+    {
+      return toPending->find (fromNode) == toPending->end () ? INFINITE_COST : cost;
+    }
+  uint32_t from = FindIndex (fromNode);
+  uint32_t to = FindIndex (toNode);
+  if (from == NONE || to == NONE || !m_vertices[to].hasLsp
+      || FindLinkCost (m_vertices[to].links, from) == INFINITE_COST)
+    {
+      return INFINITE_COST;
+    }
+  return cost;
+}
+
+bool
+LSSpfEngine::AddNextHop (Vertex &vertex, uint32_t nextHop)
+{
+  if (!m_multipath)
+    {
+      if (nextHop >= vertex.nextHops.front ())
+        {
+          return false;
+        }
+      vertex.nextHops.front () = nextHop;
+      return true;
+    }
+  std::vector<uint32_t>::iterator iter =
+    std::lower_bound (vertex.nextHops.begin (), vertex.nextHops.end (), nextHop);
+  if (iter != vertex.nextHops.end () && *iter == nextHop)
+    {
+      return false;
+    }
+  vertex.nextHops.insert (iter, nextHop);
+  return true;
+}
+
+/*
+ * Offer index a path of the given cost through from.  A cheaper path
+ * replaces the next hops, an equally cheap one adds to them.  Returns
+ * whether the label changed.
+ */
+bool
+LSSpfEngine::Improve (uint32_t index, uint32_t cost, uint32_t from)
+{
+  Vertex &vertex = m_vertices[index];
+  if (cost > vertex.cost)
+    {
+      return false;
+    }
+  // Neighbors of the computing router are their own next hop
+  const std::vector<uint32_t> &hops = m_vertices[from].nextHops;
+  uint32_t firstHop = (from == 0) ? vertex.node : hops.front ();
+  if (cost < vertex.cost)
+    {
+      vertex.cost = cost;
+      if (from == 0 || !m_multipath)
+        {
+          vertex.nextHops.assign (1, firstHop);
+        }
+      else
+        {
+          vertex.nextHops = hops;
+        }
+      return true;
+    }
+  if (from == 0 || !m_multipath)
+    {
+      return AddNextHop (vertex, firstHop);
+    }
+  bool added = false;
+  for (uint32_t i = 0; i < hops.size (); i++)
+    {
+      added = AddNextHop (vertex, hops[i]) || added;
+    }
+  return added;
+}
+
+void
+LSSpfEngine::ApplyPending ()
+{
+  for (std::map<uint32_t, Adjacency>::iterator iter = m_pending.begin ();
+       iter != m_pending.end (); iter++)
+    {
+      // Directly connected neighbors get a vertex, and so a route, even
+      // without an LSP
+      LinkList links;
+      for (Adjacency::iterator it = iter->second.begin (); it != iter->second.end (); it++)
+        {
+          links.push_back (std::make_pair (GetIndex (it->first), it->second));
+        }
+      std::sort (links.begin (), links.end ());
+      Vertex &vertex = m_vertices[GetIndex (iter->first)];
+      vertex.links.swap (links);
+      vertex.hasLsp = (iter->first != ROOT);
+    }
+  m_pending.clear ();
+  m_heap.Resize (m_vertices.size ());
+}
+
+void
+LSSpfEngine::CompileGraph ()
+{
+  m_offsets.assign (1, 0);
+  m_targets.clear ();
+  m_costs.clear ();
+  for (uint32_t from = 0; from < m_vertices.size (); from++)
+    {
+      const LinkList &links = m_vertices[from].links;
+      for (LinkList::const_iterator iter = links.begin (); iter != links.end (); iter++)
+        {
+          uint32_t cost = LinkCost (from, iter->first);
+          if (cost != INFINITE_COST)
+            {
+              m_targets.push_back (iter->first);
+              m_costs.push_back (cost);
+            }
+        }
+      m_offsets.push_back (m_targets.size ());
+    }
+}
+
+void
+LSSpfEngine::Relax (uint32_t index, uint32_t cost, uint32_t from, LabelMap &before)
+{
+  const Vertex &vertex = m_vertices[index];
+  if (cost > vertex.cost)
+    {
+      return;
+    }
+  if (before.find (index) != before.end ())
+    {
+      if (Improve (index, cost, from))
+        {
+          m_heap.Push (index, cost);
+        }
+      return;
+    }
+  Label label (vertex.cost, vertex.nextHops);
+  if (Improve (index, cost, from))
+    {
+      Label &entry = before[index];
+      entry.first = label.first;
+      entry.second.swap (label.second);
+      m_heap.Push (index, cost);
+    }
+}
+
+void
+LSSpfEngine::RunQueue (LabelMap &before)
+{
+  while (!m_heap.IsEmpty ())
+    {
+      uint32_t from = m_heap.Pop ();
+      const LinkList &links = m_vertices[from].links;
+      for (LinkList::const_iterator iter = links.begin (); iter != links.end (); iter++)
+        {
+          uint32_t linkCost = LinkCost (from, iter->first);
+          if (linkCost != INFINITE_COST)
+            {
+              Relax (iter->first, m_vertices[from].cost + linkCost, from, before);
+            }
+        }
+    }
+}
+
+void
+LSSpfEngine::FullRun (std::vector<uint32_t> &changed)
+{
+  ApplyPending ();
+  CompileGraph ();
+  std::vector<Label> before (m_vertices.size ());
+  for (uint32_t index = 1; index < m_vertices.size (); index++)
+    {
+      Vertex &vertex = m_vertices[index];
+      before[index].first = vertex.cost;
+      before[index].second.swap (vertex.nextHops);
+      vertex.cost = INFINITE_COST;
+      vertex.nextHops.clear ();
+    }
+  m_heap.Push (0, 0);
+  while (!m_heap.IsEmpty ())
+    {
+      uint32_t from = m_heap.Pop ();
+      uint32_t cost = m_vertices[from].cost;
+      for (uint32_t i = m_offsets[from]; i < m_offsets[from + 1]; i++)
+        {
+          if (Improve (m_targets[i], cost + m_costs[i], from))
+            {
+              m_heap.Push (m_targets[i], cost + m_costs[i]);
+            }
+        }
+    }
+  for (uint32_t index = 1; index < m_vertices.size (); index++)
+    {
+      if (before[index].first != m_vertices[index].cost
+          || before[index].second != m_vertices[index].nextHops)
+        {
+          changed.push_back (m_vertices[index].node);
+        }
+    }
+  m_fullRuns++;
+}
+
+bool
+LSSpfEngine::IncrementalRun (std::vector<uint32_t> &changed)
+{
+  if (m_pending.size () > m_fullRunFraction * m_vertices.size ())
+    {
+      return false;
+    }
+
+  // Every link with an end in a pending LSP may have changed cost
+  std::set<std::pair<uint32_t, uint32_t> > links;
+  for (std::map<uint32_t, Adjacency>::iterator iter = m_pending.begin ();
+       iter != m_pending.end (); iter++)
+    {
+      uint32_t node = iter->first;
+      std::set<uint32_t> ends;
+      uint32_t index = FindIndex (node);
+      if (index != NONE)
+        {
+          const LinkList &current = m_vertices[index].links;
+          for (LinkList::const_iterator it = current.begin (); it != current.end (); it++)
+            {
+              ends.insert (m_vertices[it->first].node);
+            }
+        }
+      for (Adjacency::iterator it = iter->second.begin (); it != iter->second.end (); it++)
+        {
+          ends.insert (it->first);
+        }
+      for (std::set<uint32_t>::iterator it = ends.begin (); it != ends.end (); it++)
+        {
+          links.insert (std::make_pair (node, *it));
+          if (node != ROOT)
+            {
+              links.insert (std::make_pair (*it, node));
+            }
+        }
+    }
+  std::vector<LinkChange> linkChanges;
+  for (std::set<std::pair<uint32_t, uint32_t> >::iterator iter = links.begin (); iter != links.end (); iter++)
+    {
+      uint32_t from = FindIndex (iter->first);
+      uint32_t to = FindIndex (iter->second);
+      LinkChange linkChange = { iter->first, iter->second,
+                                (from == NONE || to == NONE) ? INFINITE_COST : LinkCost (from, to),
+                                PendingLinkCost (iter->first, iter->second) };
+      if (linkChange.oldCost != linkChange.newCost)
+        {
+          linkChanges.push_back (linkChange);
+        }
+    }
+
+  // A node loses its label if a link on one of its shortest paths got
+  // worse, and so does everything below it in the old shortest path DAG.
+  std::set<uint32_t> affected;
+  std::vector<uint32_t> stack;
+  for (uint32_t i = 0; i < linkChanges.size (); i++)
+    {
+      LinkChange &linkChange = linkChanges[i];
+      if (linkChange.newCost < linkChange.oldCost || linkChange.oldCost == INFINITE_COST)
+        {
+          continue;
+        }
+      uint32_t from = FindIndex (linkChange.from);
+      uint32_t to = FindIndex (linkChange.to);
+      if (m_vertices[from].cost != INFINITE_COST
+          && m_vertices[from].cost + linkChange.oldCost == m_vertices[to].cost
+          && affected.insert (to).second)
+        {
+          stack.push_back (to);
+        }
+    }
+  while (!stack.empty ())
+    {
+      if (affected.size () > m_fullRunFraction * m_vertices.size ())
+        {
+          return false;
+        }
+      uint32_t from = stack.back ();
+      stack.pop_back ();
+      const LinkList &links = m_vertices[from].links;
+      for (LinkList::const_iterator iter = links.begin (); iter != links.end (); iter++)
+        {
+          uint32_t linkCost = LinkCost (from, iter->first);
+          if (linkCost != INFINITE_COST
+              && m_vertices[from].cost + linkCost == m_vertices[iter->first].cost
+              && affected.insert (iter->first).second)
+            {
+              stack.push_back (iter->first);
+            }
+        }
+    }
+
+  ApplyPending ();
+
+  LabelMap before;
+  for (std::set<uint32_t>::iterator iter = affected.begin (); iter != affected.end (); iter++)
+    {
+      Vertex &vertex = m_vertices[*iter];
+      before[*iter] = Label (vertex.cost, vertex.nextHops);
+      vertex.cost = INFINITE_COST;
+      vertex.nextHops.clear ();
+    }
+  // Re-seed the affected nodes from their unaffected neighbors
+  for (std::set<uint32_t>::iterator iter = affected.begin (); iter != affected.end (); iter++)
+    {
+      uint32_t rootCost = LinkCost (0, *iter);
+      if (rootCost != INFINITE_COST)
+        {
+          Relax (*iter, rootCost, 0, before);
+        }
+      const LinkList &links = m_vertices[*iter].links;
+      for (LinkList::const_iterator it = links.begin (); it != links.end (); it++)
+        {
+          const Vertex &from = m_vertices[it->first];
+          if (from.cost == INFINITE_COST || affected.find (it->first) != affected.end ())
+            {
+              continue;
+            }
+          uint32_t linkCost = LinkCost (it->first, *iter);
+          if (linkCost != INFINITE_COST)
+            {
+              Relax (*iter, from.cost + linkCost, it->first, before);
+            }
+        }
+    }
+  // and push improvements across links that got better
+  for (uint32_t i = 0; i < linkChanges.size (); i++)
+    {
+      LinkChange &linkChange = linkChanges[i];
+      uint32_t from = FindIndex (linkChange.from);
+      uint32_t to = FindIndex (linkChange.to);
+      if (linkChange.newCost > linkChange.oldCost || affected.find (from) != affected.end ()
+          || m_vertices[from].cost == INFINITE_COST)
+        {
+          continue;
+        }
+      Relax (to, m_vertices[from].cost + linkChange.newCost, from, before);
+    }
+  RunQueue (before);
+
+  for (LabelMap::iterator iter = before.begin (); iter != before.end (); iter++)
+    {
+      const Vertex &vertex = m_vertices[iter->first];
+      if (iter->second.first != vertex.cost || iter->second.second != vertex.nextHops)
+        {
+          changed.push_back (vertex.node);
+        }
+    }
+  m_incrementalRuns++;
+  return true;
+}
+
+void
+LSSpfEngine::Compute (std::vector<uint32_t> &changed)
+{
+  changed.clear ();
+  if (m_computed && m_pending.empty ())
+    {
+      return;
+    }
+  if (!m_computed || !m_incremental || !IncrementalRun (changed))
+    {
+      FullRun (changed);
+    }
+  m_computed = true;
+}
@@ -0,0 +1,172 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 University of Pennsylvania
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LS_SPF_ENGINE_H
+#define LS_SPF_ENGINE_H
+
+#include <stdint.h>
+#include <map>
+#include <set>
+#include <vector>
+
+/**
+ * \brief Shortest path engine over the link state database.
+ *
+ * The engine keeps the last shortest path result and updates it
+ * incrementally when LSPs or the local neighbor set change: only nodes
+ * whose shortest path ran through a changed link are recomputed.  When a
+ * change touches more than a fraction of the graph, or incremental mode
+ * is off, a full Dijkstra run is done instead.
+ *
+ * The computing router is the virtual vertex ROOT.  Its links come from
+ * the neighbor table and are used as-is, every other link is used only
+ * if both ends list each other in their LSPs.  With multipath on, a node
+ * keeps the union of the next hops of all its equal cost parents;
+ * otherwise only the lowest numbered one.  Either way the result does not
+ * depend on the order of relaxations, so incremental and full runs agree.
+ *
+ * Nodes are numbered densely in the order they are first seen, with ROOT
+ * at index 0.  Full runs compile the database into a CSR adjacency array
+ * holding only links confirmed by both ends.
+ */
+class LSSpfEngine
+{
+  public:
+    typedef std::map<uint32_t, uint32_t> Adjacency;
+
+    static const uint32_t ROOT = 0xffffffff;
+    static const uint32_t INFINITE_COST = 0xffffffff;
+
+    LSSpfEngine ();
+
+    void SetIncremental (bool incremental);
+    void SetFullRunFraction (double fraction);
+    void SetMultipath (bool multipath);
+    /**
+     * \brief Replace the links of the computing router.
+     *
+     * \param adjacency Neighbor node number to link cost.
+     */
+    void SetRootAdjacency (const Adjacency &adjacency);
+    /**
+     * \brief Replace the links advertised by node in its LSP.
+     *
+     * \param node Originator node number.
+     * \param adjacency Neighbor node number to link cost.
+     */
+    void SetLsp (uint32_t node, const Adjacency &adjacency);
+    bool IsDirty () const;
+    /**
+     * \brief Bring the shortest path result up to date with all pending changes.
+     *
+     * \param changed Filled with the nodes whose cost or next hops changed.
+     */
+    void Compute (std::vector<uint32_t> &changed);
+    /**
+     * \brief Look up the route to node.
+     *
+     * \returns false if node is unknown or unreachable.
+     */
+    bool GetRoute (uint32_t node, uint32_t &cost, uint32_t &nextHop) const;
+    /**
+     * \brief Look up all equal cost next hops to node, in ascending order.
+     *
+     * \returns false if node is unknown or unreachable.
+     */
+    bool GetRoute (uint32_t node, uint32_t &cost, std::vector<uint32_t> &nextHops) const;
+    uint32_t GetNodeCount () const;
+    uint32_t GetFullRuns () const;
+    uint32_t GetIncrementalRuns () const;
+
+  private:
+    // (dense index of the far end, cost), sorted by index
+    typedef std::vector<std::pair<uint32_t, uint32_t> > LinkList;
+    struct Vertex
+    {
+      uint32_t node;
+      LinkList links;
+      bool hasLsp;
+      uint32_t cost;
+      // Sorted, a single entry unless multipath is on
+      std::vector<uint32_t> nextHops;
+    };
+    struct LinkChange
+    {
+      uint32_t from;
+      uint32_t to;
+      uint32_t oldCost;
+      uint32_t newCost;
+    };
+    typedef std::pair<uint32_t, std::vector<uint32_t> > Label;
+    typedef std::map<uint32_t, Label> LabelMap;
+
+    /**
+     * \brief Binary min-heap of dense vertex indices keyed by cost, with decrease-key.
+     */
+    class IndexedHeap
+    {
+      public:
+        void Resize (uint32_t size);
+        bool IsEmpty () const;
+        /**
+         * \brief Insert index, or lower its key if it is already queued.
+         */
+        void Push (uint32_t index, uint32_t key);
+        uint32_t Pop ();
+      private:
+        void Swap (uint32_t i, uint32_t j);
+        void SiftUp (uint32_t i);
+        void SiftDown (uint32_t i);
+        // (key, index)
+        std::vector<std::pair<uint32_t, uint32_t> > m_heap;
+        std::vector<uint32_t> m_position;
+    };
+
+    static const uint32_t NONE = 0xffffffff;
+
+    uint32_t FindIndex (uint32_t node) const;
+    uint32_t GetIndex (uint32_t node);
+    uint32_t LinkCost (uint32_t from, uint32_t to) const;
+    uint32_t PendingLinkCost (uint32_t fromNode, uint32_t toNode) const;
+    const Adjacency *FindPending (uint32_t node) const;
+    bool AddNextHop (Vertex &vertex, uint32_t nextHop);
+    bool Improve (uint32_t index, uint32_t cost, uint32_t from);
+    void ApplyPending ();
+    void CompileGraph ();
+    void Relax (uint32_t index, uint32_t cost, uint32_t from, LabelMap &before);
+    void RunQueue (LabelMap &before);
+    void FullRun (std::vector<uint32_t> &changed);
+    bool IncrementalRun (std::vector<uint32_t> &changed);
+
+    std::vector<Vertex> m_vertices;
+    std::map<uint32_t, uint32_t> m_index;
+    std::map<uint32_t, Adjacency> m_pending;
+    // CSR form of the confirmed links, rebuilt for full runs
+    std::vector<uint32_t> m_offsets;
+    std::vector<uint32_t> m_targets;
+    std::vector<uint32_t> m_costs;
+    IndexedHeap m_heap;
+    bool m_incremental;
+    bool m_multipath;
+    bool m_computed;
+    double m_fullRunFraction;
+    uint32_t m_fullRuns;
+    uint32_t m_incrementalRuns;
+};
+
+#endif
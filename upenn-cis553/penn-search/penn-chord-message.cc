@@ -80,7 +80,8 @@ PennChordMessage::GetSerializedSize (void) const
       case NOTIFY:
          break;
       case STABILIZE_REQ:
-         break;
+        size += m_message.stabilizeReq.GetSerializedSize();
+        break;
       case STABILIZE_RESP:
         size += m_message.stabilizeResp.GetSerializedSize();
         break;
@@ -105,6 +106,9 @@ PennChordMessage::GetSerializedSize (void) const
       case LOOKUP_PUBLISH_SUCCESS:
         size += m_message.lookupPublishSuccess.GetSerializedSize();
         break;
+      case MEMBERSHIP:
+        size += m_message.membership.GetSerializedSize();
+        break;
       default:
         NS_ASSERT (false);
     }
@@ -136,6 +140,9 @@ PennChordMessage::Print (std::ostream &os) const
       case JOIN_CHORD_SUCCESS:
         m_message.joinChordSuccess.Print(os);
         break;
+      case STABILIZE_REQ:
+        m_message.stabilizeReq.Print(os);
+        break;
       case STABILIZE_RESP:
         m_message.stabilizeResp.Print(os);
         break;
@@ -160,6 +167,9 @@ PennChordMessage::Print (std::ostream &os) const
       case LOOKUP_PUBLISH_SUCCESS:
         m_message.lookupPublishSuccess.Print(os);
         break;
+      case MEMBERSHIP:
+        m_message.membership.Print(os);
+        break;
       default:
         break;  
     }
@@ -195,6 +205,7 @@ PennChordMessage::Serialize (Buffer::Iterator start) const
       case NOTIFY:
         break;
       case STABILIZE_REQ:
+        m_message.stabilizeReq.Serialize(i);
         break;
       case STABILIZE_RESP:
         m_message.stabilizeResp.Serialize(i);
@@ -220,6 +231,9 @@ PennChordMessage::Serialize (Buffer::Iterator start) const
       case LOOKUP_PUBLISH_SUCCESS:
         m_message.lookupPublishSuccess.Serialize(i);
         break;
+      case MEMBERSHIP:
+        m_message.membership.Serialize(i);
+        break;
       default:
         NS_ASSERT (false);   
     }
@@ -257,6 +271,7 @@ PennChordMessage::Deserialize (Buffer::Iterator start)
       case NOTIFY:
         break;
       case STABILIZE_REQ:
+        size += m_message.stabilizeReq.Deserialize(i);
         break;
       case STABILIZE_RESP:
         size += m_message.stabilizeResp.Deserialize(i);
@@ -282,6 +297,9 @@ PennChordMessage::Deserialize (Buffer::Iterator start)
       case LOOKUP_PUBLISH_SUCCESS:
         size += m_message.lookupPublishSuccess.Deserialize(i);
         break;
+      case MEMBERSHIP:
+        size += m_message.membership.Deserialize(i);
+        break;
       default:
         NS_ASSERT (false);
     }
@@ -528,13 +546,69 @@ PennChordMessage::GetJoinChordSuccess ()
   return m_message.joinChordSuccess;
 }
 
+/* STABILIZE_REQ */
+
+uint32_t
+PennChordMessage::StabilizeReq::GetSerializedSize (void) const
+{
+  uint32_t size;
+  size = sizeof(uint8_t) + sizeof(uint8_t) + sizeof(uint32_t);
+  return size;
+}
+
+void
+PennChordMessage::StabilizeReq::Print (std::ostream &os) const
+{
+  os << "Notify : " << (uint16_t) notify << " Finger Hints : " << (uint16_t) fingerHints << "\n";
+}
+
+void
+PennChordMessage::StabilizeReq::Serialize (Buffer::Iterator &start) const
+{
+  start.WriteU8 (notify);
+  start.WriteU8 (fingerHints);
+  start.WriteHtonU32 (hintsChecksum);
+}
+
+uint32_t
+PennChordMessage::StabilizeReq::Deserialize (Buffer::Iterator &start)
+{
+  notify = start.ReadU8 ();
+  fingerHints = start.ReadU8 ();
+  hintsChecksum = start.ReadNtohU32 ();
+  return StabilizeReq::GetSerializedSize ();
+}
+
+void
+PennChordMessage::SetStabilizeReq (uint8_t notify, uint8_t fingerHints, uint32_t hintsChecksum)
+{
+  if (m_messageType == 0)
+    {
+      m_messageType = STABILIZE_REQ;
+    }
+  else
+    {
+      NS_ASSERT (m_messageType = STABILIZE_REQ);
+    }
+  m_message.stabilizeReq.notify = notify;
+  m_message.stabilizeReq.fingerHints = fingerHints;
+  m_message.stabilizeReq.hintsChecksum = hintsChecksum;
+}
+
+PennChordMessage::StabilizeReq
+PennChordMessage::GetStabilizeReq ()
+{
+  return m_message.stabilizeReq;
+}
+
 /* STABILIZE_RESP */
 
 uint32_t
 PennChordMessage::StabilizeResp::GetSerializedSize (void) const
 {
   uint32_t size;
-  size = IPV4_ADDRESS_SIZE ;
+  size = IPV4_ADDRESS_SIZE + sizeof(uint8_t) + successorList.size () * IPV4_ADDRESS_SIZE
+         + sizeof(uint8_t) + fingerHints.size () * (sizeof(uint16_t) + IPV4_ADDRESS_SIZE);
   return size;
 }
 
@@ -542,23 +616,65 @@ void
 PennChordMessage::StabilizeResp::Print (std::ostream &os) const
 {
   os << "Predecessor Address : " << predecessorAddress << "\n";
+  os << "Successor List :";
+  for (std::vector<Ipv4Address>::const_iterator iter = successorList.begin (); iter != successorList.end (); iter++)
+    {
+      os << " " << *iter;
+    }
+  os << "\n";
+  os << "Finger Hints :";
+  for (std::map<uint16_t, Ipv4Address>::const_iterator iter = fingerHints.begin (); iter != fingerHints.end (); iter++)
+    {
+      os << " " << iter->first << ":" << iter->second;
+    }
+  os << "\n";
 }
 
 void
 PennChordMessage::StabilizeResp::Serialize (Buffer::Iterator &start) const
 {
   start.WriteHtonU32 (predecessorAddress.Get());
+  start.WriteU8 (successorList.size ());
+  for (std::vector<Ipv4Address>::const_iterator iter = successorList.begin (); iter != successorList.end (); iter++)
+    {
+      start.WriteHtonU32 (iter->Get ());
+    }
+  start.WriteU8 (fingerHints.size ());
+  for (std::map<uint16_t, Ipv4Address>::const_iterator iter = fingerHints.begin (); iter != fingerHints.end (); iter++)
+    {
+      start.WriteHtonU16 (iter->first);
+      start.WriteHtonU32 (iter->second.Get ());
+    }
 }
 
 uint32_t
 PennChordMessage::StabilizeResp::Deserialize (Buffer::Iterator &start)
 {
   predecessorAddress = Ipv4Address (start.ReadNtohU32());
+  successorList.clear ();
+  uint8_t successors = start.ReadU8 ();
+  for (uint8_t j = 0; j < successors; j++)
+    {
+      successorList.push_back (Ipv4Address (start.ReadNtohU32 ()));
+    }
+  fingerHints.clear ();
+  uint8_t hints = start.ReadU8 ();
+  for (uint8_t j = 0; j < hints; j++)
+    {
+      uint16_t index = start.ReadNtohU16 ();
+      fingerHints[index] = Ipv4Address (start.ReadNtohU32 ());
+    }
   return StabilizeResp::GetSerializedSize ();
 }
 
 void
 PennChordMessage::SetStabilizeResp (Ipv4Address predecessorAddr)
+{
+  SetStabilizeResp (predecessorAddr, std::vector<Ipv4Address> (), std::map<uint16_t, Ipv4Address> ());
+}
+
+void
+PennChordMessage::SetStabilizeResp (Ipv4Address predecessorAddr, std::vector<Ipv4Address> successorList, std::map<uint16_t, Ipv4Address> fingerHints)
 {
   if (m_messageType == 0)
     {
@@ -569,6 +685,8 @@ PennChordMessage::SetStabilizeResp (Ipv4Address predecessorAddr)
       NS_ASSERT (m_messageType = STABILIZE_RESP);
     }
   m_message.stabilizeResp.predecessorAddress = predecessorAddr;
+  m_message.stabilizeResp.successorList = successorList;
+  m_message.stabilizeResp.fingerHints = fingerHints;
 }
 
 PennChordMessage::StabilizeResp
@@ -785,7 +903,7 @@ uint32_t
 PennChordMessage::FindFingerSuccess::GetSerializedSize (void) const
 {
   uint32_t size;
-  size = IPV4_ADDRESS_SIZE +  sizeof(uint16_t);
+  size = IPV4_ADDRESS_SIZE +  sizeof(uint16_t) + sizeof(uint8_t) + candidates.size () * IPV4_ADDRESS_SIZE;
   return size;
 }
 
@@ -800,6 +918,11 @@ PennChordMessage::FindFingerSuccess::Serialize (Buffer::Iterator &start) const
 {
   start.WriteHtonU32 (fingerAddress.Get());
   start.WriteU16 (fingerIndex);
+  start.WriteU8 (candidates.size ());
+  for (std::vector<Ipv4Address>::const_iterator iter = candidates.begin (); iter != candidates.end (); iter++)
+    {
+      start.WriteHtonU32 (iter->Get ());
+    }
 }
 
 uint32_t
@@ -807,11 +930,23 @@ PennChordMessage::FindFingerSuccess::Deserialize (Buffer::Iterator &start)
 {
     fingerAddress = Ipv4Address (start.ReadNtohU32());
     fingerIndex = start.ReadU16();
+    candidates.clear ();
+    uint8_t count = start.ReadU8 ();
+    for (uint8_t j = 0; j < count; j++)
+      {
+        candidates.push_back (Ipv4Address (start.ReadNtohU32 ()));
+      }
     return FindFingerSuccess::GetSerializedSize ();
 }
 
 void
 PennChordMessage::SetFindFingerSuccess (Ipv4Address fingerAddr, uint16_t fingerInd)
+{
+  SetFindFingerSuccess (fingerAddr, fingerInd, std::vector<Ipv4Address> ());
+}
+
+void
+PennChordMessage::SetFindFingerSuccess (Ipv4Address fingerAddr, uint16_t fingerInd, std::vector<Ipv4Address> candidates)
 {
   if (m_messageType == 0)
     {
@@ -823,6 +958,7 @@ PennChordMessage::SetFindFingerSuccess (Ipv4Address fingerAddr, uint16_t fingerI
     }
   m_message.findFingerSuccess.fingerAddress = fingerAddr;
   m_message.findFingerSuccess.fingerIndex = fingerInd;
+  m_message.findFingerSuccess.candidates = candidates;
 }
 
 PennChordMessage::FindFingerSuccess
@@ -954,6 +1090,75 @@ PennChordMessage::GetLookupPublishSuccess ()
   return m_message.lookupPublishSuccess;
 }
 
+/*MEMBERSHIP*/
+
+uint32_t
+PennChordMessage::Membership::GetSerializedSize (void) const
+{
+  uint32_t size;
+  size = sizeof(uint16_t) + events.size () * (IPV4_ADDRESS_SIZE + sizeof(uint32_t) + sizeof(uint8_t));
+  return size;
+}
+
+void
+PennChordMessage::Membership::Print (std::ostream &os) const
+{
+  os << "Membership Events :";
+  for (std::vector<MemberEvent>::const_iterator iter = events.begin (); iter != events.end (); iter++)
+    {
+      os << " " << (iter->joined ? "+" : "-") << iter->memberAddress << "/" << iter->sequence;
+    }
+  os << "\n";
+}
+
+void
+PennChordMessage::Membership::Serialize (Buffer::Iterator &start) const
+{
+  start.WriteHtonU16 (events.size ());
+  for (std::vector<MemberEvent>::const_iterator iter = events.begin (); iter != events.end (); iter++)
+    {
+      start.WriteHtonU32 (iter->memberAddress.Get ());
+      start.WriteHtonU32 (iter->sequence);
+      start.WriteU8 (iter->joined);
+    }
+}
+
+uint32_t
+PennChordMessage::Membership::Deserialize (Buffer::Iterator &start)
+{
+  events.clear ();
+  uint16_t count = start.ReadNtohU16 ();
+  for (uint16_t j = 0; j < count; j++)
+    {
+      MemberEvent event;
+      event.memberAddress = Ipv4Address (start.ReadNtohU32 ());
+      event.sequence = start.ReadNtohU32 ();
+      event.joined = start.ReadU8 ();
+      events.push_back (event);
+    }
+  return Membership::GetSerializedSize ();
+}
+
+void
+PennChordMessage::SetMembership (std::vector<MemberEvent> events)
+{
+  if (m_messageType == 0)
+    {
+      m_messageType = MEMBERSHIP;
+    }
+  else
+    {
+      NS_ASSERT (m_messageType = MEMBERSHIP);
+    }
+  m_message.membership.events = events;
+}
+
+PennChordMessage::Membership
+PennChordMessage::GetMembership ()
+{
+  return m_message.membership;
+}
+
 
 
 
@@ -21,6 +21,8 @@
 #include "ns3/ipv4-address.h"
 #include "ns3/packet.h"
 #include "ns3/object.h"
+#include <map>
+#include <vector>
 
 using namespace ns3;
 
@@ -50,7 +52,8 @@ class PennChordMessage : public Header
 	FIND_FINGER = 13,
 	FIND_FINGER_SUCCESS = 14,
 	LOOKUP_PUBLISH = 15,
-	LOOKUP_PUBLISH_SUCCESS = 16
+	LOOKUP_PUBLISH_SUCCESS = 16,
+	MEMBERSHIP = 17
         // Define extra message types when needed       
       };
 
@@ -146,6 +149,22 @@ class PennChordMessage : public Header
         Ipv4Address successorAddress;
       };
 
+    struct StabilizeReq
+      {
+    void Print (std::ostream &os) const;
+    uint32_t GetSerializedSize (void) const;
+    void Serialize (Buffer::Iterator &start) const;
+    uint32_t Deserialize (Buffer::Iterator &start);
+    //Payload
+        // Sender is offering itself as predecessor (piggybacked NOTIFY)
+        uint8_t notify;
+        // Sender wants finger hints in the response
+        uint8_t fingerHints;
+        // Checksum of the finger hints the sender got last, the response
+        // leaves the hints out while they stay the same
+        uint32_t hintsChecksum;
+      };
+
     struct StabilizeResp
       {
     void Print (std::ostream &os) const;
@@ -154,6 +173,9 @@ class PennChordMessage : public Header
     uint32_t Deserialize (Buffer::Iterator &start);
     //Payload
         Ipv4Address predecessorAddress;
+        std::vector<Ipv4Address> successorList;
+        // Finger index -> node, only where the node changes from the previous index
+        std::map<uint16_t, Ipv4Address> fingerHints;
       };
 
     struct Ringstate
@@ -203,6 +225,8 @@ class PennChordMessage : public Header
       //Payload
       Ipv4Address fingerAddress;
       uint16_t fingerIndex;
+      // Other nodes of the finger interval, alternatives for proximity selection
+      std::vector<Ipv4Address> candidates;
     };
   struct LookupPublish
       {
@@ -227,6 +251,22 @@ class PennChordMessage : public Header
 	std::string lookupKey;
 	Ipv4Address addressResponsible;
       };
+  struct MemberEvent
+      {
+	Ipv4Address memberAddress;
+	// Incarnation of the member, the time it joined in milliseconds
+	uint32_t sequence;
+	uint8_t joined;
+      };
+  struct Membership
+      {
+	void Print (std::ostream &os) const;
+	uint32_t GetSerializedSize (void) const;
+	void Serialize (Buffer::Iterator &start) const;
+	uint32_t Deserialize (Buffer::Iterator &start);
+	//Payload
+	std::vector<MemberEvent> events;
+      };
   
 
     
@@ -238,6 +278,7 @@ class PennChordMessage : public Header
         JoinChord joinChord;
         FindSuccessor findSuccessor;
         JoinChordSuccess joinChordSuccess;
+        StabilizeReq stabilizeReq;
         StabilizeResp stabilizeResp;
         Ringstate ringstate;
         LeaveSuccessor leaveSuccessor;
@@ -246,6 +287,7 @@ class PennChordMessage : public Header
 	FindFingerSuccess findFingerSuccess;
 	LookupPublish lookupPublish;
 	LookupPublishSuccess lookupPublishSuccess;
+	Membership membership;
       } m_message;
     
   public:
@@ -277,7 +319,11 @@ class PennChordMessage : public Header
     void SetJoinChordSuccess (Ipv4Address successorAddr);
     JoinChordSuccess GetJoinChordSuccess ();
 
+    void SetStabilizeReq (uint8_t notify, uint8_t fingerHints, uint32_t hintsChecksum = 0);
+    StabilizeReq GetStabilizeReq ();
+
     void SetStabilizeResp (Ipv4Address predecessorAddr);
+    void SetStabilizeResp (Ipv4Address predecessorAddr, std::vector<Ipv4Address> successorList, std::map<uint16_t, Ipv4Address> fingerHints);
     StabilizeResp GetStabilizeResp ();
 
     void SetRingstate (Ipv4Address initiatorAddr);
@@ -293,6 +339,7 @@ class PennChordMessage : public Header
     FindFinger GetFindFinger ();
     
     void SetFindFingerSuccess (Ipv4Address fingerAddr, uint16_t fingerInd);
+    void SetFindFingerSuccess (Ipv4Address fingerAddr, uint16_t fingerInd, std::vector<Ipv4Address> candidates);
     FindFingerSuccess GetFindFingerSuccess ();
     
     void SetLookupPublish (uint16_t flag, Ipv4Address initiatorAddr, unsigned char *lookupDig, std::string lookupKey);
@@ -301,6 +348,9 @@ class PennChordMessage : public Header
     void SetLookupPublishSuccess (uint16_t flag, Ipv4Address addressResp, std::string lookupKey);
     LookupPublishSuccess GetLookupPublishSuccess ();
 
+    void SetMembership (std::vector<MemberEvent> events);
+    Membership GetMembership ();
+
 
 }; // class PennChordMessage
 
@@ -21,11 +21,24 @@
 
 #include "ns3/random-variable.h"
 #include "ns3/inet-socket-address.h"
+#include <algorithm>
 
 using namespace ns3;
 
+// Registered up front so that --PennChord::<attribute> works on the command line
+NS_OBJECT_ENSURE_REGISTERED (PennChord);
+
 float PennChord::globalHopCount = 0;
 float PennChord::globalQueryCount = 0;
+uint32_t PennChord::globalControlCount = 0;
+uint64_t PennChord::globalControlBytes = 0;
+uint32_t PennChord::globalNodeCount = 0;
+float PennChord::globalStretchSum = 0;
+float PennChord::globalStretchCount = 0;
+float PennChord::globalLatencySum = 0;
+float PennChord::globalLatencyCount = 0;
+std::vector<float> PennChord::globalLatencies;
+const std::string PennChord::proximityProbe = "PROXIMITY_PROBE";
 
 TypeId
 PennChord::GetTypeId ()
@@ -43,6 +56,11 @@ PennChord::GetTypeId ()
                    TimeValue (MilliSeconds (2000)),
                    MakeTimeAccessor (&PennChord::m_pingTimeout),
                    MakeTimeChecker ())
+    .AddAttribute ("LookupTimeout",
+                   "Lookups of ReportStretch and ReportLatency unanswered for this long are dropped",
+                   TimeValue (MilliSeconds (10000)),
+                   MakeTimeAccessor (&PennChord::m_lookupTimeout),
+                   MakeTimeChecker ())
     .AddAttribute ("StabilizePeriod",
                    "Timeout value for Stabilize in milliseconds",
                    TimeValue (MilliSeconds (5000)),
@@ -53,17 +71,60 @@ PennChord::GetTypeId ()
                    TimeValue (MilliSeconds (8000)),
                    MakeTimeAccessor (&PennChord::m_fixFingerTimeout),
                    MakeTimeChecker ())
+    .AddAttribute ("CoalesceStabilize",
+                   "Piggyback notify, successor list and finger hints on stabilize messages",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&PennChord::m_coalesceStabilize),
+                   MakeBooleanChecker ())
+    .AddAttribute ("SuccessorListLength",
+                   "Number of successors carried in STABILIZE_RESP",
+                   UintegerValue (3),
+                   MakeUintegerAccessor (&PennChord::m_successorListLength),
+                   MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("FingerAuditPeriod",
+                   "Timeout value for verifying hinted fingers with FIND_FINGER in milliseconds",
+                   TimeValue (MilliSeconds (60000)),
+                   MakeTimeAccessor (&PennChord::m_fingerAuditTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("MaxStabilizeMisses",
+                   "Unanswered STABILIZE_REQs before the successor is declared failed",
+                   UintegerValue (3),
+                   MakeUintegerAccessor (&PennChord::m_maxStabilizeMisses),
+                   MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("OneHopRouting",
+                   "Keep the full membership and resolve lookups in one hop, "
+                   "less traffic than fingers while the ring changes less than once per 30 to 75 s",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&PennChord::m_oneHopRouting),
+                   MakeBooleanChecker ())
+    .AddAttribute ("ProximityFingers",
+                   "Pick the lowest RTT node valid for each finger interval",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&PennChord::m_proximityFingers),
+                   MakeBooleanChecker ())
+    .AddAttribute ("ProximityCandidates",
+                   "Nodes of the finger interval offered by FIND_FINGER_SUCCESS to ProximityFingers",
+                   UintegerValue (16),
+                   MakeUintegerAccessor (&PennChord::m_proximityCandidates),
+                   MakeUintegerChecker<uint8_t> ())
+    .AddAttribute ("ReportStretch",
+                   "Report lookup latency, and probe lookup responders to report overlay over direct latency",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&PennChord::m_reportStretch),
+                   MakeBooleanChecker ())
+    .AddAttribute ("ReportLatency",
+                   "Record the latency of every lookup, without the probes of ReportStretch",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&PennChord::m_reportLatency),
+                   MakeBooleanChecker ())
         ;
   return tid;
 }
 
 PennChord::PennChord ()
-  : m_auditPingsTimer (Timer::CANCEL_ON_DESTROY)
+  : m_random ("PennChord"),
+    m_auditPingsTimer (Timer::CANCEL_ON_DESTROY)
 {
-  RandomVariable random;
-  SeedManager::SetSeed (time (NULL));
-  random = UniformVariable (0x00000000, 0xFFFFFFFF);
-  m_currentTransactionId = random.GetInteger ();
 }
 
 PennChord::~PennChord ()
@@ -81,6 +142,8 @@ PennChord::DoDispose ()
 void
 PennChord::StartApplication (void)
 {
+  m_random.SetNode (GetNode ()->GetId ());
+  m_currentTransactionId = m_random.GetInteger (0, 0xFFFFFFFF);
   if (m_socket == 0)
     { 
       TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
@@ -95,6 +158,14 @@ PennChord::StartApplication (void)
   SHA_1(m_localAddress, m_localDigest);
   SetSuccessorAddress (Ipv4Address::GetAny());
   SetPredecessorAddress (Ipv4Address::GetAny());
+  m_successorList.clear ();
+  m_stabilizeMisses = 0;
+  m_memberState.clear ();
+  m_memberRing.clear ();
+  m_rttTable.clear ();
+  m_lookupTracker.clear ();
+  m_pendingStretch.clear ();
+  PennStatsAdd (PennChord::globalNodeCount, 1);
 
   // Configure timers
   m_auditPingsTimer.SetFunction (&PennChord::AuditPings, this);
@@ -119,6 +190,19 @@ PennChord::StopApplication (void)
     }
 
   PRINT_LOG("------------------Average Hop Count ="<< (PennChord::globalHopCount/PennChord::globalQueryCount)<<"------------------");
+  double periods = Simulator::Now ().GetSeconds () / m_stabilizeTimeout.GetSeconds ();
+  if (PennChord::globalNodeCount > 0 && periods > 0)
+    {
+      PRINT_LOG("------------------Control Packets Per Node Per Stabilize Period ="<< (PennChord::globalControlCount / (PennChord::globalNodeCount * periods))<<"------------------");
+    }
+  if (PennChord::globalStretchCount > 0)
+    {
+      PRINT_LOG("------------------Average Lookup Stretch ="<< (PennChord::globalStretchSum/PennChord::globalStretchCount)<<"------------------");
+    }
+  if (PennChord::globalLatencyCount > 0)
+    {
+      PRINT_LOG("------------------Average Lookup Latency ="<< (PennChord::globalLatencySum/PennChord::globalLatencyCount)<<" ms------------------");
+    }
 
   // Cancel timers
   m_auditPingsTimer.Cancel ();
@@ -151,6 +235,10 @@ PennChord::ProcessCommand (std::vector<std::string> tokens)
       m_chordStatus=1;
       SetSuccessorAddress(m_localAddress);
       SetPredecessorAddress(Ipv4Address::GetAny());
+      if (m_oneHopRouting)
+      {
+        AnnounceMembership (m_localAddress, true);
+      }
       CHORD_LOG ("Chord is created with a landmark node: " << nodeId );
     }
 
@@ -189,8 +277,15 @@ PennChord::ProcessCommand (std::vector<std::string> tokens)
           SetSuccessorAddress (Ipv4Address::GetAny());
           SetPredecessorAddress (Ipv4Address::GetAny());
           m_fingerTable.clear();
+          m_successorList.clear();
+          m_memberState.clear();
+          m_memberRing.clear();
           return;
       }
+      if (m_oneHopRouting)
+      {
+          AnnounceMembership (m_localAddress, false);
+      }
       uint32_t stransactionId = GetNextTransactionId ();
       Ptr<Packet> spacket = Create<Packet> ();
       PennChordMessage smessage = PennChordMessage (PennChordMessage::LEAVE_SUCCESSOR, stransactionId);
@@ -214,6 +309,9 @@ PennChord::ProcessCommand (std::vector<std::string> tokens)
       SetSuccessorAddress (Ipv4Address::GetAny());
       SetPredecessorAddress (Ipv4Address::GetAny());
       m_fingerTable.clear();
+      m_successorList.clear();
+      m_memberState.clear();
+      m_memberRing.clear();
   }
   if (command == "RINGSTATE")
   {
@@ -241,6 +339,14 @@ PennChord::ProcessCommand (std::vector<std::string> tokens)
           PRINT_LOG ("\t"<<"Index : "<<DisplayHEX(indexHash)<<" Successor : "<< ReverseLookup(iter->second));
       }
   }
+  if (command == "DUMP")
+  {
+      CHORD_LOG("-------------Membership of "<<DisplayHEX(m_localDigest));
+      for (std::map<Ipv4Address, MemberState>::iterator iter = m_memberState.begin();iter!=m_memberState.end();iter++)
+      {
+          PRINT_LOG ("\t"<<"Member : "<<ReverseLookup(iter->first)<<" Sequence : "<<iter->second.sequence<<" Alive : "<<iter->second.alive);
+      }
+  }
 
 }
 
@@ -328,6 +434,9 @@ PennChord::RecvMessage (Ptr<Socket> socket)
       case PennChordMessage::LOOKUP_PUBLISH_SUCCESS:
         ProcessLookupPublishSuccess (message, sourceAddress, sourcePort);
         break;
+      case PennChordMessage::MEMBERSHIP:
+        ProcessMembership (message, sourceAddress, sourcePort);
+        break;
       default:
         ERROR_LOG ("Unknown Message Type!");
         break;
@@ -337,10 +446,12 @@ PennChord::RecvMessage (Ptr<Socket> socket)
 void
 PennChord::ProcessPingReq (PennChordMessage message, Ipv4Address sourceAddress, uint16_t sourcePort)
 {
+    bool probe = (message.GetPingReq().pingMessage == proximityProbe);
 
     // Use reverse lookup for ease of debug
     std::string fromNode = ReverseLookup (sourceAddress);
-    CHORD_LOG ("Received PING_REQ, From Node: " << fromNode << ", Message: " << message.GetPingReq().pingMessage);
+    if (!probe)
+      CHORD_LOG ("Received PING_REQ, From Node: " << fromNode << ", Message: " << message.GetPingReq().pingMessage);
     // Send Ping Response
     PennChordMessage resp = PennChordMessage (PennChordMessage::PING_RSP, message.GetTransactionId());
     resp.SetPingRsp (message.GetPingReq().pingMessage);
@@ -348,7 +459,8 @@ PennChord::ProcessPingReq (PennChordMessage message, Ipv4Address sourceAddress,
     packet->AddHeader (resp);
     m_socket->SendTo (packet, 0 , InetSocketAddress (sourceAddress, sourcePort));
     // Send indication to application layer
-    m_pingRecvFn (sourceAddress, message.GetPingReq().pingMessage);
+    if (!probe)
+      m_pingRecvFn (sourceAddress, message.GetPingReq().pingMessage);
 }
 
 void
@@ -357,7 +469,28 @@ PennChord::ProcessPingRsp (PennChordMessage message, Ipv4Address sourceAddress,
   // Remove from pingTracker
   std::map<uint32_t, Ptr<PingRequest> >::iterator iter;
   iter = m_pingTracker.find (message.GetTransactionId ());
-  if (iter != m_pingTracker.end ())
+  if (iter != m_pingTracker.end () && iter->second->GetPingMessage () == proximityProbe)
+    {
+      Time rtt = Simulator::Now () - iter->second->GetTimestamp ();
+      m_rttTable[sourceAddress] = rtt;
+      m_pingTracker.erase (iter);
+      if (m_proximityFingers)
+        {
+          AdoptProximityFinger (sourceAddress, rtt);
+        }
+      // Settle the lookups that were waiting for the direct latency
+      std::map<Ipv4Address, std::vector<Time> >::iterator pending = m_pendingStretch.find (sourceAddress);
+      if (pending != m_pendingStretch.end ())
+        {
+          std::vector<Time> latencies = pending->second;
+          m_pendingStretch.erase (pending);
+          for (std::vector<Time>::iterator latency = latencies.begin (); latency != latencies.end (); latency++)
+            {
+              RecordLookupStretch (sourceAddress, *latency);
+            }
+        }
+    }
+  else if (iter != m_pingTracker.end ())
     {
       std::string fromNode = ReverseLookup (sourceAddress);
       CHORD_LOG ("Received PING_RSP, From Node: " << fromNode << ", Message: " << message.GetPingRsp().pingMessage);
@@ -383,6 +516,11 @@ PennChord::AuditPings ()
           DEBUG_LOG ("Ping expired. Message: " << pingRequest->GetPingMessage () << " Timestamp: " << pingRequest->GetTimestamp().GetMilliSeconds () << " CurrentTime: " << Simulator::Now().GetMilliSeconds ());
           // Remove stale entries
           m_pingTracker.erase (iter++);
+          if (pingRequest->GetPingMessage () == proximityProbe)
+            {
+              m_pendingStretch.erase (pingRequest->GetDestinationAddress ());
+              continue;
+            }
           // Send indication to application layer
           m_pingFailureFn (pingRequest->GetDestinationAddress(), pingRequest->GetPingMessage ());
         }
@@ -391,6 +529,19 @@ PennChord::AuditPings ()
           ++iter;
         }
     }
+  // Lookups lost with a failed node are never answered
+  std::map<uint32_t, Time>::iterator lookup;
+  for (lookup = m_lookupTracker.begin (); lookup != m_lookupTracker.end ();)
+    {
+      if (lookup->second + m_lookupTimeout <= Simulator::Now ())
+        {
+          m_lookupTracker.erase (lookup++);
+        }
+      else
+        {
+          ++lookup;
+        }
+    }
   // Rechedule timer
   m_auditPingsTimer.Schedule (m_pingTimeout); 
 }
@@ -501,6 +652,10 @@ PennChord::ProcessJoinChordSuccess (PennChordMessage message, Ipv4Address source
     SetPredecessorAddress (Ipv4Address::GetAny ());
     //CHORD_LOG ("PREDECESSOR: " << m_predecessorAddr << " SUCCESSOR " << m_successorAddr);
     SendNotify(message, m_successorAddr,sourcePort);
+    if (m_oneHopRouting)
+    {
+        AnnounceMembership (m_localAddress, true);
+    }
 }
 
 void
@@ -518,6 +673,8 @@ PennChord::SendNotify(PennChordMessage message, Ipv4Address destAddr, int16_t so
     PennChordMessage newMessage = PennChordMessage (PennChordMessage::NOTIFY,message.GetTransactionId());
     packet->AddHeader (newMessage);
     m_socket->SendTo (packet, 0 , InetSocketAddress (destAddr,sourcePort));
+    PennStatsAdd (PennChord::globalControlCount, 1);
+    PennStatsAdd (PennChord::globalControlBytes, packet->GetSize ());
 }
 
 void
@@ -557,13 +714,31 @@ PennChord::Stabilize()
 {
     if (m_chordStatus==1 && m_successorAddr != m_localAddress)
           {
+            // Fail over to the next entry of the successor list once the successor stops answering
+            if (m_stabilizeMisses >= m_maxStabilizeMisses && m_successorList.size () > 1)
+            {
+                Ipv4Address failedAddr = m_successorAddr;
+                m_successorList.erase (m_successorList.begin ());
+                SetSuccessorAddress (m_successorList.front ());
+                m_fingerTable[1] = m_successorAddr;
+                m_stabilizeMisses = 0;
+                CHORD_LOG ("Successor " << ReverseLookup(failedAddr) << " failed, new successor: " << ReverseLookup(m_successorAddr));
+                if (m_oneHopRouting)
+                {
+                    AnnounceMembership (failedAddr, false);
+                }
+            }
+            m_stabilizeMisses++;
             uint32_t transactionId = GetNextTransactionId ();
             //CHORD_LOG ("PREDECESSOR: " << m_predecessorAddr << " SUCCESSOR " << m_successorAddr);
             //CHORD_LOG ("Sending STABILIZE_REQ to Node: " << ReverseLookup(m_successorAddr) << " IP: " << m_successorAddr << " transactionId: " << transactionId);
             Ptr<Packet> packet = Create<Packet> ();
             PennChordMessage newmessage = PennChordMessage (PennChordMessage::STABILIZE_REQ, transactionId);
+            newmessage.SetStabilizeReq (m_coalesceStabilize, m_coalesceStabilize, m_fingerHintsChecksum);
             packet->AddHeader (newmessage);
             m_socket->SendTo (packet, 0 , InetSocketAddress (m_successorAddr, m_appPort));
+            PennStatsAdd (PennChord::globalControlCount, 1);
+            PennStatsAdd (PennChord::globalControlBytes, packet->GetSize ());
 
           }
     // Reschedule Timer
@@ -575,15 +750,40 @@ PennChord::Stabilize()
 void
 PennChord::ProcessStabilizeReq (PennChordMessage message, Ipv4Address sourceAddress, int16_t sourcePort)
 {
+    // Coalesced requests double as NOTIFY, a repeat from the current predecessor is a no-op
+    if (message.GetStabilizeReq().notify && sourceAddress != m_predecessorAddr)
+    {
+        ProcessNotify (message, sourceAddress, sourcePort);
+    }
     if(m_predecessorAddr != Ipv4Address::GetAny())
     {
         //CHORD_LOG ("Recieved STABILIZE_REQ from Node: " << ReverseLookup(sourceAddress) << " IP: " << sourceAddress << " transactionId: " << message.GetTransactionId());
         //CHORD_LOG ("PREDECESSOR: " << m_predecessorAddr << " SUCCESSOR " << m_successorAddr);
         Ptr<Packet> packet = Create<Packet> ();
         PennChordMessage newmessage = PennChordMessage (PennChordMessage::STABILIZE_RESP, message.GetTransactionId());
-        newmessage.SetStabilizeResp (m_predecessorAddr);
+        if (message.GetStabilizeReq().fingerHints)
+        {
+            std::vector<Ipv4Address> successors = m_successorList;
+            if (successors.empty () || successors.front () != m_successorAddr)
+            {
+                successors.assign (1, m_successorAddr);
+            }
+            // Hints the requester already has would only repeat themselves every period
+            std::map<uint16_t, Ipv4Address> fingerHints = FindFingerHints (sourceAddress);
+            if (GetFingerHintsChecksum (fingerHints) == message.GetStabilizeReq().hintsChecksum)
+            {
+                fingerHints.clear ();
+            }
+            newmessage.SetStabilizeResp (m_predecessorAddr, successors, fingerHints);
+        }
+        else
+        {
+            newmessage.SetStabilizeResp (m_predecessorAddr);
+        }
         packet->AddHeader (newmessage);
         m_socket->SendTo (packet, 0 , InetSocketAddress (sourceAddress, sourcePort));
+        PennStatsAdd (PennChord::globalControlCount, 1);
+        PennStatsAdd (PennChord::globalControlBytes, packet->GetSize ());
      }
     return;
 }
@@ -593,8 +793,26 @@ PennChord::ProcessStabilizeResp (PennChordMessage message, Ipv4Address sourceAdd
 {
 
     //CHORD_LOG ("Recieved STABILIZE_RESP from Node: " << ReverseLookup(sourceAddress) << " IP: " << sourceAddress << " transactionId: " << message.GetTransactionId());
-    Ipv4Address predecessorAddr=message.GetStabilizeResp().predecessorAddress;
-    if (predecessorAddr == Ipv4Address::GetAny())
+    PennChordMessage::StabilizeResp resp = message.GetStabilizeResp();
+    if (sourceAddress == m_successorAddr)
+    {
+        m_stabilizeMisses = 0;
+    }
+    if (sourceAddress == m_successorAddr && !resp.successorList.empty ())
+    {
+        UpdateSuccessorList (sourceAddress, resp.successorList);
+    }
+    if (m_chordStatus == 1 && !resp.fingerHints.empty ())
+    {
+        if (sourceAddress == m_successorAddr)
+        {
+            m_fingerHintsChecksum = GetFingerHintsChecksum (resp.fingerHints);
+        }
+        ProcessFingerHints (resp.fingerHints);
+    }
+
+    Ipv4Address predecessorAddr=resp.predecessorAddress;
+    if (predecessorAddr == Ipv4Address::GetAny() || predecessorAddr == m_successorAddr)
     {
         return;
     }
@@ -606,25 +824,166 @@ PennChord::ProcessStabilizeResp (PennChordMessage message, Ipv4Address sourceAdd
         return;
     }
 
+    bool newSuccessor;
     if(compareSHA1(m_localDigest,m_successorDigest))
     {
-        if(compareSHA1(m_recvdigest,m_localDigest) || compareSHA1(m_successorDigest, m_recvdigest))
-        {
-            SetSuccessorAddress (predecessorAddr);
-            SendNotify(message,m_successorAddr,sourcePort);
-        }
+        newSuccessor = compareSHA1(m_recvdigest,m_localDigest) || compareSHA1(m_successorDigest, m_recvdigest);
+    }
+    else
+    {
+        newSuccessor = compareSHA1(m_recvdigest,m_localDigest) && compareSHA1(m_successorDigest, m_recvdigest);
+    }
+    if (!newSuccessor)
+    {
         return;
     }
 
-    if(compareSHA1(m_recvdigest,m_localDigest) && compareSHA1(m_successorDigest, m_recvdigest))
+    SetSuccessorAddress (predecessorAddr);
+    if (m_coalesceStabilize)
+    {
+        // The notify rides on the next STABILIZE_REQ, so send it now rather than a NOTIFY
+        m_stabilizeTimer.Cancel ();
+        m_stabilizeTimer.Schedule (Seconds (0));
+    }
+    else
     {
-        SetSuccessorAddress (predecessorAddr);
         SendNotify(message,m_successorAddr,sourcePort);
     }
         //CHORD_LOG ("PREDECESSOR: " << m_predecessorAddr << " SUCCESSOR " << m_successorAddr);
         return;
 }
 
+std::map<uint16_t, Ipv4Address>
+PennChord::FindFingerHints (Ipv4Address requesterAddr)
+{
+    // Every node known here is a candidate successor for the requester's finger targets
+    std::set<Ipv4Address> known;
+    known.insert (m_localAddress);
+    known.insert (requesterAddr);
+    known.insert (m_successorAddr);
+    if (m_predecessorAddr != Ipv4Address::GetAny())
+    {
+        known.insert (m_predecessorAddr);
+    }
+    known.insert (m_successorList.begin (), m_successorList.end ());
+    for (std::map<uint16_t, Ipv4Address>::iterator iter = m_fingerTable.begin();iter!=m_fingerTable.end();iter++)
+    {
+        known.insert (iter->second);
+    }
+
+    std::vector<Ipv4Address> nodes (known.begin (), known.end ());
+    std::vector<unsigned char> digests (nodes.size () * 20);
+    for (uint32_t j = 0; j < nodes.size (); j++)
+    {
+        SHA_1 (nodes[j], &digests[j * 20]);
+    }
+
+    unsigned char requesterDigest[20];
+    unsigned char indexHash[20];
+    SHA_1 (requesterAddr, requesterDigest);
+    std::map<uint16_t, Ipv4Address> fingerHints;
+    Ipv4Address lastHint;
+    for (uint16_t i = 2; i <= 160; i++)
+    {
+        FindIndexHash (requesterDigest, i, indexHash);
+        uint32_t best = 0;
+        for (uint32_t j = 1; j < nodes.size (); j++)
+        {
+            if (IsCloserSuccessor (indexHash, &digests[j * 20], &digests[best * 20]))
+            {
+                best = j;
+            }
+        }
+        // Only send the indices where the finger changes node
+        if (nodes[best] != lastHint)
+        {
+            fingerHints[i] = nodes[best];
+            lastHint = nodes[best];
+        }
+    }
+    return fingerHints;
+}
+
+// FNV-1a over the hinted indices and nodes, never 0
+uint32_t
+PennChord::GetFingerHintsChecksum (const std::map<uint16_t, Ipv4Address> &fingerHints)
+{
+    uint32_t checksum = 2166136261U;
+    for (std::map<uint16_t, Ipv4Address>::const_iterator iter = fingerHints.begin (); iter != fingerHints.end (); iter++)
+    {
+        uint32_t words[2] = {iter->first, iter->second.Get ()};
+        for (uint32_t i = 0; i < 8; i++)
+        {
+            checksum = (checksum ^ ((words[i / 4] >> (8 * (i % 4))) & 0xff)) * 16777619U;
+        }
+    }
+    return checksum == 0 ? 1 : checksum;
+}
+
+void
+PennChord::ProcessFingerHints (std::map<uint16_t, Ipv4Address> fingerHints)
+{
+    unsigned char indexHash[20];
+    unsigned char hintDigest[20];
+    unsigned char fingerDigest[20];
+    Ipv4Address hintAddr;
+    std::map<uint16_t, Ipv4Address>::iterator hint = fingerHints.begin ();
+
+    m_fingerTable[1] = m_successorAddr;
+    for (uint16_t i = 2; i <= 160; i++)
+    {
+        // Each hint covers the indices up to the next one
+        while (hint != fingerHints.end () && hint->first <= i)
+        {
+            hintAddr = hint->second;
+            SHA_1 (hintAddr, hintDigest);
+            hint++;
+        }
+        if (hintAddr == Ipv4Address::GetAny ())
+        {
+            continue;
+        }
+        std::map<uint16_t, Ipv4Address>::iterator finger = m_fingerTable.find (i);
+        if (finger == m_fingerTable.end ())
+        {
+            m_fingerTable[i] = hintAddr;
+            continue;
+        }
+        if (finger->second == hintAddr)
+        {
+            continue;
+        }
+        // Keep the current finger unless the hint is a closer successor of the index,
+        // proximity picks are deliberately not the closest so only FIND_FINGER replaces them
+        if (m_proximityFingers)
+        {
+            continue;
+        }
+        FindIndexHash (i, indexHash);
+        SHA_1 (finger->second, fingerDigest);
+        if (IsCloserSuccessor (indexHash, hintDigest, fingerDigest))
+        {
+            finger->second = hintAddr;
+        }
+    }
+}
+
+void
+PennChord::UpdateSuccessorList (Ipv4Address successorAddr, std::vector<Ipv4Address> successorList)
+{
+    m_successorList.clear ();
+    m_successorList.push_back (successorAddr);
+    for (std::vector<Ipv4Address>::iterator iter = successorList.begin (); iter != successorList.end () && m_successorList.size () < m_successorListLength; iter++)
+    {
+        // Stop once the list wraps around the ring
+        if (*iter == m_localAddress || *iter == successorAddr)
+        {
+            break;
+        }
+        m_successorList.push_back (*iter);
+    }
+}
+
 void
 PennChord::ProcessRingstate (PennChordMessage message, Ipv4Address sourceAddress, int16_t sourcePort)
 {
@@ -669,6 +1028,8 @@ PennChord::SetSuccessorAddress(Ipv4Address ipv4Address)
 {
   m_successorAddr = ipv4Address;
   SHA_1(m_successorAddr, m_successorDigest);
+  // A new successor knows other nodes, so ask for all of its hints
+  m_fingerHintsChecksum = 0;
 }
 
 void
@@ -684,7 +1045,7 @@ PennChord::FixFinger()
 {
     if (m_chordStatus==0 || m_successorAddr == m_localAddress)
     {
-        m_fixFingerTimer.Schedule (m_fixFingerTimeout);
+        ScheduleFixFinger ();
         return;
     }
     m_fingerTable[1] = m_successorAddr;
@@ -703,7 +1064,7 @@ PennChord::SendFindFinger (uint16_t i)
     {
         if (i>160)
         {
-            m_fixFingerTimer.Schedule (m_fixFingerTimeout);
+            ScheduleFixFinger ();
             return;
         }
 
@@ -736,6 +1097,15 @@ PennChord::SendFindFinger (uint16_t i)
     message.SetFindFinger (m_localAddress, indexHash, i);
     packet->AddHeader (message);
     m_socket->SendTo (packet, 0 , InetSocketAddress (prevFinger,m_appPort));
+    PennStatsAdd (PennChord::globalControlCount, 1);
+    PennStatsAdd (PennChord::globalControlBytes, packet->GetSize ());
+}
+
+void
+PennChord::ScheduleFixFinger ()
+{
+    // Coalesced stabilize keeps fingers fresh through hints, FIND_FINGER only audits them
+    m_fixFingerTimer.Schedule (m_coalesceStabilize ? m_fingerAuditTimeout : m_fixFingerTimeout);
 }
 
 void
@@ -767,6 +1137,8 @@ PennChord::ProcessFindFinger (PennChordMessage message, Ipv4Address sourceAddres
     packet->AddHeader (newMessage);
     Ipv4Address NextHopAddr = FindNextHop (targetDig);
     m_socket->SendTo (packet, 0 , InetSocketAddress (NextHopAddr,sourcePort));
+    PennStatsAdd (PennChord::globalControlCount, 1);
+    PennStatsAdd (PennChord::globalControlBytes, packet->GetSize ());
 }
 
 void
@@ -774,9 +1146,68 @@ PennChord::ReplyFindFinger(PennChordMessage message, Ipv4Address targetAddr, uin
 {
     Ptr<Packet> packet = Create<Packet> ();
     PennChordMessage newMessage = PennChordMessage (PennChordMessage::FIND_FINGER_SUCCESS,message.GetTransactionId());
-    newMessage.SetFindFingerSuccess (m_successorAddr,targetInd);
+    std::vector<Ipv4Address> candidates;
+    if (m_proximityFingers)
+    {
+        candidates = FindFingerCandidates (targetAddr, targetInd);
+    }
+    newMessage.SetFindFingerSuccess (m_successorAddr,targetInd,candidates);
     packet->AddHeader (newMessage);
     m_socket->SendTo (packet, 0 , InetSocketAddress (targetAddr,sourcePort));
+    PennStatsAdd (PennChord::globalControlCount, 1);
+    PennStatsAdd (PennChord::globalControlBytes, packet->GetSize ());
+}
+
+std::vector<Ipv4Address>
+PennChord::FindFingerCandidates (Ipv4Address requesterAddr, uint16_t fingerInd)
+{
+    // This node precedes the index, so its successors and its short fingers
+    // fall in the finger interval [index, next index) of the requester
+    std::set<Ipv4Address> known (m_successorList.begin (), m_successorList.end ());
+    for (std::map<uint16_t, Ipv4Address>::iterator iter = m_fingerTable.begin();iter!=m_fingerTable.end();iter++)
+    {
+        known.insert (iter->second);
+    }
+    known.erase (m_successorAddr);
+    known.erase (requesterAddr);
+
+    unsigned char requesterDigest[20];
+    unsigned char indexHash[20];
+    unsigned char nextIndexHash[20];
+    SHA_1 (requesterAddr, requesterDigest);
+    FindIndexHash (requesterDigest, fingerInd, indexHash);
+    if (fingerInd < 160)
+    {
+        FindIndexHash (requesterDigest, fingerInd + 1, nextIndexHash);
+    }
+    else
+    {
+        memcpy (nextIndexHash, requesterDigest, 20);
+    }
+
+    // Closest to the index first, the first k of the interval are offered
+    std::vector<std::pair<Ipv4Address, std::vector<unsigned char> > > inInterval;
+    for (std::set<Ipv4Address>::iterator iter = known.begin (); iter != known.end (); iter++)
+    {
+        std::vector<unsigned char> digest (20);
+        SHA_1 (*iter, &digest[0]);
+        if (!IsCloserSuccessor (indexHash, &digest[0], nextIndexHash))
+        {
+            continue;
+        }
+        std::vector<std::pair<Ipv4Address, std::vector<unsigned char> > >::iterator pos = inInterval.begin ();
+        while (pos != inInterval.end () && IsCloserSuccessor (indexHash, &pos->second[0], &digest[0]))
+        {
+            pos++;
+        }
+        inInterval.insert (pos, std::make_pair (*iter, digest));
+    }
+    std::vector<Ipv4Address> candidates;
+    for (uint32_t j = 0; j < inInterval.size () && candidates.size () < m_proximityCandidates; j++)
+    {
+        candidates.push_back (inInterval[j].first);
+    }
+    return candidates;
 }
 
 void
@@ -785,14 +1216,130 @@ PennChord::ProcessFindFingerSuccess (PennChordMessage message, Ipv4Address sourc
     std::string fromNode = ReverseLookup (sourceAddress);
     //CHORD_LOG ("Received FIND_FINGER_SUCCESS, From Node: " << fromNode);
     uint16_t fingerInd = message.GetFindFingerSuccess().fingerIndex;
-    m_fingerTable[fingerInd]=message.GetFindFingerSuccess().fingerAddress;
+    Ipv4Address fingerAddr = message.GetFindFingerSuccess().fingerAddress;
+    if (m_proximityFingers && fingerInd > 1)
+    {
+        fingerAddr = SelectProximityFinger (fingerAddr, message.GetFindFingerSuccess().candidates);
+    }
+    m_fingerTable[fingerInd]=fingerAddr;
     SendFindFinger(fingerInd+1);
 }
 
+Ipv4Address
+PennChord::SelectProximityFinger (Ipv4Address fingerAddr, std::vector<Ipv4Address> candidates)
+{
+    // Any node in [index, next index) is a valid finger, the replier only offers those
+    candidates.insert (candidates.begin (), fingerAddr);
+    Ipv4Address bestAddr = fingerAddr;
+    Time bestRtt;
+    bool measured = false;
+    for (std::vector<Ipv4Address>::iterator iter = candidates.begin (); iter != candidates.end (); iter++)
+    {
+        std::map<Ipv4Address, Time>::iterator rtt = m_rttTable.find (*iter);
+        if (rtt == m_rttTable.end ())
+        {
+            // Adopted by AdoptProximityFinger once the probe answers
+            SendProximityProbe (*iter);
+            continue;
+        }
+        if (!measured || rtt->second < bestRtt)
+        {
+            bestAddr = *iter;
+            bestRtt = rtt->second;
+            measured = true;
+        }
+    }
+    return bestAddr;
+}
+
+void
+PennChord::AdoptProximityFinger (Ipv4Address candidateAddr, Time rtt)
+{
+    if (candidateAddr == m_successorAddr)
+    {
+        return;
+    }
+    unsigned char candidateDigest[20];
+    unsigned char indexHash[20];
+    unsigned char nextIndexHash[20];
+    SHA_1 (candidateAddr, candidateDigest);
+    for (uint16_t i = 2; i < 160; i++)
+    {
+        FindIndexHash (i, indexHash);
+        FindIndexHash (i + 1, nextIndexHash);
+        if (!IsCloserSuccessor (indexHash, candidateDigest, nextIndexHash))
+        {
+            continue;
+        }
+        // A finger sharing no interval with the candidate is not replaced
+        std::map<uint16_t, Ipv4Address>::iterator finger = m_fingerTable.find (i);
+        if (finger == m_fingerTable.end () || finger->second == candidateAddr)
+        {
+            return;
+        }
+        std::map<Ipv4Address, Time>::iterator fingerRtt = m_rttTable.find (finger->second);
+        if (fingerRtt == m_rttTable.end () || rtt < fingerRtt->second)
+        {
+            finger->second = candidateAddr;
+        }
+        return;
+    }
+}
+
+void
+PennChord::SendProximityProbe (Ipv4Address destAddress)
+{
+    for (std::map<uint32_t, Ptr<PingRequest> >::iterator iter = m_pingTracker.begin (); iter != m_pingTracker.end (); iter++)
+    {
+        if (iter->second->GetDestinationAddress () == destAddress && iter->second->GetPingMessage () == proximityProbe)
+        {
+            return;
+        }
+    }
+    uint32_t transactionId = GetNextTransactionId ();
+    Ptr<PingRequest> pingRequest = Create<PingRequest> (transactionId, Simulator::Now(), destAddress, proximityProbe);
+    m_pingTracker.insert (std::make_pair (transactionId, pingRequest));
+    Ptr<Packet> packet = Create<Packet> ();
+    PennChordMessage message = PennChordMessage (PennChordMessage::PING_REQ, transactionId);
+    message.SetPingReq (proximityProbe);
+    packet->AddHeader (message);
+    m_socket->SendTo (packet, 0 , InetSocketAddress (destAddress, m_appPort));
+}
+
+void
+PennChord::RecordLookupStretch (Ipv4Address replierAddress, Time overlayLatency)
+{
+    std::map<Ipv4Address, Time>::iterator rtt = m_rttTable.find (replierAddress);
+    if (rtt == m_rttTable.end ())
+    {
+        m_pendingStretch[replierAddress].push_back (overlayLatency);
+        SendProximityProbe (replierAddress);
+        return;
+    }
+    if (rtt->second.IsZero ())
+    {
+        return;
+    }
+    PennStatsAdd (PennChord::globalStretchSum, overlayLatency.GetSeconds () / rtt->second.GetSeconds ());
+    PennStatsAdd (PennChord::globalStretchCount, 1);
+}
+
 Ipv4Address
 PennChord::FindNextHop (unsigned char *targetDigest)
 {
     //return m_successorAddr;
+    if (m_oneHopRouting)
+    {
+        Ipv4Address oneHopAddr = FindOneHop (targetDigest);
+        if (oneHopAddr != Ipv4Address::GetAny ())
+        {
+            return oneHopAddr;
+        }
+    }
+    if (m_fingerTable.empty ())
+    {
+        return m_successorAddr;
+    }
     unsigned char fingerDigest[20];
     for (std::map<uint16_t, Ipv4Address>::iterator iter = (--m_fingerTable.end());iter!=m_fingerTable.begin();iter--)
     {
@@ -833,8 +1380,12 @@ PennChord::LookupPublish (std::string key, uint16_t flag, uint32_t transactionId
     {
         LookupCallback(flag, key, m_successorAddr,transactionId);
     }
-    PennChord::globalQueryCount++;
-    PennChord::globalHopCount++;
+    PennStatsAdd (PennChord::globalQueryCount, 1);
+    PennStatsAdd (PennChord::globalHopCount, 1);
+    if (m_reportStretch || m_reportLatency)
+    {
+        m_lookupTracker[transactionId] = Simulator::Now ();
+    }
 
     unsigned char NextHopDigest[20];
     Ipv4Address NextHopAddr = FindNextHop (digestkey);
@@ -882,7 +1433,7 @@ PennChord::SendLookupPublish (PennChordMessage message, unsigned char* digestkey
     newMessage.SetLookupPublish (message.GetLookupPublish().flag, message.GetLookupPublish().initiatorAddress, digestkey, message.GetLookupPublish().lookupKey);
     packet->AddHeader (newMessage);
     m_socket->SendTo (packet, 0 , InetSocketAddress (NextHopAddr,sourcePort));
-    PennChord::globalHopCount++;
+    PennStatsAdd (PennChord::globalHopCount, 1);
 }
 
 void
@@ -902,6 +1453,20 @@ void
 PennChord::ProcessLookupPublishSuccess (PennChordMessage message,Ipv4Address sourceAddress,uint16_t sourcePort)
 {
     //CHORD_LOG("Lookup Success reached with result");
+    std::map<uint32_t, Time>::iterator lookup = m_lookupTracker.find (message.GetTransactionId ());
+    if (lookup != m_lookupTracker.end ())
+    {
+        // Round trip through the overlay against a direct round trip to the responder
+        Time overlayLatency = Simulator::Now () - lookup->second;
+        m_lookupTracker.erase (lookup);
+        PennStatsAdd (PennChord::globalLatencySum, overlayLatency.GetSeconds () * 1000);
+        PennStatsAdd (PennChord::globalLatencyCount, 1);
+        PennStatsSample (PennChord::globalLatencies, overlayLatency.GetSeconds () * 1000);
+        if (m_reportStretch && sourceAddress != m_localAddress)
+        {
+            RecordLookupStretch (sourceAddress, overlayLatency);
+        }
+    }
     LookupCallback(message.GetLookupPublishSuccess().flag, message.GetLookupPublishSuccess().lookupKey, message.GetLookupPublishSuccess().addressResponsible, message.GetTransactionId());
 }
 
@@ -925,6 +1490,331 @@ PennChord::LookupCallback (uint16_t flag, std::string key, Ipv4Address addressRe
     }
 }
 
+void
+PennChord::AnnounceMembership (Ipv4Address memberAddr, bool joined)
+{
+    PennChordMessage::MemberEvent event;
+    event.memberAddress = memberAddr;
+    event.joined = joined;
+    event.sequence = (uint32_t) Simulator::Now ().GetMilliSeconds ();
+    if (!joined)
+    {
+        // A departure cancels the incarnation we know about
+        std::map<Ipv4Address, MemberState>::iterator iter = m_memberState.find (memberAddr);
+        event.sequence = (iter != m_memberState.end ()) ? iter->second.sequence : 0;
+    }
+    if (ApplyMemberEvent (event))
+    {
+        GossipMembership (std::vector<PennChordMessage::MemberEvent> (1, event), m_localAddress);
+    }
+}
+
+bool
+PennChord::ApplyMemberEvent (PennChordMessage::MemberEvent event)
+{
+    std::map<Ipv4Address, MemberState>::iterator iter = m_memberState.find (event.memberAddress);
+    if (iter != m_memberState.end ())
+    {
+        // Newer incarnations win, and a departure beats the join it cancels
+        if (event.sequence < iter->second.sequence)
+            return false;
+        if (event.sequence == iter->second.sequence && (event.joined || !iter->second.alive))
+            return false;
+    }
+    MemberState state;
+    state.sequence = event.sequence;
+    state.alive = event.joined;
+    m_memberState[event.memberAddress] = state;
+
+    unsigned char digest[20];
+    SHA_1 (event.memberAddress, digest);
+    std::string ringKey ((char *) digest, 20);
+    if (event.joined)
+    {
+        m_memberRing[ringKey] = event.memberAddress;
+    }
+    else
+    {
+        m_memberRing.erase (ringKey);
+    }
+    return true;
+}
+
+void
+PennChord::GossipMembership (std::vector<PennChordMessage::MemberEvent> events, Ipv4Address sourceAddress)
+{
+    // Flood over fingers, every node forwards an event the first time it sees it
+    std::set<Ipv4Address> peers;
+    peers.insert (m_successorAddr);
+    peers.insert (m_predecessorAddr);
+    for (std::map<uint16_t, Ipv4Address>::iterator iter = m_fingerTable.begin();iter!=m_fingerTable.end();iter++)
+    {
+        peers.insert (iter->second);
+    }
+    for (std::vector<PennChordMessage::MemberEvent>::iterator iter = events.begin (); iter != events.end (); iter++)
+    {
+        if (!iter->joined)
+        {
+            peers.erase (iter->memberAddress);
+        }
+    }
+    peers.erase (m_localAddress);
+    peers.erase (sourceAddress);
+    peers.erase (Ipv4Address::GetAny ());
+    for (std::set<Ipv4Address>::iterator iter = peers.begin (); iter != peers.end (); iter++)
+    {
+        SendMembership (events, *iter);
+    }
+}
+
+void
+PennChord::SendMembership (std::vector<PennChordMessage::MemberEvent> events, Ipv4Address destAddr)
+{
+    uint32_t transactionId = GetNextTransactionId ();
+    Ptr<Packet> packet = Create<Packet> ();
+    PennChordMessage message = PennChordMessage (PennChordMessage::MEMBERSHIP, transactionId);
+    message.SetMembership (events);
+    packet->AddHeader (message);
+    m_socket->SendTo (packet, 0 , InetSocketAddress (destAddr, m_appPort));
+    PennStatsAdd (PennChord::globalControlCount, 1);
+    PennStatsAdd (PennChord::globalControlBytes, packet->GetSize ());
+}
+
+void
+PennChord::ProcessMembership (PennChordMessage message, Ipv4Address sourceAddress, uint16_t sourcePort)
+{
+    if (!m_oneHopRouting || m_chordStatus == 0)
+    {
+        return;
+    }
+    std::vector<PennChordMessage::MemberEvent> events = message.GetMembership().events;
+    std::vector<PennChordMessage::MemberEvent> fresh;
+    bool newcomer = false;
+    for (std::vector<PennChordMessage::MemberEvent>::iterator iter = events.begin (); iter != events.end (); iter++)
+    {
+        if (!ApplyMemberEvent (*iter))
+        {
+            continue;
+        }
+        fresh.push_back (*iter);
+        if (iter->joined && iter->memberAddress == sourceAddress)
+        {
+            newcomer = true;
+        }
+    }
+    if (!fresh.empty ())
+    {
+        GossipMembership (fresh, sourceAddress);
+    }
+    if (newcomer)
+    {
+        // A node announcing its own join gets the whole view in return
+        std::vector<PennChordMessage::MemberEvent> view;
+        for (std::map<Ipv4Address, MemberState>::iterator iter = m_memberState.begin (); iter != m_memberState.end (); iter++)
+        {
+            if (!iter->second.alive)
+                continue;
+            PennChordMessage::MemberEvent event;
+            event.memberAddress = iter->first;
+            event.sequence = iter->second.sequence;
+            event.joined = 1;
+            view.push_back (event);
+        }
+        SendMembership (view, sourceAddress);
+    }
+}
+
+bool
+PennChord::IsMembershipFresh ()
+{
+    // The view is trusted only while it agrees with the ring stabilize has verified
+    std::map<std::string, Ipv4Address>::iterator self = m_memberRing.find (std::string ((char *) m_localDigest, 20));
+    if (m_memberRing.size () < 2 || self == m_memberRing.end ())
+    {
+        return false;
+    }
+    std::map<std::string, Ipv4Address>::iterator next = self;
+    next++;
+    if (next == m_memberRing.end ())
+    {
+        next = m_memberRing.begin ();
+    }
+    if (next->second != m_successorAddr)
+    {
+        return false;
+    }
+    if (m_predecessorAddr != Ipv4Address::GetAny ())
+    {
+        std::map<std::string, Ipv4Address>::iterator prev = self;
+        if (prev == m_memberRing.begin ())
+        {
+            prev = m_memberRing.end ();
+        }
+        prev--;
+        if (prev->second != m_predecessorAddr)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+Ipv4Address
+PennChord::FindOneHop (unsigned char *targetDigest)
+{
+    if (!IsMembershipFresh ())
+    {
+        return Ipv4Address::GetAny ();
+    }
+    // The owner's predecessor answers, the key falls between it and its successor
+    std::map<std::string, Ipv4Address>::iterator owner = m_memberRing.lower_bound (std::string ((char *) targetDigest, 20));
+    if (owner == m_memberRing.begin ())
+    {
+        owner = m_memberRing.end ();
+    }
+    owner--;
+    if (owner->second == m_localAddress)
+    {
+        return Ipv4Address::GetAny ();
+    }
+    return owner->second;
+}
+
+void
+PennChord::Bootstrap (const std::vector<std::string> &ringDigests, const std::vector<Ipv4Address> &ring)
+{
+    // Install what JOIN, stabilize and fix finger would have converged to
+    uint32_t n = ring.size ();
+    uint32_t position = std::lower_bound (ringDigests.begin (), ringDigests.end (),
+                                          std::string ((char *) m_localDigest, 20)) - ringDigests.begin ();
+    NS_ASSERT (position < n && ring[position] == m_localAddress);
+    m_chordStatus = 1;
+    m_stabilizeMisses = 0;
+    m_fingerTable.clear ();
+    m_successorList.clear ();
+    if (n == 1)
+    {
+        SetSuccessorAddress (m_localAddress);
+        SetPredecessorAddress (Ipv4Address::GetAny ());
+    }
+    else
+    {
+        SetSuccessorAddress (ring[(position + 1) % n]);
+        SetPredecessorAddress (ring[(position + n - 1) % n]);
+        for (uint32_t i = 1; i < n && m_successorList.size () < m_successorListLength; i++)
+        {
+            m_successorList.push_back (ring[(position + i) % n]);
+        }
+        // Finger i is the first member at or after local + 2^(i-1)
+        unsigned char indexHash[20];
+        for (uint16_t i = 1; i <= 160; i++)
+        {
+            FindIndexHash (i, indexHash);
+            uint32_t finger = std::lower_bound (ringDigests.begin (), ringDigests.end (),
+                                                std::string ((char *) indexHash, 20)) - ringDigests.begin ();
+            m_fingerTable[i] = ring[finger % n];
+        }
+    }
+    if (m_oneHopRouting)
+    {
+        m_memberState.clear ();
+        m_memberRing.clear ();
+        PennChordMessage::MemberEvent event;
+        event.joined = 1;
+        event.sequence = (uint32_t) Simulator::Now ().GetMilliSeconds ();
+        for (uint32_t i = 0; i < n; i++)
+        {
+            event.memberAddress = ring[i];
+            ApplyMemberEvent (event);
+        }
+    }
+    CHORD_LOG ("Chord is bootstrapped with " << n << " nodes, successor: " << ReverseLookup (m_successorAddr));
+}
+
+void
+PennChord::SaveCheckpoint (PennCheckpointWriter &writer)
+{
+    writer.WriteU8 (m_chordStatus);
+    writer.WriteAddress (m_successorAddr);
+    writer.WriteAddress (m_predecessorAddr);
+    writer.WriteU32 (m_successorList.size ());
+    for (uint32_t i = 0; i < m_successorList.size (); i++)
+    {
+        writer.WriteAddress (m_successorList[i]);
+    }
+    writer.WriteU32 (m_fingerTable.size ());
+    for (std::map<uint16_t, Ipv4Address>::iterator iter = m_fingerTable.begin ();
+         iter != m_fingerTable.end (); iter++)
+    {
+        writer.WriteU32 (iter->first);
+        writer.WriteAddress (iter->second);
+    }
+    writer.WriteU32 (m_memberState.size ());
+    for (std::map<Ipv4Address, MemberState>::iterator iter = m_memberState.begin ();
+         iter != m_memberState.end (); iter++)
+    {
+        writer.WriteAddress (iter->first);
+        writer.WriteU32 (iter->second.sequence);
+        writer.WriteU8 (iter->second.alive);
+    }
+    writer.WriteU32 (m_rttTable.size ());
+    for (std::map<Ipv4Address, Time>::iterator iter = m_rttTable.begin ();
+         iter != m_rttTable.end (); iter++)
+    {
+        writer.WriteAddress (iter->first);
+        writer.WriteTime (iter->second);
+    }
+}
+
+bool
+PennChord::LoadCheckpoint (PennCheckpointReader &reader)
+{
+    m_chordStatus = reader.ReadU8 ();
+    m_stabilizeMisses = 0;
+    SetSuccessorAddress (reader.ReadAddress ());
+    SetPredecessorAddress (reader.ReadAddress ());
+    m_successorList.clear ();
+    uint32_t size = reader.ReadU32 ();
+    for (uint32_t i = 0; i < size && reader.IsOk (); i++)
+    {
+        m_successorList.push_back (reader.ReadAddress ());
+    }
+    m_fingerTable.clear ();
+    size = reader.ReadU32 ();
+    for (uint32_t i = 0; i < size && reader.IsOk (); i++)
+    {
+        uint16_t index = reader.ReadU32 ();
+        m_fingerTable[index] = reader.ReadAddress ();
+    }
+    // The ring view is rebuilt from the member states.  Their sequences
+    // are times of the checkpointed run, the restored one starts its
+    // clock at zero again, so they are rebased to zero: later joins are
+    // newer, and a departure still cancels the restored join
+    m_memberState.clear ();
+    m_memberRing.clear ();
+    size = reader.ReadU32 ();
+    for (uint32_t i = 0; i < size && reader.IsOk (); i++)
+    {
+        PennChordMessage::MemberEvent event;
+        event.memberAddress = reader.ReadAddress ();
+        reader.ReadU32 ();
+        event.sequence = 0;
+        event.joined = reader.ReadU8 ();
+        ApplyMemberEvent (event);
+    }
+    m_rttTable.clear ();
+    size = reader.ReadU32 ();
+    for (uint32_t i = 0; i < size && reader.IsOk (); i++)
+    {
+        Ipv4Address address = reader.ReadAddress ();
+        m_rttTable[address] = reader.ReadTime ();
+    }
+    if (!reader.IsOk ())
+        return false;
+    CHORD_LOG ("Chord is restored, successor: " << ReverseLookup (m_successorAddr));
+    return true;
+}
+
 ///////////////////////////////////////////////////////////
 
 uint32_t
@@ -1070,7 +1960,13 @@ PennChord::compareSHA1 (unsigned char *digest1, unsigned char *digest2)
 void
 PennChord::FindIndexHash (uint16_t index, unsigned char* indexHash)
 {
-    memcpy(indexHash,m_localDigest, 20);
+    FindIndexHash (m_localDigest, index, indexHash);
+}
+
+void
+PennChord::FindIndexHash (unsigned char *baseDigest, uint16_t index, unsigned char* indexHash)
+{
+    memcpy(indexHash,baseDigest, 20);
     uint16_t byteIndex = 20 - ((uint8_t)((index-1)/8) + 1);
     uint16_t bitIndex = (index-1)%8;
     uint16_t byteAdded;
@@ -1092,3 +1988,18 @@ PennChord::FindIndexHash (uint16_t index, unsigned char* indexHash)
     return;
 }
 
+bool
+PennChord::IsCloserSuccessor (unsigned char *targetDigest, unsigned char *candidateDigest, unsigned char *currentDigest)
+{
+    // True when the candidate lies in [target, current) going round the ring
+    uint8_t current = compareSHA1(currentDigest, targetDigest);
+    if (current == 2)
+    {
+        return false;
+    }
+    if (current == 1)
+    {
+        return compareSHA1(candidateDigest, targetDigest) != 0 && compareSHA1(candidateDigest, currentDigest) == 0;
+    }
+    return compareSHA1(candidateDigest, targetDigest) != 0 || compareSHA1(candidateDigest, currentDigest) == 0;
+}
@@ -22,6 +22,8 @@
 #include "ns3/penn-application.h"
 #include "ns3/penn-chord-message.h"
 #include "ns3/ping-request.h"
+#include "ns3/penn-checkpoint.h"
+#include "ns3/penn-random.h"
 #include <openssl/sha.h>
 #include "ns3/ipv4-address.h"
 #include <map>
@@ -61,6 +63,10 @@ class PennChord : public PennApplication
     void Stabilize();
     void ProcessStabilizeReq (PennChordMessage message, Ipv4Address sourceAddress, int16_t sourcePort);
     void ProcessStabilizeResp (PennChordMessage message, Ipv4Address sourceAddress, int16_t sourcePort);
+    std::map<uint16_t, Ipv4Address> FindFingerHints (Ipv4Address requesterAddr);
+    void ProcessFingerHints (std::map<uint16_t, Ipv4Address> fingerHints);
+    static uint32_t GetFingerHintsChecksum (const std::map<uint16_t, Ipv4Address> &fingerHints);
+    void UpdateSuccessorList (Ipv4Address successorAddr, std::vector<Ipv4Address> successorList);
     void ProcessRingstate (PennChordMessage message, Ipv4Address sourceAddress, int16_t sourcePort);
     void DisplayChordDetails ();
     void ProcessLeaveSuccessor (PennChordMessage message, Ipv4Address sourceAddress, int16_t sourcePort);
@@ -69,9 +75,15 @@ class PennChord : public PennApplication
     void SetPredecessorAddress (Ipv4Address ipv4Address);
     void FixFinger (void);
     void SendFindFinger (uint16_t i);
+    void ScheduleFixFinger ();
     void ProcessFindFinger (PennChordMessage message, Ipv4Address sourceAddress, uint16_t sourcePort);
     void ReplyFindFinger(PennChordMessage message, Ipv4Address targetAddr, uint16_t sourcePort,uint16_t targetInd);
     void ProcessFindFingerSuccess (PennChordMessage message, Ipv4Address sourceAddress, uint16_t sourcePort);
+    std::vector<Ipv4Address> FindFingerCandidates (Ipv4Address requesterAddr, uint16_t fingerInd);
+    Ipv4Address SelectProximityFinger (Ipv4Address fingerAddr, std::vector<Ipv4Address> candidates);
+    void AdoptProximityFinger (Ipv4Address candidateAddr, Time rtt);
+    void SendProximityProbe (Ipv4Address destAddress);
+    void RecordLookupStretch (Ipv4Address replierAddress, Time overlayLatency);
     Ipv4Address FindNextHop (unsigned char *targetDigest);
     void LookupPublish (std::string key, uint16_t flag, uint32_t transactionId);
     void ProcessLookupPublish (PennChordMessage message, Ipv4Address sourceAddress, uint16_t sourcePort);
@@ -79,6 +91,20 @@ class PennChord : public PennApplication
     void ReplyLookupPublishSuccess (PennChordMessage message, unsigned char* targetDigest, uint16_t sourcePort);
     void ProcessLookupPublishSuccess (PennChordMessage message,Ipv4Address sourceAddress,uint16_t sourcePort);
     void LookupCallback (uint16_t flag, std::string key, Ipv4Address addressResponsible, uint32_t transactionId);
+    void AnnounceMembership (Ipv4Address memberAddr, bool joined);
+    bool ApplyMemberEvent (PennChordMessage::MemberEvent event);
+    void GossipMembership (std::vector<PennChordMessage::MemberEvent> events, Ipv4Address sourceAddress);
+    void SendMembership (std::vector<PennChordMessage::MemberEvent> events, Ipv4Address destAddr);
+    void ProcessMembership (PennChordMessage message, Ipv4Address sourceAddress, uint16_t sourcePort);
+    bool IsMembershipFresh ();
+    Ipv4Address FindOneHop (unsigned char *targetDigest);
+    // Joins the converged ring at once, ringDigests are the sorted 20 byte
+    // digests of every member including this node and ring their addresses
+    void Bootstrap (const std::vector<std::string> &ringDigests, const std::vector<Ipv4Address> &ring);
+    // Ring position, fingers, membership view and proximity of this node,
+    // restored over a freshly started chord
+    void SaveCheckpoint (PennCheckpointWriter &writer);
+    bool LoadCheckpoint (PennCheckpointReader &reader);
 
     uint32_t GetNextTransactionId ();
     void StopChord ();
@@ -95,6 +121,17 @@ class PennChord : public PennApplication
     
     static float globalHopCount;
     static float globalQueryCount;
+    static uint32_t globalControlCount;
+    // Bytes of those control packets, Chord header included
+    static uint64_t globalControlBytes;
+    static uint32_t globalNodeCount;
+    static float globalStretchSum;
+    static float globalStretchCount;
+    static float globalLatencySum;
+    static float globalLatencyCount;
+    // Every lookup latency in ms, for the metrics of simulator-main
+    static std::vector<float> globalLatencies;
+    static const std::string proximityProbe;
     
 
     // From PennApplication
@@ -116,18 +153,54 @@ class PennChord : public PennApplication
     unsigned char m_successorDigest[20];
     unsigned char m_predecessorDigest[20];
     std::map<uint16_t, Ipv4Address> m_fingerTable;
+    std::vector<Ipv4Address> m_successorList;
+    uint16_t m_stabilizeMisses;
+    // Checksum of the finger hints last got from the successor, 0 for none
+    uint32_t m_fingerHintsChecksum;
+
+    // Full membership view for one-hop routing.  Lookups take one hop
+    // whatever the ring size, but every join or leave reaches all the
+    // members, 100 to 180 bytes per member on 60 to 1000 nodes.  Without
+    // fingers to fix, the ring is quieter in between, which pays for a
+    // change every 75 s at 60 nodes and every 30 to 40 s at 500 to 1000.
+    struct MemberState
+    {
+      uint32_t sequence;
+      bool alive;
+    };
+    std::map<Ipv4Address, MemberState> m_memberState;
+    std::map<std::string, Ipv4Address> m_memberRing;
+
+    // Round trip times measured with proximity probes
+    std::map<Ipv4Address, Time> m_rttTable;
+    // Issue time of outstanding lookups, and overlay latencies waiting for a probe
+    std::map<uint32_t, Time> m_lookupTracker;
+    std::map<Ipv4Address, std::vector<Time> > m_pendingStretch;
 
     void SHA_1 (Ipv4Address ipv4Addr, unsigned char *digest);
     void SHA_1 (std::string s, unsigned char *digest);
     std::string DisplayHEX (unsigned char *digest);
     uint8_t compareSHA1 (unsigned char *digest1, unsigned char *digest2);
     void FindIndexHash (uint16_t index, unsigned char *indexHash);
+    void FindIndexHash (unsigned char *baseDigest, uint16_t index, unsigned char *indexHash);
+    bool IsCloserSuccessor (unsigned char *targetDigest, unsigned char *candidateDigest, unsigned char *currentDigest);
    
     uint32_t m_currentTransactionId;
+    PennRandom m_random;
     Ptr<Socket> m_socket;
     Time m_pingTimeout;
+    Time m_lookupTimeout;
     Time m_stabilizeTimeout;
     Time m_fixFingerTimeout;
+    Time m_fingerAuditTimeout;
+    bool m_coalesceStabilize;
+    uint16_t m_successorListLength;
+    uint16_t m_maxStabilizeMisses;
+    bool m_oneHopRouting;
+    bool m_proximityFingers;
+    uint8_t m_proximityCandidates;
+    bool m_reportStretch;
+    bool m_reportLatency;
     uint16_t m_appPort;
     // Timers
     Timer m_auditPingsTimer;
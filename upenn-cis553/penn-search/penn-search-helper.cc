@@ -18,6 +18,9 @@
 
 #include "ns3/penn-search-helper.h"
 #include "ns3/penn-search.h"
+#include <openssl/sha.h>
+#include <algorithm>
+#include <sstream>
 
 using namespace ns3;
 
@@ -45,3 +48,59 @@ PennSearchHelper::Install (NodeContainer c)
     }
   return apps;
 }
+
+// the 20 byte SHA-1 digest Chord places s at
+static std::string
+Digest (std::string s)
+{
+  unsigned char digest[20];
+  SHA1 ((unsigned char *) s.c_str (), s.size (), digest);
+  return std::string ((char *) digest, 20);
+}
+
+void
+PennSearchHelper::BootstrapChord (NodeContainer c)
+{
+  std::vector<std::pair<std::string, Ptr<PennSearch> > > members;
+  for (NodeContainer::Iterator i = c.Begin () ; i != c.End (); i++)
+    {
+      Ptr<PennSearch> application = (*i)->GetApplication (0)->GetObject<PennSearch> ();
+      std::ostringstream address;
+      address << application->GetLocalAddress ();
+      members.push_back (std::make_pair (Digest (address.str ()), application));
+    }
+  std::sort (members.begin (), members.end ());
+
+  m_ringDigests.clear ();
+  m_ring.clear ();
+  std::vector<Ipv4Address> addresses;
+  for (uint32_t i = 0 ; i < members.size (); i++)
+    {
+      m_ringDigests.push_back (members[i].first);
+      m_ring.push_back (members[i].second);
+      addresses.push_back (members[i].second->GetLocalAddress ());
+    }
+  for (uint32_t i = 0 ; i < m_ring.size (); i++)
+    {
+      m_ring[i]->GetChord ()->Bootstrap (m_ringDigests, addresses);
+    }
+}
+
+bool
+PennSearchHelper::PreloadKeys (std::string fileName)
+{
+  std::map<std::string, std::vector<std::string> > invertLists;
+  if (m_ring.empty () || !m_ring[0]->ReadKeyFile (fileName, invertLists))
+    {
+      return false;
+    }
+  for (std::map<std::string, std::vector<std::string> >::iterator i = invertLists.begin ();
+       i != invertLists.end (); i++)
+    {
+      // the owner is the first node at or after the digest of the key
+      uint32_t owner = std::lower_bound (m_ringDigests.begin (), m_ringDigests.end (),
+                                         Digest (i->first)) - m_ringDigests.begin ();
+      m_ring[owner % m_ring.size ()]->StoreList (i->first, i->second);
+    }
+  return true;
+}
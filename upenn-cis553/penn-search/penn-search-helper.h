@@ -25,6 +25,8 @@
 #include "ns3/node-container.h"
 #include "ns3/object-factory.h"
 #include "ns3/penn-search.h"
+#include <string>
+#include <vector>
 
 using namespace ns3;
 
@@ -37,8 +39,27 @@ class PennSearchHelper
 
     ApplicationContainer Install (NodeContainer c);
 
+    /**
+     * Computes offline the ring the PennSearch nodes of c would
+     * converge to after joining, and installs the successor,
+     * predecessor, successor list and fingers of every node directly,
+     * without JOIN or stabilize messages. The applications must have
+     * started.
+     */
+    void BootstrapChord (NodeContainer c);
+    /**
+     * Stores the posting lists of a keys file at the nodes of the
+     * bootstrapped ring which own their keywords, as PUBLISH would.
+     *
+     * \returns false if the file cannot be read or there is no ring
+     */
+    bool PreloadKeys (std::string fileName);
+
   private:
     ObjectFactory m_factory;
+    // the bootstrapped ring, sorted by digest
+    std::vector<std::string> m_ringDigests;
+    std::vector<Ptr<PennSearch> > m_ring;
 };
 
 #endif
@@ -189,7 +189,8 @@ PennSearchMessage::Deserialize (Buffer::Iterator start)
         size += m_message.pingRsp.Deserialize (i);
         break;
       case STORE_LIST:
-        size += m_message.storeList.Deserialize (i);
+        FlattenPayload (i, start.GetSize () - size);
+        size += m_message.storeList.Deserialize (m_payload);
         break;
       case SEARCH_INITIAL:
         size += m_message.searchInitial.Deserialize (i);
@@ -198,13 +199,16 @@ PennSearchMessage::Deserialize (Buffer::Iterator start)
         size += m_message.searchBegin.Deserialize (i);
         break;
       case SEARCH:
-        size += m_message.search.Deserialize (i);
+        FlattenPayload (i, start.GetSize () - size);
+        size += m_message.search.Deserialize (m_payload);
         break;
       case SEARCH_COMPLETE:
-        size += m_message.searchComplete.Deserialize(i);
+        FlattenPayload (i, start.GetSize () - size);
+        size += m_message.searchComplete.Deserialize (m_payload);
         break;
       case PASS_KEYS:
-        size += m_message.passKeys.Deserialize(i);
+        FlattenPayload (i, start.GetSize () - size);
+        size += m_message.passKeys.Deserialize (m_payload);
         break;
       default:
         NS_ASSERT (false);
@@ -212,6 +216,91 @@ PennSearchMessage::Deserialize (Buffer::Iterator start)
   return size;
 }
 
+/*
+ * Copy the rest of the packet (the message is always the first header,
+ * so everything after the fixed fields is payload) into one contiguous
+ * buffer.  List payloads are then decoded as views into it.
+ */
+void
+PennSearchMessage::FlattenPayload (Buffer::Iterator &start, uint32_t size)
+{
+  Buffer::Iterator end = start;
+  end.Next (size);
+  m_payload = Buffer ();
+  m_payload.AddAtStart (size);
+  m_payload.Begin ().Write (start, end);
+}
+
+static uint32_t
+GetListSerializedSize (const std::vector<std::string> &list, const PennSearchMessage::StringViewList &views)
+{
+  uint32_t size = sizeof(uint16_t);
+  for (uint32_t i = 0; i < list.size (); i++)
+    {
+      size += sizeof(uint16_t) + list[i].length ();
+    }
+  for (uint32_t i = 0; i < views.size (); i++)
+    {
+      size += sizeof(uint16_t) + views[i].length;
+    }
+  return size;
+}
+
+static void
+SerializeList (Buffer::Iterator &start, const std::vector<std::string> &list, const PennSearchMessage::StringViewList &views)
+{
+  start.WriteU16 (list.size () + views.size ());
+  for (uint32_t i = 0; i < list.size (); i++)
+    {
+      start.WriteU16 (list[i].length ());
+      start.Write ((uint8_t *) (const_cast<char*> (list[i].c_str())), list[i].length());
+    }
+  for (uint32_t i = 0; i < views.size (); i++)
+    {
+      start.WriteU16 (views[i].length);
+      start.Write ((const uint8_t *) views[i].data, views[i].length);
+    }
+}
+
+static std::string
+DeserializeString (Buffer::Iterator &start)
+{
+  uint16_t length = start.ReadU16 ();
+  char* str = (char*) malloc (length);
+  start.Read ((uint8_t*)str, length);
+  std::string s = std::string (str, length);
+  free (str);
+  return s;
+}
+
+static void
+DeserializeList (Buffer::Iterator &start, std::vector<std::string> &list)
+{
+  uint16_t vectorSize = start.ReadU16 ();
+  list.reserve (vectorSize);
+  for (uint16_t i = 0; i < vectorSize; i++)
+    {
+      list.push_back (DeserializeString (start));
+    }
+}
+
+static void
+DeserializeViews (Buffer::Iterator &start, Buffer const &payload, PennSearchMessage::StringViewList &views)
+{
+  const char *base = (const char *) payload.PeekData ();
+  Buffer::Iterator begin = payload.Begin ();
+  uint16_t vectorSize = start.ReadU16 ();
+  views.reserve (vectorSize);
+  for (uint16_t i = 0; i < vectorSize; i++)
+    {
+      PennSearchMessage::StringView view;
+      view.length = start.ReadU16 ();
+      view.data = base + start.GetDistanceFrom (begin);
+      start.Next (view.length);
+      views.push_back (view);
+    }
+}
+
 /* PING_REQ */
 
 uint32_t
@@ -260,7 +349,7 @@ PennSearchMessage::SetPingReq (std::string pingMessage)
   m_message.pingReq.pingMessage = pingMessage;
 }
 
-PennSearchMessage::PingReq
+const PennSearchMessage::PingReq &
 PennSearchMessage::GetPingReq ()
 {
   return m_message.pingReq;
@@ -314,7 +403,7 @@ PennSearchMessage::SetPingRsp (std::string pingMessage)
   m_message.pingRsp.pingMessage = pingMessage;
 }
 
-PennSearchMessage::PingRsp
+const PennSearchMessage::PingRsp &
 PennSearchMessage::GetPingRsp ()
 {
   return m_message.pingRsp;
@@ -326,11 +415,7 @@ uint32_t
 PennSearchMessage::StoreList::GetSerializedSize (void) const
 {
   uint32_t size;
-  size = sizeof(uint16_t) + key.length() + sizeof(uint16_t);
-  for(uint16_t i=0;i<docVector.size();i++)
-  {
-      size+= sizeof(uint16_t) + docVector[i].length();
-  }
+  size = sizeof(uint16_t) + key.length() + GetListSerializedSize (docVector, docViews);
   return size;
 }
 
@@ -345,32 +430,15 @@ PennSearchMessage::StoreList::Serialize (Buffer::Iterator &start) const
 {
   start.WriteU16 (key.length ());
   start.Write ((uint8_t *) (const_cast<char*> (key.c_str())), key.length());
-  start.WriteU16 (docVector.size());
-  for(uint16_t i=0;i<docVector.size();i++)
-  {
-      start.WriteU16 (docVector[i].length ());
-      start.Write ((uint8_t *) (const_cast<char*> (docVector[i].c_str())), docVector[i].length());
-  }
+  SerializeList (start, docVector, docViews);
 }
 
 uint32_t
-PennSearchMessage::StoreList::Deserialize (Buffer::Iterator &start)
+PennSearchMessage::StoreList::Deserialize (Buffer const &payload)
 {
-  uint16_t length = start.ReadU16 ();
-  char* str = (char*) malloc (length);
-  start.Read ((uint8_t*)str, length);
-  key = std::string (str, length);
-  free (str);
-
-  uint16_t vectorSize = start.ReadU16 ();
-  for(uint16_t i=0; i<vectorSize; i++)
-  {
-      length = start.ReadU16 ();
-      char* str = (char*) malloc (length);
-      start.Read ((uint8_t*)str, length);
-      docVector.push_back(std::string (str, length));
-      free (str);
-  }
+  Buffer::Iterator start = payload.Begin ();
+  key = DeserializeString (start);
+  DeserializeViews (start, payload, docViews);
   return StoreList::GetSerializedSize ();
 }
 
@@ -389,7 +457,7 @@ PennSearchMessage::SetStoreList (std::string key, std::vector<std::string> docVe
   m_message.storeList.docVector = docVector;
 }
 
-PennSearchMessage::StoreList
+const PennSearchMessage::StoreList &
 PennSearchMessage::GetStoreList ()
 {
   return m_message.storeList;
@@ -459,7 +527,7 @@ PennSearchMessage::SetSearchInitial (Ipv4Address initiatorAddress, std::vector<s
   m_message.searchInitial.keyList = keyList;
 }
 
-PennSearchMessage::SearchInitial
+const PennSearchMessage::SearchInitial &
 PennSearchMessage::GetSearchInitial ()
 {
   return m_message.searchInitial;
@@ -551,7 +619,7 @@ PennSearchMessage::SetSearchBegin (Ipv4Address initiatorAddress, std::vector<std
   m_message.searchBegin.docList = docList;
 }
 
-PennSearchMessage::SearchBegin
+const PennSearchMessage::SearchBegin &
 PennSearchMessage::GetSearchBegin ()
 {
   return m_message.searchBegin;
@@ -563,15 +631,8 @@ uint32_t
 PennSearchMessage::Search::GetSerializedSize (void) const
 {
   uint32_t size;
-  size = IPV4_ADDRESS_SIZE + sizeof(uint16_t) + sizeof(uint16_t);
-  for(uint16_t i=0;i<keyList.size();i++)
-  {
-      size+= sizeof(uint16_t) + keyList[i].length();
-  }
-  for(uint16_t i=0;i<docList.size();i++)
-  {
-      size+= sizeof(uint16_t) + docList[i].length();
-  }
+  size = IPV4_ADDRESS_SIZE + GetListSerializedSize (keyList, StringViewList ())
+         + GetListSerializedSize (docList, docViews);
   return size;
 }
 
@@ -585,45 +646,17 @@ void
 PennSearchMessage::Search::Serialize (Buffer::Iterator &start) const
 {
   start.WriteHtonU32 (initiatorAddress.Get());
-  uint16_t length;
-  start.WriteU16 (keyList.size());
-  for(uint16_t i=0;i<keyList.size();i++)
-  {
-      start.WriteU16 (keyList[i].length ());
-      start.Write ((uint8_t *) (const_cast<char*> (keyList[i].c_str())), keyList[i].length());
-  }
-  start.WriteU16 (docList.size());
-  for(uint16_t i=0;i<docList.size();i++)
-  {
-      start.WriteU16 (docList[i].length ());
-      start.Write ((uint8_t *) (const_cast<char*> (docList[i].c_str())), docList[i].length());
-  }
+  SerializeList (start, keyList, StringViewList ());
+  SerializeList (start, docList, docViews);
 }
 
 uint32_t
-PennSearchMessage::Search::Deserialize (Buffer::Iterator &start)
+PennSearchMessage::Search::Deserialize (Buffer const &payload)
 {
+  Buffer::Iterator start = payload.Begin ();
   initiatorAddress = Ipv4Address (start.ReadNtohU32());
-   uint16_t length;
-  uint16_t vectorSize = start.ReadU16 ();
-  for(uint16_t i=0; i<vectorSize; i++)
-  {
-      length = start.ReadU16 ();
-      char* str = (char*) malloc (length);
-      start.Read ((uint8_t*)str, length);
-      keyList.push_back(std::string (str, length));
-      free (str);
-  }
-
-  vectorSize = start.ReadU16 ();
-  for(uint16_t i=0; i<vectorSize; i++)
-  {
-      length = start.ReadU16 ();
-      char* str = (char*) malloc (length);
-      start.Read ((uint8_t*)str, length);
-      docList.push_back(std::string (str, length));
-      free (str);
-  }
+  DeserializeList (start, keyList);
+  DeserializeViews (start, payload, docViews);
   return Search::GetSerializedSize ();
 }
 
@@ -643,7 +676,7 @@ PennSearchMessage::SetSearch (Ipv4Address initiatorAddress, std::vector<std::str
   m_message.search.docList = docList;
 }
 
-PennSearchMessage::Search
+const PennSearchMessage::Search &
 PennSearchMessage::GetSearch ()
 {
   return m_message.search;
@@ -655,67 +688,37 @@ uint32_t
 PennSearchMessage::SearchComplete::GetSerializedSize (void) const
 {
   uint32_t size;
-  size = sizeof(uint16_t) + sizeof(uint16_t);
-  for(uint16_t i=0;i<keyList.size();i++)
-  {
-      size+= sizeof(uint16_t) + keyList[i].length();
-  }
-  for(uint16_t i=0;i<docList.size();i++)
-  {
-      size+= sizeof(uint16_t) + docList[i].length();
-  }
+  size = GetListSerializedSize (keyList, StringViewList ())
+         + GetListSerializedSize (docList, docViews);
   return size;
 }
 
 void
 PennSearchMessage::SearchComplete::Print (std::ostream &os) const
 {
-    for(uint16_t i=0;i<docList.size();i++)
+    for(uint32_t i=0;i<docList.size();i++)
     {
         os << "Docs "<<i<<".  "<< docList[i] << "\n";
     }
+    for(uint32_t i=0;i<docViews.size();i++)
+    {
+        os << "Docs "<<i<<".  "<< docViews[i] << "\n";
+    }
 }
 
 void
 PennSearchMessage::SearchComplete::Serialize (Buffer::Iterator &start) const
 {
-  start.WriteU16 (keyList.size());
-  for(uint16_t i=0;i<keyList.size();i++)
-  {
-      start.WriteU16 (keyList[i].length ());
-      start.Write ((uint8_t *) (const_cast<char*> (keyList[i].c_str())), keyList[i].length());
-  }
-  start.WriteU16 (docList.size());
-  for(uint16_t i=0;i<docList.size();i++)
-  {
-      start.WriteU16 (docList[i].length ());
-      start.Write ((uint8_t *) (const_cast<char*> (docList[i].c_str())), docList[i].length());
-  }
+  SerializeList (start, keyList, StringViewList ());
+  SerializeList (start, docList, docViews);
 }
 
 uint32_t
-PennSearchMessage::SearchComplete::Deserialize (Buffer::Iterator &start)
+PennSearchMessage::SearchComplete::Deserialize (Buffer const &payload)
 {
-  uint16_t length;
-  uint16_t vectorSize = start.ReadU16 ();
-  for(uint16_t i=0; i<vectorSize; i++)
-  {
-      length = start.ReadU16 ();
-      char* str = (char*) malloc (length);
-      start.Read ((uint8_t*)str, length);
-      keyList.push_back(std::string (str, length));
-      free (str);
-  }
-
-  vectorSize = start.ReadU16 ();
-  for(uint16_t i=0; i<vectorSize; i++)
-  {
-      length = start.ReadU16 ();
-      char* str = (char*) malloc (length);
-      start.Read ((uint8_t*)str, length);
-      docList.push_back(std::string (str, length));
-      free (str);
-  }
+  Buffer::Iterator start = payload.Begin ();
+  DeserializeList (start, keyList);
+  DeserializeViews (start, payload, docViews);
   return SearchComplete::GetSerializedSize ();
 }
 
@@ -734,7 +737,7 @@ PennSearchMessage::SetSearchComplete (std::vector<std::string> keyList, std::vec
   m_message.searchComplete.docList = docList;
 }
 
-PennSearchMessage::SearchComplete
+const PennSearchMessage::SearchComplete &
 PennSearchMessage::GetSearchComplete ()
 {
   return m_message.searchComplete;
@@ -746,11 +749,7 @@ uint32_t
 PennSearchMessage::PassKeys::GetSerializedSize (void) const
 {
     uint32_t size;
-    size = sizeof(uint16_t) + key.length() + sizeof(uint16_t);
-    for(uint16_t i=0;i<docVector.size();i++)
-    {
-        size+= sizeof(uint16_t) + docVector[i].length();
-    }
+    size = sizeof(uint16_t) + key.length() + GetListSerializedSize (docVector, docViews);
     return size;
 }
 
@@ -765,32 +764,15 @@ PennSearchMessage::PassKeys::Serialize (Buffer::Iterator &start) const
 {
     start.WriteU16 (key.length ());
     start.Write ((uint8_t *) (const_cast<char*> (key.c_str())), key.length());
-    start.WriteU16 (docVector.size());
-    for(uint16_t i=0;i<docVector.size();i++)
-    {
-        start.WriteU16 (docVector[i].length ());
-        start.Write ((uint8_t *) (const_cast<char*> (docVector[i].c_str())), docVector[i].length());
-    }
+    SerializeList (start, docVector, docViews);
 }
 
 uint32_t
-PennSearchMessage::PassKeys::Deserialize (Buffer::Iterator &start)
+PennSearchMessage::PassKeys::Deserialize (Buffer const &payload)
 {
-    uint16_t length = start.ReadU16 ();
-    char* str = (char*) malloc (length);
-    start.Read ((uint8_t*)str, length);
-    key = std::string (str, length);
-    free (str);
-
-    uint16_t vectorSize = start.ReadU16 ();
-    for(uint16_t i=0; i<vectorSize; i++)
-    {
-        length = start.ReadU16 ();
-        char* str = (char*) malloc (length);
-        start.Read ((uint8_t*)str, length);
-        docVector.push_back(std::string (str, length));
-        free (str);
-    }
+    Buffer::Iterator start = payload.Begin ();
+    key = DeserializeString (start);
+    DeserializeViews (start, payload, docViews);
     return PassKeys::GetSerializedSize ();
 }
 
@@ -809,7 +791,7 @@ PennSearchMessage::SetPassKeys (std::string key, std::vector<std::string> docVec
   m_message.passKeys.docVector = docVector;
 }
 
-PennSearchMessage::PassKeys
+const PennSearchMessage::PassKeys &
 PennSearchMessage::GetPassKeys ()
 {
   return m_message.passKeys;
@@ -22,6 +22,9 @@
 #include "ns3/packet.h"
 #include "ns3/object.h"
 #include <map>
+#include <vector>
+#include <string>
+#include <cstring>
 
 using namespace ns3;
 
@@ -88,6 +91,31 @@ class PennSearchMessage : public Header
     void Serialize (Buffer::Iterator start) const;
     uint32_t Deserialize (Buffer::Iterator start);
 
+    /**
+     *  \brief Read-only reference to a string inside the flattened payload
+     *  of a received message.
+     *
+     *  Document lists are decoded as views instead of std::string objects;
+     *  the bytes stay valid for as long as any copy of the message is alive.
+     *  Call ToString () only when the value has to be stored.
+     */
+    struct StringView
+      {
+        const char *data;
+        uint16_t length;
+
+        std::string ToString () const
+        {
+          return std::string (data, length);
+        }
+        bool operator< (const StringView &o) const
+        {
+          int cmp = memcmp (data, o.data, length < o.length ? length : o.length);
+          return cmp < 0 || (cmp == 0 && length < o.length);
+        }
+      };
+    typedef std::vector<StringView> StringViewList;
+
     
     struct PingReq
       {
@@ -114,10 +142,12 @@ class PennSearchMessage : public Header
 	void Print (std::ostream &os) const;
 	uint32_t GetSerializedSize (void) const;
 	void Serialize (Buffer::Iterator &start) const;
-	uint32_t Deserialize (Buffer::Iterator &start);
+	uint32_t Deserialize (Buffer const &payload);
 	// Payload
 	std::string key;
 	std::vector<std::string> docVector;
+	// Received documents, views into the flattened payload
+	StringViewList docViews;
       };
     struct SearchInitial
       {
@@ -145,31 +175,37 @@ class PennSearchMessage : public Header
 	void Print (std::ostream &os) const;
 	uint32_t GetSerializedSize (void) const;
 	void Serialize (Buffer::Iterator &start) const;
-	uint32_t Deserialize (Buffer::Iterator &start);
+	uint32_t Deserialize (Buffer const &payload);
 	// Payload
 	Ipv4Address initiatorAddress;
 	std::vector<std::string> keyList;
 	std::vector<std::string> docList;
+	// Received documents, views into the flattened payload
+	StringViewList docViews;
       };
     struct SearchComplete
       {
 	void Print (std::ostream &os) const;
 	uint32_t GetSerializedSize (void) const;
 	void Serialize (Buffer::Iterator &start) const;
-	uint32_t Deserialize (Buffer::Iterator &start);
+	uint32_t Deserialize (Buffer const &payload);
 	// Payload
 	std::vector<std::string> keyList;
 	std::vector<std::string> docList;
+	// Received documents, views into the flattened payload
+	StringViewList docViews;
       };
    struct PassKeys
       {
 	void Print (std::ostream &os) const;
 	uint32_t GetSerializedSize (void) const;
 	void Serialize (Buffer::Iterator &start) const;
-	uint32_t Deserialize (Buffer::Iterator &start);
+	uint32_t Deserialize (Buffer const &payload);
 	// Payload
 	std::string key;
 	std::vector<std::string> docVector;
+	// Received documents, views into the flattened payload
+	StringViewList docViews;
       };
 
 
@@ -185,12 +221,16 @@ class PennSearchMessage : public Header
 	SearchComplete searchComplete;
 	PassKeys passKeys;
       } m_message;
+    // Contiguous copy of a received payload, shared between message copies
+    Buffer m_payload;
+
+    void FlattenPayload (Buffer::Iterator &start, uint32_t size);
     
   public:
     /**
      *  \returns PingReq Struct
      */
-    PingReq GetPingReq ();
+    const PingReq &GetPingReq ();
 
     /**
      *  \brief Sets PingReq message params
@@ -202,7 +242,7 @@ class PennSearchMessage : public Header
     /**
      * \returns PingRsp Struct
      */
-    PingRsp GetPingRsp ();
+    const PingRsp &GetPingRsp ();
     /**
      *  \brief Sets PingRsp message params
      *  \param message Payload String
@@ -210,22 +250,22 @@ class PennSearchMessage : public Header
     void SetPingRsp (std::string message);
     
     void SetStoreList (std::string key, std::vector<std::string> docVector);
-    StoreList GetStoreList ();
+    const StoreList &GetStoreList ();
     
     void SetSearchInitial (Ipv4Address initiatorAddress, std::vector<std::string> keyList);
-    SearchInitial GetSearchInitial ();
+    const SearchInitial &GetSearchInitial ();
 
     void SetSearchBegin (Ipv4Address initiatorAddress, std::vector<std::string> keyList, std::vector<std::string> docList);
-    SearchBegin GetSearchBegin ();
+    const SearchBegin &GetSearchBegin ();
     
     void SetSearch (Ipv4Address initiatorAddress, std::vector<std::string> keyList, std::vector<std::string> docList);
-    Search GetSearch ();
+    const Search &GetSearch ();
     
     void SetSearchComplete (std::vector<std::string> keyList, std::vector<std::string> docList);
-    SearchComplete GetSearchComplete ();
+    const SearchComplete &GetSearchComplete ();
     
     void SetPassKeys (std::string key, std::vector<std::string> docVector);
-    PassKeys GetPassKeys ();
+    const PassKeys &GetPassKeys ();
 
 
 }; // class PennSearchMessage
@@ -236,4 +276,10 @@ static inline std::ostream& operator<< (std::ostream& os, const PennSearchMessag
   return os;
 }
 
+static inline std::ostream& operator<< (std::ostream& os, const PennSearchMessage::StringView& view)
+{
+  os.write (view.data, view.length);
+  return os;
+}
+
 #endif
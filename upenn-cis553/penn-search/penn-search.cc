@@ -21,9 +21,17 @@
 
 #include "ns3/random-variable.h"
 #include "ns3/inet-socket-address.h"
+#include "ns3/enum.h"
+#include "ns3/double.h"
+#include "ns3/string.h"
+#include <sstream>
+#include <sys/time.h>
 
 using namespace ns3;
 
+// Registered up front so that --PennSearch::<attribute> works on the command line
+NS_OBJECT_ENSURE_REGISTERED (PennSearch);
+
 TypeId
 PennSearch::GetTypeId ()
 {
@@ -45,18 +53,44 @@ PennSearch::GetTypeId ()
                    TimeValue (MilliSeconds (2000)),
                    MakeTimeAccessor (&PennSearch::m_pingTimeout),
                    MakeTimeChecker ())
+    .AddAttribute ("ServiceTime",
+                   "Time the node takes to process any received message",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&PennSearch::m_serviceTime),
+                   MakeTimeChecker ())
+    .AddAttribute ("ServiceTimePerEntry",
+                   "Processing time added for every key and document in the lists of a received message",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&PennSearch::m_serviceTimePerEntry),
+                   MakeTimeChecker ())
+    .AddAttribute ("ServiceCosts",
+                   "Per message type costs, as TYPE=base[/perEntry],... e.g. SEARCH=50us/2us,STORE_LIST=10us",
+                   StringValue (""),
+                   MakeStringAccessor (&PennSearch::m_serviceCostsString),
+                   MakeStringChecker ())
+    .AddAttribute ("ServiceMeasured",
+                   "Also charge the wall clock time of each handler, times this factor",
+                   DoubleValue (0),
+                   MakeDoubleAccessor (&PennSearch::m_serviceMeasured),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("ServiceDiscipline",
+                   "Order in which queued messages are processed",
+                   EnumValue (PennSearch::FIFO),
+                   MakeEnumAccessor (&PennSearch::m_serviceDiscipline),
+                   MakeEnumChecker (PennSearch::FIFO, "Fifo",
+                                    PennSearch::PRIORITY, "Priority"))
     ;
   return tid;
 }
 
 PennSearch::PennSearch ()
-  : m_auditPingsTimer (Timer::CANCEL_ON_DESTROY)
+  : m_random ("PennSearch"),
+    m_auditPingsTimer (Timer::CANCEL_ON_DESTROY),
+    m_serviceBusy (false)
 {
   m_chord = NULL;
-  RandomVariable random;
-  SeedManager::SetSeed (time (NULL));
-  random = UniformVariable (0x00000000, 0xFFFFFFFF);
-  m_currentTransactionId = random.GetInteger ();
+  m_serviceStats.messages = 0;
+  m_serviceStats.maxQueueLength = 0;
 }
 
 PennSearch::~PennSearch ()
@@ -74,14 +108,16 @@ PennSearch::DoDispose ()
 void
 PennSearch::StartApplication (void)
 {
+  m_random.SetNode (GetNode ()->GetId ());
+  m_currentTransactionId = m_random.GetInteger (0, 0xFFFFFFFF);
   // Create and Configure PennChord
   ObjectFactory factory;
   factory.SetTypeId (PennChord::GetTypeId ());
   factory.Set ("AppPort", UintegerValue (m_chordPort));
   m_chord = factory.Create<PennChord> ();
   m_chord->SetNode (GetNode ());
-  m_chord->SetNodeAddressMap (m_nodeAddressMap);
-  m_chord->SetAddressNodeMap (m_addressNodeMap);
+  m_chord->SetNodeAddressMap (*m_nodeAddressMap);
+  m_chord->SetAddressNodeMap (*m_addressNodeMap);
   m_chord->SetModuleName ("CHORD");
   std::string nodeId = GetNodeId ();
   m_chord->SetNodeId (nodeId);
@@ -115,6 +151,18 @@ PennSearch::StartApplication (void)
       m_socket->SetRecvCallback (MakeCallback (&PennSearch::RecvMessage, this));
     }  
   
+  if (!ParseServiceCosts (m_serviceCostsString))
+    {
+      ERROR_LOG ("Invalid ServiceCosts: " << m_serviceCostsString);
+      m_serviceCosts.clear ();
+    }
+  m_serviceStats.messages = 0;
+  m_serviceStats.maxQueueLength = 0;
+  m_serviceStats.busy = Seconds (0);
+  m_serviceStats.queueDelay = Seconds (0);
+  m_serviceStats.maxQueueDelay = Seconds (0);
+  m_serviceStart = Simulator::Now ();
+
   // Configure timers
   m_auditPingsTimer.SetFunction (&PennSearch::AuditPings, this);
   // Start timers
@@ -138,6 +186,11 @@ PennSearch::StopApplication (void)
   m_auditPingsTimer.Cancel ();
   m_pingTracker.clear ();
   m_searchTracker.clear();
+  // Drop the messages still waiting for the CPU
+  m_serviceEvent.Cancel ();
+  m_serviceQueue[0].clear ();
+  m_serviceQueue[1].clear ();
+  m_serviceBusy = false;
 }
 
 void
@@ -156,62 +209,11 @@ PennSearch::ProcessCommand (std::vector<std::string> tokens)
   {
       iterator++;
       std::string filename = *iterator; 
-      std::string line;
-      std::string docx;
-      std::string keyWord;
-      std::vector<std::string> docName;
-      std::vector<std::string> strtoken;
-      std::map<std::string,std::vector<std::string> >::iterator iterInvertList;
-
-      char *fcstr=new char[filename.length() + 1];
-      strcpy(fcstr,filename.c_str());
-      char result[50]={'\0'};
-      const char *cstr="../ns-3/upenn-cis553/keys/";
-      //strcat(result,cstr);
-      strcat(result,fcstr);
-      std::ifstream keyfile(result);
-      m_invertListMap.clear();
-
-      if(keyfile.is_open())
-      {
-          while(getline(keyfile,line))
-          {
-              if (line.empty())
-              {
-                  continue;
-              }
-              strtoken.clear();
-              Tokenizer(line, strtoken," ");
-              std::vector<std::string>::iterator it=strtoken.begin();
-              docx=*it;
-              it++;
-
-              for(;it!=strtoken.end();it++)
-              {
-                 // From each line put the Doc0 value in a string.
-                 // Iterator pointing to the keys, do .find in map. If map.end() insert to the map. Else insert to the vector.
-                  keyWord=*it;
-                  iterInvertList=m_invertListMap.find(keyWord);
-
-                  if(iterInvertList == m_invertListMap.end())
-                  {
-                      docName.clear();
-                      docName.push_back(docx);
-                      m_invertListMap[keyWord] = docName;
-                  }
-                  else
-                  {
-                      iterInvertList->second.push_back(docx);
-                  }
-              }
-          }
-      }
-      else
+      if (!ReadKeyFile (filename, m_invertListMap))
       {
           SEARCH_LOG("File "<<filename <<" Open Unsuccesful");
           return;
       }
-      keyfile.close();
       for(std::map<std::string,std::vector<std::string> >::iterator iter=m_invertListMap.begin(); iter!=m_invertListMap.end();iter++)
       {
           for(std::vector<std::string>::iterator iter1=iter->second.begin(); iter1!=iter->second.end();iter1++)
@@ -221,7 +223,6 @@ PennSearch::ProcessCommand (std::vector<std::string> tokens)
       }
 
       Publish();
-      delete fcstr;
   }
   if (command == "SEARCH")
   {
@@ -251,6 +252,17 @@ PennSearch::ProcessCommand (std::vector<std::string> tokens)
       packet->AddHeader (message);
       m_socket->SendTo (packet, 0 , InetSocketAddress (nodeAddr, m_appPort));
   }
+  if (command == "SERVICE")
+  {
+      // Load of the virtual CPU, run on "*" to find the hot nodes
+      ServiceStats stats = GetServiceStats ();
+      uint32_t served = stats.messages - m_serviceQueue[0].size () - m_serviceQueue[1].size ();
+      double utilization = stats.elapsed.IsZero () ? 0 : 100 * stats.busy.GetSeconds () / stats.elapsed.GetSeconds ();
+      double meanDelay = served == 0 ? 0 : stats.queueDelay.GetSeconds () * 1000 / served;
+      SEARCH_LOG ("Service<messages " << stats.messages << ", utilization " << utilization
+                  << "%, queue delay mean " << meanDelay << "ms max " << stats.maxQueueDelay.GetMilliSeconds ()
+                  << "ms, queue max " << stats.maxQueueLength << ">");
+  }
 
   if (command == "PING")
     {
@@ -271,8 +283,8 @@ PennSearch::ProcessCommand (std::vector<std::string> tokens)
         {
           iterator++;
           std::string pingMessage = *iterator;
-          std::map<uint32_t, Ipv4Address>::iterator iter;
-          for (iter = m_nodeAddressMap.begin () ; iter != m_nodeAddressMap.end (); iter++)  
+          std::map<uint32_t, Ipv4Address>::const_iterator iter;
+          for (iter = m_nodeAddressMap->begin () ; iter != m_nodeAddressMap->end (); iter++)  
             {
               std::ostringstream sin;
               uint32_t nodeNumber = iter->first;
@@ -324,6 +336,170 @@ PennSearch::RecvMessage (Ptr<Socket> socket)
   PennSearchMessage message;
   packet->RemoveHeader (message);
 
+  m_serviceStats.messages++;
+  Time cost = GetServiceTime (message);
+  if (cost.IsZero () && m_serviceMeasured == 0 && !m_serviceBusy)
+    {
+      // Nothing to model, process right away as without a service time
+      ProcessMessage (message, sourceAddress, sourcePort);
+      return;
+    }
+  ServiceJob job;
+  job.message = message;
+  job.sourceAddress = sourceAddress;
+  job.sourcePort = sourcePort;
+  job.arrival = Simulator::Now ();
+  job.cost = cost;
+  uint8_t type = message.GetMessageType ();
+  bool background = m_serviceDiscipline == PRIORITY
+    && (type == PennSearchMessage::STORE_LIST || type == PennSearchMessage::PASS_KEYS);
+  m_serviceQueue[background ? 1 : 0].push_back (job);
+  uint32_t queueLength = m_serviceQueue[0].size () + m_serviceQueue[1].size ();
+  m_serviceStats.maxQueueLength = std::max (m_serviceStats.maxQueueLength, queueLength);
+  if (!m_serviceBusy)
+    {
+      StartService ();
+    }
+}
+
+/*
+ * The virtual CPU serves one message at a time.  A message is processed
+ * when its service time is over, so what it sends leaves after the
+ * delay.  With ServiceMeasured the cost is only known once the handler
+ * has run, so the handler runs when the message reaches the CPU and the
+ * CPU stays busy for the measured time afterwards.  Measured costs
+ * depend on the host and break the reproducibility of a seeded run.
+ */
+void
+PennSearch::StartService ()
+{
+  std::deque<ServiceJob> &queue = m_serviceQueue[0].empty () ? m_serviceQueue[1] : m_serviceQueue[0];
+  if (queue.empty ())
+    {
+      m_serviceBusy = false;
+      return;
+    }
+  m_serviceJob = queue.front ();
+  queue.pop_front ();
+  m_serviceBusy = true;
+  Time waited = Simulator::Now () - m_serviceJob.arrival;
+  m_serviceStats.queueDelay += waited;
+  m_serviceStats.maxQueueDelay = Max (m_serviceStats.maxQueueDelay, waited);
+  Time cost = m_serviceJob.cost;
+  if (m_serviceMeasured > 0)
+    {
+      struct timeval start, end;
+      gettimeofday (&start, 0);
+      ProcessMessage (m_serviceJob.message, m_serviceJob.sourceAddress, m_serviceJob.sourcePort);
+      gettimeofday (&end, 0);
+      double wall = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+      cost += Seconds (wall * m_serviceMeasured);
+    }
+  m_serviceStats.busy += cost;
+  m_serviceEvent = Simulator::Schedule (cost, &PennSearch::FinishService, this);
+}
+
+void
+PennSearch::FinishService ()
+{
+  if (m_serviceMeasured == 0)
+    {
+      ProcessMessage (m_serviceJob.message, m_serviceJob.sourceAddress, m_serviceJob.sourcePort);
+    }
+  StartService ();
+}
+
+Time
+PennSearch::GetServiceTime (PennSearchMessage &message)
+{
+  Time base = m_serviceTime;
+  Time perEntry = m_serviceTimePerEntry;
+  std::map<uint8_t, std::pair<Time, Time> >::iterator iter = m_serviceCosts.find (message.GetMessageType ());
+  if (iter != m_serviceCosts.end ())
+    {
+      base = iter->second.first;
+      perEntry = iter->second.second;
+    }
+  if (perEntry.IsZero ())
+    {
+      return base;
+    }
+  uint32_t entries = 0;
+  switch (message.GetMessageType ())
+    {
+      case PennSearchMessage::STORE_LIST:
+        entries = message.GetStoreList ().docViews.size ();
+        break;
+      case PennSearchMessage::SEARCH_INITIAL:
+        entries = message.GetSearchInitial ().keyList.size ();
+        break;
+      case PennSearchMessage::SEARCH_BEGIN:
+        entries = message.GetSearchBegin ().keyList.size () + message.GetSearchBegin ().docList.size ();
+        break;
+      case PennSearchMessage::SEARCH:
+        entries = message.GetSearch ().keyList.size () + message.GetSearch ().docViews.size ();
+        break;
+      case PennSearchMessage::SEARCH_COMPLETE:
+        entries = message.GetSearchComplete ().keyList.size () + message.GetSearchComplete ().docViews.size ();
+        break;
+      case PennSearchMessage::PASS_KEYS:
+        entries = message.GetPassKeys ().docViews.size ();
+        break;
+      default:
+        break;
+    }
+  return base + NanoSeconds (perEntry.GetNanoSeconds () * entries);
+}
+
+bool
+PennSearch::ParseServiceCosts (std::string costs)
+{
+  static const char *names[] = { "PING_REQ", "PING_RSP", "STORE_LIST", "SEARCH_INITIAL",
+                                 "SEARCH_BEGIN", "SEARCH", "SEARCH_COMPLETE", "PASS_KEYS" };
+  m_serviceCosts.clear ();
+  std::vector<std::string> entries;
+  Tokenizer (costs, entries, ",");
+  for (uint32_t i = 0; i < entries.size (); i++)
+    {
+      std::string::size_type equals = entries[i].find ('=');
+      if (equals == std::string::npos)
+        {
+          return false;
+        }
+      std::string name = entries[i].substr (0, equals);
+      uint8_t type = 0;
+      for (uint8_t j = 0; j < sizeof (names) / sizeof (names[0]); j++)
+        {
+          if (name == names[j])
+            {
+              type = PennSearchMessage::PING_REQ + j;
+            }
+        }
+      std::vector<std::string> times;
+      Tokenizer (entries[i].substr (equals + 1), times, "/");
+      TimeValue base, perEntry (Seconds (0));
+      if (type == 0 || times.empty () || times.size () > 2
+          || !base.DeserializeFromString (times[0], MakeTimeChecker ())
+          || (times.size () == 2 && !perEntry.DeserializeFromString (times[1], MakeTimeChecker ())))
+        {
+          return false;
+        }
+      m_serviceCosts[type] = std::make_pair (base.Get (), perEntry.Get ());
+    }
+  return true;
+}
+
+PennSearch::ServiceStats
+PennSearch::GetServiceStats (void) const
+{
+  ServiceStats stats = m_serviceStats;
+  stats.elapsed = Simulator::Now () - m_serviceStart;
+  return stats;
+}
+
+void
+PennSearch::ProcessMessage (PennSearchMessage message, Ipv4Address sourceAddress, uint16_t sourcePort)
+{
   switch (message.GetMessageType ())
     {
       case PennSearchMessage::PING_REQ:
@@ -411,6 +587,92 @@ PennSearch::AuditPings ()
   m_auditPingsTimer.Schedule (m_pingTimeout); 
 }
 
+bool
+PennSearch::ReadKeyFile (std::string fileName, std::map<std::string, std::vector<std::string> > &invertLists)
+{
+    std::string line;
+    std::string docx;
+    std::vector<std::string> strtoken;
+
+    std::ifstream keyfile(fileName.c_str());
+    invertLists.clear();
+    if(!keyfile.is_open())
+    {
+        return false;
+    }
+    while(getline(keyfile,line))
+    {
+        if (line.empty())
+        {
+            continue;
+        }
+        strtoken.clear();
+        Tokenizer(line, strtoken," ");
+        std::vector<std::string>::iterator it=strtoken.begin();
+        docx=*it;
+        it++;
+        // Every keyword of the line lists the document of its first word
+        for(;it!=strtoken.end();it++)
+        {
+            invertLists[*it].push_back(docx);
+        }
+    }
+    return true;
+}
+
+void
+PennSearch::StoreList (std::string key, const std::vector<std::string> &docs)
+{
+    for(uint32_t i=0; i < docs.size();i++)
+    {
+        SEARCH_LOG("Store<"<< key <<", "<<docs[i]<<">");
+    }
+    std::vector<std::string> &stored = m_dataMap[key];
+    stored.insert (stored.end (), docs.begin (), docs.end ());
+}
+
+Ptr<PennChord>
+PennSearch::GetChord (void) const
+{
+    return m_chord;
+}
+
+void
+PennSearch::SaveCheckpoint (PennCheckpointWriter &writer)
+{
+    m_chord->SaveCheckpoint (writer);
+    writer.WriteU32 (m_dataMap.size ());
+    for (std::map<std::string, std::vector<std::string> >::iterator iter = m_dataMap.begin ();
+         iter != m_dataMap.end (); iter++)
+    {
+        writer.WriteString (iter->first);
+        writer.WriteU32 (iter->second.size ());
+        for (uint32_t i = 0; i < iter->second.size (); i++)
+        {
+            writer.WriteString (iter->second[i]);
+        }
+    }
+}
+
+bool
+PennSearch::LoadCheckpoint (PennCheckpointReader &reader)
+{
+    if (!m_chord->LoadCheckpoint (reader))
+        return false;
+    m_dataMap.clear ();
+    uint32_t size = reader.ReadU32 ();
+    for (uint32_t i = 0; i < size && reader.IsOk (); i++)
+    {
+        std::vector<std::string> &docs = m_dataMap[reader.ReadString ()];
+        uint32_t count = reader.ReadU32 ();
+        for (uint32_t j = 0; j < count && reader.IsOk (); j++)
+        {
+            docs.push_back (reader.ReadString ());
+        }
+    }
+    return reader.IsOk ();
+}
+
 uint32_t
 PennSearch::GetNextTransactionId ()
 {
@@ -456,23 +718,21 @@ void
 PennSearch::ProcessStoreList (PennSearchMessage message, Ipv4Address sourceAddress, uint16_t sourcePort)
 {
     //SEARCH_LOG ("Recieved STORE_LIST from Node: " << ReverseLookup(sourceAddress) << " IP: " << sourceAddress << " transactionId: " << message.GetTransactionId());
-    std::vector<std::string> recVect = message.GetStoreList().docVector;
-    std::map<std::string,std::vector<std::string> >::iterator iter = m_dataMap.find(message.GetStoreList().key);
+    const PennSearchMessage::StoreList &storeList = message.GetStoreList();
+    const PennSearchMessage::StringViewList &recVect = storeList.docViews;
 
-    //SEARCH_LOG ("m_dataMap modification Key: "<<message.GetStoreList().key);
-    for(uint16_t i=0; i < recVect.size();i++)
+    //SEARCH_LOG ("m_dataMap modification Key: "<<storeList.key);
+    for(uint32_t i=0; i < recVect.size();i++)
     {
-        SEARCH_LOG("Store<"<< message.GetStoreList().key <<", "<<recVect[i]<<">");
+        SEARCH_LOG("Store<"<< storeList.key <<", "<<recVect[i]<<">");
     }
 
-    if (iter==m_dataMap.end())
-    {
-        m_dataMap[message.GetStoreList().key]= recVect;
-        return;
-    }
-    for (int i=0; i<recVect.size();i++)
+    // Documents are materialized only here, when they are stored
+    std::vector<std::string> &docs = m_dataMap[storeList.key];
+    docs.reserve (docs.size() + recVect.size());
+    for (uint32_t i=0; i<recVect.size();i++)
     {
-        iter->second.push_back(recVect[i]);
+        docs.push_back(recVect[i].ToString());
     }
     return;
 }
@@ -561,24 +821,29 @@ PennSearch::SendSearch (std::string key,Ipv4Address addressResponsible, uint32_t
 void
 PennSearch::ProcessSearch (PennSearchMessage message, Ipv4Address sourceAddress, uint16_t sourcePort)
 {
-    std::vector<std::string> currentKeyList = message.GetSearch().keyList;
+    const PennSearchMessage::Search &search = message.GetSearch();
+    std::vector<std::string> currentKeyList = search.keyList;
     std::vector<std::string>::iterator iter = currentKeyList.begin();
     std::string key = *iter;
     currentKeyList.erase(iter);
-    std::vector<std::string> currentDocList = m_dataMap.find(key)->second;
-    std:: vector<std::string> FinalDocList = FindIntersection(currentDocList,message.GetSearch().docList);
+    std::vector<std::string> FinalDocList;
+    std::map<std::string, std::vector<std::string> >::iterator it = m_dataMap.find(key);
+    if (it != m_dataMap.end())
+    {
+        FinalDocList = FindIntersection(it->second, search.docViews);
+    }
     if(currentKeyList.empty())
     {
-        SendSearchComplete (message.GetSearch().initiatorAddress, currentKeyList, FinalDocList, message.GetTransactionId());
-        //SEARCH_LOG("SearchResults<"<<ReverseLookup(message.GetSearch().initiatorAddress)<<", Empty List>");
+        SendSearchComplete (search.initiatorAddress, currentKeyList, FinalDocList, message.GetTransactionId());
+        //SEARCH_LOG("SearchResults<"<<ReverseLookup(search.initiatorAddress)<<", Empty List>");
         return;
     }
     if(FinalDocList.empty())
     {
-        SendSearchComplete (message.GetSearch().initiatorAddress, currentKeyList, FinalDocList, message.GetTransactionId());
+        SendSearchComplete (search.initiatorAddress, currentKeyList, FinalDocList, message.GetTransactionId());
         return;
     }
-    SearchData searchData = {message.GetSearch().initiatorAddress, currentKeyList, FinalDocList};
+    SearchData searchData = {search.initiatorAddress, currentKeyList, FinalDocList};
     m_searchTracker.insert (std::make_pair (message.GetTransactionId(), searchData));
     m_chord->LookupPublish(*(currentKeyList.begin()), (uint16_t)2, message.GetTransactionId());
 }
@@ -597,20 +862,16 @@ void
 PennSearch::ProcessSearchComplete (PennSearchMessage message, Ipv4Address sourceAddress, uint16_t sourcePort)
 {
     //SEARCH_LOG("Final Doc List Received");
+    const PennSearchMessage::StringViewList &docViews = message.GetSearchComplete().docViews;
     std::string final_output;
-    for(uint8_t i=0; i<message.GetSearchComplete().docList.size(); i++)
+    for(uint32_t i=0; i<docViews.size(); i++)
     {
-        final_output.append(message.GetSearchComplete().docList[i]);
+        final_output.append(docViews[i].data, docViews[i].length);
         final_output.append(" ");
-        //PRINT_LOG("\t"<< message.GetSearchComplete().docList[i]);
+        //PRINT_LOG("\t"<< docViews[i]);
     }
 
     SEARCH_LOG("SearchResults<"<<ReverseLookup(GetLocalAddress())<<", "<<final_output<<">");
-    //SEARCH_LOG("Final Key List Received");
-    for(uint8_t i=0; i<message.GetSearchComplete().keyList.size(); i++)
-    {
-        //PRINT_LOG("\t"<< message.GetSearchComplete().keyList[i]);
-    }
 
 }
 
@@ -676,22 +937,19 @@ PennSearch::PassKeysLeave (Ipv4Address successorAddress, uint32_t transactionId)
 void
 PennSearch::ProcessPassKeys (PennSearchMessage message, Ipv4Address sourceAddress, uint16_t sourcePort)
 {
-    std::vector<std::string> recVect = message.GetPassKeys().docVector;
-    std::map<std::string,std::vector<std::string> >::iterator iter = m_dataMap.find(message.GetPassKeys().key);
+    const PennSearchMessage::PassKeys &passKeys = message.GetPassKeys();
+    const PennSearchMessage::StringViewList &recVect = passKeys.docViews;
 /*
-    for(uint16_t i=0; i < recVect.size();i++)
+    for(uint32_t i=0; i < recVect.size();i++)
     {
-        SEARCH_LOG("PassKeys<"<< message.GetPassKeys().key <<": "<<recVect[i]<<">");
+        SEARCH_LOG("PassKeys<"<< passKeys.key <<": "<<recVect[i]<<">");
     }
 */
-    if (iter==m_dataMap.end())
+    std::vector<std::string> &docs = m_dataMap[passKeys.key];
+    docs.reserve (docs.size() + recVect.size());
+    for (uint32_t i=0; i<recVect.size();i++)
     {
-        m_dataMap[message.GetPassKeys().key]= recVect;
-        return;
-    }
-    for (int i=0; i<recVect.size();i++)
-    {
-        iter->second.push_back(recVect[i]);
+        docs.push_back(recVect[i].ToString());
     }
     return;
 }
@@ -839,6 +1097,30 @@ PennSearch::FindIntersection (std::vector<std::string> v1, std::vector<std::stri
     return v3;
 }
 
+std::vector<std::string>
+PennSearch::FindIntersection (const std::vector<std::string> &stored, const PennSearchMessage::StringViewList &received)
+{
+    // Sort views instead of strings, only the result is copied out
+    PennSearchMessage::StringViewList v1, v2, v3;
+    v1.reserve (stored.size());
+    for (uint32_t i=0; i<stored.size(); i++)
+    {
+        PennSearchMessage::StringView view = {stored[i].data(), (uint16_t) stored[i].length()};
+        v1.push_back (view);
+    }
+    v2 = received;
+    std::sort (v1.begin(), v1.end());
+    std::sort (v2.begin(), v2.end());
+    std::set_intersection (v1.begin(), v1.end(), v2.begin(), v2.end(), back_inserter(v3));
+    std::vector<std::string> result;
+    result.reserve (v3.size());
+    for (uint32_t i=0; i<v3.size(); i++)
+    {
+        result.push_back (v3[i].ToString());
+    }
+    return result;
+}
+
 void
 PennSearch::SHA_1 (Ipv4Address ipv4Addr, unsigned char *digest)
 {
@@ -25,6 +25,7 @@
 #include "ns3/ping-request.h"
 
 #include "ns3/ipv4-address.h"
+#include <deque>
 #include <map>
 #include <set>
 #include <vector>
@@ -48,6 +49,7 @@ class PennSearch : public PennApplication
     void SendPing (std::string nodeId, std::string pingMessage);
     void SendPennSearchPing (Ipv4Address destAddress, std::string pingMessage);
     void RecvMessage (Ptr<Socket> socket);
+    void ProcessMessage (PennSearchMessage message, Ipv4Address sourceAddress, uint16_t sourcePort);
     void ProcessPingReq (PennSearchMessage message, Ipv4Address sourceAddress, uint16_t sourcePort);
     void ProcessPingRsp (PennSearchMessage message, Ipv4Address sourceAddress, uint16_t sourcePort);
     void AuditPings ();
@@ -65,6 +67,32 @@ class PennSearch : public PennApplication
     void PassKeysJoin (Ipv4Address predecessorAddress, uint32_t transactionId);
     void PassKeysLeave (Ipv4Address successorAddress, uint32_t transactionId);
     void ProcessPassKeys (PennSearchMessage message, Ipv4Address sourceAddress, uint16_t sourcePort);
+    // Reads a keys file of "<doc> <keyword>..." lines into keyword -> documents
+    bool ReadKeyFile (std::string fileName, std::map<std::string, std::vector<std::string> > &invertLists);
+    // Stores a posting list here as STORE_LIST would, for preloaded keys
+    void StoreList (std::string key, const std::vector<std::string> &docs);
+    Ptr<PennChord> GetChord (void) const;
+    // The chord state and the posting lists stored here
+    void SaveCheckpoint (PennCheckpointWriter &writer);
+    bool LoadCheckpoint (PennCheckpointReader &reader);
+
+    enum ServiceDiscipline
+      {
+        FIFO,
+        // Searches and pings are served before STORE_LIST and PASS_KEYS
+        PRIORITY,
+      };
+    // Work of the virtual CPU of this node since the application started
+    struct ServiceStats
+    {
+      uint32_t messages;
+      uint32_t maxQueueLength;
+      Time busy;
+      Time queueDelay;
+      Time maxQueueDelay;
+      Time elapsed;
+    };
+    ServiceStats GetServiceStats (void) const;
 
     
     
@@ -90,6 +118,7 @@ class PennSearch : public PennApplication
     virtual void SetSearchVerbose (bool on);
     void Tokenizer (const std::string& str,std::vector<std::string>& tokens,const std::string& delimiters);
     std::vector<std::string> FindIntersection (std::vector<std::string> v1, std::vector<std::string> v2);
+    std::vector<std::string> FindIntersection (const std::vector<std::string> &stored, const PennSearchMessage::StringViewList &received);
     
   protected:
     virtual void DoDispose ();
@@ -108,6 +137,20 @@ class PennSearch : public PennApplication
       std::vector<std::string> docList;
     };
     
+    struct ServiceJob
+    {
+      PennSearchMessage message;
+      Ipv4Address sourceAddress;
+      uint16_t sourcePort;
+      Time arrival;
+      Time cost;
+    };
+
+    Time GetServiceTime (PennSearchMessage &message);
+    bool ParseServiceCosts (std::string costs);
+    void StartService ();
+    void FinishService ();
+
     void SHA_1 (Ipv4Address ipv4Addr, unsigned char *digest);
     void SHA_1 (std::string s, unsigned char *digest);
     uint8_t compareSHA1 (unsigned char *digest1, unsigned char *digest2);
@@ -115,6 +158,7 @@ class PennSearch : public PennApplication
     
     Ptr<PennChord> m_chord;
     uint32_t m_currentTransactionId;
+    PennRandom m_random;
     Ptr<Socket> m_socket;
     Time m_pingTimeout;
     uint16_t m_appPort, m_chordPort;
@@ -123,6 +167,20 @@ class PennSearch : public PennApplication
     // Ping tracker
     std::map<uint32_t, Ptr<PingRequest> > m_pingTracker;
     std::map<uint32_t, SearchData> m_searchTracker;
+    // Virtual CPU
+    Time m_serviceTime;
+    Time m_serviceTimePerEntry;
+    std::string m_serviceCostsString;
+    double m_serviceMeasured;
+    ServiceDiscipline m_serviceDiscipline;
+    // message type -> (base cost, cost per list entry)
+    std::map<uint8_t, std::pair<Time, Time> > m_serviceCosts;
+    std::deque<ServiceJob> m_serviceQueue[2];
+    ServiceJob m_serviceJob;
+    bool m_serviceBusy;
+    EventId m_serviceEvent;
+    ServiceStats m_serviceStats;
+    Time m_serviceStart;
     
 };
 
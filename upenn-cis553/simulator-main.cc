@@ -32,9 +32,13 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <iostream>
+#include <iomanip>
+#include <sstream>
 #include <string.h>
 #include <vector>
+#include <algorithm>
 #include <map>
+#include <set>
 #include "ns3/core-module.h"
 #include "ns3/common-module.h"
 #include "ns3/node-module.h"
@@ -46,11 +50,17 @@
 
 #include "ns3/ls-routing-helper.h"
 #include "ns3/dv-routing-helper.h"
+#include "ns3/ls-area-partitioner.h"
 #include "ns3/penn-search-helper.h"
 #include "ns3/l4-platform-helper.h"
 #include "ns3/l4-device.h"
+#include "ns3/event-trace-scheduler.h"
+#include "ns3/penn-random.h"
+#include "ns3/penn-share-table.h"
+#include "ns3/parallel-simulator-impl.h"
 
 #include <sys/types.h>
+#include <sys/time.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -68,6 +78,7 @@
 #define SIM_MODULE_NAME "SIM"
 
 #define START_TIME 0
+#define CHECKPOINT_MAGIC 0x504e4331
 
 using namespace ns3;
 
@@ -83,6 +94,8 @@ struct CommandHandlerArgument
 
 void Tokenize(const std::string& str, std::vector<std::string>& tokens, const std::string& delimiters);
 void UpperCase (std::string &str);
+std::map<uint32_t, uint32_t> ReadInetAreas (std::string topologyFile);
+void WriteMetrics (std::string metricsFile, double wallSeconds, NodeContainer nodes);
 
 class SimulatorMain
 {
@@ -103,6 +116,10 @@ class SimulatorMain
     void LinkOperation (uint32_t linkNumber, bool isUp);
     void P2POperation (uint32_t nodeANum, uint32_t nodeBNum, bool isUp);
     void AllInterfacesOperation (uint32_t nodeNumber, bool isUp);
+    void ChordBootstrap (std::vector<uint32_t> nodeNumbers);
+    void ChordPreload (std::string fileName);
+    void Checkpoint (std::string fileName);
+    void Restore (std::string fileName);
 
     void SetRoutingVerbose (Ptr<PennRoutingProtocol> routingProtocol, std::vector<std::string> tokens);
     void SetApplicationVerbose (Ptr<PennApplication> application, std::vector<std::string> tokens);
@@ -121,10 +138,13 @@ class SimulatorMain
     uint32_t m_scanDelay;
     uint32_t m_notReadyCount;
     uint32_t m_totalNodes, m_totalLinks;
+    PennSearchHelper m_chordBootstrap;
 
     pthread_t m_commandHandlerThreadId;
     struct CommandHandlerArgument m_thArgument;
 
+    Ptr<LSRoutingProtocol> GetLSRouting (uint32_t nodeNumber);
+
     // Print
     void PrintCharArray (uint8_t*, uint32_t, std::ostream&);
     void PrintHexArray (uint8_t*, uint32_t, std::ostream&);
@@ -417,6 +437,59 @@ SimulatorMain::ProcessCommandTokens (std::vector<std::string> tokens, Time time)
           return;
         }
     }
+  else if (command == "CHECKPOINT")
+    {
+      // CHECKPOINT <file> saves the routing, chord and search state of
+      // every node, simulator-main --restore=<file> starts from it
+      if (m_realStack || tokens.size () != 2)
+        {
+          NS_LOG_ERROR ("CHECKPOINT needs the simulated stack and a file name");
+          return;
+        }
+      Simulator::Schedule (MilliSeconds (time.GetMilliSeconds ()), &SimulatorMain::Checkpoint, this, tokens[1]);
+    }
+  else if (command == "CHORD")
+    {
+      // CHORD BOOTSTRAP [<node> ...] builds the converged ring of the
+      // nodes, all of them if none is given, and CHORD PRELOAD <keys file>
+      // places posting lists on it as if they were published
+      if (m_realStack)
+        {
+          NS_LOG_ERROR ("CHORD BOOTSTRAP and PRELOAD need the simulated stack");
+          return;
+        }
+      tokens.erase (iterator);
+      iterator = tokens.begin ();
+      UpperCase (*iterator);
+      std::string operation = *iterator;
+      tokens.erase (iterator);
+      if (operation == "BOOTSTRAP")
+        {
+          std::vector<uint32_t> nodeNumbers;
+          for (iterator = tokens.begin (); iterator != tokens.end (); iterator++)
+            {
+              uint32_t nodeNumber = atoi ((*iterator).c_str ());
+              if (nodeNumber >= m_totalNodes)
+                {
+                  NS_LOG_ERROR ("Invalid node number!");
+                  return;
+                }
+              nodeNumbers.push_back (nodeNumber);
+            }
+          if (nodeNumbers.empty ())
+            {
+              for (uint32_t i = 0 ; i < m_totalNodes ; i++)
+                {
+                  nodeNumbers.push_back (i);
+                }
+            }
+          Simulator::Schedule (MilliSeconds (time.GetMilliSeconds ()), &SimulatorMain::ChordBootstrap, this, nodeNumbers);
+        }
+      else if (operation == "PRELOAD" && tokens.size () == 1)
+        {
+          Simulator::Schedule (MilliSeconds (time.GetMilliSeconds ()), &SimulatorMain::ChordPreload, this, tokens[0]);
+        }
+    }
   else if (*iterator == "*")    
     {
       // Send command to all nodes 
@@ -755,6 +828,116 @@ SimulatorMain::P2POperation (uint32_t nodeANum, uint32_t nodeBNum, bool isUp)
 
 }
 
+void
+SimulatorMain::ChordBootstrap (std::vector<uint32_t> nodeNumbers)
+{
+  NodeContainer members;
+  for (uint32_t i = 0 ; i < nodeNumbers.size () ; i++)
+    {
+      members.Add (m_nodeContainer.Get (nodeNumbers[i]));
+    }
+  m_chordBootstrap.BootstrapChord (members);
+  NS_LOG_INFO ("Chord ring bootstrapped with " << members.GetN () << " nodes");
+}
+
+void
+SimulatorMain::ChordPreload (std::string fileName)
+{
+  if (!m_chordBootstrap.PreloadKeys (fileName))
+    {
+      NS_LOG_ERROR ("Cannot preload " << fileName << ", is the ring bootstrapped?");
+    }
+}
+
+Ptr<LSRoutingProtocol>
+SimulatorMain::GetLSRouting (uint32_t nodeNumber)
+{
+  Ptr<Ipv4> ipv4 = m_nodeContainer.Get (nodeNumber)->GetObject<Ipv4> ();
+  Ptr<Ipv4ListRouting> listRouting = ipv4 ? DynamicCast<Ipv4ListRouting> (ipv4->GetRoutingProtocol ()) : 0;
+  if (!listRouting)
+    {
+      return 0;
+    }
+  for (uint32_t i = 0 ; i < listRouting->GetNRoutingProtocols () ; i++)
+    {
+      int16_t priority;
+      Ptr<LSRoutingProtocol> lsRouting = DynamicCast<LSRoutingProtocol> (listRouting->GetRoutingProtocol (i, priority));
+      if (lsRouting)
+        {
+          return lsRouting;
+        }
+    }
+  return 0;
+}
+
+/*
+ * A checkpoint holds the magic, the time it was taken and the number of
+ * nodes, then per node a flag and the LS state if it runs LS, and the
+ * chord and search state.  DV and the messages in flight are not
+ * saved, DV converges again after a restore.
+ */
+void
+SimulatorMain::Checkpoint (std::string fileName)
+{
+  std::ofstream file (fileName.c_str (), std::ios::binary);
+  if (!file)
+    {
+      NS_LOG_ERROR ("Cannot open checkpoint " << fileName);
+      return;
+    }
+  PennCheckpointWriter writer (file);
+  writer.WriteU32 (CHECKPOINT_MAGIC);
+  writer.WriteTime (Simulator::Now ());
+  writer.WriteU32 (m_totalNodes);
+  for (uint32_t i = 0 ; i < m_totalNodes ; i++)
+    {
+      Ptr<LSRoutingProtocol> lsRouting = GetLSRouting (i);
+      writer.WriteU8 (lsRouting != 0);
+      if (lsRouting)
+        {
+          lsRouting->SaveCheckpoint (writer);
+        }
+      m_nodeContainer.Get (i)->GetApplication (0)->GetObject<PennSearch> ()->SaveCheckpoint (writer);
+    }
+  if (!file)
+    {
+      NS_LOG_ERROR ("Cannot write checkpoint " << fileName);
+      return;
+    }
+  NS_LOG_INFO ("Checkpoint of " << m_totalNodes << " nodes written to " << fileName);
+}
+
+void
+SimulatorMain::Restore (std::string fileName)
+{
+  std::ifstream file (fileName.c_str (), std::ios::binary);
+  PennCheckpointReader reader (file);
+  if (!file || reader.ReadU32 () != CHECKPOINT_MAGIC)
+    {
+      NS_FATAL_ERROR ("Cannot read checkpoint " << fileName);
+    }
+  // the time the checkpoint was taken, the restored run has its own clock
+  reader.ReadTime ();
+  if (reader.ReadU32 () != m_totalNodes)
+    {
+      NS_FATAL_ERROR ("Checkpoint " << fileName << " is of another topology");
+    }
+  for (uint32_t i = 0 ; i < m_totalNodes ; i++)
+    {
+      Ptr<LSRoutingProtocol> lsRouting = GetLSRouting (i);
+      if (reader.ReadU8 () != (lsRouting != 0))
+        {
+          NS_FATAL_ERROR ("Checkpoint " << fileName << " is of another routing protocol");
+        }
+      if ((lsRouting && !lsRouting->LoadCheckpoint (reader))
+          || !m_nodeContainer.Get (i)->GetApplication (0)->GetObject<PennSearch> ()->LoadCheckpoint (reader))
+        {
+          NS_FATAL_ERROR ("Checkpoint " << fileName << " is corrupt");
+        }
+    }
+  NS_LOG_INFO ("Restored " << m_totalNodes << " nodes from " << fileName);
+}
+
 void
 SimulatorMain::LinkOperation (uint32_t linkNumber, bool isUp)
 {
@@ -797,6 +980,163 @@ UpperCase (std::string &str)
     }
 }
 
+/*
+ * Wall clock time of the setup phases of main, printed with
+ * --profile-startup.  Each Mark ends the phase started by the one
+ * before it.
+ */
+class StartupProfile
+{
+public:
+  StartupProfile ()
+  {
+    gettimeofday (&m_start, 0);
+    m_last = m_start;
+  }
+
+  void Mark (std::string phase)
+  {
+    struct timeval now;
+    gettimeofday (&now, 0);
+    m_phases.push_back (std::make_pair (phase, ToSeconds (now) - ToSeconds (m_last)));
+    m_last = now;
+  }
+
+  void Print (void)
+  {
+    std::cout << "Startup profile:" << std::endl;
+    for (uint32_t i = 0; i < m_phases.size (); i++)
+      {
+        std::cout << "  " << std::setw (20) << std::left << m_phases[i].first << std::right
+                  << std::fixed << std::setprecision (3) << m_phases[i].second << " s" << std::endl;
+      }
+    std::cout << "  " << std::setw (20) << std::left << "total" << std::right
+              << std::fixed << std::setprecision (3) << ToSeconds (m_last) - ToSeconds (m_start) << " s" << std::endl;
+    std::cout.unsetf (std::ios::floatfield);
+  }
+
+private:
+  static double ToSeconds (const struct timeval &time)
+  {
+    return time.tv_sec + time.tv_usec / 1e6;
+  }
+
+  struct timeval m_start;
+  struct timeval m_last;
+  std::vector<std::pair<std::string, double> > m_phases;
+};
+
+/*
+ * Inet node lines are "node x y", an optional fourth column puts the node
+ * into an LS area.  Returns no areas unless every node has one.
+ */
+std::map<uint32_t, uint32_t>
+ReadInetAreas (std::string topologyFile)
+{
+  std::map<uint32_t, uint32_t> nodeAreaMap;
+  std::ifstream topology (topologyFile.c_str ());
+  std::string line;
+  uint32_t totalNodes = 0;
+  if (!std::getline (topology, line))
+    {
+      return nodeAreaMap;
+    }
+  std::istringstream (line) >> totalNodes;
+  for (uint32_t i = 0; i < totalNodes && std::getline (topology, line); i++)
+    {
+      std::vector<std::string> tokens;
+      Tokenize (line, tokens, " \t");
+      if (tokens.size () < 4)
+        {
+          nodeAreaMap.clear ();
+          return nodeAreaMap;
+        }
+      nodeAreaMap[atoi (tokens[0].c_str ())] = atoi (tokens[3].c_str ());
+    }
+  return nodeAreaMap;
+}
+
+// nearest rank
+static float
+Percentile (const std::vector<float> &sorted, double fraction)
+{
+  if (sorted.empty ())
+    {
+      return 0;
+    }
+  uint32_t rank = (uint32_t) (fraction * sorted.size () + 0.999999);
+  return sorted[std::min (std::max (rank, (uint32_t) 1), (uint32_t) sorted.size ()) - 1];
+}
+
+/*
+ * One "name value" line per metric, for sweep-runner.  Message counts
+ * are totals over all nodes, the LS ones since the last DUMP SPF.  The
+ * service ones are the virtual CPUs of PennSearch, the most utilized
+ * node is the hot spot.  The sorted lookup latencies go to a second
+ * file, one per line, so that sweep-runner can take the percentiles of
+ * several runs together.
+ */
+void
+WriteMetrics (std::string metricsFile, double wallSeconds, NodeContainer nodes)
+{
+  std::ofstream file (metricsFile.c_str ());
+  if (!file)
+    {
+      NS_LOG_ERROR ("Unable to open metrics file " << metricsFile);
+      return;
+    }
+  std::vector<float> latencies = PennChord::globalLatencies;
+  std::sort (latencies.begin (), latencies.end ());
+  std::ofstream latenciesFile ((metricsFile + ".latencies").c_str ());
+  for (uint32_t i = 0; i < latencies.size (); i++)
+    {
+      latenciesFile << latencies[i] << std::endl;
+    }
+  uint32_t lsps;
+  uint64_t floodingBytes;
+  uint32_t spfRuns;
+  LSRoutingProtocol::GetStats (lsps, floodingBytes, spfRuns);
+  file << "sim_seconds " << Simulator::Now ().GetSeconds () << std::endl;
+  file << "wall_seconds " << wallSeconds << std::endl;
+  file << "lookups " << latencies.size () << std::endl;
+  file << "lookup_hops " << (PennChord::globalQueryCount > 0 ? PennChord::globalHopCount / PennChord::globalQueryCount : 0) << std::endl;
+  file << "lookup_p50_ms " << Percentile (latencies, 0.5) << std::endl;
+  file << "lookup_p90_ms " << Percentile (latencies, 0.9) << std::endl;
+  file << "lookup_p99_ms " << Percentile (latencies, 0.99) << std::endl;
+  file << "lookup_max_ms " << (latencies.empty () ? 0 : latencies.back ()) << std::endl;
+  file << "chord_messages " << PennChord::globalControlCount << std::endl;
+  file << "chord_bytes " << PennChord::globalControlBytes << std::endl;
+  file << "lsps " << lsps << std::endl;
+  file << "flooding_bytes " << floodingBytes << std::endl;
+  file << "spf_runs " << spfRuns << std::endl;
+  file << "route_convergence_ms " << LSRoutingProtocol::GetLastRouteChange ().GetMilliSeconds () << std::endl;
+
+  uint32_t messages = 0;
+  Time queueDelay = Seconds (0);
+  Time maxQueueDelay = Seconds (0);
+  double maxUtilization = 0;
+  uint32_t hotNode = 0;
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      Ptr<PennSearch> application = nodes.Get (i)->GetApplication (0)->GetObject<PennSearch> ();
+      PennSearch::ServiceStats stats = application->GetServiceStats ();
+      messages += stats.messages;
+      queueDelay += stats.queueDelay;
+      maxQueueDelay = Max (maxQueueDelay, stats.maxQueueDelay);
+      double utilization = stats.elapsed.IsZero () ? 0 : stats.busy.GetSeconds () / stats.elapsed.GetSeconds ();
+      if (utilization > maxUtilization)
+        {
+          maxUtilization = utilization;
+          hotNode = i;
+        }
+    }
+  file << "service_messages " << messages << std::endl;
+  file << "service_queue_delay_mean_ms " << (messages > 0 ? queueDelay.GetSeconds () * 1000 / messages : 0) << std::endl;
+  file << "service_queue_delay_max_ms " << maxQueueDelay.GetSeconds () * 1000 << std::endl;
+  file << "service_utilization_max " << maxUtilization << std::endl;
+  file << "service_hot_node " << hotNode << std::endl;
+}
+
 /* Method Tokenize, Credits:  http://oopweb.com/CPP/Documents/CPPHOWTO/Volume/C++Programming-HOWTO-7.html */
 
 void 
@@ -823,6 +1163,7 @@ Tokenize(const std::string& str,
 int
 main (int argc, char *argv[])
 {
+  StartupProfile profile;
   std::string scriptFile = "";
   std::string topologyFile = "";
   std::string routingProtocol = LS_MODULE_NAME;
@@ -830,6 +1171,21 @@ main (int argc, char *argv[])
   std::string realStack = "";
 
   std::string localAddress = "";
+  std::string packetPool = "";
+  std::string eventPool = "";
+  std::string inetDelays = "";
+  uint32_t areaSize = 0;
+  std::string eventTrace = "";
+  uint32_t threads = 1;
+  uint32_t mtu = 1500;
+  std::string restoreFile = "";
+  std::string metricsFile = "";
+  uint32_t seed = 1;
+  uint32_t run = 1;
+  std::string nodeSeeds = "";
+  std::string eventHash = "";
+  std::string expectHash = "";
+  std::string profileStartup = "";
 
   // Command Line parameters
   CommandLine cmd;
@@ -839,10 +1195,74 @@ main (int argc, char *argv[])
   cmd.AddValue ("anim-file",  "File Name for Animation Logs", animFile);
   cmd.AddValue ("real-stack", "Use real IP stack/sockets: <yes/no>", realStack);
   cmd.AddValue ("local-address", "Local Address if real stack is used (optional)", localAddress);
+  cmd.AddValue ("packet-pool", "Recycle packets and buffers through free lists, not with real-stack: <yes/no>", packetPool);
+  cmd.AddValue ("event-pool", "Recycle simulator events through free lists, not with real-stack: <yes/no>", eventPool);
+  cmd.AddValue ("inet-delays", "Use Inet link weights as link delays in microseconds: <yes/no>", inetDelays);
+  cmd.AddValue ("area-size", "Split the topology into LS areas of about this many nodes, 0 takes the areas from a fourth column of the Inet node lines if there is one", areaSize);
+  cmd.AddValue ("event-trace", "Record every scheduler operation to this file, for bench-scheduler", eventTrace);
+  cmd.AddValue ("mtu", "MTU of the point-to-point links in bytes, up to 65535 for large search results", mtu);
+  cmd.AddValue ("restore", "Start from the state saved by a CHECKPOINT scenario command, on the same topology and routing", restoreFile);
+  cmd.AddValue ("metrics", "Write the lookup latencies, message counts and route convergence time of the run to this file", metricsFile);
+  cmd.AddValue ("seed", "Seed of the random streams of every module of every node", seed);
+  cmd.AddValue ("run", "Run number, picks the substream of every random stream", run);
+  cmd.AddValue ("node-seeds", "Seed and run of single nodes instead of the global ones: <node>:<seed>:<run>[,...]", nodeSeeds);
+  cmd.AddValue ("event-hash", "Hash every scheduler operation and print the hash at the end, equal hashes mean identical runs: <yes/no>", eventHash);
+  cmd.AddValue ("expect-hash", "Hash the events as event-hash does and fail unless the hash is this one", expectHash);
+  cmd.AddValue ("profile-startup", "Print the wall clock time of the setup phases up to the start of the nodes: <yes/no>", profileStartup);
+  cmd.AddValue ("threads", "Run the nodes on this many threads with the parallel simulator, not with real-stack or the pools", threads);
 
   cmd.Parse (argc, argv);
   
+  if (!metricsFile.empty ())
+    {
+      Config::SetDefault ("PennChord::ReportLatency", BooleanValue (true));
+    }
   UpperCase (realStack);
+  UpperCase (eventHash);
+  UpperCase (profileStartup);
+  UpperCase (packetPool);
+  UpperCase (eventPool);
+  UpperCase (inetDelays);
+
+  SeedManager::SetSeed (seed);
+  SeedManager::SetRun (run);
+  PennRandom::SetSeed (seed, run);
+  std::vector<std::string> nodeSeedList;
+  Tokenize (nodeSeeds, nodeSeedList, ",");
+  for (uint32_t i = 0 ; i < nodeSeedList.size () ; i++)
+    {
+      std::vector<std::string> fields;
+      Tokenize (nodeSeedList[i], fields, ":");
+      if (fields.size () != 3)
+        {
+          NS_FATAL_ERROR ("node-seeds takes <node>:<seed>:<run>, not " << nodeSeedList[i]);
+        }
+      PennRandom::SetNodeSeed (atoi (fields[0].c_str ()), atoi (fields[1].c_str ()), atoi (fields[2].c_str ()));
+    }
+  bool hashEvents = eventHash == "YES" || !expectHash.empty ();
+
+  if (threads > 1)
+    {
+      // the pools and the event trace are not locked, and the real
+      // stack has its own simulator
+      if (packetPool == "YES" || eventPool == "YES" || realStack == "YES" || !eventTrace.empty () || hashEvents)
+        {
+          NS_FATAL_ERROR ("threads cannot be used with packet-pool, event-pool, real-stack, event-trace or event-hash");
+        }
+      GlobalValue::Bind ("SimulatorImplementationType",
+                         StringValue ("ns3::ParallelSimulatorImpl"));
+    }
+
+  if (packetPool == "YES")
+    {
+      // the real stack runs a select thread and the command handler
+      // thread next to the simulator, and the packet pool is not locked
+      if (realStack == "YES")
+        {
+          NS_FATAL_ERROR ("packet-pool cannot be used with real-stack");
+        }
+      Packet::EnablePool (true);
+    }
 
   if (realStack == "YES")
     {
@@ -850,12 +1270,39 @@ main (int argc, char *argv[])
                          StringValue ("ns3::RealtimeSimulatorImpl"));
     }
 
+  if (eventPool == "YES")
+    {
+      // the command handler thread schedules events of its own with
+      // the realtime simulator, and the event pool is not locked
+      if (realStack == "YES")
+        {
+          NS_FATAL_ERROR ("event-pool cannot be used with real-stack");
+        }
+      EventImpl::EnablePool (true);
+    }
+
+  if (!eventTrace.empty () || hashEvents)
+    {
+      if (!eventTrace.empty () && !EventTraceScheduler::Open (eventTrace))
+        {
+          NS_FATAL_ERROR ("Unable to open event trace file " << eventTrace);
+        }
+      if (hashEvents)
+        {
+          EventTraceScheduler::EnableHash ();
+        }
+      ObjectFactory schedulerFactory;
+      schedulerFactory.SetTypeId (EventTraceScheduler::GetTypeId ());
+      Simulator::SetScheduler (schedulerFactory);
+    }
+
   // Enable Logs
   LogComponentEnable ("SimulatorMain", LOG_LEVEL_ALL);
   LogComponentEnable ("LSRoutingProtocol", LOG_LEVEL_ALL);
   LogComponentEnable ("UdpTransportSocketImpl", LOG_LEVEL_ERROR);
   LogComponentEnable ("TcpTransportSocketImpl", LOG_LEVEL_ERROR);
   LogComponentEnable ("Ipv4GlobalRouting", LOG_LEVEL_ALL);
+  profile.Mark ("options");
     
   // Create SimulatorMain
   SimulatorMain simulatorMain;
@@ -867,15 +1314,11 @@ main (int argc, char *argv[])
   NodeContainer nodeContainer, realNodeContainer;
   NetDeviceContainer* ndc = NULL;
   uint32_t totalLinks = 0, totalNodes = 0;
-  Ipv4InterfaceContainer* ipic = NULL;
-  NodeContainer* nc = NULL;
   Ipv4Address local;
   std::string nodeName;
 
   if (realStack != "YES")
     {  
-      std::map<uint32_t, Ptr<Node> > nodeMap;
-
       topoHelper.SetFileName (topologyFile);
       topoHelper.SetFileType ("Inet");
       topologyReader = topoHelper.GetTopologyReader ();
@@ -884,6 +1327,7 @@ main (int argc, char *argv[])
         {
           nodeContainer = topologyReader->Read ();
         }
+      profile.Mark ("read topology");
       if (topologyReader->LinksSize () == 0)
         {
           NS_FATAL_ERROR ("Unable to read/parse topology file");
@@ -932,6 +1376,7 @@ main (int argc, char *argv[])
       NS_LOG_INFO ("Routing protocol: " << routingProtocol);
       internetStack.SetRoutingHelper (listRoutingHelper);
       internetStack.Install (nodeContainer);
+      profile.Mark ("internet stack");
 
       NS_LOG_INFO ("Assigning IP addresses to nodes...");
       Ipv4AddressHelper address;
@@ -940,61 +1385,124 @@ main (int argc, char *argv[])
       totalLinks = topologyReader->LinksSize ();
       totalNodes = nodeContainer.GetN ();
 
-      NS_LOG_INFO ("Creating node containers... Nodes : " << totalNodes);
-      nc = new NodeContainer[totalLinks];
+      NS_LOG_INFO ("Creating network devices... Nodes : " << totalNodes << " Links : " << totalLinks);
+      // Inet node numbers run from 0 to totalNodes - 1
+      std::vector<Ptr<Node> > nodes (totalNodes);
+      ndc = new NetDeviceContainer[totalLinks];
+      LSAreaPartitioner::LinkList areaLinks;
+      PointToPointHelper p2p;
+      p2p.SetDeviceAttribute ("DataRate", StringValue ("5Mbps"));
+      p2p.SetDeviceAttribute ("Mtu", UintegerValue (mtu));
       TopologyReader::ConstLinksIterator iter;
       int num = 0;
       for (iter = topologyReader->LinksBegin (); iter != topologyReader->LinksEnd(); iter++, num++)
         {
-          std::istringstream fromName(iter->GetFromNodeName ());
-          std::istringstream toName (iter->GetToNodeName ());
-          uint32_t from, to;
-          fromName >> from;
-          toName >> to;
+          uint32_t from = atoi (iter->GetFromNodeName ().c_str ());
+          uint32_t to = atoi (iter->GetToNodeName ().c_str ());
           NS_LOG_INFO ("Adding Link From: " << from << " To: " << to);
-          nodeMap.insert (std::make_pair (from, iter->GetFromNode()));
-          nodeMap.insert (std::make_pair (to, iter->GetToNode()));
-          nc[num] = NodeContainer (iter->GetFromNode (), iter->GetToNode ());
+          if (from >= totalNodes || to >= totalNodes)
+            {
+              NS_FATAL_ERROR ("Corrupt node container!");
+            }
+          nodes[from] = iter->GetFromNode ();
+          nodes[to] = iter->GetToNode ();
+          areaLinks.push_back (std::make_pair (from, to));
+          Time delay = MilliSeconds (2);
+          if (inetDelays == "YES")
+            {
+              TopologyReader::Link link = *iter;
+              std::string weight;
+              if (link.GetAttributeFailSafe ("Weight", weight))
+                {
+                  delay = MicroSeconds (std::max (atoi (weight.c_str ()), 1));
+                }
+            }
+          p2p.SetChannelAttribute ("Delay", TimeValue (delay));
+          ndc[num] = p2p.Install (iter->GetFromNode (), iter->GetToNode ());
         }
 
       // Create real node container
       for (uint32_t i = 0 ; i < totalNodes ; i++)
         {
-          std::map<uint32_t, Ptr<Node> >::iterator iter = nodeMap.find(i);
-          if (iter != nodeMap.end())
+          if (nodes[i] == 0)
             {
-              Ptr<Node> node = iter->second;
-              realNodeContainer.Add (node);
+              NS_FATAL_ERROR ("Corrupt node container!");
             }
-          else
+          realNodeContainer.Add (nodes[i]);
+        }
+      profile.Mark ("devices");
+
+      // LS areas
+      std::map<uint32_t, uint32_t> nodeAreaMap;
+      if (areaSize > 0)
+        {
+          std::vector<uint32_t> partition = LSAreaPartitioner::Partition (totalNodes, areaLinks, areaSize);
+          for (uint32_t i = 0 ; i < totalNodes ; i++)
             {
-              NS_FATAL_ERROR ("Corrupt node container!");
+              nodeAreaMap[i] = partition[i];
             }
         }
+      else
+        {
+          nodeAreaMap = ReadInetAreas (topologyFile);
+        }
+      std::set<uint32_t> areas;
+      for (std::map<uint32_t, uint32_t>::iterator iter = nodeAreaMap.begin (); iter != nodeAreaMap.end (); iter++)
+        {
+          areas.insert (iter->second);
+        }
+      NS_LOG_INFO ("LS areas: " << areas.size ());
 
-      NS_LOG_INFO ("Creating network device containers... Links : " << totalLinks);
-      ndc = new NetDeviceContainer[totalLinks];
-      PointToPointHelper p2p;
-      for (uint32_t i = 0 ; i < totalLinks ; i++)
+      if (threads > 1)
         {
-          p2p.SetChannelAttribute ("Delay", StringValue ("2ms"));
-          p2p.SetDeviceAttribute ("DataRate", StringValue ("5Mbps"));
-          ndc[i] = p2p.Install (nc[i]);
+          // connected areas keep most links, and the events sent over
+          // them, within one thread. The areas are about half the size
+          // of a thread's share, and the largest go first to the thread
+          // with the fewest nodes.
+          std::vector<uint32_t> area = LSAreaPartitioner::Partition (totalNodes, areaLinks,
+                                                                     (totalNodes + 2 * threads - 1) / (2 * threads));
+          std::vector<std::pair<uint32_t, uint32_t> > areaSizes;
+          for (uint32_t i = 0 ; i < totalNodes ; i++)
+            {
+              if (area[i] >= areaSizes.size ())
+                {
+                  areaSizes.resize (area[i] + 1, std::make_pair (0, 0));
+                }
+              areaSizes[area[i]].first++;
+              areaSizes[area[i]].second = area[i];
+            }
+          std::sort (areaSizes.rbegin (), areaSizes.rend ());
+          std::vector<uint32_t> areaThread (areaSizes.size ());
+          std::vector<uint32_t> load (threads, 0);
+          for (uint32_t i = 0 ; i < areaSizes.size () ; i++)
+            {
+              uint32_t thread = std::min_element (load.begin (), load.end ()) - load.begin ();
+              areaThread[areaSizes[i].second] = thread;
+              load[thread] += areaSizes[i].first;
+            }
+          std::vector<uint32_t> partitions (NodeList::GetNNodes (), 0);
+          for (uint32_t i = 0 ; i < totalNodes ; i++)
+            {
+              partitions[realNodeContainer.Get (i)->GetId ()] = areaThread[area[i]];
+            }
+          Ptr<ParallelSimulatorImpl> parallel = DynamicCast<ParallelSimulatorImpl> (Simulator::GetImplementation ());
+          parallel->SetPartitions (partitions);
+          NS_LOG_INFO ("Partitions: " << parallel->GetNPartitions ());
         }
 
       // Create subnets for each couple of nodes
-      ipic = new Ipv4InterfaceContainer[totalLinks];
       for (uint32_t i = 0 ; i < totalLinks ; i++)
         {
-          ipic[i] = address.Assign (ndc[i]);
+          address.Assign (ndc[i]);
           address.NewNetwork ();
         } 
+      profile.Mark ("addresses");
 
       NS_LOG_INFO ("Assigning Main IP addresses...");
-      // Assign main ip-address(es)
+      // Assign main ip-address(es), the first one of a node
+      std::vector<int32_t> mainInterfaces (totalNodes, -1);
       for (uint32_t i = 0 ; i < totalNodes ; i++)
         {
-          bool mainSet = false;
           Ptr<Ipv4> ipv4 = realNodeContainer.Get(i)->GetObject<Ipv4> ();
           for (uint32_t j = 0 ; j < ipv4->GetNInterfaces () ; j++)
             {
@@ -1003,50 +1511,21 @@ main (int argc, char *argv[])
                 continue;
               // Add to address-node map
               simulatorMain.g_addressNodeMap.insert (std::make_pair(addr, i));
-              if (mainSet == false)
+              if (mainInterfaces[i] < 0)
                 {
-                  mainSet = true;
-                  Ipv4Address mainAddress = addr;
-                  simulatorMain.g_nodeAddressMap.insert (std::make_pair (i, mainAddress)); 
-                  NS_LOG_INFO ("Node: " << i << " Main Address: " << mainAddress);
-                  //Get Routing Protocol
-                  Ptr<Ipv4ListRouting> listRouting = DynamicCast<Ipv4ListRouting> (ipv4->GetRoutingProtocol ());
-                  if (!listRouting)
-                    {
-                      continue;
-                    }
-                  uint32_t protocols = listRouting->GetNRoutingProtocols ();
-                  for (uint32_t k = 0 ; k < protocols ; k++)
-                    {
-                      int16_t priority;
-                      Ptr<LSRoutingProtocol> lsRouting = DynamicCast<LSRoutingProtocol> (listRouting->GetRoutingProtocol (k, priority));
-                      if (lsRouting)
-                        {
-                          std::ostringstream nodeId;
-                          nodeId << i;
-                          lsRouting->SetNodeId (nodeId.str ());
-                          lsRouting->SetModuleName (LS_MODULE_NAME);
-                          lsRouting->SetMainInterface (j);
-                          continue;
-                        }
-                      Ptr<DVRoutingProtocol> dvRouting = DynamicCast<DVRoutingProtocol> (listRouting->GetRoutingProtocol (k, priority));
-                      if (dvRouting)
-                        {
-                          std::ostringstream nodeId;
-                          nodeId << i;
-                          dvRouting->SetNodeId (nodeId.str ());
-                          dvRouting->SetModuleName (DV_MODULE_NAME);
-                          dvRouting->SetMainInterface (j);
-                          continue;
-                        }
-                    }
+                  mainInterfaces[i] = j;
+                  simulatorMain.g_nodeAddressMap.insert (simulatorMain.g_nodeAddressMap.end (), std::make_pair (i, addr));
+                  NS_LOG_INFO ("Node: " << i << " Main Address: " << addr);
                 }
             }
         }
 
-      // Assign node-address map
+      // Every node is handed the same tables, one shared copy of each
+      const std::map<uint32_t, Ipv4Address> &nodeAddressMap = *PennShareTable (simulatorMain.g_nodeAddressMap);
+      const std::map<Ipv4Address, uint32_t> &addressNodeMap = *PennShareTable (simulatorMain.g_addressNodeMap);
+      const std::map<uint32_t, uint32_t> &sharedAreaMap = *PennShareTable (nodeAreaMap);
       for (uint32_t i = 0 ; i < totalNodes ; i++)
-        {      
+        {
           Ptr<Ipv4> ipv4 = realNodeContainer.Get(i)->GetObject<Ipv4> ();
           //Get Routing Protocol
           Ptr<Ipv4ListRouting> listRouting = DynamicCast<Ipv4ListRouting> (ipv4->GetRoutingProtocol ());
@@ -1054,27 +1533,43 @@ main (int argc, char *argv[])
             {
               continue;
             }
+          std::ostringstream nodeId;
+          nodeId << i;
           uint32_t protocols = listRouting->GetNRoutingProtocols ();
           for (uint32_t k = 0 ; k < protocols ; k++)
             {
               int16_t priority;
-              Ptr<LSRoutingProtocol> lsRouting = DynamicCast<LSRoutingProtocol> (listRouting->GetRoutingProtocol (k, priority));
+              Ptr<Ipv4RoutingProtocol> protocol = listRouting->GetRoutingProtocol (k, priority);
+              Ptr<LSRoutingProtocol> lsRouting = DynamicCast<LSRoutingProtocol> (protocol);
               if (lsRouting)
                 {
-                  lsRouting->SetNodeAddressMap (simulatorMain.g_nodeAddressMap);
-                  lsRouting->SetAddressNodeMap (simulatorMain.g_addressNodeMap);
+                  if (mainInterfaces[i] >= 0)
+                    {
+                      lsRouting->SetNodeId (nodeId.str ());
+                      lsRouting->SetModuleName (LS_MODULE_NAME);
+                      lsRouting->SetMainInterface (mainInterfaces[i]);
+                    }
+                  lsRouting->SetNodeAddressMap (nodeAddressMap);
+                  lsRouting->SetAddressNodeMap (addressNodeMap);
+                  lsRouting->SetNodeAreaMap (sharedAreaMap);
                   continue;
                 }
-              Ptr<DVRoutingProtocol> dvRouting = DynamicCast<DVRoutingProtocol> (listRouting->GetRoutingProtocol (k, priority));
+              Ptr<DVRoutingProtocol> dvRouting = DynamicCast<DVRoutingProtocol> (protocol);
               if (dvRouting)
                 {
-                  dvRouting->SetNodeAddressMap (simulatorMain.g_nodeAddressMap);
-                  dvRouting->SetAddressNodeMap (simulatorMain.g_addressNodeMap);
+                  if (mainInterfaces[i] >= 0)
+                    {
+                      dvRouting->SetNodeId (nodeId.str ());
+                      dvRouting->SetModuleName (DV_MODULE_NAME);
+                      dvRouting->SetMainInterface (mainInterfaces[i]);
+                    }
+                  dvRouting->SetNodeAddressMap (nodeAddressMap);
+                  dvRouting->SetAddressNodeMap (addressNodeMap);
                   continue;
                 }
             }
         }
-
+      profile.Mark ("routing setup");
     }
   else 
     {
@@ -1125,11 +1620,13 @@ main (int argc, char *argv[])
 
   PennSearchHelper appHelper = PennSearchHelper ();
   ApplicationContainer apps = appHelper.Install (realNodeContainer);
+  const std::map<uint32_t, Ipv4Address> &nodeAddressMap = *PennShareTable (simulatorMain.g_nodeAddressMap);
+  const std::map<Ipv4Address, uint32_t> &addressNodeMap = *PennShareTable (simulatorMain.g_addressNodeMap);
   for (uint32_t i = 0 ; i < totalNodes ; i++)
     {
       Ptr<PennSearch> application = realNodeContainer.Get(i)->GetApplication(0)->GetObject<PennSearch> ();
-      application->SetNodeAddressMap (simulatorMain.g_nodeAddressMap);
-      application->SetAddressNodeMap (simulatorMain.g_addressNodeMap);
+      application->SetNodeAddressMap (nodeAddressMap);
+      application->SetAddressNodeMap (addressNodeMap);
       if (realStack == "YES")
       {
     	  application->SetRealStack (true);
@@ -1146,6 +1643,7 @@ main (int argc, char *argv[])
       application->SetModuleName (APP_MODULE_NAME);
     }
   apps.Start (MilliSeconds (START_TIME));
+  profile.Mark ("applications");
 
   NS_LOG_INFO ("Creating script/command handler...");  
   // Start simulator main
@@ -1154,6 +1652,16 @@ main (int argc, char *argv[])
       simulatorMain.SetRealStack (true);
     }
   simulatorMain.Start (scriptFile, realNodeContainer, ndc, totalNodes, totalLinks);
+  if (!restoreFile.empty ())
+    {
+      if (realStack == "YES")
+        {
+          NS_FATAL_ERROR ("restore cannot be used with real-stack");
+        }
+      // After the applications and their chord started, which all
+      // happens at START_TIME
+      Simulator::Schedule (MilliSeconds (START_TIME) + NanoSeconds (1), &SimulatorMain::Restore, &simulatorMain, restoreFile);
+    }
 
   // Create the animation object and configure for specified output
   AnimationInterface anim;
@@ -1163,19 +1671,45 @@ main (int argc, char *argv[])
       anim.StartAnimation ();
     }
 
+  profile.Mark ("scenario");
+  if (profileStartup == "YES")
+    {
+      // the nodes, their routing protocols and applications start with
+      // the first events at START_TIME
+      Simulator::Schedule (MilliSeconds (START_TIME) + NanoSeconds (1), &StartupProfile::Mark, &profile, std::string ("node start"));
+      Simulator::Schedule (MilliSeconds (START_TIME) + NanoSeconds (1), &StartupProfile::Print, &profile);
+    }
+
   // Run the simulation
   NS_LOG_INFO ("Running Simulation...");
+  struct timeval runStart, runEnd;
+  gettimeofday (&runStart, 0);
   Simulator::Run ();
+  gettimeofday (&runEnd, 0);
+  if (!metricsFile.empty ())
+    {
+      WriteMetrics (metricsFile, (runEnd.tv_sec - runStart.tv_sec) + (runEnd.tv_usec - runStart.tv_usec) / 1e6,
+                    realNodeContainer);
+    }
   Simulator::Destroy ();
 
-  if (ipic)
-    delete[] ipic;
+  int status = 0;
+  if (hashEvents)
+    {
+      std::ostringstream hash;
+      hash << std::hex << std::setfill ('0') << std::setw (16) << EventTraceScheduler::GetHash ();
+      std::cout << "Event trace hash: " << hash.str () << std::endl;
+      if (!expectHash.empty () && expectHash != hash.str ())
+        {
+          std::cout << "Event trace hash differs from the expected " << expectHash << std::endl;
+          status = 1;
+        }
+    }
+
   if (ndc)
     delete[] ndc;
-  if (nc)
-    delete[] nc;
 
   NS_LOG_INFO ("End of Simulation.");
-  return 0;
+  return status;
 }
 